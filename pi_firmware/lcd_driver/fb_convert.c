@@ -25,10 +25,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <errno.h>
 #include <armbianio.h>
 #include <unistd.h>
 #include <sys/fcntl.h>
 #include <sys/ioctl.h>
+#include <sys/mman.h>
 #include <linux/fb.h>
 #include "fb_convert.h"
 
@@ -40,6 +42,39 @@ static const int ref_height				= 240;
 static int hfb = 0;
 static int ref_bits_per_pixel = 0;
 static int ref_size = 0;
+static int ref_line_length = 0;
+static off_t ref_offset = 0;
+
+//	mmap backend
+static unsigned char *p_mapped = NULL;
+static size_t mapped_size = 0;
+
+// --------------------------------------------------------------------
+static int fbc_map( const struct fb_var_screeninfo *p_vsi ) {
+	struct fb_fix_screeninfo fsi;
+	off_t offset;
+	void *p;
+
+	//	read() copies from the top of the framebuffer, so the offset
+	//	of the visible area is used only when it is mapped.
+	ref_offset = 0;
+	if( ioctl( hfb, FBIOGET_FSCREENINFO, &fsi ) == -1 ) {
+		return 0;
+	}
+	ref_line_length = fsi.line_length;
+	offset = (off_t) p_vsi->yoffset * ref_line_length + p_vsi->xoffset * (ref_bits_per_pixel / 8);
+	if( offset + (off_t) ref_line_length * ref_height > fsi.smem_len ) {
+		return 0;
+	}
+	p = mmap( NULL, fsi.smem_len, PROT_READ, MAP_SHARED, hfb, 0 );
+	if( p == MAP_FAILED ) {
+		return 0;
+	}
+	p_mapped	= (unsigned char*) p;
+	mapped_size	= fsi.smem_len;
+	ref_offset	= offset;
+	return 1;
+}
 
 // --------------------------------------------------------------------
 int fbc_initialize( void ) {
@@ -60,12 +95,23 @@ int fbc_initialize( void ) {
 		fprintf( stderr, "[ERROR] Non-supported size of framebuffer.\n" );
 		return 0;	// Failed
 	}
-	ref_size = ref_width * ref_height * ref_bits_per_pixel / 8;
+	if( !fbc_map( &si ) ) {
+		//	Fall back to read(), which copies the visible area into the buffer.
+		fprintf( stderr, "[WARNING] Cannot map framebuffer, use read() instead.\n" );
+		if( ref_line_length < ref_width * ref_bits_per_pixel / 8 ) {
+			ref_line_length = ref_width * ref_bits_per_pixel / 8;
+		}
+	}
+	ref_size = ref_line_length * ref_height;
 	return 1;	// Success
 }
 
 // --------------------------------------------------------------------
 void fbc_terminate( void ) {
+	if( p_mapped != NULL ) {
+		munmap( p_mapped, mapped_size );
+		p_mapped = NULL;
+	}
 	close( hfb );
 }
 
@@ -85,8 +131,40 @@ int fbc_get_size( int *p_width, int *p_height, int *p_bpp ) {
 }
 
 // --------------------------------------------------------------------
-void fbc_capture( void *p_image ) {
+int fbc_get_line_length( void ) {
 
-	lseek( hfb, 0, SEEK_SET );
-	read( hfb, p_image, ref_size );
+	return ref_line_length;
+}
+
+// --------------------------------------------------------------------
+int fbc_is_mapped( void ) {
+
+	return p_mapped != NULL;
+}
+
+// --------------------------------------------------------------------
+const void *fbc_capture( void *p_image ) {
+	unsigned char *p = (unsigned char*) p_image;
+	ssize_t r;
+	int size;
+
+	if( p_mapped != NULL ) {
+		return p_mapped + ref_offset;
+	}
+	if( lseek( hfb, 0, SEEK_SET ) == (off_t) -1 ) {
+		return p_image;
+	}
+	//	The driver may return less than asked for. Read the rest, and
+	//	on an error keep the rest of the last captured image.
+	for( size = ref_size; size > 0; size -= (int) r, p += r ) {
+		r = read( hfb, p, size );
+		if( r == -1 && errno == EINTR ) {
+			r = 0;
+			continue;
+		}
+		if( r <= 0 ) {
+			break;
+		}
+	}
+	return p_image;
 }
@@ -53,15 +53,34 @@ void fbc_terminate( void );
 // --------------------------------------------------------------------
 int fbc_get_size( int *p_width, int *p_height, int *p_bpp );
 
+// --------------------------------------------------------------------
+//	fbc_get_line_length
+//	input)
+//		none
+//	output)
+//		distance between the lines of the captured image (bytes).
+// --------------------------------------------------------------------
+int fbc_get_line_length( void );
+
+// --------------------------------------------------------------------
+//	fbc_is_mapped
+//	input)
+//		none
+//	output)
+//		0 .... The framebuffer is read by read(). fbc_capture() requires p_image.
+//		!0 ... The framebuffer is mapped. fbc_capture() does not use p_image.
+// --------------------------------------------------------------------
+int fbc_is_mapped( void );
 
 // --------------------------------------------------------------------
 //	fbc_capture
 //	input)
 //		p_image ... Area for storing frame buffer contents.
-//					400x240, 32bpp (
+//					400x240, 32bpp or 16bpp, fbc_get_size() bytes.
 //	output)
-//		*p_image .. result
+//		address of the captured image.
+//		It points into the mapped framebuffer, or is p_image when read() is used.
 // --------------------------------------------------------------------
-void fbc_capture( void *p_image );
+const void *fbc_capture( void *p_image );
 
 #endif
@@ -0,0 +1,215 @@
+// --------------------------------------------------------------------
+// Frame scheduler for sangria_lcd
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <linux/input.h>
+#include "frame_scheduler.h"
+
+#define MAX_INPUT_DEVICES		8
+#define IDLE_FRAMES				8			//	unchanged frames before starting the backoff
+
+static int64_t		min_interval	= 1000000000 / 60;	//	nanoseconds
+static int64_t		max_interval	= 500000000;		//	nanoseconds
+static int64_t		interval		= 0;
+static int64_t		last_wake		= 0;
+static uint32_t		last_hash		= 0;
+static int			same_count		= 0;
+
+static struct pollfd input_fds[ MAX_INPUT_DEVICES ];
+static int			input_count		= 0;
+
+//	statistics
+static int64_t		start_time		= 0;
+static int64_t		busy_total		= 0;
+static int64_t		busy_max		= 0;
+static unsigned long long frames			= 0;
+static unsigned long long changed_frames	= 0;
+static unsigned long long input_wakeups		= 0;
+
+// --------------------------------------------------------------------
+static int64_t _get_time( void ) {
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void _open_input_devices( void ) {
+	char s_name[ 32 ];
+	int i, h;
+
+	input_count = 0;
+	for( i = 0; i < 32 && input_count < MAX_INPUT_DEVICES; i++ ) {
+		snprintf( s_name, sizeof(s_name), "/dev/input/event%d", i );
+		h = open( s_name, O_RDONLY | O_NONBLOCK );
+		if( h == -1 ) {
+			continue;
+		}
+		input_fds[ input_count ].fd		= h;
+		input_fds[ input_count ].events	= POLLIN;
+		input_count++;
+	}
+}
+
+// --------------------------------------------------------------------
+static void _drain_input_devices( void ) {
+	struct input_event events[ 16 ];
+	int i;
+
+	for( i = 0; i < input_count; i++ ) {
+		if( input_fds[i].revents & (POLLERR | POLLHUP | POLLNVAL) ) {
+			//	The device has been removed.
+			close( input_fds[i].fd );
+			input_fds[i].fd = -1;
+		}
+		else if( input_fds[i].revents & POLLIN ) {
+			while( read( input_fds[i].fd, events, sizeof(events) ) > 0 ) {
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+void fsch_initialize( int max_fps, int idle_ms ) {
+
+	if( max_fps > 0 ) {
+		min_interval = 1000000000 / max_fps;
+	}
+	if( idle_ms > 0 ) {
+		max_interval = (int64_t) idle_ms * 1000000;
+	}
+	if( max_interval < min_interval ) {
+		max_interval = min_interval;
+	}
+	interval	= min_interval;
+	last_wake	= 0;
+	same_count	= 0;
+	start_time	= _get_time();
+	_open_input_devices();
+}
+
+// --------------------------------------------------------------------
+void fsch_terminate( void ) {
+	int i;
+
+	for( i = 0; i < input_count; i++ ) {
+		if( input_fds[i].fd != -1 ) {
+			close( input_fds[i].fd );
+		}
+	}
+	input_count = 0;
+}
+
+// --------------------------------------------------------------------
+void fsch_wait( void ) {
+	struct timespec ts;
+	int64_t now, busy, wait;
+
+	now = _get_time();
+	if( last_wake != 0 ) {
+		busy = now - last_wake;
+		busy_total += busy;
+		if( busy > busy_max ) {
+			busy_max = busy;
+		}
+		wait = last_wake + interval - now;
+	}
+	else {
+		wait = 0;
+	}
+
+	if( wait > 0 ) {
+		ts.tv_sec	= (time_t)( wait / 1000000000 );
+		ts.tv_nsec	= (long)( wait % 1000000000 );
+		if( input_count ) {
+			if( ppoll( input_fds, input_count, &ts, NULL ) > 0 ) {
+				//	Wake up quickly, because the screen will be updated by this input.
+				_drain_input_devices();
+				interval	= min_interval;
+				same_count	= 0;
+				input_wakeups++;
+			}
+		}
+		else {
+			nanosleep( &ts, NULL );
+		}
+	}
+	last_wake = _get_time();
+}
+
+// --------------------------------------------------------------------
+int fsch_update( uint32_t hash ) {
+
+	frames++;
+	if( hash != last_hash || frames == 1 ) {
+		last_hash	= hash;
+		interval	= min_interval;
+		same_count	= 0;
+		changed_frames++;
+		return 1;
+	}
+	same_count++;
+	if( same_count >= IDLE_FRAMES ) {
+		interval = interval * 2;
+		if( interval > max_interval ) {
+			interval = max_interval;
+		}
+	}
+	return 0;
+}
+
+// --------------------------------------------------------------------
+uint32_t fsch_hash( const void *p_image, int size ) {
+	const uint32_t *p = (const uint32_t*) p_image;
+	uint32_t hash = 2166136261u;
+	int i;
+
+	//	FNV-1a (32bit word version)
+	for( i = 0; i < size; i += 4 ) {
+		hash = (hash ^ *(p++)) * 16777619u;
+	}
+	return hash;
+}
+
+// --------------------------------------------------------------------
+void fsch_print_statistics( FILE *p_file ) {
+	int64_t elapsed;
+	double busy_avg, load;
+
+	elapsed		= _get_time() - start_time;
+	busy_avg	= frames ? (double) busy_total / frames / 1000000. : 0.;
+	load		= elapsed ? (double) busy_total * 100. / elapsed : 0.;
+
+	fprintf( p_file, "[STATISTICS] frames: %llu (changed: %llu, unchanged: %llu), input wake-ups: %llu\n",
+			frames, changed_frames, frames - changed_frames, input_wakeups );
+	fprintf( p_file, "[STATISTICS] interval: %.1f ms, busy: avg %.2f ms / max %.2f ms, load: %.1f%%\n",
+			(double) interval / 1000000., busy_avg, (double) busy_max / 1000000., load );
+}
@@ -0,0 +1,98 @@
+// --------------------------------------------------------------------
+// Frame scheduler for sangria_lcd
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#ifndef __FRAME_SCHEDULER_H__
+#define __FRAME_SCHEDULER_H__
+
+#include <stdio.h>
+#include <stdint.h>
+
+// --------------------------------------------------------------------
+//	fsch_initialize
+//	input)
+//		max_fps ...... maximum frame rate (frames per second)
+//		idle_ms ...... maximum capture interval while the screen is idle (milliseconds)
+//	output)
+//		none
+//	comment)
+//		The input devices (/dev/input/event*) are watched so that the
+//		capture rate returns to max_fps as soon as a key is pressed.
+// --------------------------------------------------------------------
+void fsch_initialize( int max_fps, int idle_ms );
+
+// --------------------------------------------------------------------
+//	fsch_terminate
+//	input)
+//		none
+//	output)
+//		none
+// --------------------------------------------------------------------
+void fsch_terminate( void );
+
+// --------------------------------------------------------------------
+//	fsch_wait
+//	input)
+//		none
+//	output)
+//		none
+//	comment)
+//		Sleeps until the next frame should be captured.
+//		Returns early on input events or signals.
+// --------------------------------------------------------------------
+void fsch_wait( void );
+
+// --------------------------------------------------------------------
+//	fsch_update
+//	input)
+//		hash ......... hash value of the captured frame
+//	output)
+//		0 ............ The frame is the same as the previous one.
+//		!0 ........... The frame has been changed.
+//	comment)
+//		The capture interval is extended while the frames are the same,
+//		and returns to the shortest one when the frame is changed.
+//		Equal hashes do not prove equal frames. Compare the frames before
+//		skipping one; the hash is meant for the backoff only.
+// --------------------------------------------------------------------
+int fsch_update( uint32_t hash );
+
+// --------------------------------------------------------------------
+//	fsch_hash
+//	input)
+//		p_image ...... image data
+//		size ......... size of image data (bytes, multiple of 4)
+//	output)
+//		hash value
+// --------------------------------------------------------------------
+uint32_t fsch_hash( const void *p_image, int size );
+
+// --------------------------------------------------------------------
+//	fsch_print_statistics
+//	input)
+//		p_file ....... output stream
+//	output)
+//		none
+// --------------------------------------------------------------------
+void fsch_print_statistics( FILE *p_file );
+
+#endif
@@ -0,0 +1,334 @@
+// --------------------------------------------------------------------
+// Shared memory frame receiver for sangria_lcd
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+#include <time.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <grp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "sangria_shm.h"
+#include "frame_shm.h"
+
+#define LINE_BYTES		(SANGRIA_SHM_WIDTH / 8)
+
+static SANGRIA_SHM_T *p_shm			= NULL;
+static int64_t		min_interval	= 1000000000 / 60;	//	nanoseconds
+static int64_t		last_wake		= 0;
+static uint32_t		last_frame		= 0;
+static uint32_t		front			= 2;		//	slot owned by sangria_lcd
+
+//	the last frame of the client, converted to 1bpp
+static unsigned char client_bitmap[ LINE_BYTES * SANGRIA_SHM_HEIGHT ];
+static int32_t		client_pid		= 0;
+static int			is_valid		= 0;		//	client_bitmap is the frame last_published
+static uint32_t		last_published	= 0;
+
+//	statistics
+static unsigned long long client_frames	= 0;
+static unsigned long long detaches		= 0;
+static unsigned long long converted_lines	= 0;
+
+// --------------------------------------------------------------------
+static int64_t _get_time( void ) {
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	Same conversion as the draw thread of the former sangria_glib.
+//
+static void _convert_8bpp( const uint8_t *p_src, unsigned char *p_dest, int lines ) {
+	int i, bit;
+	unsigned char d;
+
+	for( i = 0; i < LINE_BYTES * lines; i++ ) {
+		d = 0;
+		for( bit = 0; bit < 8; bit++ ) {
+			d = (d << 1) | (*(p_src++) < 128);
+		}
+		*(p_dest++) = d;
+	}
+}
+
+// --------------------------------------------------------------------
+//	output)
+//		0 ..... The history has been overwritten, all lines must be converted.
+//		!0 .... *p_top ... *p_bottom are the lines changed after last_published.
+//
+static int _get_dirty_lines( uint32_t published, int32_t *p_top, int32_t *p_bottom ) {
+	const SANGRIA_SHM_LINES_T *p_lines;
+	uint32_t n;
+
+	if( !is_valid || (published - last_published) > SANGRIA_SHM_HISTORY ) {
+		return 0;
+	}
+	*p_top		= SANGRIA_SHM_HEIGHT;
+	*p_bottom	= -1;
+	for( n = last_published + 1; n != published + 1; n++ ) {
+		p_lines = &p_shm->dirty[ n % SANGRIA_SHM_HISTORY ];
+		if( p_lines->top > p_lines->bottom ) {
+			continue;
+		}
+		if( *p_top > p_lines->top ) {
+			*p_top = p_lines->top;
+		}
+		if( *p_bottom < p_lines->bottom ) {
+			*p_bottom = p_lines->bottom;
+		}
+	}
+	if( *p_top < 0 ) {
+		*p_top = 0;
+	}
+	if( *p_bottom >= SANGRIA_SHM_HEIGHT ) {
+		*p_bottom = SANGRIA_SHM_HEIGHT - 1;
+	}
+	return 1;
+}
+
+// --------------------------------------------------------------------
+int fshm_initialize( int max_fps ) {
+	struct group *p_group;
+	int h;
+
+	if( max_fps > 0 ) {
+		min_interval = 1000000000 / max_fps;
+	}
+
+	//	A new object every time, so nobody keeps a mapping of an old one
+	//	with other permissions.
+	shm_unlink( SANGRIA_SHM_NAME );
+	h = shm_open( SANGRIA_SHM_NAME, O_RDWR | O_CREAT | O_EXCL, 0600 );
+	if( h == -1 ) {
+		fprintf( stderr, "[ERROR] Cannot create shared memory %s.\n", SANGRIA_SHM_NAME );
+		return 0;
+	}
+	//	sangria_lcd runs as root. The clients run as normal users, and
+	//	they have to be in SANGRIA_SHM_GROUP. umask must not limit the mode.
+	p_group = getgrnam( SANGRIA_SHM_GROUP );
+	if( p_group != NULL && fchown( h, (uid_t) -1, p_group->gr_gid ) == 0 ) {
+		fchmod( h, 0660 );
+	}
+	else {
+		fprintf( stderr, "[WARNING] No group %s, only root can use sangria_glib.\n", SANGRIA_SHM_GROUP );
+	}
+	if( ftruncate( h, sizeof(SANGRIA_SHM_T) ) == -1 ) {
+		fprintf( stderr, "[ERROR] Cannot allocate shared memory.\n" );
+		close( h );
+		return 0;
+	}
+	p_shm = (SANGRIA_SHM_T*) mmap( NULL, sizeof(SANGRIA_SHM_T), PROT_READ | PROT_WRITE, MAP_SHARED, h, 0 );
+	close( h );
+	if( p_shm == MAP_FAILED ) {
+		fprintf( stderr, "[ERROR] Cannot map shared memory.\n" );
+		p_shm = NULL;
+		return 0;
+	}
+	memset( p_shm, 0, sizeof(SANGRIA_SHM_T) );
+	p_shm->version	= SANGRIA_SHM_VERSION;
+	//	slot 0 is the back slot of the first client
+	front			= 2;
+	p_shm->middle	= 1;
+	p_shm->front	= front;
+	//	The clients check magic at last, so they never see a half initialized one.
+	__atomic_store_n( &p_shm->magic, SANGRIA_SHM_MAGIC, __ATOMIC_RELEASE );
+	return 1;
+}
+
+// --------------------------------------------------------------------
+void fshm_terminate( void ) {
+
+	if( p_shm == NULL ) {
+		return;
+	}
+	munmap( p_shm, sizeof(SANGRIA_SHM_T) );
+	shm_unlink( SANGRIA_SHM_NAME );
+	p_shm = NULL;
+}
+
+// --------------------------------------------------------------------
+int fshm_is_attached( void ) {
+	int32_t pid;
+
+	if( p_shm == NULL ) {
+		return 0;
+	}
+	pid = __atomic_load_n( &p_shm->client_pid, __ATOMIC_ACQUIRE );
+	if( pid == 0 ) {
+		return 0;
+	}
+	if( kill( pid, 0 ) == -1 && errno == ESRCH ) {
+		//	The client has exited without sangria_terminate().
+		__atomic_store_n( &p_shm->is_published, 0, __ATOMIC_RELEASE );
+		__atomic_compare_exchange_n( &p_shm->client_pid, &pid, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+		detaches++;
+		return 0;
+	}
+	return __atomic_load_n( &p_shm->is_published, __ATOMIC_ACQUIRE );
+}
+
+// --------------------------------------------------------------------
+void fshm_wait( int timeout_ms ) {
+	struct timespec ts;
+	int64_t wait;
+	uint32_t frame;
+
+	if( last_wake != 0 ) {
+		wait = last_wake + min_interval - _get_time();
+		if( wait > 0 ) {
+			ts.tv_sec	= (time_t)( wait / 1000000000 );
+			ts.tv_nsec	= (long)( wait % 1000000000 );
+			nanosleep( &ts, NULL );
+		}
+	}
+	//	The client wakes up the futex only while waiting is set. Both sides
+	//	store and then load in sequential consistency, so no wake is lost.
+	__atomic_store_n( &p_shm->waiting, 1, __ATOMIC_SEQ_CST );
+	frame = __atomic_load_n( &p_shm->frame, __ATOMIC_SEQ_CST );
+	if( frame == last_frame ) {
+		ts.tv_sec	= timeout_ms / 1000;
+		ts.tv_nsec	= (long)( timeout_ms % 1000 ) * 1000000;
+		syscall( SYS_futex, &p_shm->frame, FUTEX_WAIT, frame, &ts, NULL, 0 );
+		frame = __atomic_load_n( &p_shm->frame, __ATOMIC_ACQUIRE );
+	}
+	__atomic_store_n( &p_shm->waiting, 0, __ATOMIC_RELAXED );
+	last_frame	= frame;
+	last_wake	= _get_time();
+}
+
+// --------------------------------------------------------------------
+//	The front slot is owned by sangria_lcd, so it cannot be changed while it is read.
+//
+static void _convert_front( void ) {
+	const SANGRIA_SHM_SLOT_T *p_slot = &p_shm->slot[ front ];
+	int32_t top, bottom;
+	uint32_t published;
+	int is_history;
+
+	published = p_slot->published;
+	is_history = _get_dirty_lines( published, &top, &bottom );
+	__atomic_thread_fence( __ATOMIC_ACQUIRE );
+	if( is_history && (__atomic_load_n( &p_shm->published, __ATOMIC_RELAXED ) - last_published) > SANGRIA_SHM_HISTORY ) {
+		//	The client has overwritten the history while it was read.
+		is_history = 0;
+	}
+	if( !is_history ) {
+		top		= 0;
+		bottom	= SANGRIA_SHM_HEIGHT - 1;
+	}
+	if( top <= bottom ) {
+		if( p_slot->format == SANGRIA_SHM_FORMAT_1BPP ) {
+			memcpy( client_bitmap + top * LINE_BYTES, p_slot->image + top * LINE_BYTES, (bottom - top + 1) * LINE_BYTES );
+		}
+		else {
+			_convert_8bpp( p_slot->image + top * SANGRIA_SHM_WIDTH, client_bitmap + top * LINE_BYTES, bottom - top + 1 );
+		}
+		converted_lines += bottom - top + 1;
+	}
+	last_published	= published;
+	is_valid		= 1;
+}
+
+// --------------------------------------------------------------------
+int fshm_read( unsigned char *p_bitmap ) {
+	int32_t pid;
+	uint32_t middle;
+
+	if( p_shm == NULL ) {
+		return 0;
+	}
+	pid = __atomic_load_n( &p_shm->client_pid, __ATOMIC_ACQUIRE );
+	if( pid == 0 || !__atomic_load_n( &p_shm->is_published, __ATOMIC_ACQUIRE ) ) {
+		return 0;
+	}
+	if( pid != client_pid ) {
+		//	The history belongs to another client.
+		client_pid	= pid;
+		is_valid	= 0;
+	}
+	middle = __atomic_load_n( &p_shm->middle, __ATOMIC_ACQUIRE );
+	if( middle & SANGRIA_SHM_FRESH ) {
+		//	take the newest frame, and give the last one back to the client
+		middle	= __atomic_exchange_n( &p_shm->middle, front, __ATOMIC_ACQ_REL );
+		if( (middle & SANGRIA_SHM_SLOT_MASK) >= SANGRIA_SHM_SLOTS ) {
+			//	The shared memory is written by the clients. A broken slot
+			//	index is not read, and the last frame is not shown again as
+			//	a new one. middle gets the slot next to front, which the
+			//	client takes as its back slot.
+			__atomic_store_n( &p_shm->middle, (front + 1) % SANGRIA_SHM_SLOTS, __ATOMIC_RELEASE );
+			is_valid = 0;
+			return 0;
+		}
+		front	= middle & SANGRIA_SHM_SLOT_MASK;
+		__atomic_store_n( &p_shm->front, front, __ATOMIC_RELEASE );
+		__atomic_add_fetch( &p_shm->presented, 1, __ATOMIC_RELAXED );
+		_convert_front();
+	}
+	else if( !is_valid ) {
+		_convert_front();
+	}
+	memcpy( p_bitmap, client_bitmap, sizeof(client_bitmap) );
+	client_frames++;
+	return 1;
+}
+
+// --------------------------------------------------------------------
+unsigned int fshm_get_frame_id( void ) {
+
+	//	published starts from 0, so the ID is never 0.
+	return is_valid ? last_published + 1 : 0;
+}
+
+// --------------------------------------------------------------------
+void fshm_notify_transferred( unsigned int frame_id ) {
+
+	if( p_shm == NULL || frame_id == 0 ) {
+		return;
+	}
+	//	Same as _wake_up_lcd() of sangria_glib, in the other direction.
+	__atomic_store_n( &p_shm->transferred, frame_id, __ATOMIC_SEQ_CST );
+	if( __atomic_load_n( &p_shm->transfer_waiting, __ATOMIC_SEQ_CST ) ) {
+		syscall( SYS_futex, &p_shm->transferred, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+	}
+}
+
+// --------------------------------------------------------------------
+void fshm_print_statistics( FILE *p_file ) {
+	int32_t pid;
+
+	pid = (p_shm == NULL) ? 0 : p_shm->client_pid;
+	fprintf( p_file, "[STATISTICS] client: pid %d, %llu frames read, %u presented, %u dropped, %llu detached, %.1f lines converted per frame\n",
+			(int) pid, client_frames, (p_shm == NULL) ? 0 : p_shm->presented, (p_shm == NULL) ? 0 : p_shm->dropped,
+			detaches, client_frames ? (double) converted_lines / client_frames : 0. );
+}
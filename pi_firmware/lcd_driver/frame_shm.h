@@ -0,0 +1,123 @@
+// --------------------------------------------------------------------
+// Shared memory frame receiver for sangria_lcd
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#ifndef __FRAME_SHM_H__
+#define __FRAME_SHM_H__
+
+#include <stdio.h>
+
+// --------------------------------------------------------------------
+//	fshm_initialize
+//	input)
+//		max_fps ...... maximum frame rate (frames per second)
+//	output)
+//		0 ..... Failed.
+//		!0 .... Success.
+//	comment)
+//		Creates the shared memory of sangria_shm.h. Root and the members
+//		of SANGRIA_SHM_GROUP can open it, so the clients need neither root
+//		nor SPI access. An old one is removed first.
+// --------------------------------------------------------------------
+int fshm_initialize( int max_fps );
+
+// --------------------------------------------------------------------
+//	fshm_terminate
+//	input)
+//		none
+//	output)
+//		none
+// --------------------------------------------------------------------
+void fshm_terminate( void );
+
+// --------------------------------------------------------------------
+//	fshm_is_attached
+//	input)
+//		none
+//	output)
+//		0 ..... No client, show /dev/fb0.
+//		!0 .... A client has published a frame.
+//	comment)
+//		A client that has exited without sangria_terminate() is detached here.
+// --------------------------------------------------------------------
+int fshm_is_attached( void );
+
+// --------------------------------------------------------------------
+//	fshm_wait
+//	input)
+//		timeout_ms ... maximum waiting time (milliseconds)
+//	output)
+//		none
+//	comment)
+//		Sleeps until the client publishes a new frame, but not shorter
+//		than the interval of max_fps. Returns early on signals.
+// --------------------------------------------------------------------
+void fshm_wait( int timeout_ms );
+
+// --------------------------------------------------------------------
+//	fshm_read
+//	input)
+//		p_bitmap ..... area for storing the 1bpp image (50 x 240 bytes)
+//	output)
+//		0 ..... No client frame. *p_bitmap is not changed.
+//		!0 .... *p_bitmap is the latest frame of the client.
+//	comment)
+//		The front slot is owned by sangria_lcd while it is read, so no
+//		retry is needed and a torn frame is never returned. If middle
+//		has a broken slot index, 0 is returned until the next frame.
+// --------------------------------------------------------------------
+int fshm_read( unsigned char *p_bitmap );
+
+// --------------------------------------------------------------------
+//	fshm_get_frame_id
+//	input)
+//		none
+//	output)
+//		0 ..... No client frame has been read.
+//		!0 .... ID of the frame stored by the last fshm_read().
+//	comment)
+//		Pass it to fshm_notify_transferred() after the frame is sent.
+// --------------------------------------------------------------------
+unsigned int fshm_get_frame_id( void );
+
+// --------------------------------------------------------------------
+//	fshm_notify_transferred
+//	input)
+//		frame_id ..... ID from fshm_get_frame_id()
+//	output)
+//		none
+//	comment)
+//		Tells the client that the frame is on the display
+//		(sangria_wait_transfer() returns).
+// --------------------------------------------------------------------
+void fshm_notify_transferred( unsigned int frame_id );
+
+// --------------------------------------------------------------------
+//	fshm_print_statistics
+//	input)
+//		p_file ....... output stream
+//	output)
+//		none
+// --------------------------------------------------------------------
+void fshm_print_statistics( FILE *p_file );
+
+#endif
@@ -0,0 +1,16 @@
+#	NEON kernels (*_neon.c) are selected at run time, so they are built even
+#	for ARMv6 (Pi Zero). They are enabled by the target of the compiler, not
+#	by "uname -m", which reports aarch64 or armv8l for a 32bit userland on a
+#	64bit kernel. SANGRIA_HAVE_NEON tells the C code to link the kernels.
+#	Included by lcd_driver/Makefile and sangria_glib/Makefile.
+NEON_TARGET := $(shell $(CC) -dumpmachine)
+ifneq ($(filter aarch64-% arm64-%,$(NEON_TARGET)),)
+CFLAGS += -DSANGRIA_HAVE_NEON
+else ifneq ($(filter arm%,$(NEON_TARGET)),)
+CFLAGS += -DSANGRIA_HAVE_NEON
+ifneq ($(filter %hf,$(NEON_TARGET)),)
+NEON_CFLAGS = -march=armv7-a -mfpu=neon -mfloat-abi=hard
+else
+NEON_CFLAGS = -march=armv7-a -mfpu=neon -mfloat-abi=softfp
+endif
+endif
@@ -22,6 +22,7 @@
 //	DEALINGS IN THE SOFTWARE.
 // ------------------------------------------------------------------------
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
@@ -30,13 +31,68 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/sem.h>
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
 
 #include "sharp_memory_display_driver.h"
 #include "sangria_effects.h"
 #include "fb_convert.h"
+#include "frame_scheduler.h"
+#include "smdd_convert.h"
+#include "vcom_toggler.h"
+#include "frame_shm.h"
 
 //static int hspi;
 static volatile int is_active = 1;
+static volatile int is_report_request = 0;
+
+//	statistics of the differential transfer mode
+static unsigned long long lines_sent = 0;
+static unsigned long long lines_skipped = 0;
+
+//	time budget of one frame (usec)
+static int frame_budget = 1000000 / 60;
+
+//	maximum capture interval while the screen is idle (msec)
+static int idle_time = 500;
+
+//	pipeline mode
+#define RING_SIZE		3			//	converting, waiting and transferring
+
+//	interval to check the stop request while waiting for the display (nsec)
+#define LOCK_POLL_TIME	100000000
+
+typedef struct {
+	unsigned long long count;
+	unsigned long long total;		//	nsec
+	unsigned long long max;			//	nsec
+} LATENCY_T;
+
+typedef struct {
+	unsigned char	*p_bitmap;
+	int				is_changed;		//	changed since the last frame that was passed to the transfer stage
+	long long		capture_time;	//	time when the capture has started (nsec)
+	long long		ready_time;		//	time when the conversion has finished (nsec)
+	unsigned int	frame_id;		//	fshm_get_frame_id() of the client frame, 0: captured from /dev/fb0
+} FRAME_T;
+
+static FRAME_T ring[ RING_SIZE ];
+static int ready_index = -1;
+static int busy_index = -1;
+static volatile int is_pipeline_active = 0;
+static pthread_mutex_t ring_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ring_cond = PTHREAD_COND_INITIALIZER;
+
+static LATENCY_T capture_latency;
+static LATENCY_T convert_latency;
+static LATENCY_T queue_latency;
+static LATENCY_T transfer_latency;
+static LATENCY_T total_latency;
+static unsigned long long pipeline_frames = 0;
+static unsigned long long pipeline_dropped = 0;
+static unsigned long long pipeline_sent = 0;
+static long long pipeline_start = 0;
 
  union semun {
 	int val;
@@ -50,6 +106,11 @@ static void shutdown_handler( int signal ) {
 	is_active = 0;
 }
 
+// --------------------------------------------------------------------
+static void report_handler( int signal ) {
+	is_report_request = 1;
+}
+
 // --------------------------------------------------------------------
 static void set_shutdown_handler( void ) {
 	struct sigaction sa;
@@ -58,10 +119,77 @@ static void set_shutdown_handler( void ) {
 	sigemptyset( &sa.sa_mask );
 	sa.sa_flags = 0;
 	sigaction( SIGINT, &sa, NULL );
+
+	sa.sa_handler = report_handler;
+	sigaction( SIGUSR1, &sa, NULL );
+}
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void add_latency( LATENCY_T *p_latency, long long t ) {
+
+	p_latency->count++;
+	p_latency->total += t;
+	if( p_latency->max < (unsigned long long) t ) {
+		p_latency->max = t;
+	}
+}
+
+// --------------------------------------------------------------------
+static void print_latency( const char *p_name, const LATENCY_T *p_latency ) {
+	unsigned long long average;
+
+	average = p_latency->count ? (p_latency->total / p_latency->count / 1000) : 0;
+	fprintf( stderr, "[STATISTICS]   %-9s average %llu.%03llu msec, max %llu.%03llu msec\n", p_name,
+		average / 1000, average % 1000, p_latency->max / 1000000, (p_latency->max / 1000) % 1000 );
 }
 
 // --------------------------------------------------------------------
-static void command_line_options( int argc, char *argv[], int *p_do_splash ) {
+static void print_pipeline_statistics( void ) {
+	long long elapsed;
+
+	pthread_mutex_lock( &ring_mutex );
+	elapsed = get_nsec() - pipeline_start;
+	fprintf( stderr, "[STATISTICS] pipeline: %.1f fps processed, %.1f fps sent, %llu frames dropped\n",
+		pipeline_frames * 1000000000.0 / elapsed, pipeline_sent * 1000000000.0 / elapsed, pipeline_dropped );
+	print_latency( "capture", &capture_latency );
+	print_latency( "convert", &convert_latency );
+	print_latency( "queue", &queue_latency );
+	print_latency( "transfer", &transfer_latency );
+	print_latency( "total", &total_latency );
+	pthread_mutex_unlock( &ring_mutex );
+}
+
+// --------------------------------------------------------------------
+static void print_statistics( int do_diff ) {
+	int average, max;
+
+	fsch_print_statistics( stderr );
+	vcom_print_statistics( stderr );
+	fshm_print_statistics( stderr );
+	fprintf( stderr, "[STATISTICS] converter: %s\n", smdd_get_converter_info() );
+	if( smdd_get_convert_time( &average, &max ) ) {
+		fprintf( stderr, "[STATISTICS] convert time: average %d.%03d msec, max %d.%03d msec, budget %d.%03d msec (%s)\n",
+			average / 1000, average % 1000, max / 1000, max % 1000, frame_budget / 1000, frame_budget % 1000,
+			(max <= frame_budget) ? "OK" : "OVER" );
+	}
+	if( do_diff ) {
+		fprintf( stderr, "[STATISTICS] differential transfer: %llu lines sent, %llu lines skipped\n", lines_sent, lines_skipped );
+	}
+	if( pipeline_start ) {
+		print_pipeline_statistics();
+	}
+}
+
+// --------------------------------------------------------------------
+static void command_line_options( int argc, char *argv[], int *p_do_splash, int *p_do_diff, int *p_do_pipeline, int *p_max_fps, int *p_idle_ms, int *p_vcom_hz ) {
 	int i;
 
 	// analyze the command-line options
@@ -69,9 +197,36 @@ static void command_line_options( int argc, char *argv[], int *p_do_splash ) {
 		if( strcmp( argv[i], "-nosplash" ) == 0 ) {
 			*p_do_splash = 0;
 		}
+		else if( strcmp( argv[i], "-diff" ) == 0 ) {
+			*p_do_diff = 1;
+		}
+		else if( strcmp( argv[i], "-pipeline" ) == 0 ) {
+			*p_do_pipeline = 1;
+		}
+		else if( strcmp( argv[i], "-nosimd" ) == 0 ) {
+			smdd_set_simd( 0 );
+		}
 		else if( strcmp( argv[i], "-invert" ) == 0 ) {
 			smdd_set_invert( 1 );
 		}
+		else if( strcmp( argv[i], "-fps" ) == 0 && (i + 1) < argc ) {
+			i++;
+			*p_max_fps = atoi( argv[i] );
+		}
+		else if( strcmp( argv[i], "-vcom" ) == 0 && (i + 1) < argc ) {
+			i++;
+			*p_vcom_hz = atoi( argv[i] );
+		}
+		else if( strcmp( argv[i], "-idle" ) == 0 && (i + 1) < argc ) {
+			i++;
+			*p_idle_ms = atoi( argv[i] );
+		}
+		else if( strcmp( argv[i], "-dither" ) == 0 && (i + 1) < argc ) {
+			i++;
+			if( !smdd_set_dither( smdd_find_dither( argv[i] ) ) ) {
+				fprintf( stderr, "[WARNING] Unknown dither mode %s.\n", argv[i] );
+			}
+		}
 		else if( strcmp( argv[i], "-thresold" ) == 0 && (i + 1) < argc ) {
 			i++;
 			smdd_set_threshold( atoi( argv[i] ) );
@@ -83,24 +238,317 @@ static void command_line_options( int argc, char *argv[], int *p_do_splash ) {
 }
 
 // --------------------------------------------------------------------
-static void main_process( int sem_id, uint32_t *p_capture, unsigned char *p_bitmap ) {
+//	input)
+//		p_is_running .. the wait for another process is given up when it becomes 0
+//	output)
+//		0 ..... Failed.
+//		!0 .... Locked. *p_is_refresh is set, if another process has used the display.
+static int lock_display( int sem_id, int *p_is_refresh, volatile int *p_is_running ) {
 	struct sembuf lock_operations;
-	struct sembuf unlock_operations;
+	struct sembuf try_lock_operations;
+	struct timespec poll_time;
 
 	lock_operations.sem_num = 0;
 	lock_operations.sem_op = -1;
 	lock_operations.sem_flg = SEM_UNDO;
+	try_lock_operations.sem_num = 0;
+	try_lock_operations.sem_op = -1;
+	try_lock_operations.sem_flg = SEM_UNDO | IPC_NOWAIT;
+
+	if( semop( sem_id, &try_lock_operations, 1 ) == -1 ) {
+		if( errno != EAGAIN ) {
+			return 0;
+		}
+		//	Another process is drawing on the display, so its contents are unknown after that.
+		poll_time.tv_sec	= 0;
+		poll_time.tv_nsec	= LOCK_POLL_TIME;
+		while( semtimedop( sem_id, &lock_operations, 1, &poll_time ) == -1 ) {
+			if( (errno != EAGAIN && errno != EINTR) || !__atomic_load_n( p_is_running, __ATOMIC_ACQUIRE ) ) {
+				return 0;
+			}
+		}
+		*p_is_refresh = 1;
+	}
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static void unlock_display( int sem_id ) {
+	struct sembuf unlock_operations;
+
 	unlock_operations.sem_num = 0;
 	unlock_operations.sem_op = 1;
 	unlock_operations.sem_flg = SEM_UNDO;
+	semop( sem_id, &unlock_operations, 1 );
+}
 
-	while( is_active ) {
-		semop( sem_id, &lock_operations, 1 );
-		fbc_capture( p_capture );
-		smdd_convert_image( p_capture, p_bitmap );
+// --------------------------------------------------------------------
+//	output)
+//		0 ..... Nothing is sent.
+//		!0 .... Sent.
+static int transfer_frame( unsigned char *p_bitmap, unsigned char *p_last, int height, int is_changed, int *p_is_refresh ) {
+	int lines;
+
+	if( *p_is_refresh ) {
+		smdd_transfer_bitmap( p_bitmap );
+		if( p_last != NULL ) {
+			memcpy( p_last, p_bitmap, height * 50 );
+			lines_sent += height;
+		}
+		*p_is_refresh = 0;
+		return 1;
+	}
+	if( !is_changed ) {
+		//	The display already shows this frame.
+		if( p_last != NULL ) {
+			lines_skipped += height;
+		}
+		return 0;
+	}
+	if( p_last == NULL ) {
 		smdd_transfer_bitmap( p_bitmap );
-		semop( sem_id, &unlock_operations, 1 );
+		return 1;
+	}
+	lines = smdd_transfer_bitmap_diff( p_bitmap, p_last );
+	lines_sent += lines;
+	lines_skipped += height - lines;
+	return lines != 0;
+}
+
+// --------------------------------------------------------------------
+//	The hash drives only the idle backoff of the scheduler. A frame is
+//	skipped only if it is the same as the previous one byte by byte, so
+//	a hash collision cannot leave the display stale.
+//
+static int is_frame_changed( const unsigned char *p_bitmap, int size ) {
+	static unsigned char previous[ 50 * 240 ];
+	int is_changed;
+
+	is_changed = fsch_update( fsch_hash( p_bitmap, size ) );
+	if( !is_changed && (size > (int) sizeof(previous) || memcmp( p_bitmap, previous, size ) != 0) ) {
+		is_changed = 1;
+	}
+	if( is_changed && size <= (int) sizeof(previous) ) {
+		memcpy( previous, p_bitmap, size );
+	}
+	return is_changed;
+}
+
+// --------------------------------------------------------------------
+//	A client of the shared memory is woken by its frames, the framebuffer by the scheduler.
+//
+static void wait_frame( void ) {
+
+	if( fshm_is_attached() ) {
+		fshm_wait( idle_time );
+	}
+	else {
+		fsch_wait();
+	}
+}
+
+// --------------------------------------------------------------------
+//	p_last ..... NULL: transfer all lines every time, !NULL: differential transfer mode
+static void main_process( int sem_id, uint32_t *p_capture, unsigned char *p_bitmap, unsigned char *p_last, int height ) {
+	int is_refresh, is_changed;
+	unsigned int frame_id;
+
+	is_refresh = 1;
+	while( is_active ) {
+		if( is_report_request ) {
+			is_report_request = 0;
+			print_statistics( p_last != NULL );
+		}
+		wait_frame();
+		vcom_poll();
+		if( !lock_display( sem_id, &is_refresh, &is_active ) ) {
+			continue;
+		}
+		frame_id = 0;
+		if( fshm_read( p_bitmap ) ) {
+			frame_id = fshm_get_frame_id();
+		}
+		else {
+			smdd_convert_image( fbc_capture( p_capture ), p_bitmap );
+		}
+		is_changed = is_frame_changed( p_bitmap, height * 50 );
+		transfer_frame( p_bitmap, p_last, height, is_changed, &is_refresh );
+		unlock_display( sem_id );
+		fshm_notify_transferred( frame_id );
+	}
+}
+
+// --------------------------------------------------------------------
+//	Pipeline mode
+//
+//	The main thread captures and converts frame N+1 while the transfer
+//	thread sends frame N. The frames are passed through the ring:
+//
+//		writing ... being converted by the main thread
+//		ready ..... waiting for the transfer thread (newest one wins)
+//		busy ...... being transferred
+//
+//	The transfer thread locks the semaphore for each frame, in the same
+//	way as main_process(), so sangria_glib clients can still take over
+//	the display.
+//
+typedef struct {
+	int				sem_id;
+	unsigned char	*p_last;
+	int				height;
+} TRANSFER_PARAM_T;
+
+// --------------------------------------------------------------------
+static void *transfer_thread( void *p_arg ) {
+	const TRANSFER_PARAM_T *p_param = (const TRANSFER_PARAM_T*) p_arg;
+	FRAME_T *p_frame;
+	int is_refresh, is_sent;
+	long long start, end;
+
+	is_refresh = 1;
+	for(;;) {
+		pthread_mutex_lock( &ring_mutex );
+		while( ready_index == -1 && is_pipeline_active ) {
+			pthread_cond_wait( &ring_cond, &ring_mutex );
+		}
+		if( !is_pipeline_active ) {
+			pthread_mutex_unlock( &ring_mutex );
+			break;
+		}
+		busy_index = ready_index;
+		ready_index = -1;
+		p_frame = &ring[ busy_index ];
+		pthread_mutex_unlock( &ring_mutex );
+
+		start = get_nsec();
+		is_sent = 0;
+		if( lock_display( p_param->sem_id, &is_refresh, &is_pipeline_active ) ) {
+			is_sent = transfer_frame( p_frame->p_bitmap, p_param->p_last, p_param->height, p_frame->is_changed, &is_refresh );
+			unlock_display( p_param->sem_id );
+			fshm_notify_transferred( p_frame->frame_id );
+		}
+		end = get_nsec();
+
+		pthread_mutex_lock( &ring_mutex );
+		add_latency( &queue_latency, start - p_frame->ready_time );
+		if( is_sent ) {
+			add_latency( &transfer_latency, end - start );
+			add_latency( &total_latency, end - p_frame->capture_time );
+			pipeline_sent++;
+		}
+		pipeline_frames++;
+		busy_index = -1;
+		pthread_mutex_unlock( &ring_mutex );
 	}
+	return NULL;
+}
+
+// --------------------------------------------------------------------
+static int pipeline_run( int sem_id, uint32_t *p_capture, unsigned char *p_last, int height ) {
+	TRANSFER_PARAM_T param;
+	pthread_t thread;
+	sigset_t mask, old_mask;
+	FRAME_T *p_frame;
+	int i, writing_index;
+	long long start, captured;
+	const void *p_image;
+
+	param.sem_id	= sem_id;
+	param.p_last	= p_last;
+	param.height	= height;
+	is_pipeline_active = 1;
+	pipeline_start = get_nsec();
+
+	//	The report request is handled by the main thread, so that wait_frame() returns on it.
+	sigemptyset( &mask );
+	sigaddset( &mask, SIGUSR1 );
+	pthread_sigmask( SIG_BLOCK, &mask, &old_mask );
+	if( pthread_create( &thread, NULL, transfer_thread, &param ) != 0 ) {
+		pthread_sigmask( SIG_SETMASK, &old_mask, NULL );
+		fprintf( stderr, "[ERROR] Cannot create the transfer thread.\n" );
+		return 0;
+	}
+	pthread_sigmask( SIG_SETMASK, &old_mask, NULL );
+
+	writing_index = 0;
+	while( is_active ) {
+		if( is_report_request ) {
+			is_report_request = 0;
+			print_statistics( p_last != NULL );
+		}
+		wait_frame();
+		vcom_poll();
+		p_frame = &ring[ writing_index ];
+		start = get_nsec();
+		p_frame->frame_id = 0;
+		if( fshm_read( p_frame->p_bitmap ) ) {
+			//	The frame of the client has been converted while it was read.
+			captured = start;
+			p_frame->frame_id = fshm_get_frame_id();
+		}
+		else {
+			p_image = fbc_capture( p_capture );
+			captured = get_nsec();
+			smdd_convert_image( p_image, p_frame->p_bitmap );
+		}
+		p_frame->is_changed		= is_frame_changed( p_frame->p_bitmap, height * 50 );
+		p_frame->capture_time	= start;
+		p_frame->ready_time		= get_nsec();
+
+		pthread_mutex_lock( &ring_mutex );
+		add_latency( &capture_latency, captured - start );
+		add_latency( &convert_latency, p_frame->ready_time - captured );
+		if( ready_index != -1 ) {
+			//	The transfer thread has not taken the previous frame, so it is dropped.
+			p_frame->is_changed |= ring[ ready_index ].is_changed;
+			pipeline_dropped++;
+		}
+		ready_index = writing_index;
+		//	The next frame is written into the buffer that is neither waiting nor being transferred.
+		for( i = 0; i < RING_SIZE; i++ ) {
+			if( i != ready_index && i != busy_index ) {
+				writing_index = i;
+				break;
+			}
+		}
+		pthread_cond_signal( &ring_cond );
+		pthread_mutex_unlock( &ring_mutex );
+	}
+
+	//	The transfer thread may be waiting for the semaphore held by another process,
+	//	lock_display() gives it up within LOCK_POLL_TIME.
+	pthread_mutex_lock( &ring_mutex );
+	__atomic_store_n( &is_pipeline_active, 0, __ATOMIC_RELEASE );
+	pthread_cond_signal( &ring_cond );
+	pthread_mutex_unlock( &ring_mutex );
+	pthread_join( thread, NULL );
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static int pipeline_process( int sem_id, uint32_t *p_capture, unsigned char *p_last, int width, int height ) {
+	int i, is_allocated, result;
+
+	is_allocated = 1;
+	for( i = 0; i < RING_SIZE; i++ ) {
+		ring[i].p_bitmap	= (unsigned char*) malloc( width * height / 8 );
+		ring[i].is_changed	= 0;
+		if( ring[i].p_bitmap == NULL ) {
+			is_allocated = 0;
+		}
+	}
+	if( is_allocated ) {
+		result = pipeline_run( sem_id, p_capture, p_last, height );
+	}
+	else {
+		fprintf( stderr, "[ERROR] Not enough memory.\n" );
+		result = 0;
+	}
+	for( i = 0; i < RING_SIZE; i++ ) {
+		free( ring[i].p_bitmap );
+		ring[i].p_bitmap = NULL;
+	}
+	return result;
 }
 
 // --------------------------------------------------------------------
@@ -108,8 +556,13 @@ int main( int argc, char *argv[] ) {
 	int size;
 	uint32_t *p_capture;
 	int width, height;
-	unsigned char *p_bitmap;
+	unsigned char *p_bitmap = NULL;
+	unsigned char *p_last = NULL;
 	int do_splash = 1;
+	int do_diff = 0;
+	int do_pipeline = 0;
+	int max_fps = 60;
+	int vcom_hz = 1;
 	key_t key;
 	int sem_id;
 	union semun sem_arg;
@@ -126,22 +579,45 @@ int main( int argc, char *argv[] ) {
 	if( !smdd_initialize() ) {
 		return 3;
 	}
-	command_line_options( argc, argv, &do_splash );
+	command_line_options( argc, argv, &do_splash, &do_diff, &do_pipeline, &max_fps, &idle_time, &vcom_hz );
+	if( max_fps > 0 ) {
+		frame_budget = 1000000 / max_fps;
+	}
+	if( !vcom_initialize( vcom_hz ) ) {
+		return 7;
+	}
 	if( do_splash ) {
 		sangria_splash();
 	}
 
 	size = fbc_get_size( &width, &height, NULL );
-	p_capture = (uint32_t*) malloc( size );
-	if( p_capture == NULL ) {
-		fprintf( stderr, "[ERROR] Not enough memory.\n" );
-		return 4;
+	if( fbc_is_mapped() ) {
+		//	The converter reads the mapped framebuffer directly.
+		p_capture = NULL;
+	}
+	else {
+		p_capture = (uint32_t*) malloc( size );
+		if( p_capture == NULL ) {
+			fprintf( stderr, "[ERROR] Not enough memory.\n" );
+			return 4;
+		}
 	}
 
-	p_bitmap = (unsigned char*) malloc( width * height / 8 );
-	if( p_bitmap == NULL ) {
-		fprintf( stderr, "[ERROR] Not enough memory.\n" );
-		return 5;
+	//	The pipeline mode has its own frames.
+	if( !do_pipeline ) {
+		p_bitmap = (unsigned char*) malloc( width * height / 8 );
+		if( p_bitmap == NULL ) {
+			fprintf( stderr, "[ERROR] Not enough memory.\n" );
+			return 5;
+		}
+	}
+
+	if( do_diff ) {
+		p_last = (unsigned char*) malloc( width * height / 8 );
+		if( p_last == NULL ) {
+			fprintf( stderr, "[ERROR] Not enough memory.\n" );
+			return 5;
+		}
 	}
 
 	key = ftok( "/usr/local/bin/sangria_lcd", 1 );
@@ -153,12 +629,27 @@ int main( int argc, char *argv[] ) {
     sem_arg.val = 1;
     semctl( sem_id, 0, SETVAL, sem_arg );
 
-	main_process( sem_id, p_capture, p_bitmap );
+	if( !fshm_initialize( max_fps ) ) {
+		return 8;
+	}
+	fsch_initialize( max_fps, idle_time );
+	if( do_pipeline ) {
+		pipeline_process( sem_id, p_capture, p_last, width, height );
+	}
+	else {
+		main_process( sem_id, p_capture, p_bitmap, p_last, height );
+	}
+	fsch_terminate();
+	fshm_terminate();
 
 	semctl( sem_id, 1, IPC_RMID, NULL );
 
+	print_statistics( do_diff );
+
+	free( p_last );
 	free( p_bitmap );
 	free( p_capture );
+	vcom_terminate();
 	smdd_terminate();
 	sangria_terminate();
 	fbc_terminate();
@@ -0,0 +1,124 @@
+// --------------------------------------------------------------------
+// Shared memory frame ring between sangria_lcd and its clients
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	sangria_lcd is the only process that drives the display. It creates
+//	the shared memory SANGRIA_SHM_NAME, and a client (sangria_glib) writes
+//	its frames into it instead of using SPI.
+//	Only root and the members of SANGRIA_SHM_GROUP can open it (0660).
+//	Without the group, only root can.
+//
+//	The slots are a triple buffer. Each slot is owned by one side at a
+//	time, so it is never read while it is written:
+//		back ..... the client draws into it (known only to the client)
+//		middle ... the newest frame, exchanged by both sides
+//		front .... sangria_lcd reads it
+//	A new client takes the slot that is neither middle nor front.
+//
+//	Publishing a frame (client):
+//		1. Draw the frame into the back slot, and store the lines changed
+//		   from the previous frame into dirty[ published % SANGRIA_SHM_HISTORY ].
+//		2. Exchange middle with (back | SANGRIA_SHM_FRESH). The old middle is
+//		   the next back slot. If it was still fresh, sangria_lcd has not
+//		   taken it, and dropped is incremented.
+//		3. Increment published and frame. Wake up the futex on frame only
+//		   if sangria_lcd is waiting on it.
+//
+//	Reading a frame (sangria_lcd):
+//		If middle is fresh, exchange it with front and store the new front.
+//		Only the dirty lines of the frames since the last read one have to
+//		be converted. After the frame has been sent to the display, store
+//		its published + 1 into transferred, and wake up the futex on
+//		transferred only if the client is waiting on it.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_SHM_H__
+#define __SANGRIA_SHM_H__
+
+#include <stdint.h>
+
+#ifndef SANGRIA_SHM_NAME
+#define SANGRIA_SHM_NAME		"/sangria_lcd"	//	tests use another name
+#endif
+#ifndef SANGRIA_SHM_GROUP
+#define SANGRIA_SHM_GROUP		"sangria"		//	members can use the display
+#endif
+#define SANGRIA_SHM_MAGIC		0x4D485353		//	"SSHM"
+#define SANGRIA_SHM_VERSION		4
+#define SANGRIA_SHM_WIDTH		400
+#define SANGRIA_SHM_HEIGHT		240
+#define SANGRIA_SHM_SLOTS		3
+#define SANGRIA_SHM_HISTORY		16
+#define SANGRIA_SHM_SLOT_MASK	0x03			//	slot index in middle
+#define SANGRIA_SHM_FRESH		0x04			//	middle has not been taken by sangria_lcd
+
+// --------------------------------------------------------------------
+//	SANGRIA_SHM_FORMAT_T
+// --------------------------------------------------------------------
+typedef enum {
+	SANGRIA_SHM_FORMAT_1BPP = 1,	//	50 bytes per line, bit7 is the left pixel. Sent to the display as it is.
+	SANGRIA_SHM_FORMAT_8BPP = 8,	//	400 bytes per line, same as sangria_display() (0...127: bit 1, 128...255: bit 0)
+} SANGRIA_SHM_FORMAT_T;
+
+// --------------------------------------------------------------------
+//	SANGRIA_SHM_LINES_T
+//	comment)
+//		No line is included if top > bottom.
+// --------------------------------------------------------------------
+typedef struct {
+	int32_t		top;
+	int32_t		bottom;
+} SANGRIA_SHM_LINES_T;
+
+// --------------------------------------------------------------------
+//	SANGRIA_SHM_SLOT_T
+// --------------------------------------------------------------------
+typedef struct {
+	uint32_t	format;				//	SANGRIA_SHM_FORMAT_T
+	uint32_t	published;			//	number of this frame
+	uint32_t	reserved[ 2 ];
+	int32_t		client[ 5 ];		//	used by the client (head of SANGRIA_BACKBUFFER_T, so it draws into image)
+	uint8_t		image[ SANGRIA_SHM_WIDTH * SANGRIA_SHM_HEIGHT ];
+} SANGRIA_SHM_SLOT_T;
+
+// --------------------------------------------------------------------
+//	SANGRIA_SHM_T
+// --------------------------------------------------------------------
+typedef struct {
+	uint32_t	magic;				//	SANGRIA_SHM_MAGIC
+	uint32_t	version;			//	SANGRIA_SHM_VERSION
+	int32_t		client_pid;			//	process that owns the display, 0: none (sangria_lcd shows /dev/fb0)
+	int32_t		is_published;		//	0: the client has not published any frame
+	uint32_t	frame;				//	incremented on each event of the client (futex)
+	uint32_t	waiting;			//	!0: sangria_lcd is waiting on frame
+	uint32_t	published;			//	number of published frames
+	uint32_t	middle;				//	slot of the newest frame, and SANGRIA_SHM_FRESH
+	uint32_t	front;				//	slot read by sangria_lcd
+	uint32_t	presented;			//	frames taken by sangria_lcd
+	uint32_t	dropped;			//	frames replaced by the next one before sangria_lcd took them
+	uint32_t	transferred;		//	published + 1 of the last frame sent to the display (futex)
+	uint32_t	transfer_waiting;	//	!0: the client is waiting on transferred
+	SANGRIA_SHM_LINES_T	dirty[ SANGRIA_SHM_HISTORY ];	//	lines changed from the previous frame
+	SANGRIA_SHM_SLOT_T	slot[ SANGRIA_SHM_SLOTS ];
+} SANGRIA_SHM_T;
+
+#endif
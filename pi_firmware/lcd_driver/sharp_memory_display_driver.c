@@ -26,16 +26,30 @@
 
 #include <armbianio.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <linux/spi/spidev.h>
 #include "sharp_memory_display_driver.h"
 #include "fb_convert.h"
+#include "smdd_convert.h"
 
 //	Parameter
 static const int		ref_height	= 240;
 
-static unsigned char	invert		= 0;
-static int				threshold	= 128;
 static int				hspi		= -1;
+static int				bpp			= 32;
+static int				use_simd	= 1;
+static SMDD_DITHER_T	dither		= SMDD_DITHER_NONE;
+static SMDD_TRANSFER_MODE_T transfer_mode = SMDD_TRANSFER_BATCH;
+static SMDD_CONVERT_PARAM_T convert_param = {
+	400,		//	width
+	240,		//	height
+	400 * 4,	//	line_length
+	128,		//	threshold
+	0x00,		//	invert
+};
 
 #define CS				28
 #define DISPON			32
@@ -43,6 +57,15 @@ static int				hspi		= -1;
 
 #define SPEED			3500000
 
+//	Command of one frame: mode, { line address, data, dummy } x 240, trailer
+#define LINE_SIZE		(1 + 50 + 1)
+#define COMMAND_SIZE	(1 + LINE_SIZE * 240 + 1)
+
+static const char *s_spi_bufsiz = "/sys/module/spidev/parameters/bufsiz";
+
+static unsigned char *p_command = NULL;
+static int spi_bufsiz = 4096;
+
 // --------------------------------------------s------------------------
 //	Table for inverting the sequence of bits
 //	{ b7, b6, ... , b0 } --> { b0, b1, ... , b7 }
@@ -66,14 +89,67 @@ static const unsigned char mirror[256] = {
 	15, 143, 79, 207, 47, 175, 111, 239, 31, 159, 95, 223, 63, 191, 127, 255
 };
 
-static void smdd_convert_image16( const uint16_t *p_src, unsigned char *p_dest );
-static void smdd_convert_image32( const uint32_t *p_src, unsigned char *p_dest );
+static SMDD_CONVERT_T p_convert_image = NULL;
+
+//	time spent in the converter (nsec)
+static unsigned long long convert_count = 0;
+static unsigned long long convert_total = 0;
+static unsigned long long convert_max = 0;
 
-static void (*p_convert_image)( const void *p_src, unsigned char *p_dest ) = NULL;
+// --------------------------------------------------------------------
+static void smdd_select_converter( void ) {
+
+	p_convert_image = smdd_get_dither_converter( bpp, dither );
+	if( p_convert_image == NULL ) {
+		p_convert_image = smdd_get_converter( bpp, use_simd );
+	}
+	convert_count = 0;
+	convert_total = 0;
+	convert_max = 0;
+}
+
+// --------------------------------------------------------------------
+//	spidev copies one message into its own buffer, so a message must not
+//	be larger than the bufsiz parameter of the module.
+//
+static void smdd_read_spi_bufsiz( void ) {
+	FILE *p_file;
+	int size;
+
+	p_file = fopen( s_spi_bufsiz, "r" );
+	if( p_file == NULL ) {
+		return;
+	}
+	if( fscanf( p_file, "%d", &size ) == 1 && size > 0 ) {
+		spi_bufsiz = size;
+	}
+	fclose( p_file );
+}
+
+// --------------------------------------------------------------------
+//	Send the command in as few ioctl() as possible. CS is controlled by the caller.
+//
+static void smdd_send_command( unsigned char *p, int size ) {
+	struct spi_ioc_transfer xfer;
+	int length;
+
+	while( size > 0 ) {
+		length = ( size > spi_bufsiz ) ? spi_bufsiz : size;
+		memset( &xfer, 0, sizeof(xfer) );
+		xfer.tx_buf			= (unsigned long) p;
+		xfer.len			= length;
+		xfer.speed_hz		= SPEED;
+		xfer.bits_per_word	= 8;
+		if( ioctl( hspi, SPI_IOC_MESSAGE(1), &xfer ) < 0 ) {
+			AIOWriteSPI( hspi, p, length );
+		}
+		p += length;
+		size -= length;
+	}
+}
 
 // --------------------------------------------------------------------
 int smdd_initialize( void ) {
-	int bpp;
 	unsigned char frame_buffer[ 50 * 240 ] = { 0 };
 
 	AIOInitBoard( "Raspberry Pi" );
@@ -86,6 +162,13 @@ int smdd_initialize( void ) {
 	if( hspi == -1 ) {
 		return 0;
 	}
+	smdd_read_spi_bufsiz();
+
+	p_command = (unsigned char*) malloc( COMMAND_SIZE );
+	if( p_command == NULL ) {
+		fprintf( stderr, "[ERROR] Not enough memory.\n" );
+		return 0;
+	}
 
 	AIOWriteGPIO( DISPON	, 0 );
 	AIOWriteGPIO( EXTCOMIN	, 0 );
@@ -96,18 +179,16 @@ int smdd_initialize( void ) {
 	AIOWriteGPIO( DISPON	, 1 );
 
 	fbc_get_size( NULL, NULL, &bpp );
-	if( bpp == 32 ) {
-		p_convert_image = (void*) smdd_convert_image32;
-	}
-	else {
-		p_convert_image = (void*) smdd_convert_image16;
-	}
+	convert_param.line_length = fbc_get_line_length();
+	smdd_select_converter();
 	return 1;
 }
 
 // --------------------------------------------------------------------
 void smdd_terminate( void ) {
 	AIOWriteGPIO( DISPON, 0 );
+	free( p_command );
+	p_command = NULL;
 }
 
 // --------------------------------------------------------------------
@@ -116,7 +197,9 @@ void smdd_display( int switch_on ) {
 }
 
 // --------------------------------------------------------------------
-void smdd_transfer_bitmap( unsigned char *p_image ) {
+//	One AIOWriteSPI() for each part of the line (SMDD_TRANSFER_LINE)
+//
+static void smdd_transfer_bitmap_line( unsigned char *p_image ) {
 	int y;
 	unsigned char buffer = 0x80, zero = 0;
 	unsigned char *p = p_image;
@@ -131,80 +214,156 @@ void smdd_transfer_bitmap( unsigned char *p_image ) {
 		AIOWriteSPI( hspi, &zero, 1 );
 		p += 50;
 	}
+	AIOWriteSPI( hspi, &zero, 1 );
 	AIOWriteGPIO( CS, 0 );
 }
 
 // --------------------------------------------------------------------
-static void smdd_convert_image32( const uint32_t *p_src, unsigned char *p_dest ) {
-	int x, y, width, height, bit_count;
-	uint32_t p;
-	unsigned char d;
-
-	width		= 400;
-	height		= 240;
-	d			= 0;
-	bit_count	= 0;
-
-	for( y = 0; y < height; y++ ) {
-		for( x = 0; x < width; x++ ) {
-			p = *(p_src++);
-			p = (p & 255) + ((p >> 8) & 255) + ((p >> 16) & 255);
-			d <<= 1;
-			d += ( p > threshold );
-			bit_count++;
-			if( bit_count >= 8 ) {
-				*(p_dest++) = d ^ invert;
-				bit_count = 0;
-			}
-		}
+void smdd_transfer_bitmap( unsigned char *p_image ) {
+	int y;
+	unsigned char *p = p_command;
+
+	if( transfer_mode == SMDD_TRANSFER_LINE ) {
+		smdd_transfer_bitmap_line( p_image );
+		return;
+	}
+
+	*(p++) = 0x80;
+	for( y = 0; y < ref_height; y++ ) {
+		//	line number, data, dummy
+		*(p++) = mirror[ y + 1 ];
+		memcpy( p, p_image + y * 50, 50 );
+		p += 50;
+		*(p++) = 0;
 	}
+	//	trailer
+	*(p++) = 0;
+
+	AIOWriteGPIO( CS, 1 );
+	smdd_send_command( p_command, p - p_command );
+	AIOWriteGPIO( CS, 0 );
 }
 
 // --------------------------------------------------------------------
-static void smdd_convert_image16( const uint16_t *p_src, unsigned char *p_dest ) {
-	int x, y, width, height, bit_count;
-	uint32_t p;
-	unsigned char d;
+int smdd_transfer_bitmap_diff( const unsigned char *p_image, unsigned char *p_last ) {
+	int y, lines;
+	unsigned char *p = p_command;
 
-	width		= 400;
-	height		= 240;
-	d			= 0;
-	bit_count	= 0;
+	*(p++) = 0x80;
+	lines = 0;
+	for( y = 0; y < ref_height; y++ ) {
+		if( memcmp( p_image + y * 50, p_last + y * 50, 50 ) == 0 ) {
+			continue;
+		}
+		//	line number, data, dummy
+		*(p++) = mirror[ y + 1 ];
+		memcpy( p, p_image + y * 50, 50 );
+		p += 50;
+		*(p++) = 0;
+		memcpy( p_last + y * 50, p_image + y * 50, 50 );
+		lines++;
+	}
+	if( lines == 0 ) {
+		return 0;
+	}
+	//	trailer
+	*(p++) = 0;
 
-	for( y = 0; y < height; y++ ) {
-		for( x = 0; x < width; x++ ) {
-			p = (uint32_t) *(p_src++);
-			p = ((p & 31) + ((p >> 6) & 31) + ((p >> 11) & 31)) << 3;
-			d <<= 1;
-			d += ( p > threshold );
-			bit_count++;
-			if( bit_count >= 8 ) {
-				*(p_dest++) = d ^ invert;
-				bit_count = 0;
-			}
+	AIOWriteGPIO( CS, 1 );
+	if( transfer_mode == SMDD_TRANSFER_LINE ) {
+		//	one AIOWriteSPI() for each line
+		AIOWriteSPI( hspi, p_command, 1 );
+		for( y = 0; y < lines; y++ ) {
+			AIOWriteSPI( hspi, p_command + 1 + y * LINE_SIZE, LINE_SIZE );
 		}
+		AIOWriteSPI( hspi, p - 1, 1 );
+	}
+	else {
+		smdd_send_command( p_command, p - p_command );
 	}
+	AIOWriteGPIO( CS, 0 );
+	return lines;
 }
 
 // --------------------------------------------------------------------
 void smdd_convert_image( const void *p_src, unsigned char *p_dest ) {
+	struct timespec start, end;
+	unsigned long long t;
+
+	clock_gettime( CLOCK_MONOTONIC, &start );
+	p_convert_image( &convert_param, p_src, p_dest );
+	clock_gettime( CLOCK_MONOTONIC, &end );
 
-	p_convert_image( p_src, p_dest );
+	t = (unsigned long long)( (end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec) );
+	convert_count++;
+	convert_total += t;
+	if( convert_max < t ) {
+		convert_max = t;
+	}
 }
 
 // --------------------------------------------------------------------
 void smdd_set_invert( int inv ) {
 
 	if( inv ) {
-		invert = 0xFF;
+		convert_param.invert = 0xFF;
 	}
 	else {
-		invert = 0x00;
+		convert_param.invert = 0x00;
 	}
 }
 
 // --------------------------------------------------------------------
 void smdd_set_threshold( int thres ) {
 
-	threshold = thres;
+	convert_param.threshold = thres;
+}
+
+// --------------------------------------------------------------------
+void smdd_set_simd( int simd ) {
+
+	use_simd = simd;
+	smdd_select_converter();
+}
+
+// --------------------------------------------------------------------
+int smdd_set_dither( int mode ) {
+
+	if( mode != SMDD_DITHER_NONE && smdd_get_dither_converter( bpp, (SMDD_DITHER_T) mode ) == NULL ) {
+		return 0;
+	}
+	if( convert_param.width > SMDD_DITHER_MAX_WIDTH ) {
+		return 0;
+	}
+	dither = (SMDD_DITHER_T) mode;
+	smdd_select_converter();
+	return 1;
+}
+
+// --------------------------------------------------------------------
+const char *smdd_get_converter_info( void ) {
+
+	if( dither != SMDD_DITHER_NONE ) {
+		return smdd_get_dither_name( dither );
+	}
+	return smdd_get_converter_name( use_simd );
+}
+
+// --------------------------------------------------------------------
+void smdd_set_transfer_mode( SMDD_TRANSFER_MODE_T mode ) {
+
+	transfer_mode = mode;
+}
+
+// --------------------------------------------------------------------
+int smdd_get_convert_time( int *p_average, int *p_max ) {
+
+	if( convert_count == 0 ) {
+		*p_average = 0;
+		*p_max = 0;
+		return 0;
+	}
+	*p_average	= (int)( convert_total / convert_count / 1000 );
+	*p_max		= (int)( convert_max / 1000 );
+	return 1;
 }
@@ -27,6 +27,14 @@
 
 #include <stdint.h>
 
+// --------------------------------------------------------------------
+//	SMDD_TRANSFER_MODE_T
+// --------------------------------------------------------------------
+typedef enum {
+	SMDD_TRANSFER_LINE = 0,		//	AIOWriteSPI() for each part of the lines (old way)
+	SMDD_TRANSFER_BATCH = 1,	//	one command buffer for the frame (default)
+} SMDD_TRANSFER_MODE_T;
+
 // --------------------------------------------------------------------
 //	smdd_initialize()
 //	input)
@@ -62,10 +70,26 @@ void smdd_display( int switch_on );
 //	output)
 //		none
 //	comment)
-//		The contents of p_image are destroyed.
+//		The whole frame is built in one command buffer and sent with a few
+//		ioctl(), each as large as spidev accepts.
 // --------------------------------------------------------------------
 void smdd_transfer_bitmap( unsigned char *p_image );
 
+// --------------------------------------------------------------------
+//	smdd_transfer_bitmap_diff()
+//	input)
+//		p_image .... 1bpp image data
+//		p_last ..... 1bpp image data that was transferred last time
+//	output)
+//		number of transferred lines
+//		*p_last .... updated to the contents of p_image
+//	comment)
+//		Only the lines that differ from p_last are transferred.
+//		All of them are sent in one CS window, each with its own line address.
+//		The command is built in the same buffer as smdd_transfer_bitmap().
+// --------------------------------------------------------------------
+int smdd_transfer_bitmap_diff( const unsigned char *p_image, unsigned char *p_last );
+
 // --------------------------------------------------------------------
 //	smdd_convert_image()
 //	input)
@@ -94,4 +118,59 @@ void smdd_set_invert( int inv );
 // --------------------------------------------------------------------
 void smdd_set_threshold( int thres );
 
+// --------------------------------------------------------------------
+//	smdd_set_simd()
+//	input)
+//		simd ..... 0: use the portable C converter, 1: use the SIMD converter if available
+//	output)
+//		none
+// --------------------------------------------------------------------
+void smdd_set_simd( int simd );
+
+// --------------------------------------------------------------------
+//	smdd_get_converter_info()
+//	input)
+//		none
+//	output)
+//		name of the converter in use
+// --------------------------------------------------------------------
+const char *smdd_get_converter_info( void );
+
+// --------------------------------------------------------------------
+//	smdd_set_dither()
+//	input)
+//		mode ..... SMDD_DITHER_T (0: binary threshold)
+//	output)
+//		0 ..... Failed. (unknown mode)
+//		!0 .... Success.
+//	comment)
+//		Call after smdd_initialize(), the converter depends on the bit depth
+//		of the framebuffer. The dithering modes use the portable C version.
+// --------------------------------------------------------------------
+int smdd_set_dither( int mode );
+
+// --------------------------------------------------------------------
+//	smdd_set_transfer_mode()
+//	input)
+//		mode ..... SMDD_TRANSFER_LINE or SMDD_TRANSFER_BATCH
+//	output)
+//		none
+//	comment)
+//		SMDD_TRANSFER_LINE is kept to compare the transfer time.
+// --------------------------------------------------------------------
+void smdd_set_transfer_mode( SMDD_TRANSFER_MODE_T mode );
+
+// --------------------------------------------------------------------
+//	smdd_get_convert_time()
+//	input)
+//		p_average .... address to store the average time (usec)
+//		p_max ........ address to store the maximum time (usec)
+//	output)
+//		0 ..... No frame has been converted yet.
+//		!0 .... Success.
+//	comment)
+//		The time of smdd_convert_image() since the converter was selected.
+// --------------------------------------------------------------------
+int smdd_get_convert_time( int *p_average, int *p_max );
+
 #endif
@@ -0,0 +1,495 @@
+// --------------------------------------------------------------------
+// Sharp Memory Display Driver (image converter)
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#include <stdint.h>
+#include <string.h>
+#include "smdd_convert.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(SANGRIA_HAVE_NEON) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON		(1 << 12)
+#endif
+#endif
+
+#if defined(SANGRIA_HAVE_NEON)
+//	smdd_convert_neon.c (SANGRIA_HAVE_NEON is given by neon.mk)
+void smdd_convert_image32_neon( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest );
+void smdd_convert_image16_neon( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest );
+#endif
+
+// --------------------------------------------------------------------
+//	Portable C version (reference)
+//
+static void smdd_convert_image32_c( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+	int x, y, bit_count;
+	const uint32_t *p_line;
+	uint32_t p;
+	unsigned char d;
+
+	d			= 0;
+	bit_count	= 0;
+
+	for( y = 0; y < p_param->height; y++ ) {
+		p_line = (const uint32_t*)( (const unsigned char*) p_src + y * p_param->line_length );
+		for( x = 0; x < p_param->width; x++ ) {
+			p = *(p_line++);
+			p = (p & 255) + ((p >> 8) & 255) + ((p >> 16) & 255);
+			d <<= 1;
+			d += ( p > p_param->threshold );
+			bit_count++;
+			if( bit_count >= 8 ) {
+				*(p_dest++) = d ^ p_param->invert;
+				bit_count = 0;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image16_c( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+	int x, y, bit_count;
+	const uint16_t *p_line;
+	uint32_t p;
+	unsigned char d;
+
+	d			= 0;
+	bit_count	= 0;
+
+	for( y = 0; y < p_param->height; y++ ) {
+		p_line = (const uint16_t*)( (const unsigned char*) p_src + y * p_param->line_length );
+		for( x = 0; x < p_param->width; x++ ) {
+			p = (uint32_t) *(p_line++);
+			p = ((p & 31) + ((p >> 6) & 31) + ((p >> 11) & 31)) << 3;
+			d <<= 1;
+			d += ( p > p_param->threshold );
+			bit_count++;
+			if( bit_count >= 8 ) {
+				*(p_dest++) = d ^ p_param->invert;
+				bit_count = 0;
+			}
+		}
+	}
+}
+
+#if defined(__SSE2__)
+// --------------------------------------------------------------------
+//	SSE2 version: 16 pixels per iteration
+//
+//	The lanes are packed in reverse order, so that the leftmost pixel
+//	becomes bit7 of the output byte after _mm_movemask_epi8().
+//
+static inline __m128i _reverse32( __m128i v ) {
+
+	return _mm_shuffle_epi32( v, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+}
+
+// --------------------------------------------------------------------
+static inline __m128i _reverse16( __m128i v ) {
+
+	v = _mm_shufflelo_epi16( v, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+	v = _mm_shufflehi_epi16( v, _MM_SHUFFLE( 0, 1, 2, 3 ) );
+	return _mm_shuffle_epi32( v, _MM_SHUFFLE( 1, 0, 3, 2 ) );
+}
+
+// --------------------------------------------------------------------
+static inline __m128i _luminance32( const uint32_t *p, __m128i mask ) {
+	__m128i v, s;
+
+	v = _mm_loadu_si128( (const __m128i*) p );
+	s = _mm_and_si128( v, mask );
+	s = _mm_add_epi32( s, _mm_and_si128( _mm_srli_epi32( v, 8 ), mask ) );
+	s = _mm_add_epi32( s, _mm_and_si128( _mm_srli_epi32( v, 16 ), mask ) );
+	return s;
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image32_sse2( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+	int x, y, m;
+	const uint32_t *p_line;
+	__m128i mask, thres, c0, c1, c2, c3;
+
+	//	The C version compares as unsigned, so a negative threshold never matches.
+	mask	= _mm_set1_epi32( 255 );
+	thres	= _mm_set1_epi32( (p_param->threshold < 0) ? 0x7FFFFFFF : p_param->threshold );
+
+	for( y = 0; y < p_param->height; y++ ) {
+		p_line = (const uint32_t*)( (const unsigned char*) p_src + y * p_param->line_length );
+		for( x = 0; x < p_param->width; x += 16 ) {
+			c0 = _reverse32( _mm_cmpgt_epi32( _luminance32( p_line +  0, mask ), thres ) );
+			c1 = _reverse32( _mm_cmpgt_epi32( _luminance32( p_line +  4, mask ), thres ) );
+			c2 = _reverse32( _mm_cmpgt_epi32( _luminance32( p_line +  8, mask ), thres ) );
+			c3 = _reverse32( _mm_cmpgt_epi32( _luminance32( p_line + 12, mask ), thres ) );
+			m = _mm_movemask_epi8( _mm_packs_epi16( _mm_packs_epi32( c1, c0 ), _mm_packs_epi32( c3, c2 ) ) );
+			*(p_dest++) = (unsigned char)( m      ) ^ p_param->invert;
+			*(p_dest++) = (unsigned char)( m >> 8 ) ^ p_param->invert;
+			p_line += 16;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static inline __m128i _luminance16( const uint16_t *p, __m128i mask ) {
+	__m128i v, s;
+
+	v = _mm_loadu_si128( (const __m128i*) p );
+	s = _mm_and_si128( v, mask );
+	s = _mm_add_epi16( s, _mm_and_si128( _mm_srli_epi16( v, 6 ), mask ) );
+	s = _mm_add_epi16( s, _mm_srli_epi16( v, 11 ) );
+	return _mm_slli_epi16( s, 3 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image16_sse2( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+	int x, y, m;
+	const uint16_t *p_line;
+	__m128i mask, thres, c0, c1;
+
+	mask	= _mm_set1_epi16( 31 );
+	thres	= _mm_set1_epi16( (p_param->threshold < 0 || p_param->threshold > 0x7FFF) ? 0x7FFF : p_param->threshold );
+
+	for( y = 0; y < p_param->height; y++ ) {
+		p_line = (const uint16_t*)( (const unsigned char*) p_src + y * p_param->line_length );
+		for( x = 0; x < p_param->width; x += 16 ) {
+			c0 = _reverse16( _mm_cmpgt_epi16( _luminance16( p_line + 0, mask ), thres ) );
+			c1 = _reverse16( _mm_cmpgt_epi16( _luminance16( p_line + 8, mask ), thres ) );
+			m = _mm_movemask_epi8( _mm_packs_epi16( c0, c1 ) );
+			*(p_dest++) = (unsigned char)( m      ) ^ p_param->invert;
+			*(p_dest++) = (unsigned char)( m >> 8 ) ^ p_param->invert;
+			p_line += 16;
+		}
+	}
+}
+#endif
+
+// --------------------------------------------------------------------
+static int _has_simd( void ) {
+
+#if defined(__SSE2__) || (defined(SANGRIA_HAVE_NEON) && defined(__aarch64__))
+	return 1;
+#elif defined(SANGRIA_HAVE_NEON)
+	return (getauxval( AT_HWCAP ) & HWCAP_NEON) != 0;
+#else
+	return 0;
+#endif
+}
+
+// --------------------------------------------------------------------
+SMDD_CONVERT_T smdd_get_converter( int bpp, int use_simd ) {
+
+	if( use_simd && _has_simd() ) {
+#if defined(SANGRIA_HAVE_NEON)
+		return (bpp == 32) ? smdd_convert_image32_neon : smdd_convert_image16_neon;
+#elif defined(__SSE2__)
+		return (bpp == 32) ? smdd_convert_image32_sse2 : smdd_convert_image16_sse2;
+#endif
+	}
+	return (bpp == 32) ? smdd_convert_image32_c : smdd_convert_image16_c;
+}
+
+// --------------------------------------------------------------------
+const char *smdd_get_converter_name( int use_simd ) {
+
+	if( use_simd && _has_simd() ) {
+#if defined(SANGRIA_HAVE_NEON)
+		return "NEON";
+#elif defined(__SSE2__)
+		return "SSE2";
+#endif
+	}
+	return "C";
+}
+
+// --------------------------------------------------------------------
+//	Dithering
+//
+//	The source line is converted to luminance (0 ... white) first, and
+//	then the kernel decides each pixel. white is 255 * 3 for 32bpp and
+//	31 * 3 * 8 for 16bpp, the same scale as the threshold of the binary
+//	converters.
+//
+typedef void (*SMDD_READ_LINE_T)( const void *p_line, int width, int *p_lum );
+
+static const int white32 = 255 * 3;
+static const int white16 = 31 * 3 * 8;
+
+static const unsigned char bayer4[4][4] = {
+	{  0,  8,  2, 10 },
+	{ 12,  4, 14,  6 },
+	{  3, 11,  1,  9 },
+	{ 15,  7, 13,  5 },
+};
+
+static const unsigned char bayer8[8][8] = {
+	{  0, 32,  8, 40,  2, 34, 10, 42 },
+	{ 48, 16, 56, 24, 50, 18, 58, 26 },
+	{ 12, 44,  4, 36, 14, 46,  6, 38 },
+	{ 60, 28, 52, 20, 62, 30, 54, 22 },
+	{  3, 35, 11, 43,  1, 33,  9, 41 },
+	{ 51, 19, 59, 27, 49, 17, 57, 25 },
+	{ 15, 47,  7, 39, 13, 45,  5, 37 },
+	{ 63, 31, 55, 23, 61, 29, 53, 21 },
+};
+
+//	luminance of the current line, and the errors for the following lines
+//	(index 0 is x = -1, so that the kernels do not need edge checks)
+static int lum_line[ SMDD_DITHER_MAX_WIDTH ];
+static int err_line[3][ SMDD_DITHER_MAX_WIDTH + 3 ];
+
+// --------------------------------------------------------------------
+static void _read_line32( const void *p_line, int width, int *p_lum ) {
+	const uint32_t *p = (const uint32_t*) p_line;
+	uint32_t c;
+	int x;
+
+	for( x = 0; x < width; x++ ) {
+		c = *(p++);
+		*(p_lum++) = (c & 255) + ((c >> 8) & 255) + ((c >> 16) & 255);
+	}
+}
+
+// --------------------------------------------------------------------
+static void _read_line16( const void *p_line, int width, int *p_lum ) {
+	const uint16_t *p = (const uint16_t*) p_line;
+	uint32_t c;
+	int x;
+
+	for( x = 0; x < width; x++ ) {
+		c = (uint32_t) *(p++);
+		*(p_lum++) = ((c & 31) + ((c >> 6) & 31) + ((c >> 11) & 31)) << 3;
+	}
+}
+
+// --------------------------------------------------------------------
+static void _dither_bayer( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest,
+		SMDD_READ_LINE_T read_line, int white, int size ) {
+	int x, y, i;
+	int threshold[8];
+	unsigned char d;
+
+	for( y = 0; y < p_param->height; y++ ) {
+		//	thresholds of this line: (2m + 1) / (2 * size * size) of white
+		for( i = 0; i < size; i++ ) {
+			if( size == 4 ) {
+				threshold[i] = (2 * bayer4[ y & 3 ][ i ] + 1) * white / 32;
+			}
+			else {
+				threshold[i] = (2 * bayer8[ y & 7 ][ i ] + 1) * white / 128;
+			}
+		}
+		read_line( (const unsigned char*) p_src + y * p_param->line_length, p_param->width, lum_line );
+		for( x = 0; x < p_param->width; x += 8 ) {
+			d = 0;
+			for( i = 0; i < 8; i++ ) {
+				d = (d << 1) | ( lum_line[ x + i ] > threshold[ (x + i) & (size - 1) ] );
+			}
+			*(p_dest++) = d ^ p_param->invert;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	Floyd-Steinberg
+//		      *   7/16
+//		3/16 5/16 1/16
+//
+static void _dither_floyd_steinberg( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest,
+		SMDD_READ_LINE_T read_line, int white ) {
+	int x, y, i, v, e;
+	int *p_cur, *p_next, *p_temp;
+	unsigned char d;
+
+	p_cur	= err_line[0];
+	p_next	= err_line[1];
+	memset( p_cur, 0, sizeof(err_line[0]) );
+	for( y = 0; y < p_param->height; y++ ) {
+		memset( p_next, 0, sizeof(err_line[0]) );
+		read_line( (const unsigned char*) p_src + y * p_param->line_length, p_param->width, lum_line );
+		for( x = 0; x < p_param->width; x += 8 ) {
+			d = 0;
+			for( i = x; i < x + 8; i++ ) {
+				v = lum_line[i] + p_cur[ i + 1 ];
+				d <<= 1;
+				if( v > (white >> 1) ) {
+					d |= 1;
+					e = v - white;
+				}
+				else {
+					e = v;
+				}
+				p_cur[ i + 2 ]	+= (e * 7) >> 4;
+				p_next[ i ]		+= (e * 3) >> 4;
+				p_next[ i + 1 ]	+= (e * 5) >> 4;
+				p_next[ i + 2 ]	+= e >> 4;
+			}
+			*(p_dest++) = d ^ p_param->invert;
+		}
+		p_temp	= p_cur;
+		p_cur	= p_next;
+		p_next	= p_temp;
+	}
+}
+
+// --------------------------------------------------------------------
+//	Atkinson (3/4 of the error is diffused, 1/8 each)
+//		     *  1  1
+//		  1  1  1
+//		     1
+//
+static void _dither_atkinson( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest,
+		SMDD_READ_LINE_T read_line, int white ) {
+	int x, y, i, v, e;
+	int *p_cur, *p_next1, *p_next2, *p_temp;
+	unsigned char d;
+
+	p_cur	= err_line[0];
+	p_next1	= err_line[1];
+	p_next2	= err_line[2];
+	memset( err_line, 0, sizeof(err_line) );
+	for( y = 0; y < p_param->height; y++ ) {
+		read_line( (const unsigned char*) p_src + y * p_param->line_length, p_param->width, lum_line );
+		for( x = 0; x < p_param->width; x += 8 ) {
+			d = 0;
+			for( i = x; i < x + 8; i++ ) {
+				v = lum_line[i] + p_cur[ i + 1 ];
+				d <<= 1;
+				if( v > (white >> 1) ) {
+					d |= 1;
+					e = (v - white) >> 3;
+				}
+				else {
+					e = v >> 3;
+				}
+				p_cur[ i + 2 ]		+= e;
+				p_cur[ i + 3 ]		+= e;
+				p_next1[ i ]		+= e;
+				p_next1[ i + 1 ]	+= e;
+				p_next1[ i + 2 ]	+= e;
+				p_next2[ i + 1 ]	+= e;
+			}
+			*(p_dest++) = d ^ p_param->invert;
+		}
+		//	rotate the line buffers, the current line becomes the last one
+		p_temp	= p_cur;
+		p_cur	= p_next1;
+		p_next1	= p_next2;
+		p_next2	= p_temp;
+		memset( p_next2, 0, sizeof(err_line[0]) );
+	}
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image32_bayer4( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_bayer( p_param, p_src, p_dest, _read_line32, white32, 4 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image16_bayer4( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_bayer( p_param, p_src, p_dest, _read_line16, white16, 4 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image32_bayer8( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_bayer( p_param, p_src, p_dest, _read_line32, white32, 8 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image16_bayer8( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_bayer( p_param, p_src, p_dest, _read_line16, white16, 8 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image32_fs( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_floyd_steinberg( p_param, p_src, p_dest, _read_line32, white32 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image16_fs( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_floyd_steinberg( p_param, p_src, p_dest, _read_line16, white16 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image32_atkinson( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_atkinson( p_param, p_src, p_dest, _read_line32, white32 );
+}
+
+// --------------------------------------------------------------------
+static void smdd_convert_image16_atkinson( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+
+	_dither_atkinson( p_param, p_src, p_dest, _read_line16, white16 );
+}
+
+// --------------------------------------------------------------------
+SMDD_CONVERT_T smdd_get_dither_converter( int bpp, SMDD_DITHER_T dither ) {
+
+	switch( dither ) {
+	case SMDD_DITHER_BAYER4:
+		return (bpp == 32) ? smdd_convert_image32_bayer4 : smdd_convert_image16_bayer4;
+	case SMDD_DITHER_BAYER8:
+		return (bpp == 32) ? smdd_convert_image32_bayer8 : smdd_convert_image16_bayer8;
+	case SMDD_DITHER_FLOYD_STEINBERG:
+		return (bpp == 32) ? smdd_convert_image32_fs : smdd_convert_image16_fs;
+	case SMDD_DITHER_ATKINSON:
+		return (bpp == 32) ? smdd_convert_image32_atkinson : smdd_convert_image16_atkinson;
+	default:
+		return NULL;
+	}
+}
+
+// --------------------------------------------------------------------
+static const char *dither_name[] = {
+	"none", "bayer4", "bayer8", "fs", "atkinson",
+};
+
+// --------------------------------------------------------------------
+const char *smdd_get_dither_name( SMDD_DITHER_T dither ) {
+
+	if( (int) dither < 0 || (int) dither >= (int)( sizeof(dither_name) / sizeof(dither_name[0]) ) ) {
+		return "unknown";
+	}
+	return dither_name[ dither ];
+}
+
+// --------------------------------------------------------------------
+int smdd_find_dither( const char *p_name ) {
+	int i;
+
+	for( i = 0; i < (int)( sizeof(dither_name) / sizeof(dither_name[0]) ); i++ ) {
+		if( strcmp( p_name, dither_name[i] ) == 0 ) {
+			return i;
+		}
+	}
+	return -1;
+}
@@ -0,0 +1,115 @@
+// --------------------------------------------------------------------
+// Sharp Memory Display Driver (image converter)
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#ifndef __SMDD_CONVERT_H__
+#define __SMDD_CONVERT_H__
+
+#include <stdint.h>
+
+// --------------------------------------------------------------------
+//	SMDD_CONVERT_PARAM_T
+// --------------------------------------------------------------------
+typedef struct {
+	int				width;			//	pixels (multiple of 16)
+	int				height;			//	lines
+	int				line_length;	//	distance between the lines of the source image (bytes)
+	int				threshold;		//	threshold for binary conversion
+	unsigned char	invert;			//	0x00: not invert, 0xFF: invert
+} SMDD_CONVERT_PARAM_T;
+
+typedef void (*SMDD_CONVERT_T)( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest );
+
+// --------------------------------------------------------------------
+//	SMDD_DITHER_T
+//	comment)
+//		threshold of SMDD_CONVERT_PARAM_T is used by SMDD_DITHER_NONE only.
+//		The others decide at the middle of the luminance range.
+// --------------------------------------------------------------------
+typedef enum {
+	SMDD_DITHER_NONE = 0,				//	binary threshold
+	SMDD_DITHER_BAYER4 = 1,				//	ordered dither, 4x4 Bayer matrix
+	SMDD_DITHER_BAYER8 = 2,				//	ordered dither, 8x8 Bayer matrix
+	SMDD_DITHER_FLOYD_STEINBERG = 3,	//	error diffusion, Floyd-Steinberg
+	SMDD_DITHER_ATKINSON = 4,			//	error diffusion, Atkinson
+} SMDD_DITHER_T;
+
+#define SMDD_DITHER_MAX_WIDTH	1024
+
+// --------------------------------------------------------------------
+//	smdd_get_converter()
+//	input)
+//		bpp ......... bits per pixel of the source image (16 or 32)
+//		use_simd .... 0: portable C version, !0: the fastest version on this CPU
+//	output)
+//		converter to 1bpp image
+//	comment)
+//		The SIMD version is selected at run time (NEON on ARM, SSE2 on x86).
+//		If the CPU does not have it, the portable C version is returned.
+//		All versions produce the same 1bpp image.
+// --------------------------------------------------------------------
+SMDD_CONVERT_T smdd_get_converter( int bpp, int use_simd );
+
+// --------------------------------------------------------------------
+//	smdd_get_converter_name()
+//	input)
+//		use_simd .... 0: portable C version, !0: the fastest version on this CPU
+//	output)
+//		name of the converter ("C", "NEON" or "SSE2")
+// --------------------------------------------------------------------
+const char *smdd_get_converter_name( int use_simd );
+
+// --------------------------------------------------------------------
+//	smdd_get_dither_converter()
+//	input)
+//		bpp ......... bits per pixel of the source image (16 or 32)
+//		dither ...... conversion mode
+//	output)
+//		converter to 1bpp image
+//		NULL ... SMDD_DITHER_NONE or unknown mode, use smdd_get_converter() instead.
+//	comment)
+//		The converters process one line at a time. Error diffusion keeps
+//		its errors in small line buffers, not in a copy of the whole image.
+//		Width must be SMDD_DITHER_MAX_WIDTH or less.
+// --------------------------------------------------------------------
+SMDD_CONVERT_T smdd_get_dither_converter( int bpp, SMDD_DITHER_T dither );
+
+// --------------------------------------------------------------------
+//	smdd_get_dither_name()
+//	input)
+//		dither ...... conversion mode
+//	output)
+//		name of the mode ("none", "bayer4", "bayer8", "fs" or "atkinson")
+// --------------------------------------------------------------------
+const char *smdd_get_dither_name( SMDD_DITHER_T dither );
+
+// --------------------------------------------------------------------
+//	smdd_find_dither()
+//	input)
+//		p_name ...... name of the mode
+//	output)
+//		conversion mode
+//		-1 ... unknown name
+// --------------------------------------------------------------------
+int smdd_find_dither( const char *p_name );
+
+#endif
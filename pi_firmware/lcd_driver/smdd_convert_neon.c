@@ -0,0 +1,125 @@
+// --------------------------------------------------------------------
+// Sharp Memory Display Driver (image converter for NEON)
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	NEON versions of the smdd_convert.c converters. neon.mk builds this
+//	file with NEON_CFLAGS and defines SANGRIA_HAVE_NEON on ARM targets;
+//	smdd_get_converter() returns them only when the CPU has NEON, so the
+//	binary still runs on ARMv6.
+// --------------------------------------------------------------------
+
+#if defined(SANGRIA_HAVE_NEON)
+
+#if !defined(__ARM_NEON) && !defined(__ARM_NEON__)
+#error "smdd_convert_neon.c needs NEON_CFLAGS (see neon.mk)"
+#endif
+
+#include <stdint.h>
+#include <arm_neon.h>
+#include "smdd_convert.h"
+
+void smdd_convert_image32_neon( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest );
+void smdd_convert_image16_neon( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest );
+
+static const uint8_t bit_weight[8] = { 128, 64, 32, 16, 8, 4, 2, 1 };
+
+// --------------------------------------------------------------------
+//	Pack two compare results (8 pixels each) into 2 bytes, leftmost pixel is bit7.
+//
+static inline void _pack_bits( uint16x8_t c0, uint16x8_t c1, uint8x8_t weight, uint8_t invert, unsigned char *p_dest ) {
+	uint8x8_t m0, m1, t;
+
+	m0 = vand_u8( vmovn_u16( c0 ), weight );
+	m1 = vand_u8( vmovn_u16( c1 ), weight );
+	t = vpadd_u8( m0, m1 );
+	t = vpadd_u8( t, t );
+	t = vpadd_u8( t, t );
+	p_dest[0] = vget_lane_u8( t, 0 ) ^ invert;
+	p_dest[1] = vget_lane_u8( t, 1 ) ^ invert;
+}
+
+// --------------------------------------------------------------------
+//	16 pixels per iteration
+//
+void smdd_convert_image32_neon( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+	int x, y;
+	const uint8_t *p_line;
+	uint8x16x4_t v;
+	uint16x8_t s0, s1, thres;
+	uint8x8_t weight;
+
+	//	The C version compares as unsigned, so a negative threshold never matches.
+	thres	= vdupq_n_u16( (p_param->threshold < 0 || p_param->threshold > 0xFFFF) ? 0xFFFF : p_param->threshold );
+	weight	= vld1_u8( bit_weight );
+
+	for( y = 0; y < p_param->height; y++ ) {
+		p_line = (const uint8_t*) p_src + y * p_param->line_length;
+		for( x = 0; x < p_param->width; x += 16 ) {
+			//	val[0]: B, val[1]: G, val[2]: R, val[3]: A
+			v = vld4q_u8( p_line );
+			s0 = vaddl_u8( vget_low_u8( v.val[0] ), vget_low_u8( v.val[1] ) );
+			s0 = vaddw_u8( s0, vget_low_u8( v.val[2] ) );
+			s1 = vaddl_u8( vget_high_u8( v.val[0] ), vget_high_u8( v.val[1] ) );
+			s1 = vaddw_u8( s1, vget_high_u8( v.val[2] ) );
+			_pack_bits( vcgtq_u16( s0, thres ), vcgtq_u16( s1, thres ), weight, p_param->invert, p_dest );
+			p_dest += 2;
+			p_line += 16 * 4;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static inline uint16x8_t _luminance16( const uint16_t *p, uint16x8_t mask ) {
+	uint16x8_t v, s;
+
+	v = vld1q_u16( p );
+	s = vandq_u16( v, mask );
+	s = vaddq_u16( s, vandq_u16( vshrq_n_u16( v, 6 ), mask ) );
+	s = vaddq_u16( s, vshrq_n_u16( v, 11 ) );
+	return vshlq_n_u16( s, 3 );
+}
+
+// --------------------------------------------------------------------
+void smdd_convert_image16_neon( const SMDD_CONVERT_PARAM_T *p_param, const void *p_src, unsigned char *p_dest ) {
+	int x, y;
+	const uint16_t *p_line;
+	uint16x8_t mask, thres;
+	uint8x8_t weight;
+
+	mask	= vdupq_n_u16( 31 );
+	thres	= vdupq_n_u16( (p_param->threshold < 0 || p_param->threshold > 0xFFFF) ? 0xFFFF : p_param->threshold );
+	weight	= vld1_u8( bit_weight );
+
+	for( y = 0; y < p_param->height; y++ ) {
+		p_line = (const uint16_t*)( (const uint8_t*) p_src + y * p_param->line_length );
+		for( x = 0; x < p_param->width; x += 16 ) {
+			_pack_bits(
+				vcgtq_u16( _luminance16( p_line + 0, mask ), thres ),
+				vcgtq_u16( _luminance16( p_line + 8, mask ), thres ),
+				weight, p_param->invert, p_dest );
+			p_dest += 2;
+			p_line += 16;
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,250 @@
+// --------------------------------------------------------------------
+// Test of image converter
+// ====================================================================
+//	Compares the SIMD converters with the portable C converters.
+//	Both must produce byte-identical 1bpp images for every threshold
+//	and invert setting.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "smdd_convert.h"
+
+#define WIDTH			400
+#define HEIGHT			240
+#define PADDING			64				//	extra bytes at the end of each source line
+
+static uint32_t seed = 12345;
+
+// --------------------------------------------------------------------
+static uint32_t get_random( void ) {
+
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+// --------------------------------------------------------------------
+//	upper half: random pixels, lower half: gradation of each component
+//
+static void make_image( unsigned char *p_image, int bpp, int line_length ) {
+	int x, y, v;
+	uint32_t *p32;
+	uint16_t *p16;
+
+	for( y = 0; y < HEIGHT; y++ ) {
+		p32 = (uint32_t*)( p_image + y * line_length );
+		p16 = (uint16_t*)( p_image + y * line_length );
+		for( x = 0; x < WIDTH; x++ ) {
+			if( y < HEIGHT / 2 ) {
+				v = get_random();
+			}
+			else {
+				v = (x + y * WIDTH) & 255;
+				v = v | (v << 8) | (v << 16) | (get_random() & 0xFF000000);
+				v ^= (y & 7) << ((y >> 3) & 15);
+			}
+			if( bpp == 32 ) {
+				p32[x] = v;
+			}
+			else {
+				p16[x] = (uint16_t) v;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static int test( int bpp ) {
+	SMDD_CONVERT_PARAM_T param;
+	SMDD_CONVERT_T reference, target;
+	unsigned char *p_image;
+	static unsigned char result1[ WIDTH * HEIGHT / 8 ];
+	static unsigned char result2[ WIDTH * HEIGHT / 8 ];
+	int inv, thres, errors;
+
+	param.width			= WIDTH;
+	param.height		= HEIGHT;
+	param.line_length	= WIDTH * bpp / 8 + PADDING;
+	p_image = (unsigned char*) malloc( param.line_length * HEIGHT );
+	if( p_image == NULL ) {
+		printf( "[ERROR] Not enough memory.\n" );
+		return 1;
+	}
+	make_image( p_image, bpp, param.line_length );
+
+	reference	= smdd_get_converter( bpp, 0 );
+	target		= smdd_get_converter( bpp, 1 );
+	printf( "%dbpp: %s vs %s ... ", bpp, smdd_get_converter_name( 0 ), smdd_get_converter_name( 1 ) );
+
+	errors = 0;
+	for( inv = 0; inv < 2; inv++ ) {
+		param.invert = inv ? 0xFF : 0x00;
+		for( thres = -2; thres <= 800; thres++ ) {
+			param.threshold = thres;
+			memset( result1, 0x55, sizeof(result1) );
+			memset( result2, 0xAA, sizeof(result2) );
+			reference( &param, p_image, result1 );
+			target( &param, p_image, result2 );
+			if( memcmp( result1, result2, sizeof(result1) ) != 0 ) {
+				if( errors < 10 ) {
+					printf( "\n  mismatch: threshold = %d, invert = %d", thres, inv );
+				}
+				errors++;
+			}
+		}
+	}
+	free( p_image );
+	printf( errors ? "\nNG\n" : "OK\n" );
+	return errors != 0;
+}
+
+// --------------------------------------------------------------------
+static int count_bits( const unsigned char *p, int size ) {
+	int i, count;
+	unsigned char d;
+
+	count = 0;
+	for( i = 0; i < size; i++ ) {
+		for( d = p[i]; d; d &= d - 1 ) {
+			count++;
+		}
+	}
+	return count;
+}
+
+// --------------------------------------------------------------------
+//	The dithered image of a flat gray keeps its tone, and invert is the complement.
+//
+static int test_dither_tone( int bpp, SMDD_DITHER_T dither, int tolerance ) {
+	SMDD_CONVERT_PARAM_T param;
+	SMDD_CONVERT_T target;
+	unsigned char *p_image;
+	static unsigned char result1[ WIDTH * HEIGHT / 8 ];
+	static unsigned char result2[ WIDTH * HEIGHT / 8 ];
+	int i, level, expected, actual, last, errors;
+
+	param.width			= WIDTH;
+	param.height		= HEIGHT;
+	param.line_length	= WIDTH * bpp / 8 + PADDING;
+	param.threshold		= 128;
+	p_image = (unsigned char*) malloc( param.line_length * HEIGHT );
+	if( p_image == NULL ) {
+		printf( "[ERROR] Not enough memory.\n" );
+		return 1;
+	}
+	target = smdd_get_dither_converter( bpp, dither );
+	printf( "%dbpp: %s tone ... ", bpp, smdd_get_dither_name( dither ) );
+
+	errors = 0;
+	last = 0;
+	for( level = 0; level <= 16; level++ ) {
+		//	flat gray: level / 16 of white
+		for( i = 0; i < param.line_length * HEIGHT / (bpp / 8); i++ ) {
+			if( bpp == 32 ) {
+				((uint32_t*) p_image)[i] = (uint32_t)( level * 255 / 16 ) * 0x010101;
+			}
+			else {
+				((uint16_t*) p_image)[i] = (uint16_t)( (level * 31 / 16) * ((1 << 11) | (1 << 6) | 1) );
+			}
+		}
+		param.invert = 0x00;
+		target( &param, p_image, result1 );
+		param.invert = 0xFF;
+		target( &param, p_image, result2 );
+
+		expected	= (bpp == 32) ? (level * 255 / 16) * 1000 / 255 : (level * 31 / 16) * 1000 / 31;
+		actual		= count_bits( result1, sizeof(result1) ) * 1000 / (WIDTH * HEIGHT);
+		if( actual < expected - tolerance || actual > expected + tolerance ) {
+			printf( "\n  tone: level = %d, expected %d/1000, actual %d/1000", level, expected, actual );
+			errors++;
+		}
+		if( actual < last ) {
+			printf( "\n  tone: level = %d is darker than level = %d", level, level - 1 );
+			errors++;
+		}
+		last = actual;
+		for( i = 0; i < (int) sizeof(result1); i++ ) {
+			if( (result1[i] ^ result2[i]) != 0xFF ) {
+				printf( "\n  invert: level = %d, offset = %d", level, i );
+				errors++;
+				break;
+			}
+		}
+	}
+	free( p_image );
+	printf( errors ? "\nNG\n" : "OK\n" );
+	return errors != 0;
+}
+
+// --------------------------------------------------------------------
+//	Time of each converter, compared with the budget for 30fps.
+//
+static void benchmark( int bpp ) {
+	SMDD_CONVERT_PARAM_T param;
+	SMDD_CONVERT_T target;
+	unsigned char *p_image;
+	static unsigned char result[ WIDTH * HEIGHT / 8 ];
+	struct timespec start, end;
+	int mode, i, usec;
+	const char *p_name;
+	const int frames = 30;
+	const int budget = 1000000 / 30;
+
+	param.width			= WIDTH;
+	param.height		= HEIGHT;
+	param.line_length	= WIDTH * bpp / 8 + PADDING;
+	param.threshold		= 128;
+	param.invert		= 0x00;
+	p_image = (unsigned char*) malloc( param.line_length * HEIGHT );
+	if( p_image == NULL ) {
+		printf( "[ERROR] Not enough memory.\n" );
+		return;
+	}
+	make_image( p_image, bpp, param.line_length );
+
+	for( mode = -1; mode <= SMDD_DITHER_ATKINSON; mode++ ) {
+		if( mode == -1 ) {
+			target = smdd_get_converter( bpp, 0 );
+			p_name = smdd_get_converter_name( 0 );
+		}
+		else if( mode == SMDD_DITHER_NONE ) {
+			target = smdd_get_converter( bpp, 1 );
+			p_name = smdd_get_converter_name( 1 );
+		}
+		else {
+			target = smdd_get_dither_converter( bpp, (SMDD_DITHER_T) mode );
+			p_name = smdd_get_dither_name( (SMDD_DITHER_T) mode );
+		}
+		clock_gettime( CLOCK_MONOTONIC, &start );
+		for( i = 0; i < frames; i++ ) {
+			target( &param, p_image, result );
+		}
+		clock_gettime( CLOCK_MONOTONIC, &end );
+		usec = (int)( ((end.tv_sec - start.tv_sec) * 1000000000LL + (end.tv_nsec - start.tv_nsec)) / 1000 / frames );
+		printf( "%dbpp: %-8s %3d.%03d msec/frame (%s for 30fps)\n", bpp, p_name, usec / 1000, usec % 1000, (usec <= budget) ? "OK" : "OVER" );
+	}
+	free( p_image );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int result, bpp;
+
+	result  = test( 32 );
+	result |= test( 16 );
+	for( bpp = 32; bpp >= 16; bpp -= 16 ) {
+		result |= test_dither_tone( bpp, SMDD_DITHER_BAYER4, 70 );
+		result |= test_dither_tone( bpp, SMDD_DITHER_BAYER8, 20 );
+		result |= test_dither_tone( bpp, SMDD_DITHER_FLOYD_STEINBERG, 20 );
+		//	Atkinson drops 1/4 of the error, so light and dark tones go to the ends.
+		result |= test_dither_tone( bpp, SMDD_DITHER_ATKINSON, 130 );
+	}
+	if( argc > 1 && strcmp( argv[1], "-bench" ) == 0 ) {
+		benchmark( 32 );
+		benchmark( 16 );
+	}
+	return result;
+}
@@ -0,0 +1,113 @@
+// --------------------------------------------------------------------
+// Benchmark of SPI transfer
+// ====================================================================
+//	Measures the frame time of smdd_transfer_bitmap() and
+//	smdd_transfer_bitmap_diff() for each transfer mode.
+//	It uses the real display, so run it on the Sangria.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/ipc.h>
+#include <sys/sem.h>
+#include "sharp_memory_display_driver.h"
+
+#define FRAMES			100
+#define FRAME_SIZE		(50 * 240)
+
+static unsigned char image[2][ FRAME_SIZE ];
+static unsigned char last[ FRAME_SIZE ];
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void make_image( void ) {
+	int i;
+
+	//	checker patterns, every line differs between the two images
+	for( i = 0; i < FRAME_SIZE; i++ ) {
+		image[0][i] = ( (i / 50) & 1 ) ? 0x55 : 0xAA;
+		image[1][i] = ~image[0][i];
+	}
+}
+
+// --------------------------------------------------------------------
+static void print_result( const char *p_name, long long total, long long max ) {
+	int average;
+
+	average = (int)( total / FRAMES / 1000 );
+	printf( "%-24s average %3d.%03d msec, max %3d.%03d msec, %5.1f fps\n", p_name,
+		average / 1000, average % 1000, (int)( max / 1000000 ), (int)( (max / 1000) % 1000 ),
+		1000000.0 / average );
+}
+
+// --------------------------------------------------------------------
+static void bench( SMDD_TRANSFER_MODE_T mode, const char *p_name, int do_diff ) {
+	int i;
+	long long start, t, total, max;
+
+	smdd_set_transfer_mode( mode );
+	memcpy( last, image[1], FRAME_SIZE );
+	total = 0;
+	max = 0;
+	for( i = 0; i < FRAMES; i++ ) {
+		start = get_nsec();
+		if( do_diff ) {
+			smdd_transfer_bitmap_diff( image[ i & 1 ], last );
+		}
+		else {
+			smdd_transfer_bitmap( image[ i & 1 ] );
+		}
+		t = get_nsec() - start;
+		total += t;
+		if( max < t ) {
+			max = t;
+		}
+	}
+	print_result( p_name, total, max );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	key_t key;
+	int sem_id;
+	struct sembuf operations;
+
+	if( !smdd_initialize() ) {
+		fprintf( stderr, "[ERROR] Cannot initialize the display.\n" );
+		return 1;
+	}
+
+	//	Lock the display, if sangria_lcd is running.
+	key = ftok( "/usr/local/bin/sangria_lcd", 1 );
+	sem_id = semget( key, 1, 0666 );
+	if( sem_id != -1 ) {
+		operations.sem_num = 0;
+		operations.sem_op = -1;
+		operations.sem_flg = SEM_UNDO;
+		semop( sem_id, &operations, 1 );
+	}
+
+	make_image();
+	printf( "%d frames, every line is changed in each frame\n", FRAMES );
+	bench( SMDD_TRANSFER_LINE,  "full, per line", 0 );
+	bench( SMDD_TRANSFER_BATCH, "full, batched", 0 );
+	bench( SMDD_TRANSFER_LINE,  "diff, per line", 1 );
+	bench( SMDD_TRANSFER_BATCH, "diff, batched", 1 );
+
+	if( sem_id != -1 ) {
+		operations.sem_op = 1;
+		semop( sem_id, &operations, 1 );
+	}
+	smdd_terminate();
+	return 0;
+}
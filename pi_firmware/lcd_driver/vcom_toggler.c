@@ -0,0 +1,245 @@
+// --------------------------------------------------------------------
+// VCOM toggler for sangria_lcd
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <armbianio.h>
+#include "vcom_toggler.h"
+
+#define EXTCOMIN		27
+#define MAX_HZ			60
+#define PRIORITY		50
+
+static pthread_t	thread;
+static int			htimer			= -1;
+static int			hstop			= -1;		//	eventfd to stop the thread
+static volatile int	is_active		= 0;
+static int64_t		half_period		= 0;		//	nanoseconds
+static int			is_realtime		= 0;
+
+//	toggled by vcom_poll() when the thread cannot be used
+static int			is_polled		= 0;
+static int			poll_level		= 0;
+static int64_t		next_toggle		= 0;		//	nanoseconds
+
+//	statistics
+static unsigned long long toggles		= 0;
+static unsigned long long overruns		= 0;
+static int64_t		late_max		= 0;		//	nanoseconds
+static int64_t		late_total		= 0;		//	nanoseconds
+
+// --------------------------------------------------------------------
+static int64_t _get_time( void ) {
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void _add_late( int64_t late, uint64_t expirations ) {
+
+	if( late < 0 ) {
+		late = 0;
+	}
+	toggles++;
+	overruns += expirations - 1;
+	late_total += late;
+	if( late_max < late ) {
+		late_max = late;
+	}
+}
+
+// --------------------------------------------------------------------
+static void *_vcom_thread( void *p_arg ) {
+	struct pollfd fds[2];
+	uint64_t expirations;
+	int64_t start, expected;
+	int level;
+
+	fds[0].fd		= htimer;
+	fds[0].events	= POLLIN;
+	fds[1].fd		= hstop;
+	fds[1].events	= POLLIN;
+	level		= 0;
+	start		= _get_time();
+	expected	= start;
+	while( is_active ) {
+		if( poll( fds, 2, -1 ) <= 0 ) {
+			continue;
+		}
+		if( fds[1].revents || !is_active ) {
+			break;
+		}
+		if( read( htimer, &expirations, sizeof(expirations) ) != sizeof(expirations) ) {
+			continue;
+		}
+		level ^= 1;
+		AIOWriteGPIO( EXTCOMIN, level );
+
+		//	How late this toggle is, compared with the timer period.
+		expected += half_period * (int64_t) expirations;
+		_add_late( _get_time() - expected, expirations );
+	}
+	AIOWriteGPIO( EXTCOMIN, 0 );
+	return NULL;
+}
+
+// --------------------------------------------------------------------
+static void _close_handles( void ) {
+
+	if( htimer != -1 ) {
+		close( htimer );
+		htimer = -1;
+	}
+	if( hstop != -1 ) {
+		close( hstop );
+		hstop = -1;
+	}
+}
+
+// --------------------------------------------------------------------
+//	Without the thread, EXTCOMIN is still toggled by vcom_poll(), so the
+//	panel is not DC-biased.
+//
+static int _use_main_loop( const char *p_reason ) {
+
+	fprintf( stderr, "[WARNING] %s, VCOM is toggled by the main loop.\n", p_reason );
+	_close_handles();
+	is_active	= 0;
+	is_realtime	= 0;
+	is_polled	= 1;
+	poll_level	= 0;
+	next_toggle	= _get_time() + half_period;
+	return 1;
+}
+
+// --------------------------------------------------------------------
+int vcom_initialize( int hz ) {
+	struct itimerspec its;
+	struct sched_param sp;
+	pthread_attr_t attr;
+
+	if( hz <= 0 ) {
+		return 1;
+	}
+	if( hz > MAX_HZ ) {
+		fprintf( stderr, "[WARNING] VCOM frequency is limited to %d Hz.\n", MAX_HZ );
+		hz = MAX_HZ;
+	}
+	//	EXTCOMIN goes high and low once in each period.
+	half_period = 1000000000 / (hz * 2);
+
+	htimer = timerfd_create( CLOCK_MONOTONIC, 0 );
+	if( htimer == -1 ) {
+		return _use_main_loop( "Cannot create timer for VCOM" );
+	}
+	hstop = eventfd( 0, 0 );
+	if( hstop == -1 ) {
+		return _use_main_loop( "Cannot create eventfd for VCOM" );
+	}
+	memset( &its, 0, sizeof(its) );
+	its.it_value.tv_sec		= half_period / 1000000000;
+	its.it_value.tv_nsec	= half_period % 1000000000;
+	its.it_interval			= its.it_value;
+	if( timerfd_settime( htimer, 0, &its, NULL ) == -1 ) {
+		return _use_main_loop( "Cannot start timer for VCOM" );
+	}
+
+	is_active = 1;
+	pthread_attr_init( &attr );
+	pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+	pthread_attr_setschedpolicy( &attr, SCHED_FIFO );
+	sp.sched_priority = PRIORITY;
+	pthread_attr_setschedparam( &attr, &sp );
+	is_realtime = 1;
+	if( pthread_create( &thread, &attr, _vcom_thread, NULL ) != 0 ) {
+		//	Not allowed to use SCHED_FIFO, run as a normal thread.
+		is_realtime = 0;
+		if( pthread_create( &thread, NULL, _vcom_thread, NULL ) != 0 ) {
+			pthread_attr_destroy( &attr );
+			return _use_main_loop( "Cannot create thread for VCOM" );
+		}
+	}
+	pthread_attr_destroy( &attr );
+	return 1;
+}
+
+// --------------------------------------------------------------------
+void vcom_poll( void ) {
+	int64_t now;
+
+	if( !is_polled ) {
+		return;
+	}
+	now = _get_time();
+	if( now < next_toggle ) {
+		return;
+	}
+	poll_level ^= 1;
+	AIOWriteGPIO( EXTCOMIN, poll_level );
+	_add_late( now - next_toggle, 1 + (uint64_t)( (now - next_toggle) / half_period ) );
+	//	The main loop may have been late, the next toggle keeps the period from now.
+	next_toggle = now + half_period;
+}
+
+// --------------------------------------------------------------------
+void vcom_terminate( void ) {
+	uint64_t one = 1;
+
+	if( is_polled ) {
+		is_polled = 0;
+		AIOWriteGPIO( EXTCOMIN, 0 );
+		return;
+	}
+	if( htimer == -1 ) {
+		return;
+	}
+	//	Wake up the thread immediately, also if the timer is broken.
+	is_active = 0;
+	if( write( hstop, &one, sizeof(one) ) != sizeof(one) ) {
+		fprintf( stderr, "[WARNING] Cannot wake up the VCOM thread.\n" );
+	}
+	pthread_join( thread, NULL );
+	_close_handles();
+}
+
+// --------------------------------------------------------------------
+void vcom_print_statistics( FILE *p_file ) {
+
+	if( htimer == -1 && !is_polled ) {
+		fprintf( p_file, "[STATISTICS] VCOM: not toggled\n" );
+		return;
+	}
+	fprintf( p_file, "[STATISTICS] VCOM: %.1f Hz (%s), %llu toggles, %llu overruns, late: avg %.3f ms / max %.3f ms\n",
+			500000000. / half_period, is_polled ? "main loop" : is_realtime ? "SCHED_FIFO" : "SCHED_OTHER", toggles, overruns,
+			toggles ? (double) late_total / toggles / 1000000. : 0., (double) late_max / 1000000. );
+}
@@ -0,0 +1,80 @@
+// --------------------------------------------------------------------
+// VCOM toggler for sangria_lcd
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#ifndef __VCOM_TOGGLER_H__
+#define __VCOM_TOGGLER_H__
+
+#include <stdio.h>
+
+// --------------------------------------------------------------------
+//	vcom_initialize
+//	input)
+//		hz ........... frequency of EXTCOMIN (1 ... 60), 0: do not toggle
+//	output)
+//		0 ..... Failed.
+//		!0 .... Success.
+//	comment)
+//		EXTCOMIN is toggled by its own thread, which is woken by a timerfd.
+//		It keeps running while no frame is transferred, so the panel is not
+//		DC-biased on idle screens.
+//		The thread runs with SCHED_FIFO if it is allowed.
+//		If the timer or the thread cannot be used, EXTCOMIN is toggled by
+//		vcom_poll() instead, as often as the main loop wakes up.
+//		Call after smdd_initialize(), which sets EXTCOMIN as an output.
+// --------------------------------------------------------------------
+int vcom_initialize( int hz );
+
+// --------------------------------------------------------------------
+//	vcom_poll
+//	input)
+//		none
+//	output)
+//		none
+//	comment)
+//		Toggles EXTCOMIN if its half period has passed, only while the
+//		thread is not used. Call on each turn of the main loop.
+// --------------------------------------------------------------------
+void vcom_poll( void );
+
+// --------------------------------------------------------------------
+//	vcom_terminate
+//	input)
+//		none
+//	output)
+//		none
+//	comment)
+//		Stops the thread through an eventfd, so it does not depend on the
+//		timer, and drives EXTCOMIN low.
+// --------------------------------------------------------------------
+void vcom_terminate( void );
+
+// --------------------------------------------------------------------
+//	vcom_print_statistics
+//	input)
+//		p_file ....... output stream
+//	output)
+//		none
+// --------------------------------------------------------------------
+void vcom_print_statistics( FILE *p_file );
+
+#endif
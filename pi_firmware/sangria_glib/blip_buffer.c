@@ -0,0 +1,117 @@
+// --------------------------------------------------------------------
+// Band-limited step buffer
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+
+#include <math.h>
+#include <string.h>
+#include <stdint.h>
+#include <blip_buffer.h>
+
+#define PHASES				(1 << BLIP_PHASE_BITS)
+#define LEVEL_BITS			15			//	a kernel is 1 << LEVEL_BITS in total
+#define CUTOFF				0.45		//	of the sample rate
+#define PI					3.14159265358979
+
+static int16_t kernel[ PHASES ][ BLIP_TAPS ];
+static int is_kernel_ready = 0;
+
+// --------------------------------------------------------------------
+//	Windowed sinc (Blackman) of BLIP_TAPS samples.
+//
+static double _impulse( double x ) {
+	double y;
+
+	if( x <= -BLIP_TAPS / 2 || x >= BLIP_TAPS / 2 ) {
+		return 0.;
+	}
+	y = (x == 0.) ? 2. * CUTOFF : sin( 2. * PI * CUTOFF * x ) / (PI * x);
+	return y * (0.42 + 0.5 * cos( PI * x / (BLIP_TAPS / 2) ) + 0.08 * cos( 2. * PI * x / (BLIP_TAPS / 2) ));
+}
+
+// --------------------------------------------------------------------
+//	Tap k of a step at n + phase is added to sample n + k, that is the
+//	time n + k - BLIP_DELAY. The sum of the taps to a sample is the
+//	band-limited step at it, so a tap is the rise of the step in the
+//	sample before it (not the impulse at it, which boosts the highs).
+//
+static void _make_kernel( void ) {
+	//	integral of the impulse from -(BLIP_TAPS / 2 + 1), by 1 / PHASES
+	double step[ (BLIP_TAPS + 2) * PHASES + 1 ];
+	int i, p, k, index, sum, center;
+
+	step[0] = 0.;
+	for( i = 1; i <= (BLIP_TAPS + 2) * PHASES; i++ ) {
+		step[i] = step[ i - 1 ] + (_impulse( (double)( i - 1 ) / PHASES - (BLIP_TAPS / 2 + 1) ) +
+			_impulse( (double) i / PHASES - (BLIP_TAPS / 2 + 1) )) / (2 * PHASES);
+	}
+	for( p = 0; p < PHASES; p++ ) {
+		sum = 0;
+		for( k = 0; k < BLIP_TAPS; k++ ) {
+			//	step( k - BLIP_DELAY - phase ) - step( k - 1 - BLIP_DELAY - phase )
+			index = (k - BLIP_DELAY + BLIP_TAPS / 2 + 1) * PHASES - p;
+			kernel[p][k] = (int16_t) floor( (step[ index ] - step[ index - PHASES ]) / step[ (BLIP_TAPS + 2) * PHASES ] * (1 << LEVEL_BITS) + 0.5 );
+			sum += kernel[p][k];
+		}
+		//	the rounding error goes to the center, so a step is exactly the delta at the end
+		center = (p < PHASES / 2) ? BLIP_DELAY : BLIP_DELAY + 1;
+		kernel[p][ center ] += (1 << LEVEL_BITS) - sum;
+	}
+	is_kernel_ready = 1;
+}
+
+// --------------------------------------------------------------------
+void blip_clear( BLIP_BUFFER_T *pblip, int level ) {
+
+	if( !is_kernel_ready ) {
+		_make_kernel();
+	}
+	pblip->integrator = level << LEVEL_BITS;
+	memset( pblip->delta, 0, sizeof(pblip->delta) );
+}
+
+// --------------------------------------------------------------------
+void blip_add_delta( BLIP_BUFFER_T *pblip, uint32_t time, int delta ) {
+	const int16_t *pkernel;
+	int32_t *pdelta;
+	int k;
+
+	pdelta	= pblip->delta + (time >> BLIP_TIME_BITS);
+	pkernel	= kernel[ (time >> (BLIP_TIME_BITS - BLIP_PHASE_BITS)) & (PHASES - 1) ];
+	for( k = 0; k < BLIP_TAPS; k++ ) {
+		pdelta[k] += delta * pkernel[k];
+	}
+}
+
+// --------------------------------------------------------------------
+void blip_read_samples( BLIP_BUFFER_T *pblip, int16_t *pwave, int samples ) {
+	int32_t sum;
+	int i;
+
+	sum = pblip->integrator;
+	for( i = 0; i < samples; i++ ) {
+		sum += pblip->delta[i];
+		pwave[i] = (int16_t)( (sum + (1 << (LEVEL_BITS - 1))) >> LEVEL_BITS );
+	}
+	pblip->integrator = sum;
+	memmove( pblip->delta, pblip->delta + samples, BLIP_TAPS * sizeof(int32_t) );
+	memset( pblip->delta + BLIP_TAPS, 0, samples * sizeof(int32_t) );
+}
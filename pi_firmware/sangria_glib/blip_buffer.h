@@ -0,0 +1,90 @@
+// --------------------------------------------------------------------
+// Band-limited step buffer
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+//	A level that changes in steps (a square wave, the noise) is made
+//	band-limited by adding each change as a windowed sinc impulse at the
+//	exact time of it, between the output samples. The impulses are
+//	integrated once for each block of samples, so the cost is for each
+//	step, not for each clock of the sound chip.
+//	The output is BLIP_DELAY samples later than the steps.
+// --------------------------------------------------------------------
+
+#ifndef __BLIP_BUFFER_H__
+#define __BLIP_BUFFER_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BLIP_TIME_BITS		16			//	time is a fixed point number of samples
+#define BLIP_PHASE_BITS		8			//	256 positions between 2 samples
+#define BLIP_TAPS			16
+#define BLIP_DELAY			7			//	samples
+#define BLIP_BLOCK			1024		//	max samples in a block
+
+typedef struct {
+	int32_t		integrator;
+	int32_t		delta[ BLIP_BLOCK + BLIP_TAPS ];
+} BLIP_BUFFER_T;
+
+// --------------------------------------------------------------------
+//	blip_clear
+//	input)
+//		pblip ........ Buffer
+//		level ........ Level of the output before the first step
+//	output)
+//		none
+// --------------------------------------------------------------------
+void blip_clear( BLIP_BUFFER_T *pblip, int level );
+
+// --------------------------------------------------------------------
+//	blip_add_delta
+//	input)
+//		pblip ........ Buffer
+//		time ......... Time of the step from the start of the block
+//		               (samples << BLIP_TIME_BITS, BLIP_BLOCK samples or less)
+//		delta ........ Change of the level
+//	output)
+//		none
+// --------------------------------------------------------------------
+void blip_add_delta( BLIP_BUFFER_T *pblip, uint32_t time, int delta );
+
+// --------------------------------------------------------------------
+//	blip_read_samples
+//	input)
+//		pblip ........ Buffer
+//		pwave ........ Wave memory address
+//		samples ...... Samples of the block (BLIP_BLOCK or less)
+//	output)
+//		none
+//	comment)
+//		The next block starts at the end of this block.
+// --------------------------------------------------------------------
+void blip_read_samples( BLIP_BUFFER_T *pblip, int16_t *pwave, int samples );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
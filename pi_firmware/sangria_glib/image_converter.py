@@ -9,28 +9,200 @@
 # -----------------------------------------------------------------------------
 
 from PIL import Image
+import struct
 import sys
 
 # -----------------------------------------------------------------------------
 def usage():
-	print( "Usage: %s <input.png> <output>" % sys.argv[0] )
+	print( "Usage: %s [-a] [-u] [-t <W>x<H>] <input.png> <output>" % sys.argv[0] )
 	print( "  <output>.c and <output>.h are generated." )
 	print( "  It is the definition of an array." )
 	print( "  The array variable name is <input>." )
+	print( "  -a ........ <output>.sga is generated instead, it is loaded by" )
+	print( "              sangria_load_image() or sangria_load_tilemap()." )
+	print( "  -u ........ the image of <output>.sga is not compressed." )
+	print( "  -t WxH .... the image of <output>.sga is a tile sheet of WxH tiles" )
+	print( "              without duplicates, and a map of them." )
 
 # -----------------------------------------------------------------------------
-def main():
-	im = Image.open( sys.argv[1] )
+#  Sangria asset (.sga): little endian
+#	+0  "SGA1"
+#	+4  compression (0: none, 1: LZ)
+#	+8  bytes of the image data
+#	+12 tile width, tile height, map width, map height (0: not tiled)
+#	+28 reserved (0)
+#	+32 SANGRIA_BACKBUFFER_T: width, height, dirty_top, dirty_bottom, format
+#	+52 image data: the image[] of SANGRIA_FORMAT_1BPP
+#	    map: uint16 x map width x map height (tiled only)
+#
+#  LZ is the block format of LZ4: a token (literal length << 4 | match
+#  length - 4), literals, a 16 bit offset and extra length bytes of 255.
+# -----------------------------------------------------------------------------
+SANGRIA_FORMAT_1BPP		= 1
+SANGRIA_TILEMAP_EMPTY	= 0xFFFF
+SHEET_COLUMNS			= 16
+
+# -----------------------------------------------------------------------------
+def get_pixel( rgb, x, y ):
+	( r, g, b ) = rgb.getpixel( ( x, y ) )
+	if ( b > r * 2 ) or ( g > b * 2 ) or ( r > b * 2 ):
+		return 0		# transparent
+	elif ( r + g + b ) > ( 128 * 3 ):
+		return 1		# white
+	else:
+		return 255		# black
+
+# -----------------------------------------------------------------------------
+def pack_1bpp( pixels, width, height ):
+	stride = ( width + 7 ) >> 3
+	pixel_plane = bytearray( stride * height )
+	mask_plane = bytearray( stride * height )
+	for y in range( 0, height ):
+		for x in range( 0, width ):
+			d = pixels[ x + y * width ]
+			bit = 0x80 >> ( x & 7 )
+			if d < 128:
+				pixel_plane[ ( x >> 3 ) + y * stride ] |= bit
+			if d != 0:
+				mask_plane[ ( x >> 3 ) + y * stride ] |= bit
+	return pixel_plane + mask_plane
+
+# -----------------------------------------------------------------------------
+def lz_length( n ):
+	out = bytearray()
+	while n >= 255:
+		out.append( 255 )
+		n = n - 255
+	out.append( n )
+	return out
+
+# -----------------------------------------------------------------------------
+def lz_sequence( literals, offset, match ):
+	out = bytearray()
+	lit = len( literals )
+	token = min( lit, 15 ) << 4
+	if match:
+		token = token | min( match - 4, 15 )
+	out.append( token )
+	if lit >= 15:
+		out += lz_length( lit - 15 )
+	out += literals
+	if match:
+		out += bytes( ( offset & 255, offset >> 8 ) )
+		if match - 4 >= 15:
+			out += lz_length( match - 4 - 15 )
+	return out
+
+# -----------------------------------------------------------------------------
+def lz_compress( data ):
+	out = bytearray()
+	table = {}
+	size = len( data )
+	anchor = 0
+	i = 0
+	while i + 4 <= size:
+		key = bytes( data[ i : i + 4 ] )
+		j = table.get( key )
+		table[ key ] = i
+		if ( j is None ) or ( i - j > 65535 ):
+			i = i + 1
+			continue
+		match = 4
+		while ( i + match < size ) and ( data[ j + match ] == data[ i + match ] ):
+			match = match + 1
+		out += lz_sequence( data[ anchor : i ], i - j, match )
+		i = i + match
+		anchor = i
+	out += lz_sequence( data[ anchor : ], 0, 0 )
+	return out
+
+# -----------------------------------------------------------------------------
+def make_tiles( pixels, width, height, tile_width, tile_height ):
+	map_width = ( width + tile_width - 1 ) // tile_width
+	map_height = ( height + tile_height - 1 ) // tile_height
+	tiles = []
+	index = {}
+	tile_map = []
+	for ty in range( 0, map_height ):
+		for tx in range( 0, map_width ):
+			tile = []
+			for y in range( ty * tile_height, ( ty + 1 ) * tile_height ):
+				for x in range( tx * tile_width, ( tx + 1 ) * tile_width ):
+					tile.append( pixels[ x + y * width ] if ( x < width and y < height ) else 0 )
+			tile = tuple( tile )
+			if not any( tile ):
+				tile_map.append( SANGRIA_TILEMAP_EMPTY )
+				continue
+			if tile not in index:
+				index[ tile ] = len( tiles )
+				tiles.append( tile )
+			tile_map.append( index[ tile ] )
+	columns = max( 1, min( SHEET_COLUMNS, len( tiles ) ) )
+	sheet_width = columns * tile_width
+	sheet_height = max( 1, ( len( tiles ) + columns - 1 ) // columns ) * tile_height
+	sheet = [ 0 ] * ( sheet_width * sheet_height )
+	for n in range( 0, len( tiles ) ):
+		left = ( n % columns ) * tile_width
+		top = ( n // columns ) * tile_height
+		for y in range( 0, tile_height ):
+			for x in range( 0, tile_width ):
+				sheet[ left + x + ( top + y ) * sheet_width ] = tiles[ n ][ x + y * tile_width ]
+	return ( sheet, sheet_width, sheet_height, tile_map, map_width, map_height, len( tiles ) )
+
+# -----------------------------------------------------------------------------
+def write_asset( file_name, pixels, width, height, is_compressed, tile_size ):
+	tile_width = tile_height = map_width = map_height = 0
+	tile_map = []
+	if tile_size:
+		( tile_width, tile_height ) = tile_size
+		( pixels, width, height, tile_map, map_width, map_height, count ) = make_tiles( pixels, width, height, tile_width, tile_height )
+		print( "%d tiles, map %d x %d" % ( count, map_width, map_height ) )
+	data = pack_1bpp( pixels, width, height )
+	if is_compressed:
+		data = lz_compress( data )
+	f = open( file_name, "wb" )
+	f.write( b"SGA1" )
+	f.write( struct.pack( "<7I", 1 if is_compressed else 0, len( data ), tile_width, tile_height, map_width, map_height, 0 ) )
+	f.write( struct.pack( "<5i", width, height, 0, -1, SANGRIA_FORMAT_1BPP ) )
+	f.write( data )
+	f.write( struct.pack( "<%dH" % len( tile_map ), *tile_map ) )
+	f.close()
+	print( "Generated %s (%d bytes)" % ( file_name, 52 + len( data ) + 2 * len( tile_map ) ) )
+
+# -----------------------------------------------------------------------------
+def main( args ):
+	is_asset = False
+	is_compressed = True
+	tile_size = None
+	while len( args ) > 0 and args[0].startswith( '-' ):
+		if args[0] == '-a':
+			is_asset = True
+		elif args[0] == '-u':
+			is_compressed = False
+		elif args[0] == '-t':
+			tile_size = tuple( int( n ) for n in args[1].split( 'x' ) )
+			args = args[1:]
+		args = args[1:]
+	if len( args ) < 2:
+		usage()
+		return
+
+	im = Image.open( args[0] )
 	( width, height ) = im.size
 	rgb = im.convert( 'RGB' )
 
-	a_path = sys.argv[1].split( '/' )
+	a_path = args[0].split( '/' )
 	a_full_name = a_path[-1].split( '.' )
 	s_name = a_full_name[0]
 	print( "%s ( %d x %d )" % ( s_name, width, height ) )
 
+	if is_asset:
+		pixels = [ get_pixel( rgb, x, y ) for y in range( 0, height ) for x in range( 0, width ) ]
+		write_asset( "%s.sga" % args[1], pixels, width, height, is_compressed, tile_size )
+		return
+
 	byte_count = 0
-	f = open( "%s.c" % sys.argv[2], "w" )
+	f = open( "%s.c" % args[1], "w" )
 	f.write( "// --------------------------------------------------------------------\n" )
 	f.write( "//  Graphic data: [%s]\n" % a_path[-1] )
 	f.write( "// --------------------------------------------------------------------\n" )
@@ -40,21 +212,18 @@ def main():
 	f.write( "typedef struct {\n" )
 	f.write( "\tint32_t\twidth;\n" )
 	f.write( "\tint32_t\theight;\n" )
+	f.write( "\tint32_t\tdirty_top;\n" )
+	f.write( "\tint32_t\tdirty_bottom;\n" )
+	f.write( "\tint32_t\tformat;\n" )
 	f.write( "\tuint8_t\t\timage[%d];\n" % ( width * height ) )
 	f.write( "} _BACKBUFFER_T;\n" )
 	f.write( "\n" )
 	f.write( "const _BACKBUFFER_T _%s = {\n" % s_name )
-	f.write( "\t%d, %d, {\n" % ( width, height ) )
+	f.write( "\t%d, %d, 0, -1, 0, {\n" % ( width, height ) )
 	f.write( "\t\t" )
 	for y in range( 0, height ):
 		for x in range( 0, width ):
-			( r, g, b ) = rgb.getpixel( ( x, y ) )
-			if ( b > r * 2 ) or ( g > b * 2 ) or ( r > b * 2 ):
-				d = 0		# transparent
-			elif ( r + g + b ) > ( 128 * 3 ):
-				d = 1		# white
-			else:
-				d = 255		# black
+			d = get_pixel( rgb, x, y )
 			f.write( "0x%02X, " % ( d ) )
 			byte_count = byte_count + 1
 			if  byte_count >= 16:
@@ -64,7 +233,7 @@ def main():
 	f.write( "};\n" )
 	f.close()
 
-	f = open( "%s.h" % sys.argv[2], "w" )
+	f = open( "%s.h" % args[1], "w" )
 	f.write( "// --------------------------------------------------------------------\n" )
 	f.write( "//  Graphic data: [%s]\n" % a_path[-1] )
 	f.write( "// --------------------------------------------------------------------\n" )
@@ -91,4 +260,4 @@ if __name__ == "__main__":
 	if len( sys.argv ) < 3:
 		usage()
 	else:
-		main()
+		main( sys.argv[1:] )
@@ -27,6 +27,7 @@
 #include <stdint.h>
 #include <unistd.h>
 #include <psg_emulator.h>
+#include <blip_buffer.h>
 #include <stdio.h>
 
 typedef struct {
@@ -54,6 +55,9 @@ typedef struct {
 	uint32_t	noise_seed;
 	int			noise_count;
 	int			last_noise;
+	int			is_written;			//	levels are updated at the next tick
+	int			is_band_limited;
+	BLIP_BUFFER_T	blip;
 } PSG_T;
 
 #ifndef SAMPLE_RATE
@@ -76,6 +80,26 @@ static const int volume_table[] = {
 #define ENVELOPE_ATTACK		2
 #define ENVELOPE_CONT		3
 #define BIT( d, n )			(((d) >> (n)) & 1)
+#define MAX_TICKS			(1 << 24)
+
+//	clocks to the time of blip_buffer, and the time from the clock of a
+//	sample (floor of sample x PSG_CLOCK / SAMPLE_RATE) to the sample itself,
+//	rem is the remainder of the division
+#define CLOCK_TO_TIME		((uint32_t)( ((uint64_t) SAMPLE_RATE << 32) / PSG_CLOCK ))
+#define BLIP_TIME( c )		((uint32_t)( ((uint64_t)(c) * CLOCK_TO_TIME) >> (32 - BLIP_TIME_BITS) ))
+#define BLIP_REM_TIME( rem )	((uint32_t)( ((uint64_t)(rem) << BLIP_TIME_BITS) / PSG_CLOCK ))
+
+//	The tone counters step every 16 clocks (a tick), and the noise and
+//	the envelope step every other tick (a slow tick, clock_div32 = 0).
+//	A level changes only at a tick where a counter that feeds an audible
+//	channel reaches 0 (an event), so the clocks between two events are
+//	not stepped one by one: the counters are advanced at once, and the
+//	levels are summed as level x clocks.
+typedef struct {
+	int			is_tone[3];			//	tone of the channel is heard
+	int			is_noise;
+	int			is_envelope;
+} PSG_SOURCE_T;
 
 // --------------------------------------------------------------------
 H_PSG_T psg_initialize( void ) {
@@ -98,36 +122,23 @@ void psg_terminate( H_PSG_T hpsg ) {
 }
 
 // --------------------------------------------------------------------
-static int _tone_generator( PSG_T *ppsg, PSG_1CH_T *pch, int noise ) {
-	int index;
+//	A counter that is reloaded with period - 1 after 0, as the counters
+//	of the PSG (period 0 is 1). Returns the number of reloads in steps.
+//
+static inline int _count_down( int *p_counter, int period, int steps ) {
+	int n;
 
-	if( (ppsg->clock_div32 & 15) != 0 ) {
-		return pch->last_level;
+	if( steps <= *p_counter ) {
+		*p_counter -= steps;
+		return 0;
 	}
-
-	if( pch->counter == 0 ) {
-		if( pch->periodic_register ) {
-			pch->counter	= pch->periodic_register - 1;
-		}
-		pch->tone		= 1 - pch->tone;
+	steps -= *p_counter + 1;
+	if( period < 1 ) {
+		period = 1;
 	}
-	else {
-		pch->counter--;
-	}
-
-	if( ((pch->tone_enable == 0 || pch->tone == 1) && (pch->noise_enable == 0 || noise == 1)) == 0 ) {
-		pch->last_level = 0;
-	}
-	else {
-		if( pch->envelope_enable ) {
-			index = ppsg->envelope;
-		}
-		else {
-			index = pch->volume;
-		}
-		pch->last_level = volume_table[ index ];
-	}
-	return pch->last_level;
+	n = 1 + steps / period;
+	*p_counter = period - 1 - steps % period;
+	return n;
 }
 
 // --------------------------------------------------------------------
@@ -185,69 +196,87 @@ static int _tone_generator( PSG_T *ppsg, PSG_1CH_T *pch, int noise ) {
 //  /  |________________________ 1111 : state    31, 30, 29, ... , 16, 15, 15, 15, ...
 //                                      envelope  0,  1,  2, ... , 15, 0 , 0 , 0 , ...
 //
-static void inline _envelope_generator( PSG_T *ppsg ) {
+static void _envelope_step( PSG_T *ppsg ) {
 	int envelope;
 
-	if( ppsg->clock_div32 == 0 ) {
-		if( ppsg->envelope_counter == 0 ) {
-			if( ppsg->envelope_period ) {
-				ppsg->envelope_counter = ppsg->envelope_period - 1;
-			}
+	if( ppsg->envelope_period ) {
+		ppsg->envelope_counter = ppsg->envelope_period - 1;
+	}
 
-			if( BIT(ppsg->envelope_state, 4) != 0 ) {
-				//	case of state = 31...16
-				envelope = ppsg->envelope_state & 15;
-				if( BIT(ppsg->envelope_type, ENVELOPE_ATTACK) != 0 ) {
-					envelope = envelope ^ 15;
-				}
-			}
-			else {
-				//	case of state = 15...0
-				if( BIT(ppsg->envelope_type, ENVELOPE_CONT) == 0 ) {
-					//	case of "type = 00XX"
-					//	case of "type = 01XX"
-					envelope = 0;
-				}
-				else {
-					envelope = ppsg->envelope_state & 15;
-					if( (BIT(ppsg->envelope_type, ENVELOPE_ATTACK) ^ BIT(ppsg->envelope_type, ENVELOPE_ALTER) ^ BIT(ppsg->envelope_type, ENVELOPE_HOLD)) != 0 ) {
-						//	case of 9 (100), 10 (101), 12 (110), 15 (111)
-						envelope = envelope ^ 15;
-					}
-				}
-			}
-			ppsg->envelope = envelope;
-
-			if( ppsg->envelope_state != 0 ) {
-				if( (BIT(ppsg->envelope_state, 4) == 0) && (BIT(ppsg->envelope_type, ENVELOPE_HOLD) != 0 || BIT(ppsg->envelope_type, ENVELOPE_CONT) == 0) ) {
-					//	HOLD (state = 15)
-				}
-				else {
-					//	case of state = 31...16 or case of "type = 1XX0"
-					ppsg->envelope_state = (ppsg->envelope_state - 1) & 31;
-				}
-			}
-			else {
-				if( BIT(ppsg->envelope_type, ENVELOPE_CONT) == 0 ) {
-					ppsg->envelope_state = 0;
-				}
-				else {
-					ppsg->envelope_state = 31;
-				}
+	if( BIT(ppsg->envelope_state, 4) != 0 ) {
+		//	case of state = 31...16
+		envelope = ppsg->envelope_state & 15;
+		if( BIT(ppsg->envelope_type, ENVELOPE_ATTACK) != 0 ) {
+			envelope = envelope ^ 15;
+		}
+	}
+	else {
+		//	case of state = 15...0
+		if( BIT(ppsg->envelope_type, ENVELOPE_CONT) == 0 ) {
+			//	case of "type = 00XX"
+			//	case of "type = 01XX"
+			envelope = 0;
+		}
+		else {
+			envelope = ppsg->envelope_state & 15;
+			if( (BIT(ppsg->envelope_type, ENVELOPE_ATTACK) ^ BIT(ppsg->envelope_type, ENVELOPE_ALTER) ^ BIT(ppsg->envelope_type, ENVELOPE_HOLD)) != 0 ) {
+				//	case of 9 (100), 10 (101), 12 (110), 15 (111)
+				envelope = envelope ^ 15;
 			}
 		}
+	}
+	ppsg->envelope = envelope;
+
+	if( ppsg->envelope_state != 0 ) {
+		if( (BIT(ppsg->envelope_state, 4) == 0) && (BIT(ppsg->envelope_type, ENVELOPE_HOLD) != 0 || BIT(ppsg->envelope_type, ENVELOPE_CONT) == 0) ) {
+			//	HOLD (state = 15)
+		}
+		else {
+			//	case of state = 31...16 or case of "type = 1XX0"
+			ppsg->envelope_state = (ppsg->envelope_state - 1) & 31;
+		}
+	}
+	else {
+		if( BIT(ppsg->envelope_type, ENVELOPE_CONT) == 0 ) {
+			ppsg->envelope_state = 0;
+		}
 		else {
-			ppsg->envelope_counter--;
+			ppsg->envelope_state = 31;
 		}
 	}
 }
 
 // --------------------------------------------------------------------
-static int inline _noise_generator( PSG_T *ppsg ) {
+//	The state does not change in the next step.
+//
+static inline int _is_envelope_held( PSG_T *ppsg ) {
+
+	return BIT(ppsg->envelope_state, 4) == 0 && (BIT(ppsg->envelope_type, ENVELOPE_HOLD) != 0 || BIT(ppsg->envelope_type, ENVELOPE_CONT) == 0);
+}
+
+// --------------------------------------------------------------------
+static void _envelope_advance( PSG_T *ppsg, int steps ) {
+	int is_held;
+
+	while( steps > ppsg->envelope_counter ) {
+		steps -= ppsg->envelope_counter + 1;
+		ppsg->envelope_counter = 0;
+		is_held = _is_envelope_held( ppsg );
+		_envelope_step( ppsg );
+		if( is_held ) {
+			//	the same envelope in all the later steps
+			_count_down( &ppsg->envelope_counter, ppsg->envelope_period, steps );
+			return;
+		}
+	}
+	ppsg->envelope_counter -= steps;
+}
 
-	if( ppsg->clock_div32 ) return ppsg->last_noise;
+// --------------------------------------------------------------------
+static void _noise_advance( PSG_T *ppsg, int steps ) {
 
-	if( ppsg->noise_count == 0 ) {
+	while( steps > ppsg->noise_count ) {
+		steps -= ppsg->noise_count + 1;
 		ppsg->last_noise = BIT(ppsg->noise_seed,16);
 		if( (ppsg->noise_seed & 0x0FFFF) != 0 ) {
 			ppsg->noise_seed = ( (ppsg->noise_seed << 1) | (BIT(ppsg->noise_seed,16) ^ BIT(ppsg->noise_seed,14)) ) & 0x1FFFF;
@@ -255,39 +284,197 @@ static int inline _noise_generator( PSG_T *ppsg ) {
 		else {
 			ppsg->noise_seed = 1;
 		}
-		if( ppsg->registers[6] ) {
-			ppsg->noise_count = (int) ppsg->registers[6] - 1;
+		ppsg->noise_count = ppsg->registers[6] ? (int) ppsg->registers[6] - 1 : 0;
+	}
+	ppsg->noise_count -= steps;
+}
+
+// --------------------------------------------------------------------
+//	Advances the counters by ticks, and clock_div32 by clocks.
+//
+static void _advance( PSG_T *ppsg, int ticks, int clocks ) {
+	int ch, slow_ticks;
+
+	//	the first tick is a slow tick if clock_div32 is 16 ... 31
+	slow_ticks = BIT(ppsg->clock_div32, 4) ? (ticks + 1) >> 1 : ticks >> 1;
+	for( ch = 0; ch < 3; ch++ ) {
+		ppsg->channel[ch].tone ^= _count_down( &ppsg->channel[ch].counter, ppsg->channel[ch].periodic_register, ticks ) & 1;
+	}
+	_noise_advance( ppsg, slow_ticks );
+	_envelope_advance( ppsg, slow_ticks );
+	ppsg->clock_div32 = (ppsg->clock_div32 + clocks) & 31;
+}
+
+// --------------------------------------------------------------------
+static void _get_sources( PSG_T *ppsg, PSG_SOURCE_T *psrc ) {
+	PSG_1CH_T *pch;
+	int ch, is_heard;
+
+	psrc->is_noise		= 0;
+	psrc->is_envelope	= 0;
+	for( ch = 0; ch < 3; ch++ ) {
+		pch					= &ppsg->channel[ch];
+		is_heard			= pch->envelope_enable || pch->volume != 0;
+		psrc->is_tone[ch]	= is_heard && pch->tone_enable;
+		psrc->is_noise		|= is_heard && pch->noise_enable;
+		psrc->is_envelope	|= pch->envelope_enable;
+	}
+}
+
+// --------------------------------------------------------------------
+//	Ticks to the next event, 1 is the next tick.
+//
+static int _ticks_to_event( PSG_T *ppsg, const PSG_SOURCE_T *psrc ) {
+	int ch, ticks, first_slow;
+
+	if( ppsg->is_written ) {
+		return 1;
+	}
+	ticks = MAX_TICKS;
+	for( ch = 0; ch < 3; ch++ ) {
+		if( psrc->is_tone[ch] && ppsg->channel[ch].counter < ticks ) {
+			ticks = ppsg->channel[ch].counter + 1;
+		}
+	}
+	first_slow = BIT(ppsg->clock_div32, 4) ? 1 : 2;
+	if( psrc->is_noise && first_slow + 2 * ppsg->noise_count < ticks ) {
+		ticks = first_slow + 2 * ppsg->noise_count;
+	}
+	if( psrc->is_envelope && first_slow + 2 * ppsg->envelope_counter < ticks ) {
+		ticks = first_slow + 2 * ppsg->envelope_counter;
+	}
+	return ticks;
+}
+
+// --------------------------------------------------------------------
+//	Levels of the channels at a tick, returns the sum of them.
+//
+static int _update_levels( PSG_T *ppsg ) {
+	PSG_1CH_T *pch;
+	int ch, index, sum;
+
+	sum = 0;
+	for( ch = 0; ch < 3; ch++ ) {
+		pch = &ppsg->channel[ch];
+		if( ((pch->tone_enable == 0 || pch->tone == 1) && (pch->noise_enable == 0 || ppsg->last_noise == 1)) == 0 ) {
+			pch->last_level = 0;
 		}
+		else {
+			if( pch->envelope_enable ) {
+				index = ppsg->envelope;
+			}
+			else {
+				index = pch->volume;
+			}
+			pch->last_level = volume_table[ index ];
+		}
+		sum += pch->last_level;
 	}
-	else {
-		ppsg->noise_count--;
+	ppsg->is_written = 0;
+	return sum;
+}
+
+// --------------------------------------------------------------------
+//	Each change of the sum is a step of blip_buffer at its clock, and the
+//	clocks between the events are not seen at all.
+//
+static void _generate_band_limited( PSG_T *ppsg, int16_t *pwave, int samples ) {
+	int n, clocks, offset, to_tick, to_event, ticks, skip, sum, new_sum;
+	uint32_t end_clock, start_time;
+	PSG_SOURCE_T src;
+
+	_get_sources( ppsg, &src );
+	ticks	= _ticks_to_event( ppsg, &src );
+	sum		= ppsg->channel[0].last_level + ppsg->channel[1].last_level + ppsg->channel[2].last_level;
+	for( ; samples > 0; samples -= n, pwave += n ) {
+		n = (samples < BLIP_BLOCK) ? samples : BLIP_BLOCK;
+		end_clock	= (uint32_t)( (uint64_t)( ppsg->samples + n ) * PSG_CLOCK / SAMPLE_RATE );
+		clocks		= (int)( end_clock - ppsg->clock );
+		start_time	= BLIP_REM_TIME( (uint64_t) ppsg->samples * PSG_CLOCK % SAMPLE_RATE );
+		offset		= 0;
+		for( ;; ) {
+			to_event = 16 - (ppsg->clock_div32 & 15) + 16 * (ticks - 1);
+			if( offset + to_event > clocks ) {
+				break;
+			}
+			_advance( ppsg, ticks, to_event );
+			offset	+= to_event;
+			new_sum	= _update_levels( ppsg );
+			if( new_sum != sum ) {
+				blip_add_delta( &ppsg->blip, BLIP_TIME( offset ) - start_time, new_sum - sum );
+				sum = new_sum;
+			}
+			ticks = _ticks_to_event( ppsg, &src );
+		}
+		to_tick	= 16 - (ppsg->clock_div32 & 15);
+		skip	= (clocks - offset < to_tick) ? 0 : 1 + (clocks - offset - to_tick) / 16;
+		_advance( ppsg, skip, clocks - offset );
+		ticks	-= skip;
+		blip_read_samples( &ppsg->blip, pwave, n );
+		ppsg->clock		= end_clock;
+		ppsg->samples	+= n;
+		if( ppsg->samples >= SAMPLE_RATE ) {
+			ppsg->clock		-= PSG_CLOCK;
+			ppsg->samples	-= SAMPLE_RATE;
+		}
 	}
-	return ppsg->last_noise;
 }
 
 // --------------------------------------------------------------------
 void psg_generate_wave( H_PSG_T hpsg, int16_t *pwave, int samples ) {
-	int i, j, ch0, ch1, ch2, noise, next_clock, level;
+	int i, clocks, to_tick, to_event, ticks, skip, sum, level;
+	uint32_t next_clock, fraction;
+	PSG_SOURCE_T src;
 	PSG_T *ppsg = (PSG_T*) hpsg;
 
-	ch0 = ch1 = ch2 = 0;
+	if( ppsg->is_band_limited ) {
+		_generate_band_limited( ppsg, pwave, samples );
+		return;
+	}
+	//	the registers are not written while a block is made
+	_get_sources( ppsg, &src );
+	ticks		= _ticks_to_event( ppsg, &src );
+	sum			= ppsg->channel[0].last_level + ppsg->channel[1].last_level + ppsg->channel[2].last_level;
+	//	next_clock = samples * PSG_CLOCK / SAMPLE_RATE, without a division for each sample
+	next_clock	= (uint32_t)( (uint64_t) ppsg->samples * PSG_CLOCK / SAMPLE_RATE );
+	fraction	= (uint32_t)( (uint64_t) ppsg->samples * PSG_CLOCK % SAMPLE_RATE );
 	for( i = 0; i < samples; i++ ) {
-		next_clock = (uint32_t)( (uint64_t) ppsg->samples * PSG_CLOCK / SAMPLE_RATE );
-
-		level = 0;
-		for( j = ppsg->clock; j < next_clock; j++ ) {
-			//	1clock
-			ppsg->clock_div32 = (ppsg->clock_div32 + 1) & 31;
-			noise	= _noise_generator( ppsg );
-			_envelope_generator( ppsg );
-			ch0		= _tone_generator( ppsg, &ppsg->channel[0], noise );
-			ch1		= _tone_generator( ppsg, &ppsg->channel[1], noise );
-			ch2		= _tone_generator( ppsg, &ppsg->channel[2], noise );
-			level	+= ch0 + ch1 + ch2;
+		clocks		= (int)( next_clock - ppsg->clock );
+		to_tick		= 16 - (ppsg->clock_div32 & 15);
+		to_event	= to_tick + 16 * (ticks - 1);
+		if( clocks < to_event ) {
+			//	no event in this sample (the first sample has no clock, and sum is 0)
+			skip = (clocks < to_tick) ? 0 : 1 + (clocks - to_tick) / 16;
+			_advance( ppsg, skip, clocks );
+			ticks -= skip;
+			pwave[i] = (int16_t) sum;
+		}
+		else {
+			//	the level of the clock of an event is the new one
+			level = 0;
+			while( clocks >= to_event ) {
+				level	+= sum * (to_event - 1);
+				_advance( ppsg, ticks, to_event );
+				sum		= _update_levels( ppsg );
+				level	+= sum;
+				clocks	-= to_event;
+				ticks	= _ticks_to_event( ppsg, &src );
+				to_event = 16 * ticks;
+			}
+			skip = clocks / 16;
+			_advance( ppsg, skip, clocks );
+			ticks -= skip;
+			level += sum * clocks;
+			pwave[i] = (int16_t)( level / (int)( next_clock - ppsg->clock ) );
 		}
-		pwave[i] = (int16_t)( level / (next_clock - ppsg->clock) );
 		ppsg->clock = next_clock;
 		ppsg->samples++;
+		next_clock	+= PSG_CLOCK / SAMPLE_RATE;
+		fraction	+= PSG_CLOCK % SAMPLE_RATE;
+		if( fraction >= SAMPLE_RATE ) {
+			fraction -= SAMPLE_RATE;
+			next_clock++;
+		}
 	}
 	if( ppsg->samples >= SAMPLE_RATE ) {
 		ppsg->clock		-= PSG_CLOCK;
@@ -295,6 +482,16 @@ void psg_generate_wave( H_PSG_T hpsg, int16_t *pwave, int samples ) {
 	}
 }
 
+// --------------------------------------------------------------------
+void psg_set_band_limited( H_PSG_T hpsg, int is_band_limited ) {
+	PSG_T *ppsg = (PSG_T*) hpsg;
+
+	if( is_band_limited && !ppsg->is_band_limited ) {
+		blip_clear( &ppsg->blip, ppsg->channel[0].last_level + ppsg->channel[1].last_level + ppsg->channel[2].last_level );
+	}
+	ppsg->is_band_limited = is_band_limited;
+}
+
 // --------------------------------------------------------------------
 void psg_write_register( H_PSG_T hpsg, uint16_t address, uint8_t data ) {
 	int psg_address;
@@ -302,6 +499,7 @@ void psg_write_register( H_PSG_T hpsg, uint16_t address, uint8_t data ) {
 
 	psg_address = address & 15;
 	ppsg->registers[ psg_address ] = data;
+	ppsg->is_written = 1;
 	switch( psg_address ) {
 	case 1:
 		ppsg->registers[1]					= ppsg->registers[1] & 15;
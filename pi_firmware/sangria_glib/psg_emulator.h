@@ -66,6 +66,21 @@ void psg_terminate( H_PSG_T hpsg );
 // --------------------------------------------------------------------
 void psg_generate_wave( H_PSG_T hpsg, int16_t *pwave, int samples );
 
+// --------------------------------------------------------------------
+//	psg_set_band_limited
+//	input)
+//		hpsg ............. H_PSG_T instance
+//		is_band_limited .. 0: average of the clocks in each sample (default)
+//		                   1: band-limited steps (blip_buffer.h)
+//	output)
+//		none
+//	comment)
+//		Band-limited steps do not alias the high tones and the noise
+//		back into the audible band, and the wave is BLIP_DELAY samples
+//		later. The cost is for each change of the level.
+// --------------------------------------------------------------------
+void psg_set_band_limited( H_PSG_T hpsg, int is_band_limited );
+
 // --------------------------------------------------------------------
 //	psg_write_register
 //	input)
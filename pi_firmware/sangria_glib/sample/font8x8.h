@@ -0,0 +1,13 @@
+// --------------------------------------------------------------------
+//  Font data: [font.png]
+// --------------------------------------------------------------------
+
+#ifndef __FONT8X8_H__
+#define __FONT8X8_H__
+
+#include <sangria_text.h>
+
+extern const SANGRIA_FONT_T font8x8;
+#define p_font8x8 (&font8x8)
+
+#endif // __FONT8X8_H__
@@ -0,0 +1,132 @@
+// --------------------------------------------------------------------
+//  Font data: [font.png]
+// --------------------------------------------------------------------
+
+#include <sangria_text.h>
+
+static const uint32_t _font8x8_p_code[] = {
+	0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+	0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+	0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+	0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+	0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+	0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+	0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+	0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+	0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+	0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+	0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+	0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x007F,
+};
+
+static const uint8_t _font8x8_p_width[] = {
+	4, 3, 6, 8, 6, 8, 8, 6, 4, 4, 6, 6, 3, 6, 3, 8,
+	8, 4, 8, 8, 8, 8, 8, 8, 8, 8, 3, 3, 8, 6, 8, 8,
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 4, 8, 8, 8, 8, 8, 8,
+	8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 8, 4, 8, 4, 6, 8,
+	4, 8, 8, 7, 8, 8, 7, 8, 8, 4, 6, 6, 4, 8, 8, 8,
+	8, 8, 6, 8, 6, 8, 8, 8, 8, 7, 8, 5, 2, 5, 8, 7,
+};
+
+static const uint8_t _font8x8_p_bitmap[] = {
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, // U+0020
+	0x00, 0xC0, 0xC0, 0xC0, 0x80, 0x00, 0xC0, 0xC0, // '!'
+	0x00, 0xD8, 0x90, 0x00, 0x00, 0x00, 0x00, 0x00, // '"'
+	0x00, 0x44, 0xFE, 0x44, 0x44, 0x44, 0xFE, 0x44, // '#'
+	0x20, 0x70, 0xA8, 0x60, 0x30, 0xA8, 0x70, 0x20, // '$'
+	0x00, 0x42, 0xA4, 0xA8, 0x54, 0x2A, 0x4A, 0x84, // '%'
+	0x00, 0x38, 0x44, 0x28, 0x70, 0x8A, 0x84, 0x7A, // '&'
+	0x00, 0x18, 0x18, 0x10, 0x00, 0x00, 0x00, 0x80, // '''
+	0x00, 0x20, 0x40, 0x80, 0x80, 0x80, 0x40, 0x20, // '('
+	0x00, 0x80, 0x40, 0x20, 0x20, 0x20, 0x40, 0x80, // ')'
+	0x00, 0x20, 0xA8, 0x70, 0x20, 0x70, 0xA8, 0x20, // '*'
+	0x00, 0x00, 0x20, 0x20, 0xF8, 0x20, 0x20, 0x00, // '+'
+	0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x40, 0x80, // ','
+	0x00, 0x00, 0x00, 0x00, 0xF8, 0x00, 0x00, 0x00, // '-'
+	0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0xC0, 0x00, // '.'
+	0x00, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80, // '/'
+	0x00, 0x7C, 0x82, 0x8A, 0x92, 0xA2, 0x82, 0x7C, // '0'
+	0x00, 0x40, 0xC0, 0x40, 0x40, 0x40, 0x40, 0xE0, // '1'
+	0x00, 0x7C, 0x82, 0x82, 0x1C, 0x60, 0x80, 0xFE, // '2'
+	0x00, 0x7C, 0x82, 0x02, 0x3C, 0x02, 0x82, 0x7C, // '3'
+	0x00, 0x18, 0x28, 0x48, 0x88, 0x88, 0xFE, 0x08, // '4'
+	0x00, 0xFE, 0x80, 0xFC, 0x02, 0x02, 0x82, 0x7C, // '5'
+	0x00, 0x7C, 0x82, 0x80, 0xFC, 0x82, 0x82, 0x7C, // '6'
+	0x00, 0xFE, 0x82, 0x04, 0x08, 0x10, 0x10, 0x10, // '7'
+	0x00, 0x7C, 0x82, 0x82, 0x7C, 0x82, 0x82, 0x7C, // '8'
+	0x00, 0x7C, 0x82, 0x82, 0x7E, 0x02, 0x82, 0x7C, // '9'
+	0x00, 0x00, 0xC0, 0xC0, 0x00, 0xC0, 0xC0, 0x00, // ':'
+	0x00, 0x00, 0xC0, 0xC0, 0x00, 0xC0, 0x40, 0x80, // ';'
+	0x00, 0x06, 0x18, 0x60, 0x80, 0x60, 0x18, 0x06, // '<'
+	0x00, 0x00, 0x00, 0xF8, 0x00, 0xF8, 0x00, 0x00, // '='
+	0x00, 0xC0, 0x30, 0x0C, 0x02, 0x0C, 0x30, 0xC0, // '>'
+	0x00, 0x7C, 0x82, 0x82, 0x1C, 0x10, 0x00, 0x10, // '?'
+	0x00, 0x7C, 0x82, 0xBA, 0xAA, 0xBE, 0x80, 0x7C, // '@'
+	0x00, 0x38, 0x44, 0x82, 0x82, 0x82, 0xFE, 0x82, // 'A'
+	0x00, 0xFC, 0x82, 0x82, 0xFC, 0x82, 0x82, 0xFC, // 'B'
+	0x00, 0x7C, 0x82, 0x80, 0x80, 0x80, 0x82, 0x7C, // 'C'
+	0x00, 0xF8, 0x84, 0x82, 0x82, 0x82, 0x84, 0xF8, // 'D'
+	0x00, 0xFE, 0x80, 0x80, 0xFC, 0x80, 0x80, 0xFE, // 'E'
+	0x00, 0xFE, 0x80, 0x80, 0xFC, 0x80, 0x80, 0x80, // 'F'
+	0x00, 0x7C, 0x82, 0x80, 0x9E, 0x82, 0x82, 0x7C, // 'G'
+	0x00, 0x82, 0x82, 0x82, 0xFE, 0x82, 0x82, 0x82, // 'H'
+	0x00, 0xE0, 0x40, 0x40, 0x40, 0x40, 0x40, 0xE0, // 'I'
+	0x00, 0x02, 0x02, 0x02, 0x02, 0x82, 0x82, 0x7C, // 'J'
+	0x00, 0x82, 0x8C, 0xB0, 0xC8, 0x84, 0x84, 0x82, // 'K'
+	0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0xFE, // 'L'
+	0x00, 0x82, 0xC6, 0xAA, 0x92, 0x82, 0x82, 0x82, // 'M'
+	0x00, 0x82, 0xC2, 0xA2, 0x92, 0x8A, 0x86, 0x82, // 'N'
+	0x00, 0x7C, 0x82, 0x82, 0x82, 0x82, 0x82, 0x7C, // 'O'
+	0x00, 0xFC, 0x82, 0x82, 0x82, 0xFC, 0x80, 0x80, // 'P'
+	0x00, 0x7C, 0x82, 0x82, 0x82, 0x9A, 0xA4, 0x7A, // 'Q'
+	0x00, 0xFC, 0x82, 0x82, 0x82, 0xFC, 0x88, 0x86, // 'R'
+	0x00, 0x7C, 0x82, 0x80, 0x7C, 0x02, 0x82, 0x7C, // 'S'
+	0x00, 0xFE, 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, // 'T'
+	0x00, 0x82, 0x82, 0x82, 0x82, 0x82, 0x82, 0x7C, // 'U'
+	0x00, 0x82, 0x82, 0x82, 0x82, 0x44, 0x28, 0x10, // 'V'
+	0x00, 0x82, 0x82, 0x82, 0x92, 0xAA, 0xC6, 0x82, // 'W'
+	0x00, 0x82, 0x44, 0x28, 0x10, 0x28, 0x44, 0x82, // 'X'
+	0x00, 0x82, 0x44, 0x28, 0x10, 0x10, 0x10, 0x10, // 'Y'
+	0x00, 0xFE, 0x02, 0x0C, 0x10, 0x60, 0x80, 0xFE, // 'Z'
+	0x00, 0xE0, 0x80, 0x80, 0x80, 0x80, 0x80, 0xE0, // '['
+	0x00, 0x80, 0x40, 0x20, 0x10, 0x08, 0x04, 0x02, // U+005C
+	0x00, 0xE0, 0x20, 0x20, 0x20, 0x20, 0x20, 0xE0, // ']'
+	0x00, 0x20, 0x50, 0x88, 0x00, 0x00, 0x00, 0x00, // '^'
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xFE, // '_'
+	0x00, 0x80, 0x40, 0x20, 0x00, 0x00, 0x00, 0x00, // '`'
+	0x00, 0x00, 0x78, 0x84, 0x7C, 0x84, 0x84, 0x7A, // 'a'
+	0x00, 0x80, 0x80, 0x80, 0xFC, 0x82, 0x82, 0xFC, // 'b'
+	0x00, 0x00, 0x00, 0x00, 0x7C, 0x80, 0x80, 0x7C, // 'c'
+	0x00, 0x02, 0x02, 0x02, 0x7E, 0x82, 0x82, 0x7E, // 'd'
+	0x00, 0x00, 0x00, 0x7C, 0x82, 0xFE, 0x80, 0x7C, // 'e'
+	0x00, 0x1C, 0x20, 0x20, 0xFC, 0x20, 0x20, 0x20, // 'f'
+	0x00, 0x00, 0x7E, 0x82, 0x82, 0x7E, 0x02, 0x7C, // 'g'
+	0x00, 0x80, 0x80, 0x80, 0xBC, 0xC2, 0x82, 0x82, // 'h'
+	0x00, 0x40, 0x40, 0x00, 0xC0, 0x40, 0x40, 0xE0, // 'i'
+	0x00, 0x08, 0x08, 0x00, 0x08, 0x08, 0x88, 0x70, // 'j'
+	0x00, 0x80, 0x80, 0x88, 0xB0, 0xC0, 0xA0, 0x98, // 'k'
+	0x00, 0x80, 0x40, 0x40, 0x40, 0x40, 0x40, 0x20, // 'l'
+	0x00, 0x00, 0x00, 0xEC, 0x92, 0x92, 0x92, 0x92, // 'm'
+	0x00, 0x00, 0x00, 0xBC, 0xC2, 0x82, 0x82, 0x82, // 'n'
+	0x00, 0x00, 0x00, 0x7C, 0x82, 0x82, 0x82, 0x7C, // 'o'
+	0x00, 0x00, 0x00, 0xFC, 0x82, 0x82, 0xFC, 0x80, // 'p'
+	0x00, 0x00, 0x00, 0x7E, 0x82, 0x82, 0x7E, 0x02, // 'q'
+	0x00, 0x00, 0x00, 0xB8, 0xC0, 0x80, 0x80, 0x80, // 'r'
+	0x00, 0x00, 0x00, 0x7E, 0x80, 0x7C, 0x02, 0xFC, // 's'
+	0x00, 0x00, 0x20, 0xF8, 0x20, 0x20, 0x20, 0x10, // 't'
+	0x00, 0x00, 0x00, 0x82, 0x82, 0x82, 0x82, 0x7E, // 'u'
+	0x00, 0x00, 0x00, 0x82, 0x82, 0x44, 0x28, 0x10, // 'v'
+	0x00, 0x00, 0x00, 0x92, 0x92, 0x92, 0x92, 0x6C, // 'w'
+	0x00, 0x00, 0x00, 0xC6, 0x28, 0x10, 0x28, 0xC6, // 'x'
+	0x00, 0x00, 0x00, 0x84, 0x84, 0x7C, 0x04, 0x78, // 'y'
+	0x00, 0x00, 0x00, 0xFE, 0x04, 0x38, 0x40, 0xFE, // 'z'
+	0x00, 0x30, 0x40, 0x40, 0x80, 0x40, 0x40, 0x30, // '{'
+	0x00, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, // '|'
+	0x00, 0xC0, 0x20, 0x20, 0x10, 0x20, 0x20, 0xC0, // '}'
+	0x00, 0x00, 0x00, 0x20, 0x52, 0x94, 0x08, 0x00, // '~'
+	0x00, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0xFC, 0x00, // U+007F
+};
+
+const SANGRIA_FONT_T font8x8_p = {
+	8, 8, 96, _font8x8_p_code, _font8x8_p_width, _font8x8_p_bitmap,
+};
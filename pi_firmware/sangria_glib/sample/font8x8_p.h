@@ -0,0 +1,13 @@
+// --------------------------------------------------------------------
+//  Font data: [font.png]
+// --------------------------------------------------------------------
+
+#ifndef __FONT8X8_P_H__
+#define __FONT8X8_P_H__
+
+#include <sangria_text.h>
+
+extern const SANGRIA_FONT_T font8x8_p;
+#define p_font8x8_p (&font8x8_p)
+
+#endif // __FONT8X8_P_H__
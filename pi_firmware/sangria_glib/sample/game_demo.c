@@ -26,10 +26,15 @@
 #include <stdlib.h>
 #include <string.h>
 #include "sangria_glib.h"
-#include "game.h"
+#include "sangria_asset.h"
+#include "sangria_frame.h"
+#include "sangria_tilemap.h"
 
+#define GAME_ASSET		"sample/game.sga"
+#define TILES_ASSET		"sample/game_tiles.sga"		//	game.png in 16x16 tiles
 #define SHOT_NUM		16
 #define PLAYER_SPEED	8
+#define FRAME_RATE		30				//	the player and the background move by each frame
 
 typedef struct {
 	int x;
@@ -47,6 +52,12 @@ typedef struct {
 	int x2;
 } BG_T;
 
+static SANGRIA_BACKBUFFER_T *p_game;
+
+//	A layer keeps its lines in its cache, so each layer has its own tilemap.
+static H_SANGRIA_TILEMAP_T h_layer1, h_layer2;
+static SANGRIA_BACKBUFFER_T *p_tiles1, *p_tiles2;
+
 // --------------------------------------------------------------------
 static void player_move( SANGRIA_BACKBUFFER_T *p_screen, PLAYER_T *p_player, SHOT_T *pp_shot ) {
 	SANGRIA_KEY_STATE_T k;
@@ -104,15 +115,16 @@ static void shot_move( SANGRIA_BACKBUFFER_T *p_screen, SHOT_T *p_shot ) {
 static void back_ground( SANGRIA_BACKBUFFER_T *p_screen, BG_T *p_bg, PLAYER_T *p_player ) {
 	int y1, y2;
 
+	//	The map is 800 pixels wide and wraps around.
 	p_bg->x1 = (p_bg->x1 + 1) % 800;
 	y1 = 20 - p_player->y * 20 / 240 + 50;
-	sangria_copy( p_game, 0, 100, 799, 299, p_screen,     - p_bg->x1, y1 );
-	sangria_copy( p_game, 0, 100, 799, 299, p_screen, 800 - p_bg->x1, y1 );
+	sangria_tilemap_scroll( h_layer1, p_bg->x1, 100 );
+	sangria_tilemap_render( h_layer1, p_screen, y1, 200 );
 
 	p_bg->x2 = (p_bg->x2 + 2) % 800;
 	y2 = 40 - p_player->y * 40 / 240 + 60;
-	sangria_copy( p_game, 0, 300, 799, 599, p_screen,     - p_bg->x2, y2 );
-	sangria_copy( p_game, 0, 300, 799, 599, p_screen, 800 - p_bg->x2, y2 );
+	sangria_tilemap_scroll( h_layer2, p_bg->x2, 300 );
+	sangria_tilemap_render( h_layer2, p_screen, y2, 300 );
 }
 
 // --------------------------------------------------------------------
@@ -123,13 +135,15 @@ static void demo( void ) {
 	BG_T bg;
 	int i;
 
-	p_screen = sangria_get_display();
+	//	Drawn into the shared memory, and flipped without copying.
+	p_screen = sangria_get_flip_buffer( SANGRIA_FORMAT_8BPP );
 	memset( shot, 0, sizeof(shot) );
 	player.x = 200 - 16;
 	player.y = 120 - 16;
 	memset( &bg, 0, sizeof(bg) );
 
 	// main loop
+	sangria_set_frame_rate( FRAME_RATE );
 	for(;;) {
 		sangria_clear_buffer( p_screen, 0 );
 		back_ground( p_screen, &bg, &player );
@@ -137,10 +151,57 @@ static void demo( void ) {
 		for( i = 0; i < SHOT_NUM; i++ ) {
 			shot_move( p_screen, &shot[i] );
 		}
-		sangria_display( p_screen );
+		p_screen = sangria_flip( p_screen );
+		sangria_wait_frame();
 	}
 }
 
+// --------------------------------------------------------------------
+//	The asset is found from the directory of the executable, so the demo
+//	can be started from anywhere.
+//
+static SANGRIA_BACKBUFFER_T *load_asset( const char *p_name ) {
+	SANGRIA_BACKBUFFER_T *p_image;
+	char path[ 4096 ];
+
+	if( sangria_asset_path( p_name, path, sizeof(path) ) == NULL ) {
+		printf( "ERROR: Failed sangria_asset_path( %s )\n", p_name );
+		return NULL;
+	}
+	p_image = sangria_load_image( path, SANGRIA_FORMAT_8BPP );
+	if( p_image == NULL ) {
+		printf( "ERROR: Failed sangria_load_image( %s )\n", path );
+		printf( "       %s is looked for next to the executable, or in $SANGRIA_ASSET_DIR.\n", p_name );
+	}
+	return p_image;
+}
+
+// --------------------------------------------------------------------
+static H_SANGRIA_TILEMAP_T load_tilemap( const char *p_name, SANGRIA_BACKBUFFER_T **pp_tiles ) {
+	H_SANGRIA_TILEMAP_T htilemap;
+	char path[ 4096 ];
+
+	if( sangria_asset_path( p_name, path, sizeof(path) ) == NULL ) {
+		printf( "ERROR: Failed sangria_asset_path( %s )\n", p_name );
+		return NULL;
+	}
+	htilemap = sangria_load_tilemap( path, SANGRIA_FORMAT_8BPP, pp_tiles );
+	if( htilemap == NULL ) {
+		printf( "ERROR: Failed sangria_load_tilemap( %s )\n", path );
+	}
+	return htilemap;
+}
+
+// --------------------------------------------------------------------
+static void release_assets( void ) {
+
+	sangria_tilemap_terminate( h_layer1 );
+	sangria_tilemap_terminate( h_layer2 );
+	sangria_release_image( p_tiles1 );
+	sangria_release_image( p_tiles2 );
+	sangria_release_image( p_game );
+}
+
 // --------------------------------------------------------------------
 int main( int argc, char *argv[] ) {
 
@@ -148,8 +209,17 @@ int main( int argc, char *argv[] ) {
 		printf( "ERROR: Failed sangria_initialize()\n" );
 		return 1;
 	}
+	p_game		= load_asset( GAME_ASSET );
+	h_layer1	= load_tilemap( TILES_ASSET, &p_tiles1 );
+	h_layer2	= load_tilemap( TILES_ASSET, &p_tiles2 );
+	if( p_game == NULL || h_layer1 == NULL || h_layer2 == NULL ) {
+		release_assets();
+		sangria_terminate();
+		return 1;
+	}
 
 	demo();
+	release_assets();
 	sangria_terminate();
 	return 0;
 }
@@ -27,7 +27,11 @@
 #include <string.h>
 #include <math.h>
 #include "sangria_glib.h"
-#include "startup_logo.h"
+#include "sangria_asset.h"
+
+#define STARTUP_LOGO_ASSET	"sample/startup_logo.sga"
+
+static SANGRIA_BACKBUFFER_T *p_startup_logo;
 
 // --------------------------------------------------------------------
 static void rotate_matrix( int *p_x, int *p_y, int x, int y, double c, double s ) {
@@ -49,8 +53,8 @@ static void rotate( SANGRIA_BACKBUFFER_T *p_screen, int deg, double zoom ) {
 	rotate_matrix( &sx1, &sy1,   0,   0, c, s );
 	rotate_matrix( &sx2, &sy2, 399,   0, c, s );
 	rotate_matrix( &sx3, &sy3,   0, 239, c, s );
+	sangria_clear_buffer( p_screen, 0 );
 	sangria_rotate_copy( p_startup_logo, sx1, sy1, sx2, sy2, sx3, sy3, p_screen, 0, 0, 399, 239 );
-	sangria_display( p_screen );
 }
 
 // --------------------------------------------------------------------
@@ -58,19 +62,42 @@ static void demo( void ) {
 	SANGRIA_BACKBUFFER_T *p_screen;
 	int deg, zoom;
 
-	p_screen = sangria_get_display();
+	//	Drawn into the shared memory, and flipped without copying.
+	p_screen = sangria_get_flip_buffer( SANGRIA_FORMAT_8BPP );
 
 	for(;;) {
 		for( deg = 0; deg < 256; deg++ ) {
 			rotate( p_screen, deg & 255, 1. );
+			p_screen = sangria_flip( p_screen );
 		}
 		for( zoom = 0; zoom < 256; zoom++ ) {
 			deg = (deg + 1) & 255;
-			rotate( p_screen, deg & 255, cos( zoom * M_PI / 64. ) * 2. );;
+			rotate( p_screen, deg & 255, cos( zoom * M_PI / 64. ) * 2. );
+			p_screen = sangria_flip( p_screen );
 		}
 	}
 }
 
+// --------------------------------------------------------------------
+//	The logo is loaded relative to the executable, not to the current
+//	directory.
+//
+static SANGRIA_BACKBUFFER_T *load_asset( const char *p_name ) {
+	SANGRIA_BACKBUFFER_T *p_image;
+	char path[ 4096 ];
+
+	if( sangria_asset_path( p_name, path, sizeof(path) ) == NULL ) {
+		printf( "ERROR: Failed sangria_asset_path( %s )\n", p_name );
+		return NULL;
+	}
+	p_image = sangria_load_image( path, SANGRIA_FORMAT_8BPP );
+	if( p_image == NULL ) {
+		printf( "ERROR: Failed sangria_load_image( %s )\n", path );
+		printf( "       %s is looked for next to the executable, or in $SANGRIA_ASSET_DIR.\n", p_name );
+	}
+	return p_image;
+}
+
 // --------------------------------------------------------------------
 int main( int argc, char *argv[] ) {
 
@@ -78,8 +105,14 @@ int main( int argc, char *argv[] ) {
 		printf( "ERROR: Failed sangria_initialize()\n" );
 		return 1;
 	}
+	p_startup_logo = load_asset( STARTUP_LOGO_ASSET );
+	if( p_startup_logo == NULL ) {
+		sangria_terminate();
+		return 1;
+	}
 
 	demo();
+	sangria_release_image( p_startup_logo );
 	sangria_terminate();
 	return 0;
 }
@@ -26,10 +26,14 @@
 #include <stdlib.h>
 #include <string.h>
 #include "sangria_glib.h"
-#include "startup_logo.h"
-#include "usa.h"
+#include "sangria_asset.h"
 
-#define USA_NUM		40
+#define STARTUP_LOGO_ASSET	"sample/startup_logo.sga"
+#define USA_ASSET			"sample/usa.sga"
+#define USA_NUM				40
+
+static SANGRIA_BACKBUFFER_T *p_startup_logo;
+static SANGRIA_BACKBUFFER_T *p_usa;
 
 // --------------------------------------------------------------------
 static void demo( void ) {
@@ -37,7 +41,9 @@ static void demo( void ) {
 	int x1, y1, x2, y2, i, j;
 	int usa_x[USA_NUM], usa_y[USA_NUM], usa_vx[USA_NUM], usa_vy[USA_NUM];
 
-	p_screen = sangria_get_display();
+	//	Each frame is drawn into the shared memory and flipped without copying.
+	//	The next buffer holds an older frame, so every frame is cleared first.
+	p_screen = sangria_get_flip_buffer( SANGRIA_FORMAT_8BPP );
 
 	for( j = 0; j < 100; j++ ) {
 		sangria_clear_buffer( p_screen, 0 );
@@ -46,7 +52,7 @@ static void demo( void ) {
 		x2 = j * 16;
 		y2 = j * 3;
 		sangria_stretch_copy( p_startup_logo, 0, 0, 399, 239, p_screen, x1, y1, x2, y2 );
-		sangria_display( p_screen );
+		p_screen = sangria_flip( p_screen );
 	}
 
 	for( i = 0; i < USA_NUM; i++ ) {
@@ -84,7 +90,7 @@ static void demo( void ) {
 			}
 			sangria_copy( p_usa, 0, 0, 63, 66, p_screen, usa_x[i] >> 8, usa_y[i] >> 8 );
 		}
-		sangria_display( p_screen );
+		p_screen = sangria_flip( p_screen );
 	}
 
 	for( j = 0; j < 500; j++ ) {
@@ -96,7 +102,7 @@ static void demo( void ) {
 			y2 = rand() % 240;
 			sangria_line( p_screen, x1, y1, x2, y2, 255 );
 		}
-		sangria_display( p_screen );
+		p_screen = sangria_flip( p_screen );
 	}
 
 	for( j = 0; j < 500; j++ ) {
@@ -108,8 +114,28 @@ static void demo( void ) {
 			y2 = rand() % 240;
 			sangria_fill_rect( p_screen, x1, y1, x2, y2, 255 );
 		}
-		sangria_display( p_screen );
+		p_screen = sangria_flip( p_screen );
+	}
+}
+
+// --------------------------------------------------------------------
+//	The assets are loaded relative to the executable, not to the current
+//	directory.
+//
+static SANGRIA_BACKBUFFER_T *load_asset( const char *p_name ) {
+	SANGRIA_BACKBUFFER_T *p_image;
+	char path[ 4096 ];
+
+	if( sangria_asset_path( p_name, path, sizeof(path) ) == NULL ) {
+		printf( "ERROR: Failed sangria_asset_path( %s )\n", p_name );
+		return NULL;
+	}
+	p_image = sangria_load_image( path, SANGRIA_FORMAT_8BPP );
+	if( p_image == NULL ) {
+		printf( "ERROR: Failed sangria_load_image( %s )\n", path );
+		printf( "       %s is looked for next to the executable, or in $SANGRIA_ASSET_DIR.\n", p_name );
 	}
+	return p_image;
 }
 
 // --------------------------------------------------------------------
@@ -119,8 +145,20 @@ int main( int argc, char *argv[] ) {
 		printf( "ERROR: Failed sangria_initialize()\n" );
 		return 1;
 	}
+	p_startup_logo = load_asset( STARTUP_LOGO_ASSET );
+	if( p_startup_logo == NULL ) {
+		sangria_terminate();
+		return 1;
+	}
+	p_usa = load_asset( USA_ASSET );
+	if( p_usa == NULL ) {
+		sangria_terminate();
+		return 1;
+	}
 
 	demo();
+	sangria_release_image( p_startup_logo );
+	sangria_release_image( p_usa );
 	sangria_terminate();
 	return 0;
 }
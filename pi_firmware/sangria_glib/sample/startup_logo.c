@@ -7,11 +7,14 @@
 typedef struct {
 	int32_t	width;
 	int32_t	height;
+	int32_t	dirty_top;
+	int32_t	dirty_bottom;
+	int32_t	format;
 	uint8_t		image[96000];
 } _BACKBUFFER_T;
 
 const _BACKBUFFER_T _startup_logo = {
-	400, 240, {
+	400, 240, 0, -1, 0, {
 		0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 
 		0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 
 		0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 
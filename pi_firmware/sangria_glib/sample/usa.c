@@ -7,11 +7,14 @@
 typedef struct {
 	int32_t	width;
 	int32_t	height;
+	int32_t	dirty_top;
+	int32_t	dirty_bottom;
+	int32_t	format;
 	uint8_t		image[4288];
 } _BACKBUFFER_T;
 
 const _BACKBUFFER_T _usa = {
-	64, 67, {
+	64, 67, 0, -1, 0, {
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
 		0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 
@@ -0,0 +1,419 @@
+// --------------------------------------------------------------------
+// Sangria game library: asset loader
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "sangria_asset.h"
+#include "sangria_glib_1bpp.h"
+
+#define MAX_SIZE			32768
+
+typedef enum {
+	ASSET_RAW = 0,
+	ASSET_LZ,
+} ASSET_COMPRESSION_T;
+
+//	The file starts with this header (little endian).
+typedef struct {
+	char		magic[4];			//	"SGA1"
+	uint32_t	compression;		//	ASSET_COMPRESSION_T
+	uint32_t	data_size;			//	bytes of the image data
+	uint32_t	tile_width;			//	0: not tiled
+	uint32_t	tile_height;
+	uint32_t	map_width;
+	uint32_t	map_height;
+	uint32_t	reserved;
+	//	same as the head of SANGRIA_BACKBUFFER_T, and the image data follows
+	int32_t		width;
+	int32_t		height;
+	int32_t		dirty_top;
+	int32_t		dirty_bottom;
+	int32_t		format;
+} ASSET_HEADER_T;
+
+#define BACKBUFFER_OFFSET	32
+#define IMAGE_OFFSET		sizeof(ASSET_HEADER_T)
+
+//	mapped images, to be unmapped by sangria_release_image()
+typedef struct _MAPPED_T {
+	struct _MAPPED_T	*p_next;
+	void				*p_base;
+	size_t				size;
+} MAPPED_T;
+
+static MAPPED_T *p_mapped = NULL;
+
+// --------------------------------------------------------------------
+static int _check_header( const ASSET_HEADER_T *p, size_t file_size ) {
+	size_t image_size, map_size;
+
+	if( memcmp( p->magic, "SGA1", 4 ) != 0 || p->format != SANGRIA_FORMAT_1BPP ) {
+		return 0;
+	}
+	if( p->width <= 0 || p->height <= 0 || p->width > MAX_SIZE || p->height > MAX_SIZE ) {
+		return 0;
+	}
+	image_size = (size_t) sangria_1bpp_stride( p->width ) * p->height * 2;
+	if( p->compression == ASSET_RAW ) {
+		if( p->data_size != image_size ) return 0;
+	}
+	else if( p->compression != ASSET_LZ ) {
+		return 0;
+	}
+	if( p->map_width > MAX_SIZE || p->map_height > MAX_SIZE ) {
+		return 0;
+	}
+	map_size = (size_t) p->map_width * p->map_height * sizeof(uint16_t);
+	if( p->tile_width != 0 && (p->tile_height == 0 || map_size == 0 || p->tile_width > (uint32_t) p->width) ) {
+		return 0;
+	}
+	//	each size is checked against the rest of the file, so that a huge
+	//	data_size cannot wrap around a 32bit size_t.
+	if( file_size < IMAGE_OFFSET || map_size > file_size - IMAGE_OFFSET ) {
+		return 0;
+	}
+	return (size_t) p->data_size <= file_size - IMAGE_OFFSET - map_size;
+}
+
+// --------------------------------------------------------------------
+//	LZ4 block format. 0: broken data
+//
+static int _lz_decode( const uint8_t *p_src, size_t src_size, uint8_t *p_dest, size_t dest_size ) {
+	const uint8_t *p_end = p_src + src_size;
+	size_t d, n, offset;
+	uint8_t token, c;
+
+	d = 0;
+	while( p_src < p_end ) {
+		token = *(p_src++);
+		//	literals
+		n = token >> 4;
+		if( n == 15 ) {
+			do {
+				if( p_src >= p_end ) return 0;
+				c = *(p_src++);
+				n += c;
+			} while( c == 255 );
+		}
+		if( n > (size_t)( p_end - p_src ) || n > dest_size - d ) {
+			return 0;
+		}
+		memcpy( p_dest + d, p_src, n );
+		p_src	+= n;
+		d		+= n;
+		if( p_src == p_end ) {
+			//	the last sequence has no match
+			break;
+		}
+		//	match
+		if( p_end - p_src < 2 ) {
+			return 0;
+		}
+		offset	= p_src[0] | (p_src[1] << 8);
+		p_src	+= 2;
+		n		= (token & 15) + 4;
+		if( (token & 15) == 15 ) {
+			do {
+				if( p_src >= p_end ) return 0;
+				c = *(p_src++);
+				n += c;
+			} while( c == 255 );
+		}
+		if( offset == 0 || offset > d || n > dest_size - d ) {
+			return 0;
+		}
+		if( offset >= n ) {
+			memcpy( p_dest + d, p_dest + d - offset, n );
+			d += n;
+		}
+		else {
+			//	overlapped: repeats the last offset bytes
+			for( ; n > 0; n-- ) {
+				p_dest[d] = p_dest[ d - offset ];
+				d++;
+			}
+		}
+	}
+	return d == dest_size;
+}
+
+// --------------------------------------------------------------------
+//	8 bits to 8 bytes of 0xFF or 0x00, bit7 to the first byte.
+//
+static uint64_t _spread_bits( uint8_t bits ) {
+	uint8_t bytes[8];
+	uint64_t d;
+	int i;
+
+	for( i = 0; i < 8; i++ ) {
+		bytes[i] = (bits & (0x80 >> i)) ? 0xFF : 0x00;
+	}
+	memcpy( &d, bytes, 8 );
+	return d;
+}
+
+// --------------------------------------------------------------------
+//	8 pixels at a time from the pixel plane and the mask plane.
+//	opaque pixels: 1 (pixel bit 1) or 255 (pixel bit 0)
+//
+static void _expand_8bpp( const uint8_t *p_planes, SANGRIA_BACKBUFFER_T *p_image ) {
+	static uint64_t spread[256];
+	static int is_ready = 0;
+	const uint8_t *p_pixel, *p_mask;
+	uint8_t *p_dest;
+	uint64_t d;
+	int x, y, i, stride;
+
+	if( !is_ready ) {
+		for( i = 0; i < 256; i++ ) {
+			spread[i] = _spread_bits( i );
+		}
+		is_ready = 1;
+	}
+	stride	= sangria_1bpp_stride( p_image->width );
+	p_dest	= p_image->image;
+	for( y = 0; y < p_image->height; y++ ) {
+		p_pixel	= p_planes + y * stride;
+		p_mask	= p_planes + (p_image->height + y) * stride;
+		for( x = 0; x + 8 <= p_image->width; x += 8 ) {
+			d = spread[ p_mask[ x >> 3 ] ] & (~spread[ p_pixel[ x >> 3 ] ] | 0x0101010101010101ULL);
+			memcpy( p_dest, &d, 8 );
+			p_dest += 8;
+		}
+		for( i = 0; x < p_image->width; x++, i++ ) {
+			*(p_dest++) = (p_mask[ x >> 3 ] & (0x80 >> i)) ? ((p_pixel[ x >> 3 ] & (0x80 >> i)) ? 1 : 255) : 0;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static SANGRIA_BACKBUFFER_T *_map( int fd, size_t file_size ) {
+	MAPPED_T *p_node;
+	void *p_base;
+
+	p_node = (MAPPED_T*) malloc( sizeof(MAPPED_T) );
+	if( p_node == NULL ) {
+		return NULL;
+	}
+	//	private: the dirty lines can be written without changing the file
+	p_base = mmap( NULL, file_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0 );
+	if( p_base == MAP_FAILED ) {
+		free( p_node );
+		return NULL;
+	}
+	p_node->p_base	= p_base;
+	p_node->size	= file_size;
+	p_node->p_next	= p_mapped;
+	p_mapped		= p_node;
+	return (SANGRIA_BACKBUFFER_T*)( (uint8_t*) p_base + BACKBUFFER_OFFSET );
+}
+
+// --------------------------------------------------------------------
+static SANGRIA_BACKBUFFER_T *_decode( const uint8_t *p_file, SANGRIA_FORMAT_T format ) {
+	const ASSET_HEADER_T *p_header = (const ASSET_HEADER_T*) p_file;
+	SANGRIA_BACKBUFFER_T *p_image;
+	const uint8_t *p_data;
+	uint8_t *p_planes;
+	size_t size;
+
+	p_image = sangria_get_backbuffer_format( p_header->width, p_header->height, format );
+	if( p_image == NULL ) {
+		return NULL;
+	}
+	p_data		= p_file + IMAGE_OFFSET;
+	size		= (size_t) sangria_1bpp_stride( p_header->width ) * p_header->height * 2;
+	p_planes	= NULL;
+	if( format == SANGRIA_FORMAT_1BPP ) {
+		//	straight into the back buffer
+		p_planes = p_image->image;
+	}
+	else if( p_header->compression != ASSET_RAW ) {
+		p_planes = (uint8_t*) malloc( size );
+		if( p_planes == NULL ) {
+			sangria_release_backbuffer( p_image );
+			return NULL;
+		}
+	}
+	if( p_header->compression == ASSET_RAW ) {
+		if( format == SANGRIA_FORMAT_1BPP ) {
+			memcpy( p_planes, p_data, size );
+		}
+		else {
+			_expand_8bpp( p_data, p_image );
+		}
+		return p_image;
+	}
+	if( !_lz_decode( p_data, p_header->data_size, p_planes, size ) ) {
+		if( p_planes != p_image->image ) {
+			free( p_planes );
+		}
+		sangria_release_backbuffer( p_image );
+		return NULL;
+	}
+	if( p_planes != p_image->image ) {
+		_expand_8bpp( p_planes, p_image );
+		free( p_planes );
+	}
+	return p_image;
+}
+
+// --------------------------------------------------------------------
+//	pp_map != NULL: the asset must be tiled, and a copy of the map is returned.
+//
+static SANGRIA_BACKBUFFER_T *_load( const char *p_file_name, SANGRIA_FORMAT_T format, ASSET_HEADER_T *p_header, uint16_t **pp_map ) {
+	SANGRIA_BACKBUFFER_T *p_image;
+	struct stat st;
+	uint8_t *p_file;
+	size_t map_size;
+	int fd, is_mapped;
+
+	if( format != SANGRIA_FORMAT_8BPP && format != SANGRIA_FORMAT_1BPP ) {
+		return NULL;
+	}
+	fd = open( p_file_name, O_RDONLY );
+	if( fd < 0 ) {
+		return NULL;
+	}
+	p_image	= NULL;
+	p_file	= NULL;
+	if( fstat( fd, &st ) < 0 || pread( fd, p_header, sizeof(ASSET_HEADER_T), 0 ) != sizeof(ASSET_HEADER_T) ||
+		!_check_header( p_header, st.st_size ) || (pp_map != NULL && p_header->tile_width == 0) ) {
+		close( fd );
+		return NULL;
+	}
+	is_mapped = (p_header->compression == ASSET_RAW && format == SANGRIA_FORMAT_1BPP);
+	if( is_mapped ) {
+		p_image = _map( fd, st.st_size );
+		if( p_image != NULL ) {
+			p_file = (uint8_t*) p_image - BACKBUFFER_OFFSET;
+		}
+	}
+	else {
+		p_file = (uint8_t*) malloc( st.st_size );
+		if( p_file != NULL && pread( fd, p_file, st.st_size, 0 ) == st.st_size ) {
+			p_image = _decode( p_file, format );
+		}
+	}
+	close( fd );
+	if( p_image != NULL && pp_map != NULL ) {
+		map_size	= (size_t) p_header->map_width * p_header->map_height * sizeof(uint16_t);
+		*pp_map		= (uint16_t*) malloc( map_size );
+		if( *pp_map == NULL ) {
+			sangria_release_image( p_image );
+			p_image = NULL;
+		}
+		else {
+			memcpy( *pp_map, p_file + IMAGE_OFFSET + p_header->data_size, map_size );
+		}
+	}
+	if( !is_mapped ) {
+		free( p_file );
+	}
+	return p_image;
+}
+
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_load_image( const char *p_file_name, SANGRIA_FORMAT_T format ) {
+	ASSET_HEADER_T header;
+
+	return _load( p_file_name, format, &header, NULL );
+}
+
+// --------------------------------------------------------------------
+void sangria_release_image( SANGRIA_BACKBUFFER_T *p_image ) {
+	MAPPED_T **pp;
+	MAPPED_T *p_node;
+
+	if( p_image == NULL ) {
+		return;
+	}
+	for( pp = &p_mapped; *pp != NULL; pp = &(*pp)->p_next ) {
+		p_node = *pp;
+		if( (uint8_t*) p_node->p_base + BACKBUFFER_OFFSET == (uint8_t*) p_image ) {
+			*pp = p_node->p_next;
+			munmap( p_node->p_base, p_node->size );
+			free( p_node );
+			return;
+		}
+	}
+	sangria_release_backbuffer( p_image );
+}
+
+// --------------------------------------------------------------------
+H_SANGRIA_TILEMAP_T sangria_load_tilemap( const char *p_file_name, SANGRIA_FORMAT_T format, SANGRIA_BACKBUFFER_T **pp_tile_sheet ) {
+	ASSET_HEADER_T header;
+	SANGRIA_BACKBUFFER_T *p_sheet;
+	H_SANGRIA_TILEMAP_T htilemap;
+	uint16_t *p_map;
+
+	p_sheet = _load( p_file_name, format, &header, &p_map );
+	if( p_sheet == NULL ) {
+		return NULL;
+	}
+	htilemap = sangria_tilemap_initialize( p_sheet, header.tile_width, header.tile_height, p_map, header.map_width, header.map_height );
+	free( p_map );
+	if( htilemap == NULL ) {
+		sangria_release_image( p_sheet );
+		return NULL;
+	}
+	*pp_tile_sheet = p_sheet;
+	return htilemap;
+}
+
+// --------------------------------------------------------------------
+const char *sangria_asset_path( const char *p_name, char *p_path, size_t size ) {
+	const char *p_dir;
+	char *p_slash;
+	ssize_t length;
+	int n;
+
+	if( p_name[0] == '/' ) {
+		n = snprintf( p_path, size, "%s", p_name );
+		return (n >= 0 && (size_t) n < size) ? p_path : NULL;
+	}
+	p_dir = getenv( "SANGRIA_ASSET_DIR" );
+	if( p_dir != NULL && p_dir[0] != '\0' ) {
+		n = snprintf( p_path, size, "%s/%s", p_dir, p_name );
+		return (n >= 0 && (size_t) n < size) ? p_path : NULL;
+	}
+	//	the directory of the executable
+	length = readlink( "/proc/self/exe", p_path, size );
+	if( length <= 0 || (size_t) length >= size ) {
+		return NULL;
+	}
+	p_path[ length ] = '\0';
+	p_slash = strrchr( p_path, '/' );
+	if( p_slash == NULL ) {
+		return NULL;
+	}
+	length = p_slash + 1 - p_path;
+	n = snprintf( p_path + length, size - length, "%s", p_name );
+	return (n >= 0 && (size_t) n < size - length) ? p_path : NULL;
+}
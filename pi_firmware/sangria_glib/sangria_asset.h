@@ -0,0 +1,105 @@
+// --------------------------------------------------------------------
+// Sangria game library: asset loader
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	Loads the images made by "image_converter.py -a" (*.sga). The pixels
+//	are stored as the packed 1bpp pixel plane and mask plane of
+//	SANGRIA_FORMAT_1BPP, compressed by LZ (LZ4 block format) unless -u
+//	is given. "-t WxH" stores a tile sheet without duplicated tiles and
+//	the map of them, for sangria_tilemap.
+//
+//	A file is 1/60 of the array made by image_converter.py (game.png:
+//	480KB to 8KB), and it is loaded in a fraction of a millisecond.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_ASSET_H__
+#define __SANGRIA_ASSET_H__
+
+#include "sangria_glib.h"
+#include "sangria_tilemap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --------------------------------------------------------------------
+//	sangria_load_image()
+//	input)
+//		p_file_name .... file name of the asset (*.sga)
+//		format ......... SANGRIA_FORMAT_8BPP or SANGRIA_FORMAT_1BPP
+//	output)
+//		NULL ........... failed (no file, broken file or not enough memory)
+//		others ......... backbuffer pointer
+//	comment)
+//		Release it by sangria_release_image().
+//		An uncompressed asset loaded as SANGRIA_FORMAT_1BPP is mapped
+//		to memory (copy on write), so only the used pages are read.
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_load_image( const char *p_file_name, SANGRIA_FORMAT_T format );
+
+// --------------------------------------------------------------------
+//	sangria_release_image()
+//	input)
+//		p_image ........ backbuffer pointer from sangria_load_image()
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_release_image( SANGRIA_BACKBUFFER_T *p_image );
+
+// --------------------------------------------------------------------
+//	sangria_load_tilemap()
+//	input)
+//		p_file_name .... file name of the asset (*.sga) made with "-t WxH"
+//		format ......... format of the tile sheet
+//		pp_tile_sheet .. the loaded tile sheet is returned
+//	output)
+//		NULL ........... failed (not a tiled asset, etc.)
+//		others ......... H_SANGRIA_TILEMAP_T instance
+//	comment)
+//		Release *pp_tile_sheet by sangria_release_image() after
+//		sangria_tilemap_terminate().
+// --------------------------------------------------------------------
+H_SANGRIA_TILEMAP_T sangria_load_tilemap( const char *p_file_name, SANGRIA_FORMAT_T format, SANGRIA_BACKBUFFER_T **pp_tile_sheet );
+
+// --------------------------------------------------------------------
+//	sangria_asset_path()
+//	input)
+//		p_name ......... file name of the asset, relative to the asset
+//		                 directory (e.g. "sample/game.sga")
+//		p_path ......... buffer for the path
+//		size ........... size of p_path
+//	output)
+//		NULL ........... failed (too long path, etc.)
+//		others ......... p_path
+//	comment)
+//		The asset directory is $SANGRIA_ASSET_DIR if it is set, else
+//		the directory of the executable (/proc/self/exe), so that the
+//		program can be started from any directory.
+//		An absolute p_name is copied as it is.
+// --------------------------------------------------------------------
+const char *sangria_asset_path( const char *p_name, char *p_path, size_t size );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,163 @@
+// --------------------------------------------------------------------
+// Sangria game library: frame pacing
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include "sangria_frame.h"
+
+#define HISTOGRAM_STEP		100			//	microseconds
+#define HISTOGRAM_SIZE		1000		//	up to 100 msec, longer frames are in the last one
+
+static int			frame_rate	= 0;
+static int64_t		base_time	= 0;	//	start of the grid (nsec), 0: not started
+static int64_t		frame_index	= 0;	//	frames since base_time
+static int64_t		last_time	= 0;	//	return of the last sangria_wait_frame() (nsec)
+
+//	statistics
+static uint32_t		frames		= 0;
+static uint32_t		late_frames	= 0;
+static uint32_t		min_time	= 0;
+static uint32_t		max_time	= 0;
+static uint64_t		total_time	= 0;
+static uint64_t		total_work	= 0;
+static uint32_t		histogram[ HISTOGRAM_SIZE ];
+
+// --------------------------------------------------------------------
+static int64_t _get_time( void ) {
+	struct timespec ts;
+
+	clock_gettime( CLOCK_MONOTONIC, &ts );
+	return (int64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void _sleep_until( int64_t t ) {
+	struct timespec ts;
+
+	ts.tv_sec	= (time_t)( t / 1000000000 );
+	ts.tv_nsec	= (long)( t % 1000000000 );
+	while( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL ) == EINTR ) {
+	}
+}
+
+// --------------------------------------------------------------------
+static void _add_frame_time( uint32_t t, uint32_t work ) {
+	uint32_t i;
+
+	if( frames == 0 || min_time > t ) {
+		min_time = t;
+	}
+	if( max_time < t ) {
+		max_time = t;
+	}
+	i = t / HISTOGRAM_STEP;
+	histogram[ (i < HISTOGRAM_SIZE) ? i : HISTOGRAM_SIZE - 1 ]++;
+	total_time += t;
+	total_work += work;
+	frames++;
+}
+
+// --------------------------------------------------------------------
+void sangria_set_frame_rate( int fps ) {
+
+	frame_rate	= (fps > 0) ? fps : 0;
+	base_time	= 0;
+	last_time	= 0;
+	frames		= 0;
+	late_frames	= 0;
+	min_time	= 0;
+	max_time	= 0;
+	total_time	= 0;
+	total_work	= 0;
+	memset( histogram, 0, sizeof(histogram) );
+}
+
+// --------------------------------------------------------------------
+uint32_t sangria_wait_frame( void ) {
+	int64_t now, deadline, work;
+	uint32_t t;
+
+	now = _get_time();
+	work = last_time ? now - last_time : 0;
+	if( frame_rate > 0 ) {
+		if( base_time == 0 ) {
+			base_time	= now;
+			frame_index	= 0;
+		}
+		frame_index++;
+		//	from the start of the grid, so the rounding is not accumulated
+		deadline = base_time + frame_index * 1000000000 / frame_rate;
+		if( now < deadline ) {
+			_sleep_until( deadline );
+			now = _get_time();
+		}
+		else {
+			late_frames++;
+			if( now - deadline >= 1000000000 / frame_rate ) {
+				//	Too late to catch up, the grid starts again.
+				base_time	= now;
+				frame_index	= 0;
+			}
+		}
+	}
+	if( last_time == 0 ) {
+		last_time = now;
+		return 0;
+	}
+	//	truncated separately, so the sum of the frames is not shorter than the time
+	t = (uint32_t)( now / 1000 - last_time / 1000 );
+	last_time = now;
+	_add_frame_time( t, (uint32_t)( work / 1000 ) );
+	return t;
+}
+
+// --------------------------------------------------------------------
+void sangria_get_frame_time( SANGRIA_FRAME_TIME_T *p_time ) {
+	uint32_t i, count, limit;
+
+	memset( p_time, 0, sizeof(SANGRIA_FRAME_TIME_T) );
+	if( frames == 0 ) {
+		return;
+	}
+	p_time->frames	= frames;
+	p_time->late	= late_frames;
+	p_time->min		= min_time;
+	p_time->average	= (uint32_t)( total_time / frames );
+	p_time->max		= max_time;
+	p_time->work	= (uint32_t)( total_work / frames );
+	//	the first bin that has 99% of the frames
+	limit = frames - frames / 100;
+	count = 0;
+	for( i = 0; i < HISTOGRAM_SIZE; i++ ) {
+		count += histogram[i];
+		if( count >= limit ) {
+			break;
+		}
+	}
+	p_time->p99 = (i + 1) * HISTOGRAM_STEP;
+	if( p_time->p99 > max_time ) {
+		p_time->p99 = max_time;
+	}
+}
@@ -0,0 +1,100 @@
+// --------------------------------------------------------------------
+// Sangria game library: frame pacing
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	Paces the main loop of a game to a fixed frame rate, so the game runs
+//	at the same speed however fast the frames are sent to the display,
+//	and sleeps instead of drawing frames that are dropped.
+//
+//	The end of each frame is on a fixed grid of the start time, so the
+//	rounding of the interval and the oversleep of each wait do not add
+//	up. A frame that is late is followed by shorter ones until the grid
+//	is reached again. After a whole frame interval or more, the grid is
+//	started again from that time instead of catching up with a burst.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_FRAME_H__
+#define __SANGRIA_FRAME_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// --------------------------------------------------------------------
+//	SANGRIA_FRAME_TIME_T
+//	comment)
+//		The times are microseconds between two sangria_wait_frame().
+//		p99 is rounded up to 100 microseconds.
+// --------------------------------------------------------------------
+typedef struct {
+	uint32_t	frames;			//	measured frames
+	uint32_t	late;			//	frames that ended after their time
+	uint32_t	min;
+	uint32_t	average;
+	uint32_t	max;
+	uint32_t	p99;			//	99% of the frames are not longer than this
+	uint32_t	work;			//	average time from sangria_wait_frame() to the next one without the wait
+} SANGRIA_FRAME_TIME_T;
+
+// --------------------------------------------------------------------
+//	sangria_set_frame_rate()
+//	input)
+//		fps ........ target frame rate (frames per second), 0: no wait
+//	output)
+//		none
+//	comment)
+//		The grid starts at the next sangria_wait_frame(). The frame time
+//		statistics are cleared.
+// --------------------------------------------------------------------
+void sangria_set_frame_rate( int fps );
+
+// --------------------------------------------------------------------
+//	sangria_wait_frame()
+//	input)
+//		none
+//	output)
+//		time from the last sangria_wait_frame() (microseconds), 0 at the first call
+//	comment)
+//		Sleeps until the end of the current frame. Call it once a frame,
+//		after sangria_display() or sangria_flip(). A game that moves by
+//		the returned time keeps its speed even when frames are late.
+//		sangria_wait_transfer() can be called before it, so the next
+//		frame is not drawn before the display has the last one.
+// --------------------------------------------------------------------
+uint32_t sangria_wait_frame( void );
+
+// --------------------------------------------------------------------
+//	sangria_get_frame_time()
+//	input)
+//		p_time ..... frame time statistics since sangria_set_frame_rate() are stored
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_get_frame_time( SANGRIA_FRAME_TIME_T *p_time );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -22,35 +22,29 @@
 //	DEALINGS IN THE SOFTWARE.
 // --------------------------------------------------------------------
 
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <malloc.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <sched.h>
+#include <time.h>
 #include <sys/types.h>
-#include <sys/ipc.h>
-#include <sys/sem.h>
+#include <sys/mman.h>
 #include <sys/stat.h>
-#include <pthread.h>
-#include <armbianio.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include "sangria_shm.h"
 #include "sangria_glib.h"
+#include "sangria_glib_1bpp.h"
+#include "sangria_glib_8bpp.h"
 
-#if defined(__GNU_LIBRARY__) && !defined(_SEM_SEMUN_UNDEFINED)
-	// semun is defined into <sys/sem.h>. */
-#else
-union semun {
-	int val;					// value for SETVAL
-	struct semid_ds *buf;		// buffer for IPC_STAT, IPC_SET
-	unsigned short int *array;	// array for GETALL, SETALL
-	struct seminfo *__buf;		// buffer for IPC_INFO
-};
-#endif
-
-#define sangria_width		400
-#define sangria_height		240
-
-#define CS				28
-#define DISPON			32
-#define EXTCOMIN		27
-#define SPEED			3500000
+#define sangria_width		SANGRIA_SHM_WIDTH
+#define sangria_height		SANGRIA_SHM_HEIGHT
 
 #define LED0			15				//	LEFT-UP
 #define LED1			37				//	RIGHT-UP
@@ -63,191 +57,398 @@ union semun {
 #define SW_RIGHT		38				//	BUT4	SW104
 #define SW_UP			40				//	BUT5	SW105
 
-static int sem_id				= -1;	//	for SharpMemoryDisplay lock semaphore
-static int hspi					= -1;
-static pthread_t h_draw_thread;
+static SANGRIA_SHM_T *p_shm		= NULL;	//	frame ring of sangria_lcd
 
-static int update_sem_id		= -1;	//	for SharpMemoryDisplay update lock semaphore
-static int info_sem_id			= -1;
-static volatile int exit_request = 0;	//	0: normal, 1: exit request
-static SANGRIA_BACKBUFFER_T *p_send_buffer;
+static int32_t back_slot		= 0;	//	slot owned by this client
+static int32_t flip_format		= SANGRIA_FORMAT_8BPP;
+static SANGRIA_FRAME_COUNT_T base_count;	//	counters at sangria_initialize()
+static uint32_t last_frame_id	= 0;	//	transferred of the last published frame
+
+//	lines that have been changed since each slot was written
+static SANGRIA_SHM_LINES_T stale_lines[ SANGRIA_SHM_SLOTS ];
+static const SANGRIA_BACKBUFFER_T *p_last_image = NULL;
+static int32_t last_format = SANGRIA_FORMAT_8BPP;
 
 //static const int led_pin[] = {
 //	LED0, LED1, LED2, LED3
 //};
 
-static struct sembuf lock_operations;
-static struct sembuf unlock_operations;
+// --------------------------------------------------------------------
+static void _add_lines( int32_t *p_top, int32_t *p_bottom, int y1, int y2 ) {
+
+	if( *p_top > *p_bottom ) {
+		*p_top		= y1;
+		*p_bottom	= y2;
+		return;
+	}
+	if( *p_top > y1 ) {
+		*p_top = y1;
+	}
+	if( *p_bottom < y2 ) {
+		*p_bottom = y2;
+	}
+}
 
 // --------------------------------------------------------------------
-//	Table for inverting the sequence of bits
-//	{ b7, b6, ... , b0 } --> { b0, b1, ... , b7 }
-//
-static const unsigned char mirror[256] = {
-	0, 128, 64, 192, 32, 160, 96, 224, 16, 144, 80, 208, 48, 176, 112, 240,
-	8, 136, 72, 200, 40, 168, 104, 232, 24, 152, 88, 216, 56, 184, 120, 248,
-	4, 132, 68, 196, 36, 164, 100, 228, 20, 148, 84, 212, 52, 180, 116, 244,
-	12, 140, 76, 204, 44, 172, 108, 236, 28, 156, 92, 220, 60, 188, 124, 252,
-	2, 130, 66, 194, 34, 162, 98, 226, 18, 146, 82, 210, 50, 178, 114, 242,
-	10, 138, 74, 202, 42, 170, 106, 234, 26, 154, 90, 218, 58, 186, 122, 250,
-	6, 134, 70, 198, 38, 166, 102, 230, 22, 150, 86, 214, 54, 182, 118, 246,
-	14, 142, 78, 206, 46, 174, 110, 238, 30, 158, 94, 222, 62, 190, 126, 254,
-	1, 129, 65, 193, 33, 161, 97, 225, 17, 145, 81, 209, 49, 177, 113, 241,
-	9, 137, 73, 201, 41, 169, 105, 233, 25, 153, 89, 217, 57, 185, 121, 249,
-	5, 133, 69, 197, 37, 165, 101, 229, 21, 149, 85, 213, 53, 181, 117, 245,
-	13, 141, 77, 205, 45, 173, 109, 237, 29, 157, 93, 221, 61, 189, 125, 253,
-	3, 131, 67, 195, 35, 163, 99, 227, 19, 147, 83, 211, 51, 179, 115, 243,
-	11, 139, 75, 203, 43, 171, 107, 235, 27, 155, 91, 219, 59, 187, 123, 251,
-	7, 135, 71, 199, 39, 167, 103, 231, 23, 151, 87, 215, 55, 183, 119, 247,
-	15, 143, 79, 207, 47, 175, 111, 239, 31, 159, 95, 223, 63, 191, 127, 255
-};
-
-// --------------------------------------------------------------------
-static void *_draw_thread( void *p_arg ) {
-	static uint8_t frame_buffer[ 1 + (sangria_width / 8) + 1 ];
-	int y, x, bit;
-	uint8_t d = 0;
-	const uint8_t *p;
-	unsigned char buffer = 0x80;
+static void inline _mark_dirty( SANGRIA_BACKBUFFER_T *p_image, int y1, int y2 ) {
 
-	for(;;) {
-		//	get semaphore (update request)
-		semop( update_sem_id, &lock_operations, 1 );
-		semop( info_sem_id, &lock_operations, 1 );
-		if( exit_request ) break;
-		//	convert to 1bpp from 8bpp.
-		p = p_send_buffer->image;
-		AIOWriteGPIO( CS, 1 );
-		AIOWriteSPI( hspi, &buffer, 1 );
-		for( y = 1; y <= sangria_height; y++ ) {
-			frame_buffer[0] = mirror[ y ];
-			for( x = 1; x < 51; x++ ) {
-				d = 0;
-				for( bit = 0; bit < 8; bit++ ) {
-					d = (d << 1) + ((*p) < 128);
-					p++;
-				}
-				frame_buffer[x] = d;
-			}
-			frame_buffer[51] = 0;
-			AIOWriteSPI( hspi, frame_buffer, 1 + 50 + 1 );
+	if( y1 < 0 ) {
+		y1 = 0;
+	}
+	if( y2 >= p_image->height ) {
+		y2 = p_image->height - 1;
+	}
+	if( y1 > y2 ) {
+		return;
+	}
+	_add_lines( &p_image->dirty_top, &p_image->dirty_bottom, y1, y2 );
+}
+
+// --------------------------------------------------------------------
+static void _wake_up_lcd( void ) {
+
+	//	No system call while sangria_lcd is not waiting (see fshm_wait()).
+	__atomic_add_fetch( &p_shm->frame, 1, __ATOMIC_SEQ_CST );
+	if( __atomic_load_n( &p_shm->waiting, __ATOMIC_SEQ_CST ) ) {
+		syscall( SYS_futex, &p_shm->frame, FUTEX_WAKE, INT_MAX, NULL, NULL, 0 );
+	}
+}
+
+// --------------------------------------------------------------------
+//	The slot that is neither middle nor front. sangria_lcd stores front
+//	just after the exchange of middle, so both are read again until they
+//	are consistent.
+//
+static int _find_back_slot( void ) {
+	uint32_t middle, front;
+	int retry;
+
+	for( retry = 0; retry < 1000; retry++ ) {
+		middle	= __atomic_load_n( &p_shm->middle, __ATOMIC_ACQUIRE ) & SANGRIA_SHM_SLOT_MASK;
+		front	= __atomic_load_n( &p_shm->front, __ATOMIC_ACQUIRE );
+		if( middle != front && middle < SANGRIA_SHM_SLOTS && front < SANGRIA_SHM_SLOTS &&
+			middle == (__atomic_load_n( &p_shm->middle, __ATOMIC_ACQUIRE ) & SANGRIA_SHM_SLOT_MASK) ) {
+			back_slot = (0 + 1 + 2) - middle - front;
+			//	A frame of the previous client is not counted as dropped.
+			__atomic_and_fetch( &p_shm->middle, ~SANGRIA_SHM_FRESH, __ATOMIC_ACQ_REL );
+			return 1;
 		}
-		//	transfer
-		AIOWriteGPIO( CS, 0 );
-		semop( info_sem_id, &unlock_operations, 1 );
+		sched_yield();
+	}
+	return 0;
+}
+
+// --------------------------------------------------------------------
+static int _attach( void ) {
+	int32_t owner, pid;
+
+	pid = (int32_t) getpid();
+	owner = 0;
+	if( __atomic_compare_exchange_n( &p_shm->client_pid, &owner, pid, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE ) ) {
+		return 1;
+	}
+	if( kill( owner, 0 ) == -1 && errno == ESRCH ) {
+		//	The previous client has exited without sangria_terminate().
+		__atomic_store_n( &p_shm->is_published, 0, __ATOMIC_RELEASE );
+		return __atomic_compare_exchange_n( &p_shm->client_pid, &owner, pid, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
 	}
-	semop( info_sem_id, &unlock_operations, 1 );
-	pthread_exit( NULL );
+	//	Another client owns the display.
+	return 0;
 }
 
 // --------------------------------------------------------------------
 int sangria_initialize( void ) {
-	key_t key;
-	union semun sem_arg;
-
-	lock_operations.sem_num = 0;
-	lock_operations.sem_op = -1;
-	lock_operations.sem_flg = SEM_UNDO;
-	unlock_operations.sem_num = 0;
-	unlock_operations.sem_op = 1;
-	unlock_operations.sem_flg = SEM_UNDO;
-
-	AIOInitBoard( "Raspberry Pi" );
-
-	//AIOAddGPIO( LED0		, GPIO_OUT );
-	//AIOAddGPIO( LED1		, GPIO_OUT );
-	//AIOAddGPIO( LED2		, GPIO_OUT );
-	//AIOAddGPIO( LED3		, GPIO_OUT );
-    //
-	//AIOAddGPIO( SW_UP		, GPIO_IN );
-	//AIOAddGPIO( SW_LEFT		, GPIO_IN );
-	//AIOAddGPIO( SW_RIGHT	, GPIO_IN );
-	//AIOAddGPIO( SW_DOWN		, GPIO_IN );
-	//AIOAddGPIO( SW_BUTTON	, GPIO_IN );
-
-	AIOAddGPIO( CS			, GPIO_OUT );
-	AIOAddGPIO( DISPON		, GPIO_OUT );
-	AIOAddGPIO( EXTCOMIN	, GPIO_OUT );
-
-	//	Get SPI handle
-	hspi = AIOOpenSPI( SPI_BUS_NUMBER, SPEED );
-	if( hspi == -1 ) {
+	int h, i;
+
+	//	sangria_lcd creates the shared memory and drives the display.
+	h = shm_open( SANGRIA_SHM_NAME, O_RDWR, 0 );
+	if( h == -1 ) {
+		if( errno == EACCES ) {
+			fprintf( stderr, "[ERROR] sangria_initialize: No permission for %s, add the user to group %s.\n",
+				SANGRIA_SHM_NAME, SANGRIA_SHM_GROUP );
+		}
+		else {
+			fprintf( stderr, "[ERROR] sangria_initialize: sangria_lcd is not running, start it first"
+				" (sudo systemctl start sangria_lcd).\n" );
+		}
+		return 0;
+	}
+	p_shm = (SANGRIA_SHM_T*) mmap( NULL, sizeof(SANGRIA_SHM_T), PROT_READ | PROT_WRITE, MAP_SHARED, h, 0 );
+	close( h );
+	if( p_shm == MAP_FAILED ) {
+		fprintf( stderr, "[ERROR] sangria_initialize: Cannot map %s.\n", SANGRIA_SHM_NAME );
+		p_shm = NULL;
+		return 0;
+	}
+	if( __atomic_load_n( &p_shm->magic, __ATOMIC_ACQUIRE ) != SANGRIA_SHM_MAGIC ||
+		p_shm->version != SANGRIA_SHM_VERSION ) {
+		fprintf( stderr, "[ERROR] sangria_initialize: sangria_lcd is starting, or is not the version of this sangria_glib.\n" );
+		munmap( p_shm, sizeof(SANGRIA_SHM_T) );
+		p_shm = NULL;
 		return 0;
 	}
+	if( !_attach() ) {
+		fprintf( stderr, "[ERROR] sangria_initialize: Process %d owns the display.\n",
+			(int) __atomic_load_n( &p_shm->client_pid, __ATOMIC_ACQUIRE ) );
+		munmap( p_shm, sizeof(SANGRIA_SHM_T) );
+		p_shm = NULL;
+		return 0;
+	}
+	if( !_find_back_slot() ) {
+		fprintf( stderr, "[ERROR] sangria_initialize: The frame buffers of sangria_lcd are broken.\n" );
+		sangria_terminate();
+		return 0;
+	}
+	//	The contents of the slots are unknown.
+	for( i = 0; i < SANGRIA_SHM_SLOTS; i++ ) {
+		stale_lines[i].top		= 0;
+		stale_lines[i].bottom	= sangria_height - 1;
+	}
+	p_last_image = NULL;
+	last_frame_id = 0;
+	base_count.published	= __atomic_load_n( &p_shm->published, __ATOMIC_ACQUIRE );
+	base_count.presented	= __atomic_load_n( &p_shm->presented, __ATOMIC_ACQUIRE );
+	base_count.dropped		= __atomic_load_n( &p_shm->dropped, __ATOMIC_ACQUIRE );
+	return 1;
+}
 
-	key = ftok( "/usr/local/bin/sangria_lcd", 1 );
+// --------------------------------------------------------------------
+void sangria_terminate( void ) {
+	int32_t pid;
 
-	sem_id = semget( key, 1, 0666 );
-	if( sem_id != -1 ) {
-		semop( sem_id, &lock_operations, 1 );
+	if( p_shm == NULL ) {
+		return;
 	}
+	pid = (int32_t) getpid();
+	__atomic_store_n( &p_shm->is_published, 0, __ATOMIC_RELEASE );
+	__atomic_compare_exchange_n( &p_shm->client_pid, &pid, 0, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE );
+	//	sangria_lcd shows /dev/fb0 again.
+	_wake_up_lcd();
+	munmap( p_shm, sizeof(SANGRIA_SHM_T) );
+	p_shm = NULL;
+}
 
-	update_sem_id = semget( IPC_PRIVATE, 1, S_IRUSR | S_IWUSR );
-	if( update_sem_id == -1 ) {
-		return 0;
+// --------------------------------------------------------------------
+//	The back slot becomes the newest frame, and the slot given back by the
+//	exchange becomes the back slot.
+//	top ... bottom: lines changed from the previous frame
+//
+static void _publish( int32_t top, int32_t bottom ) {
+	uint32_t published, middle;
+	int i;
+
+	published = p_shm->published;
+	p_shm->slot[ back_slot ].published = published;
+	p_shm->dirty[ published % SANGRIA_SHM_HISTORY ].top		= top;
+	p_shm->dirty[ published % SANGRIA_SHM_HISTORY ].bottom	= bottom;
+	if( top <= bottom ) {
+		for( i = 0; i < SANGRIA_SHM_SLOTS; i++ ) {
+			_add_lines( &stale_lines[i].top, &stale_lines[i].bottom, top, bottom );
+		}
 	}
-    sem_arg.val = 0;	//	locked
-    semctl( update_sem_id, 0, SETVAL, sem_arg );
+	stale_lines[ back_slot ].top	= 0;
+	stale_lines[ back_slot ].bottom	= -1;
 
-	info_sem_id = semget( IPC_PRIVATE, 1, S_IRUSR | S_IWUSR );
-	if( info_sem_id == -1 ) {
-		return 0;
+	middle = __atomic_exchange_n( &p_shm->middle, back_slot | SANGRIA_SHM_FRESH, __ATOMIC_ACQ_REL );
+	if( middle & SANGRIA_SHM_FRESH ) {
+		__atomic_add_fetch( &p_shm->dropped, 1, __ATOMIC_RELAXED );
+	}
+	back_slot = middle & SANGRIA_SHM_SLOT_MASK;
+	last_frame_id = published + 1;
+	__atomic_store_n( &p_shm->is_published, 1, __ATOMIC_RELEASE );
+	__atomic_store_n( &p_shm->published, published + 1, __ATOMIC_RELEASE );
+	_wake_up_lcd();
+}
+
+// --------------------------------------------------------------------
+void sangria_display( SANGRIA_BACKBUFFER_T *p_image ) {
+	SANGRIA_SHM_SLOT_T *p_slot;
+	SANGRIA_SHM_LINES_T copy;
+	int32_t top, bottom;
+	int line_size;
+
+	if( p_shm == NULL ) {
+		return;
+	}
+	if( p_image->width != sangria_width || p_image->height != sangria_height ) {
+		return;
+	}
+	top		= p_image->dirty_top;
+	bottom	= p_image->dirty_bottom;
+	if( p_image != p_last_image || p_image->format != last_format ) {
+		//	The lines of another back buffer are not tracked against the last frame.
+		top		= 0;
+		bottom	= sangria_height - 1;
+		p_last_image	= p_image;
+		last_format		= p_image->format;
+	}
+	p_image->dirty_top		= 0;
+	p_image->dirty_bottom	= -1;
+
+	//	The back slot is not read by sangria_lcd, so it is written without any lock.
+	p_slot = &p_shm->slot[ back_slot ];
+	((SANGRIA_BACKBUFFER_T*) p_slot->client)->format = -1;	//	not a flip buffer any more
+	if( p_image->format == SANGRIA_FORMAT_1BPP ) {
+		//	The pixel plane is sent to the display as it is.
+		p_slot->format = SANGRIA_SHM_FORMAT_1BPP;
+		line_size = sangria_width / 8;
+	}
+	else {
+		p_slot->format = SANGRIA_SHM_FORMAT_8BPP;
+		line_size = sangria_width;
 	}
-    sem_arg.val = 1;	//	unlocked
-    semctl( info_sem_id, 0, SETVAL, sem_arg );
+	copy = stale_lines[ back_slot ];
+	if( top <= bottom ) {
+		_add_lines( &copy.top, &copy.bottom, top, bottom );
+	}
+	if( copy.top <= copy.bottom ) {
+		memcpy( p_slot->image + copy.top * line_size, p_image->image + copy.top * line_size,
+			(copy.bottom - copy.top + 1) * line_size );
+	}
+	_publish( top, bottom );
+}
 
-	AIOWriteGPIO( DISPON	, 1 );
-	AIOWriteGPIO( EXTCOMIN	, 0 );
-	AIOWriteGPIO( CS		, 0 );
+// --------------------------------------------------------------------
+//	The back slot as a back buffer of flip_format.
+//
+static SANGRIA_BACKBUFFER_T *_get_flip_buffer( void ) {
+	SANGRIA_SHM_SLOT_T *p_slot = &p_shm->slot[ back_slot ];
+	SANGRIA_BACKBUFFER_T *p_image = (SANGRIA_BACKBUFFER_T*) p_slot->client;
+	uint32_t format;
+
+	format = (flip_format == SANGRIA_FORMAT_1BPP) ? SANGRIA_SHM_FORMAT_1BPP : SANGRIA_SHM_FORMAT_8BPP;
+	if( p_slot->format != format || p_image->format != flip_format ||
+		p_image->width != sangria_width || p_image->height != sangria_height ) {
+		//	The slot holds a frame of sangria_display() or of another format.
+		p_image->width	= sangria_width;
+		p_image->height	= sangria_height;
+		p_image->format	= flip_format;
+		sangria_clear_buffer( p_image, 0 );
+		p_slot->format	= format;
+		stale_lines[ back_slot ].top	= 0;
+		stale_lines[ back_slot ].bottom	= sangria_height - 1;
+	}
+	p_image->dirty_top		= 0;
+	p_image->dirty_bottom	= -1;
+	return p_image;
+}
 
-	//AIOWriteGPIO( LED0		, SANGRIA_LED_OFF );
-	//AIOWriteGPIO( LED1		, SANGRIA_LED_OFF );
-	//AIOWriteGPIO( LED2		, SANGRIA_LED_OFF );
-	//AIOWriteGPIO( LED3		, SANGRIA_LED_OFF );
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_get_flip_buffer( SANGRIA_FORMAT_T format ) {
 
-	p_send_buffer = sangria_get_backbuffer( sangria_width, sangria_height );
-	if( p_send_buffer == NULL ) {
-		return 0;
+	if( p_shm == NULL || (format != SANGRIA_FORMAT_8BPP && format != SANGRIA_FORMAT_1BPP) ) {
+		return NULL;
 	}
-	pthread_create( &h_draw_thread, NULL, _draw_thread, NULL );
-	return 1;
+	flip_format = format;
+	return _get_flip_buffer();
 }
 
 // --------------------------------------------------------------------
-void sangria_terminate( void ) {
-	void *p_result;
+SANGRIA_BACKBUFFER_T *sangria_flip( SANGRIA_BACKBUFFER_T *p_image ) {
+	SANGRIA_SHM_LINES_T lines;
 
-	exit_request = 1;
-	semop( update_sem_id, &lock_operations, 1 );
-	pthread_join( h_draw_thread, &p_result );
-	if( sem_id != -1 ) {
-		semop( sem_id, &unlock_operations, 1 );
+	if( p_shm == NULL || p_image != (SANGRIA_BACKBUFFER_T*) p_shm->slot[ back_slot ].client ) {
+		return p_image;
 	}
+	//	The lines changed since this slot was published last are changed too.
+	lines = stale_lines[ back_slot ];
+	if( p_image->dirty_top <= p_image->dirty_bottom ) {
+		_add_lines( &lines.top, &lines.bottom, p_image->dirty_top, p_image->dirty_bottom );
+	}
+	p_last_image = NULL;
+	_publish( lines.top, lines.bottom );
+	return _get_flip_buffer();
 }
 
 // --------------------------------------------------------------------
-void sangria_display( const SANGRIA_BACKBUFFER_T *p_image ) {
+void sangria_get_frame_count( SANGRIA_FRAME_COUNT_T *p_count ) {
 
-	if( p_image->width != sangria_width || p_image->height != sangria_height ) {
+	if( p_shm == NULL ) {
+		memset( p_count, 0, sizeof(SANGRIA_FRAME_COUNT_T) );
 		return;
 	}
-	semop( info_sem_id, &lock_operations, 1 );
-	memcpy( p_send_buffer->image, p_image->image, sangria_width * sangria_height );
-	semop( info_sem_id, &unlock_operations, 1 );
-	semop( update_sem_id, &unlock_operations, 1 );
+	p_count->published	= __atomic_load_n( &p_shm->published, __ATOMIC_ACQUIRE ) - base_count.published;
+	p_count->presented	= __atomic_load_n( &p_shm->presented, __ATOMIC_ACQUIRE ) - base_count.presented;
+	p_count->dropped	= __atomic_load_n( &p_shm->dropped, __ATOMIC_ACQUIRE ) - base_count.dropped;
+}
+
+// --------------------------------------------------------------------
+int sangria_wait_transfer( int timeout_ms ) {
+	struct timespec now, deadline, ts;
+	uint32_t transferred;
+	int64_t wait;
+	int result;
+
+	if( p_shm == NULL ) {
+		return 0;
+	}
+	if( last_frame_id == 0 ) {
+		return 1;
+	}
+	clock_gettime( CLOCK_MONOTONIC, &deadline );
+	deadline.tv_sec		+= timeout_ms / 1000;
+	deadline.tv_nsec	+= (long)( timeout_ms % 1000 ) * 1000000;
+	if( deadline.tv_nsec >= 1000000000 ) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000;
+	}
+	//	sangria_lcd wakes up the futex only while transfer_waiting is set (see fshm_notify_transferred()).
+	__atomic_store_n( &p_shm->transfer_waiting, 1, __ATOMIC_SEQ_CST );
+	for(;;) {
+		transferred = __atomic_load_n( &p_shm->transferred, __ATOMIC_SEQ_CST );
+		//	A frame dropped by sangria_lcd is never sent, but the newer one is.
+		if( (int32_t)( transferred - last_frame_id ) >= 0 ) {
+			result = 1;
+			break;
+		}
+		clock_gettime( CLOCK_MONOTONIC, &now );
+		wait = (int64_t)( deadline.tv_sec - now.tv_sec ) * 1000000000 + ( deadline.tv_nsec - now.tv_nsec );
+		if( wait <= 0 ) {
+			result = 0;
+			break;
+		}
+		ts.tv_sec	= (time_t)( wait / 1000000000 );
+		ts.tv_nsec	= (long)( wait % 1000000000 );
+		syscall( SYS_futex, &p_shm->transferred, FUTEX_WAIT, transferred, &ts, NULL, 0 );
+	}
+	__atomic_store_n( &p_shm->transfer_waiting, 0, __ATOMIC_RELAXED );
+	return result;
 }
 
 // --------------------------------------------------------------------
 SANGRIA_BACKBUFFER_T *sangria_get_backbuffer( uint32_t width, uint32_t height ) {
+
+	return sangria_get_backbuffer_format( width, height, SANGRIA_FORMAT_8BPP );
+}
+
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_get_backbuffer_format( uint32_t width, uint32_t height, SANGRIA_FORMAT_T format ) {
 	uint32_t size;
 	SANGRIA_BACKBUFFER_T *p;
 
-	size = width * height;
+	if( format == SANGRIA_FORMAT_1BPP ) {
+		//	pixel plane and mask plane
+		size = sangria_1bpp_stride( width ) * height * 2;
+	}
+	else if( format == SANGRIA_FORMAT_8BPP ) {
+		size = width * height;
+	}
+	else {
+		return NULL;
+	}
 	p = (SANGRIA_BACKBUFFER_T*) malloc( sizeof(SANGRIA_BACKBUFFER_T) + size - 1 );
 	if( p != NULL ) {
-		p->width	= width;
-		p->height	= height;
-		memset( p->image, 0, size );
+		p->width		= width;
+		p->height		= height;
+		p->dirty_top	= 0;
+		p->dirty_bottom	= height - 1;
+		p->format		= format;
+		if( format == SANGRIA_FORMAT_1BPP ) {
+			sangria_1bpp_clear( p, 0 );
+		}
+		else {
+			memset( p->image, 0, size );
+		}
 	}
 	return p;
 }
@@ -258,15 +459,38 @@ SANGRIA_BACKBUFFER_T *sangria_get_display( void ) {
 	return sangria_get_backbuffer( sangria_width, sangria_height );
 }
 
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_get_display_format( SANGRIA_FORMAT_T format ) {
+
+	return sangria_get_backbuffer_format( sangria_width, sangria_height, format );
+}
+
 // --------------------------------------------------------------------
 void sangria_release_backbuffer( SANGRIA_BACKBUFFER_T *p_image ) {
 	free( p_image );
 }
 
+// --------------------------------------------------------------------
+void sangria_mark_dirty( SANGRIA_BACKBUFFER_T *p_image, int y1, int y2 ) {
+
+	if( y1 > y2 ) {
+		_mark_dirty( p_image, y2, y1 );
+	}
+	else {
+		_mark_dirty( p_image, y1, y2 );
+	}
+}
+
 // --------------------------------------------------------------------
 void sangria_clear_buffer( SANGRIA_BACKBUFFER_T *p_image, uint8_t c ) {
 
-	memset( p_image->image, c, p_image->width * p_image->height );
+	if( p_image->format == SANGRIA_FORMAT_1BPP ) {
+		sangria_1bpp_clear( p_image, c );
+	}
+	else {
+		memset( p_image->image, c, p_image->width * p_image->height );
+	}
+	_mark_dirty( p_image, 0, p_image->height - 1 );
 }
 
 // --------------------------------------------------------------------
@@ -275,7 +499,13 @@ void sangria_set_pixel( SANGRIA_BACKBUFFER_T *p_image, int x, int y, uint8_t c )
 	if( x < 0 || y < 0 || x >= p_image->width || y >= p_image->height ) {
 		return;
 	}
-	p_image->image[ x + y * p_image->width ] = c;
+	if( p_image->format == SANGRIA_FORMAT_1BPP ) {
+		sangria_1bpp_set_pixel( p_image, x, y, c );
+	}
+	else {
+		p_image->image[ x + y * p_image->width ] = c;
+	}
+	_add_lines( &p_image->dirty_top, &p_image->dirty_bottom, y, y );
 }
 
 // --------------------------------------------------------------------
@@ -284,43 +514,130 @@ uint8_t sangria_get_pixel( SANGRIA_BACKBUFFER_T *p_image, int x, int y ) {
 	if( x < 0 || y < 0 || x >= p_image->width || y >= p_image->height ) {
 		return 0;
 	}
+	if( p_image->format == SANGRIA_FORMAT_1BPP ) {
+		return sangria_1bpp_get_pixel( p_image, x, y );
+	}
 	return p_image->image[ x + y * p_image->width ];
 }
 
 // --------------------------------------------------------------------
-void sangria_line( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, int y2, uint8_t c ) {
-	int w, h, vx, vy, n, i;
+//	ceil( a / b ) for b > 0
+//
+static inline int64_t _ceil_div( int64_t a, int64_t b ) {
 
-	if( x1 == x2 && y1 == y2 ) {
-		sangria_set_pixel( p_image, x1, y1, c );
-		return;
+	return (a >= 0) ? (a + b - 1) / b : -((-a) / b);
+}
+
+// --------------------------------------------------------------------
+//	Range of the step index i that keeps v1 + v * i in 0 ... size - 1.
+//
+static inline void _index_range( int v1, int v, int size, int64_t *p_i0, int64_t *p_i1 ) {
+
+	if( v > 0 ) {
+		*p_i0 = -(int64_t) v1;
+		*p_i1 = (int64_t) size - 1 - v1;
+	}
+	else if( v < 0 ) {
+		*p_i0 = (int64_t) v1 - (size - 1);
+		*p_i1 = v1;
+	}
+	else {
+		*p_i0 = (v1 >= 0 && v1 < size) ? INT64_MIN / 4 : 1;
+		*p_i1 = (v1 >= 0 && v1 < size) ? INT64_MAX / 4 : 0;
 	}
+}
+
+// --------------------------------------------------------------------
+//	Pixel i (0 ... major) of the line is major axis a1 + va * i and minor
+//	axis b1 + vb * (i * minor / major), with the error term n = i * minor
+//	% major. So the pixels inside the back buffer are found without
+//	walking the ones outside, and written without any check.
+//
+void sangria_line( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, int y2, uint8_t c ) {
+	int64_t i0, i1, k0, k1;
+	int w, h, vx, vy, major, minor, is_x_major, n, i, x, y, step_major, step_minor;
+	uint8_t *p;
+
 	w = abs( x2 - x1 );
 	h = abs( y2 - y1 );
 	vx = (x1 == x2) ? 0 : (x1 < x2) ? 1 : -1;
 	vy = (y1 == y2) ? 0 : (y1 < y2) ? 1 : -1;
-	n = 0;
-	if( w > h ) {
-		for( i = 0; i <= w; i++ ) {
-			sangria_set_pixel( p_image, x1, y1, c );
-			x1 += vx;
-			n += h;
-			if( n >= w ) {
-				n -= w;
-				y1 += vy;
-			}
-		}
+	is_x_major = (w > h);
+	major	= is_x_major ? w : h;
+	minor	= is_x_major ? h : w;
+
+	//	clipping: i of the major axis, and k = i * minor / major of the minor axis
+	if( is_x_major ) {
+		_index_range( x1, vx, p_image->width, &i0, &i1 );
+		_index_range( y1, vy, p_image->height, &k0, &k1 );
+	}
+	else {
+		_index_range( y1, vy, p_image->height, &i0, &i1 );
+		_index_range( x1, vx, p_image->width, &k0, &k1 );
+	}
+	if( minor > 0 ) {
+		//	k0 <= i * minor / major <= k1
+		if( i0 < _ceil_div( k0 * major, minor ) ) i0 = _ceil_div( k0 * major, minor );
+		if( i1 > _ceil_div( (k1 + 1) * major, minor ) - 1 ) i1 = _ceil_div( (k1 + 1) * major, minor ) - 1;
+	}
+	else if( k0 > 0 || k1 < 0 ) {
+		return;
+	}
+	if( i0 < 0 ) i0 = 0;
+	if( i1 > major ) i1 = major;
+	if( i0 > i1 ) {
+		return;
+	}
+	n = (int)( (i0 * minor) % (major ? major : 1) );
+	k0 = major ? (i0 * minor) / major : 0;
+	if( is_x_major ) {
+		x = x1 + vx * (int) i0;
+		y = y1 + vy * (int) k0;
 	}
 	else {
-		for( i = 0; i <= h; i++ ) {
-			sangria_set_pixel( p_image, x1, y1, c );
-			y1 += vy;
-			n += w;
-			if( n >= h ) {
-				n -= h;
-				x1 += vx;
+		x = x1 + vx * (int) k0;
+		y = y1 + vy * (int) i0;
+	}
+	//	from the first pixel to the last one
+	sangria_mark_dirty( p_image, y, y1 + vy * (int)( is_x_major ? (i1 * minor) / major : i1 ) );
+
+	if( p_image->format == SANGRIA_FORMAT_1BPP ) {
+		for( i = (int) i0; i <= (int) i1; i++ ) {
+			sangria_1bpp_set_pixel( p_image, x, y, c );
+			n += minor;
+			if( is_x_major ) {
+				x += vx;
+				if( n >= major ) {
+					n -= major;
+					y += vy;
+				}
+			}
+			else {
+				y += vy;
+				if( n >= major ) {
+					n -= major;
+					x += vx;
+				}
 			}
 		}
+		return;
+	}
+	if( minor == 0 && is_x_major ) {
+		//	horizontal
+		memset( p_image->image + ((vx > 0) ? x : x - (int)( i1 - i0 )) + y * p_image->width, c, (int)( i1 - i0 ) + 1 );
+		return;
+	}
+	p = p_image->image + x + y * p_image->width;
+	step_major	= is_x_major ? vx : vy * p_image->width;
+	step_minor	= is_x_major ? vy * p_image->width : vx;
+	for( i = (int) i0; i <= (int) i1; i++ ) {
+		*p = c;
+		p += step_major;
+		n += minor;
+		if( n >= major ) {
+			n -= major;
+			p += step_minor;
+		}
 	}
 }
 
@@ -338,7 +655,7 @@ static void inline _sort2( int *p1, int *p2 ) {
 static int _sort_and_clip( int *p_x1, int *p_x2, int width ) {
 
 	_sort2( p_x1, p_x2 );
-	if( *p_x1 >= width && *p_x2 < 0 ) {
+	if( *p_x1 >= width || *p_x2 < 0 ) {
 		return 0;
 	}
 	if( *p_x1 < 0 ) {
@@ -354,98 +671,184 @@ static int _sort_and_clip( int *p_x1, int *p_x2, int width ) {
 void sangria_fill_rect( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, int y2, uint8_t c ) {
 	int w, y, pos;
 
-	if( _sort_and_clip( &x1, &x2, p_image->width  ) ) return;
-	if( _sort_and_clip( &y1, &y2, p_image->height ) ) return;
+	if( !_sort_and_clip( &x1, &x2, p_image->width  ) ) return;
+	if( !_sort_and_clip( &y1, &y2, p_image->height ) ) return;
 	//	drawing
-	w = x2 - x1 + 1;
-	pos = x1 + p_image->width * y1;
-	for( y = y1; y <= y2; y++ ) {
-		memset( p_image->image + pos, c, w );
-		pos += p_image->width;
+	if( p_image->format == SANGRIA_FORMAT_1BPP ) {
+		sangria_1bpp_fill_rect( p_image, x1, y1, x2, y2, c );
 	}
+	else {
+		w = x2 - x1 + 1;
+		pos = x1 + p_image->width * y1;
+		for( y = y1; y <= y2; y++ ) {
+			memset( p_image->image + pos, c, w );
+			pos += p_image->width;
+		}
+	}
+	_mark_dirty( p_image, y1, y2 );
 }
 
 // --------------------------------------------------------------------
-int _clip( int *p_sx1, int *p_sx2, int *p_dx1, int src_width, int dest_width ) {
-	int dx2;
-
-	//	Handling of cases where the specified area of the transfer source extends beyond the source back buffer
-	//	]̗̈w肪A]̃obNobt@[͂ݏoꍇ̏ 
-	dx2 = *p_dx1 + (*p_sx2 - *p_sx1);
-	if( *p_sx1 < 0 && *p_sx2 < 0 ) return 0;
-	if( *p_sx1 >= src_width && *p_sx2 >= src_width ) return 0;
-	if( *p_sx1 < 0 ) {
-		*p_dx1 += -*p_sx1;
-		*p_sx1 = 0;
-	}
-	if( *p_sx2 < 0 ) {
-		dx2 += -*p_sx2;
-		*p_sx2 = 0;
-	}
-	if( *p_sx1 >= src_width ) {
-		*p_dx1 -= *p_sx1 - src_width;
-	}
-	if( *p_sx2 >= src_width ) {
-		dx2 -= *p_sx2 - src_width;
-	}
-	//	Handling of cases where the destination back buffer is exceeded
-	//	]obNobt@[͂ݏoꍇ̏ 
-	if( *p_dx1 < 0 && dx2 < 0 ) return 0;
-	if( *p_dx1 >= dest_width && dx2 >= dest_width ) return 0;
-	if( *p_dx1 < 0 ) {
-		*p_sx1 += -*p_dx1;
-		*p_dx1 = 0;
-	}
-	if( dx2 < 0 ) {
-		*p_sx2 += -dx2;
-		dx2 = 0;
-	}
-	if( *p_dx1 >= dest_width ) {
-		*p_sx1 -= *p_dx1 - dest_width;
+//	Clipping of one axis of sangria_copy().
+//	The source runs from s1 to s2 (s1 > s2 is mirrored), and the
+//	destination always runs from d1 in the increasing direction.
+//
+static int _clip( int *p_s1, int *p_s2, int *p_d1, int src_size, int dest_size ) {
+	int n, v, i0, i1;
+
+	v = (*p_s1 <= *p_s2) ? 1 : -1;
+	n = (*p_s2 - *p_s1) * v + 1;
+	//	range of the pixel index i: destination d1 + i, source s1 + v * i
+	i0 = -*p_d1;
+	i1 = dest_size - 1 - *p_d1;
+	if( v > 0 ) {
+		if( i0 < -*p_s1 ) i0 = -*p_s1;
+		if( i1 > src_size - 1 - *p_s1 ) i1 = src_size - 1 - *p_s1;
 	}
-	if( dx2 >= dest_width ) {
-		*p_sx2 -= dx2 - dest_width;
+	else {
+		if( i0 < *p_s1 - (src_size - 1) ) i0 = *p_s1 - (src_size - 1);
+		if( i1 > *p_s1 ) i1 = *p_s1;
 	}
+	if( i0 < 0 ) i0 = 0;
+	if( i1 > n - 1 ) i1 = n - 1;
+	if( i0 > i1 ) return 0;
+	*p_s2 = *p_s1 + v * i1;
+	*p_s1 = *p_s1 + v * i0;
+	*p_d1 = *p_d1 + i0;
 	return 1;
 }
 
 // --------------------------------------------------------------------
-void sangria_copy( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1 ) {
-	int x, y, vx, vy;
-	uint8_t *p_src, *p_dest, d;
-	uint8_t *p_src_st, *p_dest_st;
-
-	//	clipping
-	if( !_clip( &sx1, &sx2, &dx1, p_src_image->width , p_dest_image->width  ) ) return;
-	if( !_clip( &sy1, &sy2, &dy1, p_src_image->height, p_dest_image->height ) ) return;
+//	Pixel by pixel, for the formats that have no line function.
+//
+static void _copy_pixels( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1, int is_opaque ) {
+	int x, y, vx, vy, dx;
+	uint8_t d;
 
-	vx			= (sx1 < sx2) ? 1 : -1;
-	vy			= (sy1 < sy2) ? 1 : -1;
-	p_src		= p_src_image->image  + (sx1 + sy1 * p_src_image->width );
-	p_dest		= p_dest_image->image + (dx1 + dy1 * p_dest_image->width);
-	p_src_st	= p_src;
-	p_dest_st	= p_dest;
+	vx = (sx1 <= sx2) ? 1 : -1;
+	vy = (sy1 <= sy2) ? 1 : -1;
 	for( y = sy1; ; y += vy ) {
-		p_src	= p_src_st;
-		p_dest	= p_dest_st;
+		dx = dx1;
 		for( x = sx1; ; x += vx ) {
-			d = *(p_src++);
-			if( d ) {
-				*p_dest = d;
+			d = sangria_get_pixel( p_src_image, x, y );
+			if( d || is_opaque ) {
+				sangria_set_pixel( p_dest_image, dx, dy1, d );
 			}
-			p_dest++;
+			dx++;
 			if( x == sx2 ) break;
 		}
-		p_src_st	+= p_src_image->width * vy;
-		p_dest_st	+= p_dest_image->width * vy;
+		dy1++;
 		if( y == sy2 ) break;
 	}
 }
 
+// --------------------------------------------------------------------
+static void _copy( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1, int is_opaque ) {
+	int y, vx, vy, width;
+	const uint8_t *p_src;
+	uint8_t *p_dest;
+
+	//	clipping
+	if( !_clip( &sx1, &sx2, &dx1, p_src_image->width , p_dest_image->width  ) ) return;
+	if( !_clip( &sy1, &sy2, &dy1, p_src_image->height, p_dest_image->height ) ) return;
+	vx		= (sx1 <= sx2) ? 1 : -1;
+	vy		= (sy1 <= sy2) ? 1 : -1;
+	width	= (sx2 - sx1) * vx + 1;
+	sangria_mark_dirty( p_dest_image, dy1, dy1 + (sy2 - sy1) * vy );
+
+	if( p_src_image->format == SANGRIA_FORMAT_1BPP && p_dest_image->format == SANGRIA_FORMAT_1BPP && vx > 0 ) {
+		for( y = sy1; ; y += vy ) {
+			sangria_1bpp_copy_line( p_src_image, sx1, y, p_dest_image, dx1, dy1++, width, is_opaque );
+			if( y == sy2 ) break;
+		}
+		return;
+	}
+	if( p_src_image->format != SANGRIA_FORMAT_8BPP || p_dest_image->format != SANGRIA_FORMAT_8BPP ) {
+		_copy_pixels( p_src_image, sx1, sy1, sx2, sy2, p_dest_image, dx1, dy1, is_opaque );
+		return;
+	}
+	p_src	= p_src_image->image  + (sx1 + sy1 * p_src_image->width );
+	p_dest	= p_dest_image->image + (dx1 + dy1 * p_dest_image->width);
+	for( y = sy1; ; y += vy ) {
+		if( is_opaque ) {
+			sangria_8bpp_copy_line_opaque( p_src, p_dest, width, vx );
+		}
+		else {
+			sangria_8bpp_copy_line( p_src, p_dest, width, vx );
+		}
+		p_src	+= p_src_image->width * vy;
+		p_dest	+= p_dest_image->width;
+		if( y == sy2 ) break;
+	}
+}
+
+// --------------------------------------------------------------------
+void sangria_copy( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1 ) {
+
+	_copy( p_src_image, sx1, sy1, sx2, sy2, p_dest_image, dx1, dy1, 0 );
+}
+
+// --------------------------------------------------------------------
+void sangria_copy_opaque( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1 ) {
+
+	_copy( p_src_image, sx1, sy1, sx2, sy2, p_dest_image, dx1, dy1, 1 );
+}
+
+// --------------------------------------------------------------------
+//	base + a * t / d (truncated toward zero, as C division) while t
+//	steps by v, without division in _dda_step().
+//	t moves away from 0 in every step, so |a * t| only increases.
+//
+typedef struct {
+	int		value;
+	int		base;
+	int		sign;
+	int		q;
+	int		r;
+	int		q_step;
+	int		r_step;
+	int		d;
+} _DDA_T;
+
+// --------------------------------------------------------------------
+static inline void _dda_start( _DDA_T *p, int base, int a, int t, int v, int d ) {
+	int n;
+
+	n			= abs( a * t );
+	p->value	= base + a * t / d;
+	p->base		= base;
+	p->sign		= (a < 0) ? -v : v;
+	p->q		= n / d;
+	p->r		= n % d;
+	p->q_step	= abs( a ) / d;
+	p->r_step	= abs( a ) % d;
+	p->d		= d;
+}
+
+// --------------------------------------------------------------------
+static inline void _dda_step( _DDA_T *p ) {
+
+	p->q += p->q_step;
+	p->r += p->r_step;
+	if( p->r >= p->d ) {
+		p->r -= p->d;
+		p->q++;
+	}
+	p->value = p->base + p->sign * p->q;
+}
+
+// --------------------------------------------------------------------
+static inline int _clip_position( int x, int width ) {
+
+	return (x < 0) ? 0 : (x >= width) ? width - 1 : x;
+}
+
 // --------------------------------------------------------------------
 void sangria_stretch_copy( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1, int dx2, int dy2 ) {
-	int x, y, vx, vy, sx, sy, sw, dw, sh, dh, dx1d, dx2d, dy1d, dy2d;
-	uint8_t d;
+	int x, y, vx, vy, sw, dw, sh, dh, dx1d, dx2d, dy1d, dy2d, is_8bpp;
+	_DDA_T sx_start, sx, sy;
+	const uint8_t *p_src;
+	uint8_t *p_dest, d;
 
 	if( (dx1 < 0) && (dx2 < 0) ) return;
 	if( (dy1 < 0) && (dy2 < 0) ) return;
@@ -457,60 +860,109 @@ void sangria_stretch_copy( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1,
 	sh = abs(sy2 - sy1) + 1;
 	dw = abs(dx2 - dx1) + 1;
 	dh = abs(dy2 - dy1) + 1;
-	dx1d = (dx1 < 0) ? 0 : (dx1 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx1;
-	dx2d = (dx2 < 0) ? 0 : (dx2 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx2;
-	dy1d = (dy1 < 0) ? 0 : (dy1 >= p_dest_image->height) ? p_dest_image->height - 1: dy1;
-	dy2d = (dy2 < 0) ? 0 : (dy2 >= p_dest_image->height) ? p_dest_image->height - 1: dy2;
+	dx1d = _clip_position( dx1, p_dest_image->width  );
+	dx2d = _clip_position( dx2, p_dest_image->width  );
+	dy1d = _clip_position( dy1, p_dest_image->height );
+	dy2d = _clip_position( dy2, p_dest_image->height );
+	is_8bpp = (p_src_image->format == SANGRIA_FORMAT_8BPP) && (p_dest_image->format == SANGRIA_FORMAT_8BPP);
+	if( is_8bpp ) {
+		_mark_dirty( p_dest_image, (vy > 0) ? dy1d : dy2d, (vy > 0) ? dy2d : dy1d );
+	}
+	//	sx = (x - dx1) * sw / dw + sx1, sy = (y - dy1) * sh / dh + sy1
+	_dda_start( &sx_start, sx1, sw, dx1d - dx1, vx, dw );
+	_dda_start( &sy, sy1, sh, dy1d - dy1, vy, dh );
 	for( y = dy1d; ; y += vy ) {
-		sy = (y - dy1) * sh / dh + sy1;
-		for( x = dx1d; ; x += vx ) {
-			sx = (x - dx1) * sw / dw + sx1;
-			d = sangria_get_pixel( p_src_image, sx, sy );
-			if( d ) {
-				sangria_set_pixel( p_dest_image, x, y, d );
+		if( is_8bpp ) {
+			if( (unsigned) sy.value < (unsigned) p_src_image->height ) {
+				p_src	= p_src_image->image  + sy.value * p_src_image->width;
+				p_dest	= p_dest_image->image + y * p_dest_image->width;
+				sx		= sx_start;
+				for( x = dx1d; ; x += vx ) {
+					if( (unsigned) sx.value < (unsigned) p_src_image->width ) {
+						d = p_src[ sx.value ];
+						if( d ) {
+							p_dest[ x ] = d;
+						}
+					}
+					if( x == dx2d ) break;
+					_dda_step( &sx );
+				}
+			}
+		}
+		else {
+			sx = sx_start;
+			for( x = dx1d; ; x += vx ) {
+				d = sangria_get_pixel( p_src_image, sx.value, sy.value );
+				if( d ) {
+					sangria_set_pixel( p_dest_image, x, y, d );
+				}
+				if( x == dx2d ) break;
+				_dda_step( &sx );
 			}
-			if( x == dx2d ) break;
 		}
 		if( y == dy2d ) break;
+		_dda_step( &sy );
 	}
 }
 
-// --------------------------------------------------------------------
-static int inline _linear( int sx1, int sx2, int dx, int dxs, int dw ) {
-
-	return (sx2 - sx1) * (dx - dxs) / dw + sx1;
-}
-
 // --------------------------------------------------------------------
 void sangria_rotate_copy( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, int sx3, int sy3, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1, int dx2, int dy2 ) {
-	int sx4, sy4, sx1y, sy1y, sx2y, sy2y, sx, sy, x, y, vx, vy, dw, dh, dx1d, dx2d, dy1d, dy2d;
-	uint8_t d;
+	int sx4, sy4, x, y, vx, vy, dw, dh, dx1d, dx2d, dy1d, dy2d, is_8bpp;
+	_DDA_T sx1y, sy1y, sx2y, sy2y, sx, sy;
+	uint8_t *p_dest, d;
 
 	vx = (dx1 < dx2) ? 1 : -1;
 	vy = (dy1 < dy2) ? 1 : -1;
 	dw = abs(dx2 - dx1) + 1;
 	dh = abs(dy2 - dy1) + 1;
-	dx1d = (dx1 < 0) ? 0 : (dx1 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx1;
-	dx2d = (dx2 < 0) ? 0 : (dx2 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx2;
-	dy1d = (dy1 < 0) ? 0 : (dy1 >= p_dest_image->height) ? p_dest_image->height - 1: dy1;
-	dy2d = (dy2 < 0) ? 0 : (dy2 >= p_dest_image->height) ? p_dest_image->height - 1: dy2;
+	dx1d = _clip_position( dx1, p_dest_image->width  );
+	dx2d = _clip_position( dx2, p_dest_image->width  );
+	dy1d = _clip_position( dy1, p_dest_image->height );
+	dy2d = _clip_position( dy2, p_dest_image->height );
 	sx4 = sx3 + sx2 - sx1;
 	sy4 = sy3 + sy2 - sy1;
+	is_8bpp = (p_src_image->format == SANGRIA_FORMAT_8BPP) && (p_dest_image->format == SANGRIA_FORMAT_8BPP);
+	if( is_8bpp ) {
+		_mark_dirty( p_dest_image, (vy > 0) ? dy1d : dy2d, (vy > 0) ? dy2d : dy1d );
+	}
+	//	The left and right edges of the source on the line y
+	_dda_start( &sx1y, sx1, sx3 - sx1, dy1d - dy1, vy, dh );
+	_dda_start( &sy1y, sy1, sy3 - sy1, dy1d - dy1, vy, dh );
+	_dda_start( &sx2y, sx2, sx4 - sx2, dy1d - dy1, vy, dh );
+	_dda_start( &sy2y, sy2, sy4 - sy2, dy1d - dy1, vy, dh );
 	for( y = dy1d; ; y += vy ) {
-		sx1y = _linear( sx1, sx3, y, dy1, dh );
-		sy1y = _linear( sy1, sy3, y, dy1, dh );
-		sx2y = _linear( sx2, sx4, y, dy1, dh );
-		sy2y = _linear( sy2, sy4, y, dy1, dh );
-		for( x = dx1d; ; x += vx ) {
-			sx = _linear( sx1y, sx2y, x, dx1, dw );
-			sy = _linear( sy1y, sy2y, x, dx1, dw );
-			d = sangria_get_pixel( p_src_image, sx, sy );
-			if( d ) {
-				sangria_set_pixel( p_dest_image, x, y, d );
+		_dda_start( &sx, sx1y.value, sx2y.value - sx1y.value, dx1d - dx1, vx, dw );
+		_dda_start( &sy, sy1y.value, sy2y.value - sy1y.value, dx1d - dx1, vx, dw );
+		if( is_8bpp ) {
+			p_dest = p_dest_image->image + y * p_dest_image->width;
+			for( x = dx1d; ; x += vx ) {
+				if( (unsigned) sx.value < (unsigned) p_src_image->width && (unsigned) sy.value < (unsigned) p_src_image->height ) {
+					d = p_src_image->image[ sx.value + sy.value * p_src_image->width ];
+					if( d ) {
+						p_dest[ x ] = d;
+					}
+				}
+				if( x == dx2d ) break;
+				_dda_step( &sx );
+				_dda_step( &sy );
+			}
+		}
+		else {
+			for( x = dx1d; ; x += vx ) {
+				d = sangria_get_pixel( p_src_image, sx.value, sy.value );
+				if( d ) {
+					sangria_set_pixel( p_dest_image, x, y, d );
+				}
+				if( x == dx2d ) break;
+				_dda_step( &sx );
+				_dda_step( &sy );
 			}
-			if( x == dx2d ) break;
 		}
 		if( y == dy2d ) break;
+		_dda_step( &sx1y );
+		_dda_step( &sy1y );
+		_dda_step( &sx2y );
+		_dda_step( &sy2y );
 	}
 }
 
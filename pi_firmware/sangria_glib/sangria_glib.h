@@ -31,12 +31,27 @@
 extern "C" {
 #endif
 
+// --------------------------------------------------------------------
+//	SANGRIA_FORMAT_T
+// --------------------------------------------------------------------
+typedef enum {
+	SANGRIA_FORMAT_8BPP = 0,	//	1 byte per pixel, 0 is transparent
+	SANGRIA_FORMAT_1BPP = 1,	//	packed 1bpp pixels and 1bpp transparency mask
+} SANGRIA_FORMAT_T;
+
 // --------------------------------------------------------------------
 //	SANGRIA_BACKBUFFER_T
+//	comment)
+//		dirty_top ... dirty_bottom are the lines drawn since the last
+//		sangria_display(). No line is dirty if dirty_top > dirty_bottom.
+//		format is SANGRIA_FORMAT_T.
 // --------------------------------------------------------------------
 typedef struct {
 	int32_t		width;
 	int32_t		height;
+	int32_t		dirty_top;
+	int32_t		dirty_bottom;
+	int32_t		format;
 	uint8_t		image[1];
 } SANGRIA_BACKBUFFER_T;
 
@@ -47,6 +62,15 @@ typedef struct {
 //	output)
 //		0 ..... Failed.
 //		!0 .... Success.
+//	comment)
+//		The frames are passed to sangria_lcd through shared memory, so
+//		sangria_lcd must be running. This is a new dependency: programs
+//		that drove SPI by themselves through older sangria_glib now fail
+//		here without sangria_lcd (see lcd_driver, make install).
+//		Neither root nor SPI access is needed, but the user has to be in
+//		group SANGRIA_SHM_GROUP ("sangria"), or be root.
+//		Fails while another process owns the display.
+//		The reason of a failure is printed to stderr.
 // --------------------------------------------------------------------
 int sangria_initialize( void );
 
@@ -67,8 +91,83 @@ void sangria_terminate( void );
 //		none
 //	comment)
 //		Size must be 400x240.
+//		The frame is copied into the back slot of the triple buffer
+//		shared with sangria_lcd, and becomes the newest frame. It never
+//		waits for sangria_lcd.
+//		Only the dirty lines are copied and converted, if p_image is the
+//		same back buffer as the last time. The dirty lines are cleared,
+//		so p_image is not const: the next sangria_display() must see
+//		only the lines drawn after this one.
+//		A SANGRIA_FORMAT_1BPP back buffer is copied without conversion.
+//		sangria_flip() does the same without copying, and is faster for a
+//		game that draws every frame from scratch (see sample/*_demo.c).
+//		A buffer of sangria_get_flip_buffer() must be passed to
+//		sangria_flip(), not to this.
+// --------------------------------------------------------------------
+void sangria_display( SANGRIA_BACKBUFFER_T *p_image );
+
 // --------------------------------------------------------------------
-void sangria_display( const SANGRIA_BACKBUFFER_T *p_image );
+//	sangria_get_flip_buffer()
+//	input)
+//		format ..... SANGRIA_FORMAT_8BPP or SANGRIA_FORMAT_1BPP
+//	output)
+//		NULL ....... failed (sangria_initialize() has not succeeded)
+//		others ..... 400x240 back buffer in the shared memory
+//	comment)
+//		The game draws into it, and passes it to sangria_flip().
+//		It must not be released.
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_get_flip_buffer( SANGRIA_FORMAT_T format );
+
+// --------------------------------------------------------------------
+//	sangria_flip()
+//	input)
+//		p_image .... back buffer from sangria_get_flip_buffer() or sangria_flip()
+//	output)
+//		the next back buffer to draw into
+//	comment)
+//		p_image becomes the newest frame without copying, and the game
+//		continues with another buffer, so it never waits for sangria_lcd.
+//		sangria_lcd always takes the newest frame, older ones are dropped.
+//		The next back buffer holds the frame of two or more flips ago,
+//		so every line has to be drawn again (or cleared). Only the lines
+//		marked dirty and those changed in the meantime are converted.
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_flip( SANGRIA_BACKBUFFER_T *p_image );
+
+// --------------------------------------------------------------------
+//	SANGRIA_FRAME_COUNT_T
+// --------------------------------------------------------------------
+typedef struct {
+	uint32_t	published;		//	frames given to sangria_display() and sangria_flip()
+	uint32_t	presented;		//	frames taken by sangria_lcd
+	uint32_t	dropped;		//	frames replaced by newer ones before sangria_lcd took them
+} SANGRIA_FRAME_COUNT_T;
+
+// --------------------------------------------------------------------
+//	sangria_get_frame_count()
+//	input)
+//		p_count .... frame counters since sangria_initialize() are stored
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_get_frame_count( SANGRIA_FRAME_COUNT_T *p_count );
+
+// --------------------------------------------------------------------
+//	sangria_wait_transfer()
+//	input)
+//		timeout_ms .. maximum waiting time (milliseconds)
+//	output)
+//		0 ........... timed out, or sangria_initialize() has not succeeded
+//		!0 .......... the last published frame has been sent to the display
+//	comment)
+//		sangria_lcd sends a frame to the display over SPI after it has
+//		taken it. This waits until the frame of the last sangria_display()
+//		or sangria_flip() (or a newer one) has been sent, so the game can
+//		run in step with the display instead of drawing frames that are
+//		dropped. It returns at once if nothing has been published.
+// --------------------------------------------------------------------
+int sangria_wait_transfer( int timeout_ms );
 
 // --------------------------------------------------------------------
 //	sangria_get_backbuffer()
@@ -80,6 +179,23 @@ void sangria_display( const SANGRIA_BACKBUFFER_T *p_image );
 // --------------------------------------------------------------------
 SANGRIA_BACKBUFFER_T *sangria_get_backbuffer( uint32_t width, uint32_t height );
 
+// --------------------------------------------------------------------
+//	sangria_get_backbuffer_format()
+//	input)
+//		width ...... width of target backbuffer
+//		height ..... height of target backbuffer
+//		format ..... SANGRIA_FORMAT_8BPP or SANGRIA_FORMAT_1BPP
+//	output)
+//		NULL ....... failed
+//	comment)
+//		The pixel values of SANGRIA_FORMAT_1BPP are 0 (transparent),
+//		1 ... 127 and 128 ... 255. The same drawing functions are used for
+//		both formats, and they can be mixed in sangria_copy().
+//		sangria_copy() between two SANGRIA_FORMAT_1BPP back buffers
+//		processes 32 pixels at a time.
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_get_backbuffer_format( uint32_t width, uint32_t height, SANGRIA_FORMAT_T format );
+
 // --------------------------------------------------------------------
 //	sangria_get_display()
 //	input)
@@ -89,6 +205,15 @@ SANGRIA_BACKBUFFER_T *sangria_get_backbuffer( uint32_t width, uint32_t height );
 // --------------------------------------------------------------------
 SANGRIA_BACKBUFFER_T *sangria_get_display( void );
 
+// --------------------------------------------------------------------
+//	sangria_get_display_format()
+//	input)
+//		format ..... SANGRIA_FORMAT_8BPP or SANGRIA_FORMAT_1BPP
+//	output)
+//		NULL ....... failed
+// --------------------------------------------------------------------
+SANGRIA_BACKBUFFER_T *sangria_get_display_format( SANGRIA_FORMAT_T format );
+
 // --------------------------------------------------------------------
 //	sangria_release_backbuffer()
 //	input)
@@ -98,6 +223,20 @@ SANGRIA_BACKBUFFER_T *sangria_get_display( void );
 // --------------------------------------------------------------------
 void sangria_release_backbuffer( SANGRIA_BACKBUFFER_T *p_image );
 
+// --------------------------------------------------------------------
+//	sangria_mark_dirty()
+//	input)
+//		p_image .... target backbuffer pointer
+//		y1 ......... start Y position
+//		y2 ......... end Y position
+//	output)
+//		none
+//	comment)
+//		The drawing functions mark the lines by themselves. Call this after
+//		writing into p_image->image directly.
+// --------------------------------------------------------------------
+void sangria_mark_dirty( SANGRIA_BACKBUFFER_T *p_image, int y1, int y2 );
+
 // --------------------------------------------------------------------
 //	sangria_clear_buffer()
 //	input)
@@ -176,9 +315,31 @@ void sangria_fill_rect( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, i
 //		dy1 ............ start Y position on destination
 //	output)
 //		none
+//	comment)
+//		Pixels of value 0 are transparent. The destination is always
+//		(dx1, dy1) - (dx1 + |sx2 - sx1|, dy1 + |sy2 - sy1|), and both axes
+//		work the same way: source pixel (sx1, sy1) goes to (dx1, dy1), and
+//		each next source pixel toward (sx2, sy2) goes one pixel right or
+//		down on the destination.
+//		So sx1 > sx2 mirrors horizontally: sx1 is drawn at dx1, and sx2
+//		at the right end. sy1 > sy2 mirrors vertically: sy1 is drawn at
+//		dy1, and the lines go downward from there to sy2 at the bottom.
+//		Both axes are clipped against both back buffers.
 // --------------------------------------------------------------------
 void sangria_copy( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1 );
 
+// --------------------------------------------------------------------
+//	sangria_copy_opaque()
+//	input)
+//		same as sangria_copy()
+//	output)
+//		none
+//	comment)
+//		Same as sangria_copy(), but pixels of value 0 are copied too.
+//		Faster than sangria_copy() for backgrounds.
+// --------------------------------------------------------------------
+void sangria_copy_opaque( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1 );
+
 // --------------------------------------------------------------------
 //	sangria_stretch_copy()
 //	input)
@@ -0,0 +1,192 @@
+// --------------------------------------------------------------------
+// Sangria game library: packed 1bpp back buffer
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string.h>
+#include "sangria_glib_1bpp.h"
+
+// --------------------------------------------------------------------
+static inline uint8_t *_pixel_line( const SANGRIA_BACKBUFFER_T *p_image, int y ) {
+
+	return (uint8_t*) p_image->image + y * sangria_1bpp_stride( p_image->width );
+}
+
+// --------------------------------------------------------------------
+static inline uint8_t *_mask_line( const SANGRIA_BACKBUFFER_T *p_image, int y ) {
+
+	return (uint8_t*) p_image->image + (p_image->height + y) * sangria_1bpp_stride( p_image->width );
+}
+
+// --------------------------------------------------------------------
+//	n pixels from the bit position pos. The first pixel is bit31.
+//	Only the bytes that hold these pixels are read.
+//
+static inline uint32_t _read_bits( const uint8_t *p_line, int pos, int n ) {
+	const uint8_t *p = p_line + (pos >> 3);
+	int shift, bytes, i;
+	uint64_t d;
+
+	shift	= pos & 7;
+	bytes	= (shift + n + 7) >> 3;
+	d		= 0;
+	for( i = 0; i < bytes; i++ ) {
+		d |= (uint64_t) p[i] << (56 - 8 * i);
+	}
+	return (uint32_t)( d >> (32 - shift) );
+}
+
+// --------------------------------------------------------------------
+//	Writes the bits of d selected by mask m (bit31 is the pixel at pos).
+//
+static inline void _write_bits( uint8_t *p_line, int pos, int n, uint32_t d, uint32_t m ) {
+	uint8_t *p = p_line + (pos >> 3);
+	int shift, bytes, i;
+	uint64_t d64, m64;
+	uint8_t bm;
+
+	shift	= pos & 7;
+	bytes	= (shift + n + 7) >> 3;
+	d64		= (uint64_t) d << (32 - shift);
+	m64		= (uint64_t) m << (32 - shift);
+	for( i = 0; i < bytes; i++ ) {
+		bm = (uint8_t)( m64 >> (56 - 8 * i) );
+		p[i] = (p[i] & ~bm) | ((uint8_t)( d64 >> (56 - 8 * i) ) & bm);
+	}
+}
+
+// --------------------------------------------------------------------
+static void _fill_span( uint8_t *p_line, int x1, int x2, uint8_t d ) {
+	int b1, b2;
+	uint8_t m1, m2;
+
+	b1 = x1 >> 3;
+	b2 = x2 >> 3;
+	m1 = 0xFF >> (x1 & 7);
+	m2 = (uint8_t)( 0xFF << (7 - (x2 & 7)) );
+	if( b1 == b2 ) {
+		m1 &= m2;
+		p_line[b1] = (p_line[b1] & ~m1) | (d & m1);
+		return;
+	}
+	p_line[b1] = (p_line[b1] & ~m1) | (d & m1);
+	memset( p_line + b1 + 1, d, b2 - b1 - 1 );
+	p_line[b2] = (p_line[b2] & ~m2) | (d & m2);
+}
+
+// --------------------------------------------------------------------
+int sangria_1bpp_stride( int width ) {
+
+	return (width + 7) >> 3;
+}
+
+// --------------------------------------------------------------------
+void sangria_1bpp_clear( SANGRIA_BACKBUFFER_T *p_image, uint8_t c ) {
+	int size;
+
+	size = sangria_1bpp_stride( p_image->width ) * p_image->height;
+	memset( p_image->image, (c < 128) ? 0xFF : 0x00, size );
+	memset( p_image->image + size, c ? 0xFF : 0x00, size );
+}
+
+// --------------------------------------------------------------------
+void sangria_1bpp_set_pixel( SANGRIA_BACKBUFFER_T *p_image, int x, int y, uint8_t c ) {
+	uint8_t *p_pixel, *p_mask, bit;
+
+	p_pixel	= _pixel_line( p_image, y ) + (x >> 3);
+	p_mask	= _mask_line( p_image, y ) + (x >> 3);
+	bit		= 0x80 >> (x & 7);
+	if( c < 128 ) {
+		*p_pixel |= bit;
+	}
+	else {
+		*p_pixel &= ~bit;
+	}
+	if( c ) {
+		*p_mask |= bit;
+	}
+	else {
+		*p_mask &= ~bit;
+	}
+}
+
+// --------------------------------------------------------------------
+uint8_t sangria_1bpp_get_pixel( const SANGRIA_BACKBUFFER_T *p_image, int x, int y ) {
+	uint8_t bit;
+
+	bit = 0x80 >> (x & 7);
+	if( !(_mask_line( p_image, y )[ x >> 3 ] & bit) ) {
+		return 0;
+	}
+	return (_pixel_line( p_image, y )[ x >> 3 ] & bit) ? 1 : 255;
+}
+
+// --------------------------------------------------------------------
+void sangria_1bpp_fill_rect( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, int y2, uint8_t c ) {
+	int y;
+
+	for( y = y1; y <= y2; y++ ) {
+		_fill_span( _pixel_line( p_image, y ), x1, x2, (c < 128) ? 0xFF : 0x00 );
+		_fill_span( _mask_line( p_image, y ), x1, x2, c ? 0xFF : 0x00 );
+	}
+}
+
+// --------------------------------------------------------------------
+void sangria_1bpp_write_pixels( SANGRIA_BACKBUFFER_T *p_image, int x, int y, int n, uint32_t d, uint32_t m ) {
+
+	_write_bits( _mask_line( p_image, y ), x, n, 0xFFFFFFFF, m );
+	_write_bits( _pixel_line( p_image, y ), x, n, d, m );
+}
+
+// --------------------------------------------------------------------
+void sangria_1bpp_copy_line( const SANGRIA_BACKBUFFER_T *p_src_image, int sx, int sy, SANGRIA_BACKBUFFER_T *p_dest_image, int dx, int dy, int width, int is_opaque ) {
+	const uint8_t *p_src_pixel, *p_src_mask;
+	uint8_t *p_dest_pixel, *p_dest_mask;
+	uint32_t d, m;
+	int i, n;
+
+	p_src_pixel		= _pixel_line( p_src_image, sy );
+	p_src_mask		= _mask_line( p_src_image, sy );
+	p_dest_pixel	= _pixel_line( p_dest_image, dy );
+	p_dest_mask		= _mask_line( p_dest_image, dy );
+	for( i = 0; i < width; i += 32 ) {
+		n = width - i;
+		if( n > 32 ) {
+			n = 32;
+		}
+		if( is_opaque ) {
+			m = 0xFFFFFFFF << (32 - n);
+			_write_bits( p_dest_mask, dx + i, n, _read_bits( p_src_mask, sx + i, n ), m );
+		}
+		else {
+			m = _read_bits( p_src_mask, sx + i, n ) & (0xFFFFFFFF << (32 - n));
+			_write_bits( p_dest_mask, dx + i, n, 0xFFFFFFFF, m );
+		}
+		if( m == 0 ) {
+			//	all transparent
+			continue;
+		}
+		d = _read_bits( p_src_pixel, sx + i, n );
+		_write_bits( p_dest_pixel, dx + i, n, d, m );
+	}
+}
@@ -0,0 +1,127 @@
+// --------------------------------------------------------------------
+// Sangria game library: packed 1bpp back buffer
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	Used by sangria_glib.c only. The arguments are clipped by the caller.
+//
+//	image[] of SANGRIA_FORMAT_1BPP holds two planes of
+//	sangria_1bpp_stride( width ) bytes per line, bit7 is the left pixel.
+//		pixel plane ... same bits as sent to the display (pixel < 128: 1)
+//		mask plane .... 0: transparent (pixel 0), 1: opaque
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_GLIB_1BPP_H__
+#define __SANGRIA_GLIB_1BPP_H__
+
+#include "sangria_glib.h"
+
+// --------------------------------------------------------------------
+//	sangria_1bpp_stride()
+//	input)
+//		width ...... width of the back buffer
+//	output)
+//		bytes per line of each plane
+// --------------------------------------------------------------------
+int sangria_1bpp_stride( int width );
+
+// --------------------------------------------------------------------
+//	sangria_1bpp_clear()
+//	input)
+//		p_image .... target backbuffer pointer
+//		c .......... pixel value
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_1bpp_clear( SANGRIA_BACKBUFFER_T *p_image, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_1bpp_set_pixel()
+//	input)
+//		p_image .... target backbuffer pointer
+//		x .......... X position
+//		y .......... Y position
+//		c .......... pixel value
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_1bpp_set_pixel( SANGRIA_BACKBUFFER_T *p_image, int x, int y, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_1bpp_get_pixel()
+//	input)
+//		p_image .... target backbuffer pointer
+//		x .......... X position
+//		y .......... Y position
+//	output)
+//		0 ..... transparent
+//		1 ..... opaque, pixel bit 1
+//		255 ... opaque, pixel bit 0
+// --------------------------------------------------------------------
+uint8_t sangria_1bpp_get_pixel( const SANGRIA_BACKBUFFER_T *p_image, int x, int y );
+
+// --------------------------------------------------------------------
+//	sangria_1bpp_fill_rect()
+//	input)
+//		p_image .... target backbuffer pointer
+//		x1 ......... start X position (x1 <= x2)
+//		y1 ......... start Y position (y1 <= y2)
+//		x2 ......... end X position
+//		y2 ......... end Y position
+//		c .......... pixel value
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_1bpp_fill_rect( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, int y2, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_1bpp_write_pixels()
+//	input)
+//		p_image .... target backbuffer pointer
+//		x .......... start X position
+//		y .......... Y position
+//		n .......... number of pixels (1 ... 32)
+//		d .......... pixel bits, bit31 is the pixel at x
+//		m .......... mask bits, the pixels of 1 are written as opaque
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_1bpp_write_pixels( SANGRIA_BACKBUFFER_T *p_image, int x, int y, int n, uint32_t d, uint32_t m );
+
+// --------------------------------------------------------------------
+//	sangria_1bpp_copy_line()
+//	input)
+//		p_src_image .... source backbuffer pointer
+//		sx ............. start X position on source
+//		sy ............. Y position on source
+//		p_dest_image ... destination backbuffer pointer
+//		dx ............. start X position on destination
+//		dy ............. Y position on destination
+//		width .......... number of pixels (left to right)
+//		is_opaque ...... 0: skip transparent pixels, !0: copy them too
+//	output)
+//		none
+//	comment)
+//		32 pixels are processed at a time.
+// --------------------------------------------------------------------
+void sangria_1bpp_copy_line( const SANGRIA_BACKBUFFER_T *p_src_image, int sx, int sy, SANGRIA_BACKBUFFER_T *p_dest_image, int dx, int dy, int width, int is_opaque );
+
+#endif
@@ -0,0 +1,109 @@
+// --------------------------------------------------------------------
+// Sangria game library: 8bpp line copy
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	Used by sangria_glib.c and the layers on top of it. The arguments are
+//	clipped by the caller.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_GLIB_8BPP_H__
+#define __SANGRIA_GLIB_8BPP_H__
+
+#include <stdint.h>
+#include <string.h>
+
+// --------------------------------------------------------------------
+//	0xFF for each non-zero byte of s, 0x00 for each zero byte
+//
+static inline uint64_t _sangria_8bpp_opaque_mask( uint64_t s ) {
+	uint64_t t;
+
+	t = ((s & 0x7F7F7F7F7F7F7F7FULL) + 0x7F7F7F7F7F7F7F7FULL) | s;
+	return ((t >> 7) & 0x0101010101010101ULL) * 0xFF;
+}
+
+// --------------------------------------------------------------------
+static inline void _sangria_8bpp_blend( uint8_t *p_dest, uint64_t s ) {
+	uint64_t m, d;
+
+	m = _sangria_8bpp_opaque_mask( s );
+	if( m == 0 ) {
+		//	all transparent
+		return;
+	}
+	if( m != ~0ULL ) {
+		memcpy( &d, p_dest, 8 );
+		s = (s & m) | (d & ~m);
+	}
+	memcpy( p_dest, &s, 8 );
+}
+
+// --------------------------------------------------------------------
+//	One line of sangria_copy(), 8 pixels at a time. vx = -1 reads p_src
+//	backwards (mirror).
+//
+static inline void sangria_8bpp_copy_line( const uint8_t *p_src, uint8_t *p_dest, int width, int vx ) {
+	uint64_t s;
+	int i;
+	uint8_t d;
+
+	i = 0;
+	if( vx > 0 ) {
+		for( ; i + 8 <= width; i += 8 ) {
+			memcpy( &s, p_src + i, 8 );
+			_sangria_8bpp_blend( p_dest + i, s );
+		}
+		for( ; i < width; i++ ) {
+			d = p_src[i];
+			if( d ) {
+				p_dest[i] = d;
+			}
+		}
+	}
+	else {
+		for( ; i + 8 <= width; i += 8 ) {
+			memcpy( &s, p_src - i - 7, 8 );
+			_sangria_8bpp_blend( p_dest + i, __builtin_bswap64( s ) );
+		}
+		for( ; i < width; i++ ) {
+			d = p_src[-i];
+			if( d ) {
+				p_dest[i] = d;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static inline void sangria_8bpp_copy_line_opaque( const uint8_t *p_src, uint8_t *p_dest, int width, int vx ) {
+	int i;
+
+	if( vx > 0 ) {
+		memcpy( p_dest, p_src, width );
+		return;
+	}
+	for( i = 0; i < width; i++ ) {
+		p_dest[i] = p_src[-i];
+	}
+}
+
+#endif
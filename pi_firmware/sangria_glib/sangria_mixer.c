@@ -0,0 +1,353 @@
+// --------------------------------------------------------------------
+// Sangria game library: sound mixer
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <stdint.h>
+#include <string.h>
+#include "sangria_mixer.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(SANGRIA_HAVE_NEON) && !defined(__aarch64__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON		(1 << 12)
+#endif
+#endif
+
+#ifndef SAMPLE_RATE
+#define SAMPLE_RATE		48000		//	Hz
+#endif
+
+#define NSEC			1000000000LL
+#define RELEASE_SAMPLES	(SAMPLE_RATE / 10)		//	the limiter goes back to x1 in about 100 msec
+
+#if defined(SANGRIA_HAVE_NEON)
+//	sangria_mixer_neon.c (SANGRIA_HAVE_NEON is given by ../lcd_driver/neon.mk)
+void sangria_mixer_accumulate_neon( int32_t *p_left, int32_t *p_right, const int16_t *p_wave, int left_gain, int right_gain, int samples );
+int32_t sangria_mixer_peak_neon( const int32_t *p_left, const int32_t *p_right, int samples );
+void sangria_mixer_output_neon( int16_t *p_wave, const int32_t *p_left, const int32_t *p_right, const float *p_gain, int samples );
+#endif
+
+// --------------------------------------------------------------------
+//	Portable C version (reference)
+//
+static void _accumulate_c( int32_t *p_left, int32_t *p_right, const int16_t *p_wave, int left_gain, int right_gain, int samples ) {
+	int i;
+
+	for( i = 0; i < samples; i++ ) {
+		p_left[i]	+= p_wave[i] * left_gain;
+		p_right[i]	+= p_wave[i] * right_gain;
+	}
+}
+
+// --------------------------------------------------------------------
+static int32_t _peak_c( const int32_t *p_left, const int32_t *p_right, int samples ) {
+	int32_t peak, l, r;
+	int i;
+
+	peak = 0;
+	for( i = 0; i < samples; i++ ) {
+		l = p_left[i] < 0 ? -p_left[i] : p_left[i];
+		r = p_right[i] < 0 ? -p_right[i] : p_right[i];
+		if( l > peak ) {
+			peak = l;
+		}
+		if( r > peak ) {
+			peak = r;
+		}
+	}
+	return peak;
+}
+
+// --------------------------------------------------------------------
+static inline int16_t _saturate( int32_t x ) {
+
+	return (int16_t)( x > 32767 ? 32767 : (x < -32768 ? -32768 : x) );
+}
+
+// --------------------------------------------------------------------
+//	The gain is multiplied in float and truncated toward 0, as the SIMD
+//	versions do. p_gain is NULL when the limiter is not working.
+//
+static void _output_c( int16_t *p_wave, const int32_t *p_left, const int32_t *p_right, const float *p_gain, int samples ) {
+	int32_t l, r;
+	int i;
+
+	for( i = 0; i < samples; i++ ) {
+		l = p_left[i] >> SANGRIA_MIXER_GAIN_BITS;
+		r = p_right[i] >> SANGRIA_MIXER_GAIN_BITS;
+		if( p_gain != NULL ) {
+			l = (int32_t)( (float) l * p_gain[i] );
+			r = (int32_t)( (float) r * p_gain[i] );
+		}
+		p_wave[ (i << 1) + 0 ] = _saturate( l );
+		p_wave[ (i << 1) + 1 ] = _saturate( r );
+	}
+}
+
+static const SANGRIA_MIXER_KERNEL_T kernel_c = {
+	_accumulate_c, _peak_c, _output_c, "C",
+};
+
+#if defined(__SSE2__)
+// --------------------------------------------------------------------
+//	SSE2 version, 8 samples per iteration
+//
+static inline void _accumulate8_sse2( int32_t *p_sum, __m128i w, __m128i gain ) {
+	__m128i lo, hi;
+
+	lo = _mm_mullo_epi16( w, gain );
+	hi = _mm_mulhi_epi16( w, gain );
+	_mm_storeu_si128( (__m128i*) p_sum, _mm_add_epi32( _mm_loadu_si128( (const __m128i*) p_sum ), _mm_unpacklo_epi16( lo, hi ) ) );
+	_mm_storeu_si128( (__m128i*)( p_sum + 4 ), _mm_add_epi32( _mm_loadu_si128( (const __m128i*)( p_sum + 4 ) ), _mm_unpackhi_epi16( lo, hi ) ) );
+}
+
+// --------------------------------------------------------------------
+static void _accumulate_sse2( int32_t *p_left, int32_t *p_right, const int16_t *p_wave, int left_gain, int right_gain, int samples ) {
+	__m128i w, gl, gr;
+	int i;
+
+	gl = _mm_set1_epi16( (int16_t) left_gain );
+	gr = _mm_set1_epi16( (int16_t) right_gain );
+	for( i = 0; i + 8 <= samples; i += 8 ) {
+		w = _mm_loadu_si128( (const __m128i*)( p_wave + i ) );
+		_accumulate8_sse2( p_left + i, w, gl );
+		_accumulate8_sse2( p_right + i, w, gr );
+	}
+	_accumulate_c( p_left + i, p_right + i, p_wave + i, left_gain, right_gain, samples - i );
+}
+
+// --------------------------------------------------------------------
+static inline __m128i _max_sse2( __m128i a, __m128i b ) {
+	__m128i m;
+
+	m = _mm_cmpgt_epi32( a, b );
+	return _mm_or_si128( _mm_and_si128( m, a ), _mm_andnot_si128( m, b ) );
+}
+
+// --------------------------------------------------------------------
+static inline __m128i _abs_sse2( __m128i a ) {
+	__m128i s;
+
+	s = _mm_srai_epi32( a, 31 );
+	return _mm_sub_epi32( _mm_xor_si128( a, s ), s );
+}
+
+// --------------------------------------------------------------------
+static int32_t _peak_sse2( const int32_t *p_left, const int32_t *p_right, int samples ) {
+	__m128i m;
+	int32_t peak, tail;
+	int i;
+
+	m = _mm_setzero_si128();
+	for( i = 0; i + 4 <= samples; i += 4 ) {
+		m = _max_sse2( m, _abs_sse2( _mm_loadu_si128( (const __m128i*)( p_left + i ) ) ) );
+		m = _max_sse2( m, _abs_sse2( _mm_loadu_si128( (const __m128i*)( p_right + i ) ) ) );
+	}
+	m = _max_sse2( m, _mm_shuffle_epi32( m, _MM_SHUFFLE( 1, 0, 3, 2 ) ) );
+	m = _max_sse2( m, _mm_shuffle_epi32( m, _MM_SHUFFLE( 2, 3, 0, 1 ) ) );
+	peak = _mm_cvtsi128_si32( m );
+	tail = _peak_c( p_left + i, p_right + i, samples - i );
+	return peak > tail ? peak : tail;
+}
+
+// --------------------------------------------------------------------
+static inline __m128i _scale_sse2( const int32_t *p_sum, const float *p_gain ) {
+	__m128i x;
+
+	x = _mm_srai_epi32( _mm_loadu_si128( (const __m128i*) p_sum ), SANGRIA_MIXER_GAIN_BITS );
+	if( p_gain != NULL ) {
+		x = _mm_cvttps_epi32( _mm_mul_ps( _mm_cvtepi32_ps( x ), _mm_loadu_ps( p_gain ) ) );
+	}
+	return x;
+}
+
+// --------------------------------------------------------------------
+static void _output_sse2( int16_t *p_wave, const int32_t *p_left, const int32_t *p_right, const float *p_gain, int samples ) {
+	__m128i l, r;
+	int i;
+
+	for( i = 0; i + 8 <= samples; i += 8 ) {
+		l = _mm_packs_epi32( _scale_sse2( p_left + i, p_gain ? p_gain + i : NULL ), _scale_sse2( p_left + i + 4, p_gain ? p_gain + i + 4 : NULL ) );
+		r = _mm_packs_epi32( _scale_sse2( p_right + i, p_gain ? p_gain + i : NULL ), _scale_sse2( p_right + i + 4, p_gain ? p_gain + i + 4 : NULL ) );
+		_mm_storeu_si128( (__m128i*)( p_wave + (i << 1) ), _mm_unpacklo_epi16( l, r ) );
+		_mm_storeu_si128( (__m128i*)( p_wave + (i << 1) + 8 ), _mm_unpackhi_epi16( l, r ) );
+	}
+	_output_c( p_wave + (i << 1), p_left + i, p_right + i, p_gain ? p_gain + i : NULL, samples - i );
+}
+
+static const SANGRIA_MIXER_KERNEL_T kernel_simd = {
+	_accumulate_sse2, _peak_sse2, _output_sse2, "SSE2",
+};
+#elif defined(SANGRIA_HAVE_NEON)
+static const SANGRIA_MIXER_KERNEL_T kernel_simd = {
+	sangria_mixer_accumulate_neon, sangria_mixer_peak_neon, sangria_mixer_output_neon, "NEON",
+};
+#endif
+
+// --------------------------------------------------------------------
+static int _has_simd( void ) {
+
+#if defined(__SSE2__) || (defined(SANGRIA_HAVE_NEON) && defined(__aarch64__))
+	return 1;
+#elif defined(SANGRIA_HAVE_NEON)
+	return (getauxval( AT_HWCAP ) & HWCAP_NEON) != 0;
+#else
+	return 0;
+#endif
+}
+
+// --------------------------------------------------------------------
+void sangria_mixer_initialize( SANGRIA_MIXER_T *p_mixer, int use_simd ) {
+
+	memset( p_mixer, 0, sizeof(SANGRIA_MIXER_T) );
+	p_mixer->limiter_gain	= 1.0f;
+	p_mixer->p_kernel		= &kernel_c;
+#if defined(__SSE2__) || defined(SANGRIA_HAVE_NEON)
+	if( use_simd && _has_simd() ) {
+		p_mixer->p_kernel = &kernel_simd;
+	}
+#endif
+}
+
+// --------------------------------------------------------------------
+const char *sangria_mixer_get_name( const SANGRIA_MIXER_T *p_mixer ) {
+
+	return p_mixer->p_kernel->p_name;
+}
+
+// --------------------------------------------------------------------
+//	The entry is seen by the audio thread after it is stored.
+//
+int sangria_mixer_add_voice( SANGRIA_MIXER_T *p_mixer, int type, void *handle, int volume, int pan ) {
+	int voice;
+
+	voice = p_mixer->voices;
+	if( voice >= SANGRIA_MIXER_MAX_VOICES ) {
+		return -1;
+	}
+	p_mixer->chip[ voice ].type		= type;
+	p_mixer->chip[ voice ].handle	= handle;
+	p_mixer->chip[ voice ].pwave	= p_mixer->wave[ voice ];
+	sangria_mixer_set_voice( p_mixer, voice, volume, pan );
+	__atomic_store_n( &p_mixer->voices, voice + 1, __ATOMIC_RELEASE );
+	return voice;
+}
+
+// --------------------------------------------------------------------
+void sangria_mixer_set_voice( SANGRIA_MIXER_T *p_mixer, int voice, int volume, int pan ) {
+	int left, right;
+
+	if( voice < 0 || voice >= SANGRIA_MIXER_MAX_VOICES ) {
+		return;
+	}
+	if( volume < 0 ) {
+		volume = 0;
+	}
+	else if( volume > SANGRIA_MIXER_MAX_VOLUME ) {
+		volume = SANGRIA_MIXER_MAX_VOLUME;
+	}
+	if( pan < SANGRIA_MIXER_PAN_LEFT ) {
+		pan = SANGRIA_MIXER_PAN_LEFT;
+	}
+	else if( pan > SANGRIA_MIXER_PAN_RIGHT ) {
+		pan = SANGRIA_MIXER_PAN_RIGHT;
+	}
+	left	= pan > 0 ? volume * (SANGRIA_MIXER_PAN_RIGHT - pan) / SANGRIA_MIXER_PAN_RIGHT : volume;
+	right	= pan < 0 ? volume * (pan - SANGRIA_MIXER_PAN_LEFT) / SANGRIA_MIXER_PAN_RIGHT : volume;
+	__atomic_store_n( &p_mixer->gain[ voice ], ((uint32_t) left << 16) | (uint32_t) right, __ATOMIC_RELAXED );
+}
+
+// --------------------------------------------------------------------
+//	The gain goes down at once to keep the peak of the piece under
+//	SANGRIA_MIXER_LIMIT, and goes back up along a ramp. Returns the gain
+//	of each sample, or NULL at x1.
+//
+static const float *_limiter( SANGRIA_MIXER_T *p_mixer, int samples ) {
+	float gain, target, step;
+	int32_t peak;
+	int i;
+
+	peak = p_mixer->p_kernel->p_peak( p_mixer->left, p_mixer->right, samples ) >> SANGRIA_MIXER_GAIN_BITS;
+	target = peak > SANGRIA_MIXER_LIMIT ? (float) SANGRIA_MIXER_LIMIT / (float) peak : 1.0f;
+	gain = p_mixer->limiter_gain;
+	if( gain >= 1.0f && target >= 1.0f ) {
+		return NULL;
+	}
+	gain += (1.0f - gain) * samples / RELEASE_SAMPLES;
+	if( gain > 0.9999f ) {
+		gain = 1.0f;
+	}
+	if( gain > target ) {
+		gain = target;
+	}
+	if( gain <= p_mixer->limiter_gain ) {
+		for( i = 0; i < samples; i++ ) {
+			p_mixer->limiter[i] = gain;
+		}
+	}
+	else {
+		step = (gain - p_mixer->limiter_gain) / samples;
+		for( i = 0; i < samples; i++ ) {
+			p_mixer->limiter[i] = p_mixer->limiter_gain + step * (i + 1);
+		}
+	}
+	p_mixer->limiter_gain = gain;
+	return p_mixer->limiter;
+}
+
+// --------------------------------------------------------------------
+static void _mix( SANGRIA_MIXER_T *p_mixer, int voices, int16_t *p_wave, int samples ) {
+	const SANGRIA_MIXER_KERNEL_T *p_kernel;
+	uint32_t gain;
+	int i;
+
+	p_kernel = p_mixer->p_kernel;
+	memset( p_mixer->left, 0, sizeof(int32_t) * samples );
+	memset( p_mixer->right, 0, sizeof(int32_t) * samples );
+	for( i = 0; i < voices; i++ ) {
+		gain = __atomic_load_n( &p_mixer->gain[i], __ATOMIC_RELAXED );
+		if( gain != 0 ) {
+			p_kernel->p_accumulate( p_mixer->left, p_mixer->right, p_mixer->wave[i], (int)( gain >> 16 ), (int)( gain & 0xFFFF ), samples );
+		}
+	}
+	p_kernel->p_output( p_wave, p_mixer->left, p_mixer->right, _limiter( p_mixer, samples ), samples );
+}
+
+// --------------------------------------------------------------------
+//	Each piece is given to the queue with the time of its own end.
+//
+void sangria_mixer_render( SANGRIA_MIXER_T *p_mixer, SANGRIA_SOUND_QUEUE_T *p_queue, int16_t *p_wave, int samples, int64_t now ) {
+	int voices, n;
+
+	voices = __atomic_load_n( &p_mixer->voices, __ATOMIC_ACQUIRE );
+	for( ; samples > 0; samples -= n, p_wave += n << 1 ) {
+		n = samples < SANGRIA_MIXER_BLOCK ? samples : SANGRIA_MIXER_BLOCK;
+		sangria_sound_queue_render( p_queue, p_mixer->chip, voices, n, now - (int64_t)( samples - n ) * NSEC / SAMPLE_RATE );
+		_mix( p_mixer, voices, p_wave, n );
+	}
+}
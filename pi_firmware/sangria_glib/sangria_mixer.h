@@ -0,0 +1,149 @@
+// --------------------------------------------------------------------
+// Sangria game library: sound mixer
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	Any number of PSG and SCC (up to SANGRIA_MIXER_MAX_VOICES) are mixed
+//	to a stereo wave, each with its own volume and pan. The block is made
+//	in pieces of SANGRIA_MIXER_BLOCK samples, so the scratch waves do not
+//	depend on the size of the request. The sum is kept in 32 bits, and a
+//	limiter lowers the gain smoothly over SANGRIA_MIXER_LIMIT, instead of
+//	clipping the wave.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_MIXER_H__
+#define __SANGRIA_MIXER_H__
+
+#include <stdint.h>
+#include "sangria_sound_queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SANGRIA_MIXER_MAX_VOICES	16
+#define SANGRIA_MIXER_BLOCK			256						//	samples mixed at once
+#define SANGRIA_MIXER_GAIN_BITS		8						//	volume (1 << SANGRIA_MIXER_GAIN_BITS) is x1
+#define SANGRIA_MIXER_MAX_VOLUME	32767
+#define SANGRIA_MIXER_PAN_LEFT		-256
+#define SANGRIA_MIXER_PAN_CENTER	0
+#define SANGRIA_MIXER_PAN_RIGHT		256
+#define SANGRIA_MIXER_LIMIT			30000					//	the limiter keeps the wave under it
+
+// --------------------------------------------------------------------
+//	SANGRIA_MIXER_KERNEL_T
+//	comment)
+//		The loops of the mixer. The SIMD version is selected at run time
+//		(NEON on ARM, SSE2 on x86), and all versions make the same wave.
+// --------------------------------------------------------------------
+typedef struct {
+	void	(*p_accumulate)( int32_t *p_left, int32_t *p_right, const int16_t *p_wave, int left_gain, int right_gain, int samples );
+	int32_t	(*p_peak)( const int32_t *p_left, const int32_t *p_right, int samples );
+	void	(*p_output)( int16_t *p_wave, const int32_t *p_left, const int32_t *p_right, const float *p_gain, int samples );
+	const char	*p_name;
+} SANGRIA_MIXER_KERNEL_T;
+
+typedef struct {
+	SANGRIA_SOUND_CHIP_T	chip[ SANGRIA_MIXER_MAX_VOICES ];					//	the table of sangria_sound_queue_render()
+	int16_t		wave[ SANGRIA_MIXER_MAX_VOICES ][ SANGRIA_MIXER_BLOCK ];
+	uint32_t	gain[ SANGRIA_MIXER_MAX_VOICES ];			//	left gain << 16 | right gain
+	int			voices;
+	int32_t		left[ SANGRIA_MIXER_BLOCK ];
+	int32_t		right[ SANGRIA_MIXER_BLOCK ];
+	float		limiter[ SANGRIA_MIXER_BLOCK ];				//	gain of each sample
+	float		limiter_gain;								//	gain at the end of the last piece
+	const SANGRIA_MIXER_KERNEL_T	*p_kernel;
+} SANGRIA_MIXER_T;
+
+// --------------------------------------------------------------------
+//	sangria_mixer_initialize
+//	input)
+//		p_mixer ...... mixer to be cleared (no voices)
+//		use_simd ..... 0: portable C version, !0: the fastest version on this CPU
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_mixer_initialize( SANGRIA_MIXER_T *p_mixer, int use_simd );
+
+// --------------------------------------------------------------------
+//	sangria_mixer_get_name
+//	input)
+//		p_mixer ...... mixer
+//	output)
+//		name of the loops ("C", "NEON" or "SSE2")
+// --------------------------------------------------------------------
+const char *sangria_mixer_get_name( const SANGRIA_MIXER_T *p_mixer );
+
+// --------------------------------------------------------------------
+//	sangria_mixer_add_voice
+//	input)
+//		p_mixer ...... mixer
+//		type ......... SANGRIA_SOUND_TYPE_PSG or SANGRIA_SOUND_TYPE_SCC
+//		handle ....... H_PSG_T or H_SCC_T
+//		volume ....... 0 ... SANGRIA_MIXER_MAX_VOLUME
+//		pan .......... SANGRIA_MIXER_PAN_LEFT ... SANGRIA_MIXER_PAN_RIGHT
+//	output)
+//		index of the voice (chip of SANGRIA_SOUND_WRITE_T)
+//		-1 ... Failed (There are SANGRIA_MIXER_MAX_VOICES voices.)
+//	comment)
+//		Only one thread can add the voices, and it can be done while
+//		another thread is calling sangria_mixer_render(). The voice is
+//		mixed from the next block.
+// --------------------------------------------------------------------
+int sangria_mixer_add_voice( SANGRIA_MIXER_T *p_mixer, int type, void *handle, int volume, int pan );
+
+// --------------------------------------------------------------------
+//	sangria_mixer_set_voice
+//	input)
+//		p_mixer ...... mixer
+//		voice ........ index of the voice
+//		volume ....... 0 ... SANGRIA_MIXER_MAX_VOLUME
+//		pan .......... SANGRIA_MIXER_PAN_LEFT ... SANGRIA_MIXER_PAN_RIGHT
+//	output)
+//		none
+//	comment)
+//		The center is the volume on both sides, and a side goes down to
+//		0 as the pan goes to the other side. It is changed from the next
+//		piece of SANGRIA_MIXER_BLOCK samples.
+// --------------------------------------------------------------------
+void sangria_mixer_set_voice( SANGRIA_MIXER_T *p_mixer, int voice, int volume, int pan );
+
+// --------------------------------------------------------------------
+//	sangria_mixer_render
+//	input)
+//		p_mixer ...... mixer
+//		p_queue ...... the writes to the voices
+//		p_wave ....... stereo wave (left, right, left, right, ...)
+//		samples ...... samples of the block
+//		now .......... time of the request (nsec of CLOCK_MONOTONIC)
+//	output)
+//		none
+//	comment)
+//		The writes of the queue are done at their samples as
+//		sangria_sound_queue_render(). Only one thread can call it.
+// --------------------------------------------------------------------
+void sangria_mixer_render( SANGRIA_MIXER_T *p_mixer, SANGRIA_SOUND_QUEUE_T *p_queue, int16_t *p_wave, int samples, int64_t now );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
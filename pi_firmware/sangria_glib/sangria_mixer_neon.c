@@ -0,0 +1,128 @@
+// --------------------------------------------------------------------
+// Sangria game library: sound mixer (NEON)
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	The mixing loops of sangria_mixer.c for NEON, 8 samples at a time.
+//	Built with NEON_CFLAGS from ../lcd_driver/neon.mk, and left empty on
+//	targets without SANGRIA_HAVE_NEON. sangria_mixer_initialize() picks
+//	them after checking the CPU.
+// --------------------------------------------------------------------
+
+#if defined(SANGRIA_HAVE_NEON)
+
+#if !defined(__ARM_NEON) && !defined(__ARM_NEON__)
+#error "sangria_mixer_neon.c needs NEON_CFLAGS (see ../lcd_driver/neon.mk)"
+#endif
+
+#include <stdint.h>
+#include <arm_neon.h>
+#include "sangria_mixer.h"
+
+void sangria_mixer_accumulate_neon( int32_t *p_left, int32_t *p_right, const int16_t *p_wave, int left_gain, int right_gain, int samples );
+int32_t sangria_mixer_peak_neon( const int32_t *p_left, const int32_t *p_right, int samples );
+void sangria_mixer_output_neon( int16_t *p_wave, const int32_t *p_left, const int32_t *p_right, const float *p_gain, int samples );
+
+// --------------------------------------------------------------------
+//	8 samples per iteration
+//
+void sangria_mixer_accumulate_neon( int32_t *p_left, int32_t *p_right, const int16_t *p_wave, int left_gain, int right_gain, int samples ) {
+	int16x8_t w;
+	int i;
+
+	for( i = 0; i + 8 <= samples; i += 8 ) {
+		w = vld1q_s16( p_wave + i );
+		vst1q_s32( p_left + i,      vmlal_n_s16( vld1q_s32( p_left + i ),      vget_low_s16( w ),  (int16_t) left_gain ) );
+		vst1q_s32( p_left + i + 4,  vmlal_n_s16( vld1q_s32( p_left + i + 4 ),  vget_high_s16( w ), (int16_t) left_gain ) );
+		vst1q_s32( p_right + i,     vmlal_n_s16( vld1q_s32( p_right + i ),     vget_low_s16( w ),  (int16_t) right_gain ) );
+		vst1q_s32( p_right + i + 4, vmlal_n_s16( vld1q_s32( p_right + i + 4 ), vget_high_s16( w ), (int16_t) right_gain ) );
+	}
+	for( ; i < samples; i++ ) {
+		p_left[i]	+= p_wave[i] * left_gain;
+		p_right[i]	+= p_wave[i] * right_gain;
+	}
+}
+
+// --------------------------------------------------------------------
+int32_t sangria_mixer_peak_neon( const int32_t *p_left, const int32_t *p_right, int samples ) {
+	int32x4_t m;
+	int32x2_t t;
+	int32_t peak, l, r;
+	int i;
+
+	m = vdupq_n_s32( 0 );
+	for( i = 0; i + 4 <= samples; i += 4 ) {
+		m = vmaxq_s32( m, vabsq_s32( vld1q_s32( p_left + i ) ) );
+		m = vmaxq_s32( m, vabsq_s32( vld1q_s32( p_right + i ) ) );
+	}
+	t = vpmax_s32( vget_low_s32( m ), vget_high_s32( m ) );
+	t = vpmax_s32( t, t );
+	peak = vget_lane_s32( t, 0 );
+	for( ; i < samples; i++ ) {
+		l = p_left[i] < 0 ? -p_left[i] : p_left[i];
+		r = p_right[i] < 0 ? -p_right[i] : p_right[i];
+		if( l > peak ) {
+			peak = l;
+		}
+		if( r > peak ) {
+			peak = r;
+		}
+	}
+	return peak;
+}
+
+// --------------------------------------------------------------------
+//	vcvtq_s32_f32 truncates toward 0 as the C version.
+//
+static inline int16x4_t _scale( const int32_t *p_sum, const float *p_gain ) {
+	int32x4_t x;
+
+	x = vshrq_n_s32( vld1q_s32( p_sum ), SANGRIA_MIXER_GAIN_BITS );
+	if( p_gain != NULL ) {
+		x = vcvtq_s32_f32( vmulq_f32( vcvtq_f32_s32( x ), vld1q_f32( p_gain ) ) );
+	}
+	return vqmovn_s32( x );
+}
+
+// --------------------------------------------------------------------
+void sangria_mixer_output_neon( int16_t *p_wave, const int32_t *p_left, const int32_t *p_right, const float *p_gain, int samples ) {
+	int16x8x2_t v;
+	int32_t l, r;
+	int i;
+
+	for( i = 0; i + 8 <= samples; i += 8 ) {
+		v.val[0] = vcombine_s16( _scale( p_left + i, p_gain ? p_gain + i : NULL ), _scale( p_left + i + 4, p_gain ? p_gain + i + 4 : NULL ) );
+		v.val[1] = vcombine_s16( _scale( p_right + i, p_gain ? p_gain + i : NULL ), _scale( p_right + i + 4, p_gain ? p_gain + i + 4 : NULL ) );
+		vst2q_s16( p_wave + (i << 1), v );
+	}
+	for( ; i < samples; i++ ) {
+		l = p_left[i] >> SANGRIA_MIXER_GAIN_BITS;
+		r = p_right[i] >> SANGRIA_MIXER_GAIN_BITS;
+		if( p_gain != NULL ) {
+			l = (int32_t)( (float) l * p_gain[i] );
+			r = (int32_t)( (float) r * p_gain[i] );
+		}
+		p_wave[ (i << 1) + 0 ] = (int16_t)( l > 32767 ? 32767 : (l < -32768 ? -32768 : l) );
+		p_wave[ (i << 1) + 1 ] = (int16_t)( r > 32767 ? 32767 : (r < -32768 ? -32768 : r) );
+	}
+}
+
+#endif
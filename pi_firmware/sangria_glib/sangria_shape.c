@@ -0,0 +1,330 @@
+// --------------------------------------------------------------------
+// Sangria game library: shapes
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "sangria_shape.h"
+#include "sangria_glib_1bpp.h"
+
+#define LOCAL_ROWS			512			//	half widths of an ellipse on the stack
+#define LOCAL_EDGES			64			//	edges of a polygon on the stack
+
+typedef struct {
+	int32_t		y_end;		//	the edge is on the lines y_start ... y_end - 1
+	int32_t		x;			//	ceil() of the X position on the current line
+	int32_t		r;			//	the X position is x - r / dy (0 <= r < dy)
+	int32_t		dy;
+	int32_t		step;		//	x increases by step (+ 1) for each line
+	int32_t		step_r;		//	r decreases by step_r for each line
+	int32_t		y_start;
+	int32_t		x1, y1, dx;	//	top vertex and the width
+} EDGE_T;
+
+// --------------------------------------------------------------------
+//	The arguments are clipped by the caller.
+//
+static inline void _span( SANGRIA_BACKBUFFER_T *p_image, int x1, int x2, int y, uint8_t c ) {
+
+	if( p_image->format == SANGRIA_FORMAT_1BPP ) {
+		sangria_1bpp_fill_rect( p_image, x1, y, x2, y, c );
+	}
+	else {
+		memset( p_image->image + x1 + y * p_image->width, c, x2 - x1 + 1 );
+	}
+}
+
+// --------------------------------------------------------------------
+static inline void _clipped_span( SANGRIA_BACKBUFFER_T *p_image, int x1, int x2, int y, uint8_t c ) {
+
+	if( x1 < 0 ) {
+		x1 = 0;
+	}
+	if( x2 >= p_image->width ) {
+		x2 = p_image->width - 1;
+	}
+	if( x1 <= x2 ) {
+		_span( p_image, x1, x2, y, c );
+	}
+}
+
+// --------------------------------------------------------------------
+void sangria_hline( SANGRIA_BACKBUFFER_T *p_image, int x1, int x2, int y, uint8_t c ) {
+	int t;
+
+	if( y < 0 || y >= p_image->height ) {
+		return;
+	}
+	if( x1 > x2 ) {
+		t = x1;
+		x1 = x2;
+		x2 = t;
+	}
+	if( x2 < 0 || x1 >= p_image->width ) {
+		return;
+	}
+	_clipped_span( p_image, x1, x2, y, c );
+	sangria_mark_dirty( p_image, y, y );
+}
+
+// --------------------------------------------------------------------
+//	p_width[ dy ] is the largest x of the line dy (0 ... ry) from the
+//	center: 4 x^2 (2ry + 1)^2 + 4 dy^2 (2rx + 1)^2 <= (2rx + 1)^2 (2ry + 1)^2
+//
+static void _get_widths( int rx, int ry, int32_t *p_width ) {
+	uint64_t a, b, ab;
+	int64_t x, dy;
+
+	a	= (uint64_t)( 2 * rx + 1 ) * ( 2 * rx + 1 );
+	b	= (uint64_t)( 2 * ry + 1 ) * ( 2 * ry + 1 );
+	ab	= a * b;
+	x	= rx;
+	for( dy = 0; dy <= ry; dy++ ) {
+		while( x > 0 && 4 * (uint64_t)( x * x ) * b + 4 * (uint64_t)( dy * dy ) * a > ab ) {
+			x--;
+		}
+		p_width[ dy ] = (int32_t) x;
+	}
+}
+
+// --------------------------------------------------------------------
+static void _ellipse( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int rx, int ry, uint8_t c, int is_fill ) {
+	int32_t local_width[ LOCAL_ROWS ];
+	int32_t *p_width;
+	int dy, y, y1, y2, w, inner, start;
+
+	if( rx < 0 || ry < 0 || rx > SANGRIA_SHAPE_MAX_RADIUS || ry > SANGRIA_SHAPE_MAX_RADIUS ) {
+		return;
+	}
+	//	the lines on the back buffer
+	y1 = (cy - ry < 0) ? 0 : cy - ry;
+	y2 = (cy + ry >= p_image->height) ? p_image->height - 1 : cy + ry;
+	if( y1 > y2 || cx + rx < 0 || cx - rx >= p_image->width ) {
+		return;
+	}
+	p_width = local_width;
+	if( ry + 2 > LOCAL_ROWS ) {
+		p_width = (int32_t*) malloc( (ry + 2) * sizeof(int32_t) );
+		if( p_width == NULL ) {
+			return;
+		}
+	}
+	_get_widths( rx, ry, p_width );
+	p_width[ ry + 1 ] = -1;
+
+	for( y = y1; y <= y2; y++ ) {
+		dy	= abs( y - cy );
+		w	= p_width[ dy ];
+		if( is_fill ) {
+			_clipped_span( p_image, cx - w, cx + w, y, c );
+			continue;
+		}
+		//	The width shrinks from the center, so the pixels beyond the
+		//	narrower neighbour line are on the outline.
+		inner = p_width[ dy + 1 ];
+		start = (inner < w) ? inner + 1 : w;
+		if( start <= 0 ) {
+			_clipped_span( p_image, cx - w, cx + w, y, c );
+		}
+		else {
+			_clipped_span( p_image, cx - w, cx - start, y, c );
+			_clipped_span( p_image, cx + start, cx + w, y, c );
+		}
+	}
+	sangria_mark_dirty( p_image, y1, y2 );
+	if( p_width != local_width ) {
+		free( p_width );
+	}
+}
+
+// --------------------------------------------------------------------
+void sangria_ellipse( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int rx, int ry, uint8_t c ) {
+
+	_ellipse( p_image, cx, cy, rx, ry, c, 0 );
+}
+
+// --------------------------------------------------------------------
+void sangria_fill_ellipse( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int rx, int ry, uint8_t c ) {
+
+	_ellipse( p_image, cx, cy, rx, ry, c, 1 );
+}
+
+// --------------------------------------------------------------------
+void sangria_circle( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int r, uint8_t c ) {
+
+	_ellipse( p_image, cx, cy, r, r, c, 0 );
+}
+
+// --------------------------------------------------------------------
+void sangria_fill_circle( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int r, uint8_t c ) {
+
+	_ellipse( p_image, cx, cy, r, r, c, 1 );
+}
+
+// --------------------------------------------------------------------
+void sangria_polygon( SANGRIA_BACKBUFFER_T *p_image, const SANGRIA_POINT_T *p_points, int n, uint8_t c ) {
+	int i;
+
+	if( n <= 0 ) {
+		return;
+	}
+	for( i = 0; i < n - 1; i++ ) {
+		sangria_line( p_image, p_points[i].x, p_points[i].y, p_points[i + 1].x, p_points[i + 1].y, c );
+	}
+	sangria_line( p_image, p_points[ n - 1 ].x, p_points[ n - 1 ].y, p_points[0].x, p_points[0].y, c );
+}
+
+// --------------------------------------------------------------------
+//	floor( a / b ) for b > 0
+//
+static inline int64_t _floor_div( int64_t a, int64_t b ) {
+
+	return (a >= 0) ? a / b : -((-a + b - 1) / b);
+}
+
+// --------------------------------------------------------------------
+//	The X position on the line y is x1 + (y - y1) * dx / dy, and x is ceil() of it.
+//
+static void _start_edge( EDGE_T *p_edge, int y ) {
+	int64_t num;
+
+	num			= (int64_t) p_edge->x1 * p_edge->dy + (int64_t)( y - p_edge->y1 ) * p_edge->dx;
+	p_edge->x	= (int32_t)( -_floor_div( -num, p_edge->dy ) );
+	p_edge->r	= (int32_t)( (int64_t) p_edge->x * p_edge->dy - num );
+}
+
+// --------------------------------------------------------------------
+static inline void _step_edge( EDGE_T *p_edge ) {
+
+	p_edge->x += p_edge->step;
+	p_edge->r -= p_edge->step_r;
+	if( p_edge->r < 0 ) {
+		p_edge->r += p_edge->dy;
+		p_edge->x++;
+	}
+}
+
+// --------------------------------------------------------------------
+static int _compare_edge( const void *p1, const void *p2 ) {
+
+	return ((const EDGE_T*) p1)->y_start - ((const EDGE_T*) p2)->y_start;
+}
+
+// --------------------------------------------------------------------
+void sangria_fill_polygon( SANGRIA_BACKBUFFER_T *p_image, const SANGRIA_POINT_T *p_points, int n, uint8_t c ) {
+	EDGE_T local_edges[ LOCAL_EDGES ];
+	EDGE_T *p_edges, *p_edge, *p_active[ LOCAL_EDGES ], **pp_active, *p_t;
+	const SANGRIA_POINT_T *p1, *p2;
+	int i, j, count, next, active, y, y_top, y_bottom;
+
+	if( n < 3 ) {
+		return;
+	}
+	p_edges		= local_edges;
+	pp_active	= p_active;
+	if( n > LOCAL_EDGES ) {
+		p_edges		= (EDGE_T*) malloc( n * sizeof(EDGE_T) );
+		pp_active	= (EDGE_T**) malloc( n * sizeof(EDGE_T*) );
+		if( p_edges == NULL || pp_active == NULL ) {
+			free( p_edges );
+			free( pp_active );
+			return;
+		}
+	}
+
+	//	edge table: the edges from top to bottom, horizontal ones are not needed
+	count		= 0;
+	y_top		= p_image->height;
+	y_bottom	= 0;
+	for( i = 0; i < n; i++ ) {
+		p1 = &p_points[i];
+		p2 = &p_points[ (i + 1 < n) ? i + 1 : 0 ];
+		if( p1->y == p2->y ) {
+			continue;
+		}
+		if( p1->y > p2->y ) {
+			p1 = &p_points[ (i + 1 < n) ? i + 1 : 0 ];
+			p2 = &p_points[i];
+		}
+		p_edge = &p_edges[ count ];
+		p_edge->x1		= p1->x;
+		p_edge->y1		= p1->y;
+		p_edge->dx		= p2->x - p1->x;
+		p_edge->dy		= p2->y - p1->y;
+		p_edge->y_start	= (p1->y < 0) ? 0 : p1->y;
+		p_edge->y_end	= (p2->y > p_image->height) ? p_image->height : p2->y;
+		if( p_edge->y_start >= p_edge->y_end ) {
+			continue;
+		}
+		p_edge->step	= (int32_t) _floor_div( p_edge->dx, p_edge->dy );
+		p_edge->step_r	= p_edge->dx - p_edge->step * p_edge->dy;
+		if( y_top > p_edge->y_start ) {
+			y_top = p_edge->y_start;
+		}
+		if( y_bottom < p_edge->y_end ) {
+			y_bottom = p_edge->y_end;
+		}
+		count++;
+	}
+	qsort( p_edges, count, sizeof(EDGE_T), _compare_edge );
+
+	next	= 0;
+	active	= 0;
+	for( y = y_top; y < y_bottom; y++ ) {
+		//	the edges that end here are removed, the new ones are added
+		for( i = j = 0; i < active; i++ ) {
+			if( pp_active[i]->y_end > y ) {
+				pp_active[ j++ ] = pp_active[i];
+			}
+		}
+		active = j;
+		while( next < count && p_edges[ next ].y_start == y ) {
+			_start_edge( &p_edges[ next ], y );
+			pp_active[ active++ ] = &p_edges[ next++ ];
+		}
+		//	sorted by X: nearly sorted since the last line
+		for( i = 1; i < active; i++ ) {
+			p_t = pp_active[i];
+			for( j = i; j > 0 && pp_active[ j - 1 ]->x > p_t->x; j-- ) {
+				pp_active[j] = pp_active[ j - 1 ];
+			}
+			pp_active[j] = p_t;
+		}
+		//	even-odd: x of the left edge ... x of the right edge - 1
+		for( i = 0; i + 1 < active; i += 2 ) {
+			if( pp_active[i]->x < pp_active[ i + 1 ]->x ) {
+				_clipped_span( p_image, pp_active[i]->x, pp_active[ i + 1 ]->x - 1, y, c );
+			}
+		}
+		for( i = 0; i < active; i++ ) {
+			_step_edge( pp_active[i] );
+		}
+	}
+	if( y_top < y_bottom ) {
+		sangria_mark_dirty( p_image, y_top, y_bottom - 1 );
+	}
+	if( p_edges != local_edges ) {
+		free( p_edges );
+		free( pp_active );
+	}
+}
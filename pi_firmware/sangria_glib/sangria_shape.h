@@ -0,0 +1,146 @@
+// --------------------------------------------------------------------
+// Sangria game library: shapes
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	Filled and outlined shapes. Every shape is clipped once for each
+//	line, and drawn as horizontal spans (memset), so the pixels outside
+//	the back buffer cost nothing and no pixel is checked one by one.
+//
+//	Ellipses and circles are the pixels (x, y) from the center that are
+//	inside the ellipse of the radii + 0.5, so a circle of radius r is
+//	2r + 1 pixels wide. The outline is the pixels of the filled shape
+//	that have a neighbour (up, down, left or right) outside of it.
+//
+//	Polygons are filled by the even-odd rule with an edge table. The
+//	vertices are pixel centers, and a pixel on the right or bottom edge
+//	is not filled (top-left rule), so polygons that share an edge never
+//	overlap. Convex, concave and self-intersecting ones can be filled.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_SHAPE_H__
+#define __SANGRIA_SHAPE_H__
+
+#include "sangria_glib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SANGRIA_SHAPE_MAX_RADIUS	16383
+
+// --------------------------------------------------------------------
+//	SANGRIA_POINT_T
+// --------------------------------------------------------------------
+typedef struct {
+	int32_t		x;
+	int32_t		y;
+} SANGRIA_POINT_T;
+
+// --------------------------------------------------------------------
+//	sangria_hline()
+//	input)
+//		p_image .... target backbuffer pointer
+//		x1 ......... start X position
+//		x2 ......... end X position
+//		y .......... Y position
+//		c .......... pixel value
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_hline( SANGRIA_BACKBUFFER_T *p_image, int x1, int x2, int y, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_ellipse()
+//	input)
+//		p_image .... target backbuffer pointer
+//		cx ......... X position of the center
+//		cy ......... Y position of the center
+//		rx ......... horizontal radius (0 ... SANGRIA_SHAPE_MAX_RADIUS)
+//		ry ......... vertical radius (0 ... SANGRIA_SHAPE_MAX_RADIUS)
+//		c .......... pixel value
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_ellipse( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int rx, int ry, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_fill_ellipse()
+//	input)
+//		same as sangria_ellipse()
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_fill_ellipse( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int rx, int ry, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_circle()
+//	input)
+//		p_image .... target backbuffer pointer
+//		cx ......... X position of the center
+//		cy ......... Y position of the center
+//		r .......... radius (0 ... SANGRIA_SHAPE_MAX_RADIUS)
+//		c .......... pixel value
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_circle( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int r, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_fill_circle()
+//	input)
+//		same as sangria_circle()
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_fill_circle( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int r, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_polygon()
+//	input)
+//		p_image .... target backbuffer pointer
+//		p_points ... vertices
+//		n .......... number of vertices
+//		c .......... pixel value
+//	output)
+//		none
+//	comment)
+//		sangria_line() between the vertices, and from the last one to
+//		the first one.
+// --------------------------------------------------------------------
+void sangria_polygon( SANGRIA_BACKBUFFER_T *p_image, const SANGRIA_POINT_T *p_points, int n, uint8_t c );
+
+// --------------------------------------------------------------------
+//	sangria_fill_polygon()
+//	input)
+//		same as sangria_polygon()
+//	output)
+//		none
+//	comment)
+//		The coordinates must be in -1000000 ... 1000000.
+// --------------------------------------------------------------------
+void sangria_fill_polygon( SANGRIA_BACKBUFFER_T *p_image, const SANGRIA_POINT_T *p_points, int n, uint8_t c );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,8 @@
 #include <stdint.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
+#include <sched.h>
 #include <pthread.h>
 
 //	pulseaudio
@@ -35,6 +37,9 @@
 
 #include <psg_emulator.h>
 #include <scc_emulator.h>
+#include <sangria_slib.h>
+#include <sangria_sound_queue.h>
+#include <sangria_mixer.h>
 
 #ifndef SAMPLE_RATE
 #define SAMPLE_RATE		48000		//	Hz
@@ -42,36 +47,148 @@
 
 #define SAMPLE_CHANNELS	2
 
+#define PSG_VOLUME		(11 << SANGRIA_MIXER_GAIN_BITS)
+#define SCC_VOLUME		(22 << SANGRIA_MIXER_GAIN_BITS)
+
+#define MIN_PERIOD		1000					//	usec
+#define MAX_PERIOD		100000					//	usec
+#define STABLE_TIME		10000000000LL			//	nsec without underruns to shrink the latency
+#define MAX_STABLE_TIME	320000000000LL			//	nsec
+#define USEC_TO_FRAMES( usec )		( (int)( (int64_t)(usec) * SAMPLE_RATE / 1000000 ) )
+#define FRAMES_TO_USEC( frames )	( (int)( (int64_t)(frames) * 1000000 / SAMPLE_RATE ) )
+
 // --------------------------------------------------------------------
 static pa_context *pa_ctx;
 static pa_mainloop *pa_ml;
 static pa_buffer_attr buf_attr;
-static int underflows = 0;
 static pa_sample_spec ss;
 
 static pthread_t h_wave_thread;
+static int is_thread_started;			//	!0: h_wave_thread has to be joined
 
 static H_PSG_T hpsg;
 static H_PSG_T hpsg_se;
 static H_SCC_T hscc;
 
+static SANGRIA_SOUND_QUEUE_T sound_queue;
+static SANGRIA_MIXER_T sound_mixer;
+
+static SANGRIA_SOUND_CONFIG_T sound_config;
+static SANGRIA_SOUND_STATUS_T sound_status;
+
 static int16_t wave[ SAMPLE_RATE * SAMPLE_CHANNELS * 2 ];
-static int latency = 100;		// start latency in milli seconds
+static int latency;						//	usec, the buffer is kept at it
+static int64_t stable_time;				//	nsec without underruns to shrink the latency
+static int64_t last_change;				//	time of the last change of the latency
+static int is_shrunk;					//	!0: the last change made the latency shorter
+
+// --------------------------------------------------------------------
+static int64_t _get_time( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (int64_t) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
 
 // --------------------------------------------------------------------
 static void _sound_generator( int16_t *p_wave, int samples ) {
-	static int16_t wave1[ SAMPLE_RATE ];
-	static int16_t wave2[ SAMPLE_RATE ];
-	static int16_t wave3[ SAMPLE_RATE ];
-	int i;
 
-	psg_generate_wave( hpsg,    wave1, samples );
-	psg_generate_wave( hpsg_se, wave2, samples );
-	scc_generate_wave( hscc,    wave3, samples );
-	for( i = 0; i < samples; i++ ) {
-		p_wave[ (i << 1) + 0 ] = (wave1[ i ] + wave2[ i ] + (wave3[ i ] << 1)) * 11;
-		p_wave[ (i << 1) + 1 ] = (wave1[ i ] + wave2[ i ] + (wave3[ i ] << 1)) * 11;
+	//	the block is split at the writes of sangria_sound_write_register()
+	sangria_mixer_render( &sound_mixer, &sound_queue, p_wave, samples, _get_time() );
+}
+
+// --------------------------------------------------------------------
+//	A write in the block is mapped to the time before the request, so
+//	it is heard after the block and the delay of the device before it.
+//	Only the audio thread changes sound_status.
+//
+static void _render( int16_t *p_wave, int samples, int delay ) {
+	int measured;
+
+	_sound_generator( p_wave, samples );
+	measured = delay + FRAMES_TO_USEC( samples );
+	__atomic_store_n( &sound_status.blocks, sound_status.blocks + 1, __ATOMIC_RELAXED );
+	__atomic_store_n( &sound_status.latency_sum, sound_status.latency_sum + measured, __ATOMIC_RELAXED );
+	__atomic_store_n( &sound_status.last_latency, measured, __ATOMIC_RELAXED );
+	if( (uint32_t) measured > sound_status.max_latency ) {
+		__atomic_store_n( &sound_status.max_latency, measured, __ATOMIC_RELAXED );
+	}
+}
+
+// --------------------------------------------------------------------
+//	An underrun makes the latency 1.5 times, once in a latency (a burst
+//	of underruns is one). If the latency was made shorter just before,
+//	the stable time to shrink it again is doubled, so the latency does
+//	not go up and down at a short cycle.
+//
+static int _grow_latency( int64_t now ) {
+
+	__atomic_store_n( &sound_status.underruns, sound_status.underruns + 1, __ATOMIC_RELAXED );
+	if( now - last_change < latency * 1000LL || latency >= sound_config.max_latency ) {
+		return 0;
+	}
+	if( is_shrunk && now - last_change < stable_time && stable_time < MAX_STABLE_TIME ) {
+		stable_time <<= 1;
+	}
+	is_shrunk	= 0;
+	last_change	= now;
+	latency		= latency * 3 / 2;
+	if( latency > sound_config.max_latency ) {
+		latency = sound_config.max_latency;
+	}
+	__atomic_store_n( &sound_status.target_latency, latency, __ATOMIC_RELAXED );
+	return 1;
+}
+
+// --------------------------------------------------------------------
+//	The latency is made 3/4 after the stable time without underruns,
+//	down to the latency of the config.
+//
+static int _shrink_latency( int64_t now ) {
+
+	if( latency <= sound_config.latency || now - last_change < stable_time ) {
+		return 0;
+	}
+	is_shrunk	= 1;
+	last_change	= now;
+	latency		= latency * 3 / 4;
+	if( latency < sound_config.latency ) {
+		latency = sound_config.latency;
+	}
+	__atomic_store_n( &sound_status.target_latency, latency, __ATOMIC_RELAXED );
+	return 1;
+}
+
+// --------------------------------------------------------------------
+//	The audio thread runs at SCHED_FIFO if the config asks it. Without
+//	the permission (RLIMIT_RTPRIO or CAP_SYS_NICE), it runs at the
+//	normal priority.
+//
+static int _create_thread( void *(*p_thread)( void * ) ) {
+	pthread_attr_t attr;
+	struct sched_param param;
+	int r;
+
+	if( sound_config.priority > 0 ) {
+		param.sched_priority = sound_config.priority;
+		if( param.sched_priority > sched_get_priority_max( SCHED_FIFO ) ) {
+			param.sched_priority = sched_get_priority_max( SCHED_FIFO );
+		}
+		pthread_attr_init( &attr );
+		pthread_attr_setinheritsched( &attr, PTHREAD_EXPLICIT_SCHED );
+		pthread_attr_setschedpolicy( &attr, SCHED_FIFO );
+		pthread_attr_setschedparam( &attr, &param );
+		r = pthread_create( &h_wave_thread, &attr, p_thread, NULL );
+		pthread_attr_destroy( &attr );
+		if( r == 0 ) {
+			sound_status.is_real_time = 1;
+			is_thread_started = 1;
+			return 1;
+		}
 	}
+	sound_status.is_real_time = 0;
+	is_thread_started = (pthread_create( &h_wave_thread, NULL, p_thread, NULL ) == 0);
+	return is_thread_started;
 }
 
 // --------------------------------------------------------------------
@@ -85,10 +202,21 @@ static void *_wave_thread( void *p_no_use ) {
 	return NULL;
 }
 
+// --------------------------------------------------------------------
+static void _set_buffer_attr( pa_stream *s ) {
+	pa_operation *p_operation;
+
+	buf_attr.tlength = pa_usec_to_bytes( latency, &ss );
+	p_operation = pa_stream_set_buffer_attr( s, &buf_attr, NULL, NULL );
+	if( p_operation != NULL ) {
+		pa_operation_unref( p_operation );
+	}
+}
+
 // --------------------------------------------------------------------
 static void stream_request_cb( pa_stream *s, size_t byte_length, void *p_no_use ) {
-	//pa_usec_t usec;
-	//int neg;
+	pa_usec_t usec;
+	int neg;
 	int samples;
 
 	byte_length &= ~3;
@@ -96,26 +224,22 @@ static void stream_request_cb( pa_stream *s, size_t byte_length, void *p_no_use
 		byte_length = sizeof(wave);
 	}
 	samples = byte_length >> 2;
-	//pa_stream_get_latency( s, &usec, &neg );
-	//if( (sample_offset + (samples << 1)) > (sizeof(wave) >> 1) ) {
-	//	sample_offset = 0;
-	//}
-	_sound_generator( wave, samples );
+	if( pa_stream_get_latency( s, &usec, &neg ) < 0 || neg ) {
+		//	no timing information yet
+		usec = 0;
+	}
+	_render( wave, samples, (int) usec );
 	pa_stream_write( s, wave, samples << 2, NULL, 0LL, PA_SEEK_RELATIVE );
-	//sample_offset += samples << 1;
+	if( _shrink_latency( _get_time() ) ) {
+		_set_buffer_attr( s );
+	}
 }
 
 // --------------------------------------------------------------------
 static void stream_underflow_cb(pa_stream *s, void *userdata) {
-	// We increase the latency by 50% if we get 6 underflows and latency is under 2s
-	// This is very useful for over the network playback that can't handle low latencies
-	underflows++;
-	if( underflows >= 6 && latency < 2000000 ) {
-		latency = (latency * 3) / 2;
-		buf_attr.maxlength = pa_usec_to_bytes( latency, &ss );
-		buf_attr.tlength = pa_usec_to_bytes( latency, &ss );  
-		pa_stream_set_buffer_attr( s, &buf_attr, NULL, NULL );
-		underflows = 0;
+
+	if( _grow_latency( _get_time() ) ) {
+		_set_buffer_attr( s );
 	}
 }
 
@@ -144,22 +268,42 @@ void pa_state_cb( pa_context *c, void *userdata ) {
 }
 
 // --------------------------------------------------------------------
-int sangria_sound_initialize( void ) {
+//	Releases what _pulse_audio_initialize() has made before it failed.
+//
+static void _pulse_audio_release( pa_stream *playstream ) {
+
+	if( playstream != NULL ) {
+		pa_stream_disconnect( playstream );
+		pa_stream_unref( playstream );
+	}
+	if( pa_ctx != NULL ) {
+		pa_context_disconnect( pa_ctx );
+		pa_context_unref( pa_ctx );
+		pa_ctx = NULL;
+	}
+	if( pa_ml != NULL ) {
+		pa_mainloop_free( pa_ml );
+		pa_ml = NULL;
+	}
+}
+
+// --------------------------------------------------------------------
+static int _pulse_audio_initialize( void ) {
 	pa_mainloop_api *pa_mlapi;
 	pa_stream *playstream;
 	int pa_ready = 0;
 	int r;
 
-	hpsg	= psg_initialize();
-	hpsg_se	= psg_initialize();
-	hscc	= scc_initialize();
-	if( hpsg == NULL || hpsg_se == NULL || hscc == NULL ) {
+	pa_ml		= pa_mainloop_new();
+	if( pa_ml == NULL ) {
 		return 0;
 	}
-
-	pa_ml		= pa_mainloop_new();
 	pa_mlapi	= pa_mainloop_get_api( pa_ml );
 	pa_ctx		= pa_context_new( pa_mlapi, "sangria_slib" );
+	if( pa_ctx == NULL ) {
+		_pulse_audio_release( NULL );
+		return 0;
+	}
 	pa_context_connect( pa_ctx, NULL, 0, NULL );
 
 	pa_context_set_state_callback( pa_ctx, pa_state_cb, &pa_ready );
@@ -168,6 +312,7 @@ int sangria_sound_initialize( void ) {
 	}
 	if( pa_ready == 2 ) {
 		//	case of PA_CONTEXT_FAILED or PA_CONTEXT_TERMINATED
+		_pulse_audio_release( NULL );
 		return 0;
 	}
 	//	case of PA_CONTEXT_READY
@@ -176,6 +321,7 @@ int sangria_sound_initialize( void ) {
 	ss.channels			= SAMPLE_CHANNELS;
 	playstream = pa_stream_new( pa_ctx, "sangria_slib Playback", &ss, NULL );
 	if( playstream == NULL ) {
+		_pulse_audio_release( NULL );
 		return 0;
 	}
 	pa_stream_set_write_callback( playstream, stream_request_cb, NULL );
@@ -183,9 +329,9 @@ int sangria_sound_initialize( void ) {
 
 	buf_attr.fragsize	= (uint32_t) -1;
 	buf_attr.maxlength	= (uint32_t) -1;
-	buf_attr.minreq		= (uint32_t) -1;
+	buf_attr.minreq		= sound_config.period ? pa_usec_to_bytes( sound_config.period, &ss ) : (uint32_t) -1;
 	buf_attr.prebuf		= (uint32_t) -1;
-	buf_attr.tlength	= pa_usec_to_bytes( latency * 1000, &ss );
+	buf_attr.tlength	= pa_usec_to_bytes( latency, &ss );
 	r = pa_stream_connect_playback( playstream, NULL, &buf_attr,
 			PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_ADJUST_LATENCY,
 			NULL, NULL );
@@ -193,24 +339,87 @@ int sangria_sound_initialize( void ) {
 		//	Â PulseAudio  PA_STREAM_ADJUST_LATENCY Ƃ܂Ȃꍇ̂ŁAOăgC.
 		//	Old PulseAudio may not work with PA_STREAM_ADJUST_LATENCY, remove it and retry.
 		r = pa_stream_connect_playback(playstream, NULL, &buf_attr,
-			PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE, 
+			PA_STREAM_INTERPOLATE_TIMING | PA_STREAM_AUTO_TIMING_UPDATE,
 			NULL, NULL );
 	}
 	if( r < 0 ) {
+		_pulse_audio_release( playstream );
+		return 0;
+	}
+	sound_status.period = sound_config.period;
+	if( !_create_thread( _wave_thread ) ) {
+		_pulse_audio_release( playstream );
 		return 0;
 	}
-
-	pthread_create( &h_wave_thread, NULL, _wave_thread, NULL );
 	return 1;
 }
 
+// --------------------------------------------------------------------
+void sangria_sound_get_default_config( SANGRIA_SOUND_CONFIG_T *p_config ) {
+
+	p_config->period		= 0;
+	p_config->latency		= 100000;
+	p_config->max_latency	= 2000000;
+	p_config->priority		= 0;
+}
+
+// --------------------------------------------------------------------
+int sangria_sound_initialize_with_config( const SANGRIA_SOUND_CONFIG_T *p_config ) {
+
+	sound_config = *p_config;
+	if( sound_config.period != 0 ) {
+		if( sound_config.period < MIN_PERIOD ) {
+			sound_config.period = MIN_PERIOD;
+		}
+		else if( sound_config.period > MAX_PERIOD ) {
+			sound_config.period = MAX_PERIOD;
+		}
+		if( sound_config.latency < sound_config.period * 2 ) {
+			sound_config.latency = sound_config.period * 2;
+		}
+	}
+	if( sound_config.max_latency < sound_config.latency ) {
+		sound_config.max_latency = sound_config.latency;
+	}
+	latency		= sound_config.latency;
+	stable_time	= STABLE_TIME;
+	last_change	= 0;
+	is_shrunk	= 0;
+	memset( &sound_status, 0, sizeof(sound_status) );
+	sound_status.target_latency = latency;
+
+	//	SANGRIA_SOUND_PSG, SANGRIA_SOUND_PSG_SE and SANGRIA_SOUND_SCC
+	sangria_mixer_initialize( &sound_mixer, 1 );
+	if( sangria_sound_add_chip( SANGRIA_SOUND_TYPE_PSG ) < 0 ||
+		sangria_sound_add_chip( SANGRIA_SOUND_TYPE_PSG ) < 0 ||
+		sangria_sound_add_chip( SANGRIA_SOUND_TYPE_SCC ) < 0 ) {
+		return 0;
+	}
+	hpsg	= sound_mixer.chip[ SANGRIA_SOUND_PSG ].handle;
+	hpsg_se	= sound_mixer.chip[ SANGRIA_SOUND_PSG_SE ].handle;
+	hscc	= sound_mixer.chip[ SANGRIA_SOUND_SCC ].handle;
+	sangria_sound_queue_initialize( &sound_queue );
+
+	return _pulse_audio_initialize();
+}
+
+// --------------------------------------------------------------------
+int sangria_sound_initialize( void ) {
+	SANGRIA_SOUND_CONFIG_T config;
+
+	sangria_sound_get_default_config( &config );
+	return sangria_sound_initialize_with_config( &config );
+}
+
 // --------------------------------------------------------------------
 void sangria_sound_terminate( void ) {
 	void *p_result;
+	int i;
 
-	if( pa_ml != NULL ) {
+	if( pa_ml != NULL && is_thread_started ) {
 		pa_mainloop_quit( pa_ml, 0 );
 		pthread_join( h_wave_thread, &p_result );
+		is_thread_started = 0;
 	}
 
 	if( pa_ml != NULL ) {
@@ -218,9 +427,56 @@ void sangria_sound_terminate( void ) {
 		pa_ml = NULL;
 	}
 
-	scc_terminate( hscc );
-	psg_terminate( hpsg_se );
-	psg_terminate( hpsg );
+	for( i = 0; i < sound_mixer.voices; i++ ) {
+		if( sound_mixer.chip[i].type == SANGRIA_SOUND_TYPE_PSG ) {
+			psg_terminate( sound_mixer.chip[i].handle );
+		}
+		else {
+			scc_terminate( sound_mixer.chip[i].handle );
+		}
+	}
+	sound_mixer.voices = 0;
+}
+
+// --------------------------------------------------------------------
+void sangria_sound_get_status( SANGRIA_SOUND_STATUS_T *p_status ) {
+
+	p_status->underruns			= __atomic_load_n( &sound_status.underruns, __ATOMIC_RELAXED );
+	p_status->blocks			= __atomic_load_n( &sound_status.blocks, __ATOMIC_RELAXED );
+	p_status->latency_sum		= __atomic_load_n( &sound_status.latency_sum, __ATOMIC_RELAXED );
+	p_status->last_latency		= __atomic_load_n( &sound_status.last_latency, __ATOMIC_RELAXED );
+	p_status->max_latency		= __atomic_load_n( &sound_status.max_latency, __ATOMIC_RELAXED );
+	p_status->target_latency	= __atomic_load_n( &sound_status.target_latency, __ATOMIC_RELAXED );
+	p_status->period			= sound_status.period;
+	p_status->is_real_time		= sound_status.is_real_time;
+}
+
+// --------------------------------------------------------------------
+int sangria_sound_add_chip( int type ) {
+	void *handle;
+	int chip;
+
+	handle = (type == SANGRIA_SOUND_TYPE_PSG) ? (void*) psg_initialize() : (void*) scc_initialize();
+	if( handle == NULL ) {
+		return -1;
+	}
+	chip = sangria_mixer_add_voice( &sound_mixer, type, handle,
+		(type == SANGRIA_SOUND_TYPE_PSG) ? PSG_VOLUME : SCC_VOLUME, SANGRIA_MIXER_PAN_CENTER );
+	if( chip < 0 ) {
+		if( type == SANGRIA_SOUND_TYPE_PSG ) {
+			psg_terminate( handle );
+		}
+		else {
+			scc_terminate( handle );
+		}
+	}
+	return chip;
+}
+
+// --------------------------------------------------------------------
+void sangria_sound_set_mix( int chip, int volume, int pan ) {
+
+	sangria_mixer_set_voice( &sound_mixer, chip, volume, pan );
 }
 
 // --------------------------------------------------------------------
@@ -240,3 +496,20 @@ H_SCC_T sangria_get_scc_handle( void ) {
 
 	return hscc;
 }
+
+// --------------------------------------------------------------------
+int sangria_sound_write_register_at( int chip, uint16_t address, uint8_t data, int64_t time ) {
+	SANGRIA_SOUND_WRITE_T write;
+
+	write.time		= time;
+	write.address	= address;
+	write.data		= data;
+	write.chip		= (uint8_t) chip;
+	return sangria_sound_queue_put( &sound_queue, &write );
+}
+
+// --------------------------------------------------------------------
+int sangria_sound_write_register( int chip, uint16_t address, uint8_t data ) {
+
+	return sangria_sound_write_register_at( chip, address, data, _get_time() );
+}
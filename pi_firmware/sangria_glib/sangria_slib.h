@@ -30,11 +30,52 @@
 
 #include <psg_emulator.h>
 #include <scc_emulator.h>
+#include <sangria_sound_queue.h>
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+//	chip of sangria_sound_write_register() (and the chips of sangria_sound_add_chip())
+#define SANGRIA_SOUND_PSG		0
+#define SANGRIA_SOUND_PSG_SE	1
+#define SANGRIA_SOUND_SCC		2
+
+// --------------------------------------------------------------------
+//	SANGRIA_SOUND_CONFIG_T
+//	comment)
+//		The buffer of the device is kept at latency. An underrun makes it
+//		longer (up to max_latency), and it is made shorter again after a
+//		while without underruns (down to latency). For a low latency,
+//		period = 10000, latency = 20000 and priority = 50, for example.
+//		period = 0 lets PulseAudio decide it.
+// --------------------------------------------------------------------
+typedef struct {
+	int			period;				//	usec of a block made at once
+	int			latency;			//	usec, the shortest latency (2 periods or longer)
+	int			max_latency;		//	usec
+	int			priority;			//	SCHED_FIFO priority of the audio thread, 0: normal thread
+} SANGRIA_SOUND_CONFIG_T;
+
+// --------------------------------------------------------------------
+//	SANGRIA_SOUND_STATUS_T
+//	comment)
+//		The latency of a block is from a write to the time it is heard
+//		(the block and the delay of the device before it). latency_sum
+//		wraps around, the average is the difference of latency_sum over
+//		the difference of blocks.
+// --------------------------------------------------------------------
+typedef struct {
+	uint32_t	underruns;			//	underruns of the device
+	uint32_t	blocks;				//	blocks made
+	uint32_t	latency_sum;		//	usec, sum of the latency of the blocks
+	uint32_t	last_latency;		//	usec, latency of the last block
+	uint32_t	max_latency;		//	usec, the longest latency of a block
+	uint32_t	target_latency;		//	usec, the latency the buffer is kept at now
+	uint32_t	period;				//	usec of a block (0: decided by PulseAudio)
+	int			is_real_time;		//	!0: the audio thread runs at SCHED_FIFO
+} SANGRIA_SOUND_STATUS_T;
+
 // --------------------------------------------------------------------
 //	sangria_sound_initialize
 //	input)
@@ -42,9 +83,35 @@ extern "C" {
 //	output)
 //		0 ...... Failed (Sound device is not found.)
 //		!0 ..... Success
+//	comment)
+//		PulseAudio with 100 msec latency (sangria_sound_get_default_config).
+//		SANGRIA_SOUND_PSG, SANGRIA_SOUND_PSG_SE and SANGRIA_SOUND_SCC are
+//		mixed at the center, the SCC twice as loud as a PSG.
 // --------------------------------------------------------------------
 int sangria_sound_initialize( void );
 
+// --------------------------------------------------------------------
+//	sangria_sound_get_default_config
+//	input)
+//		p_config ..... the config of sangria_sound_initialize() is stored
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_sound_get_default_config( SANGRIA_SOUND_CONFIG_T *p_config );
+
+// --------------------------------------------------------------------
+//	sangria_sound_initialize_with_config
+//	input)
+//		p_config ..... period and latency
+//	output)
+//		0 ...... Failed (Sound device is not found.)
+//		!0 ..... Success
+//	comment)
+//		Without the permission of SCHED_FIFO, the audio thread runs at
+//		the normal priority (is_real_time of SANGRIA_SOUND_STATUS_T).
+// --------------------------------------------------------------------
+int sangria_sound_initialize_with_config( const SANGRIA_SOUND_CONFIG_T *p_config );
+
 // --------------------------------------------------------------------
 //	sangria_sound_terminate
 //	input)
@@ -54,12 +121,54 @@ int sangria_sound_initialize( void );
 // --------------------------------------------------------------------
 void sangria_sound_terminate( void );
 
+// --------------------------------------------------------------------
+//	sangria_sound_get_status
+//	input)
+//		p_status ..... the latency and the underruns are stored
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_sound_get_status( SANGRIA_SOUND_STATUS_T *p_status );
+
+// --------------------------------------------------------------------
+//	sangria_sound_add_chip
+//	input)
+//		type ......... SANGRIA_SOUND_TYPE_PSG or SANGRIA_SOUND_TYPE_SCC
+//	output)
+//		chip of sangria_sound_write_register()
+//		-1 ... Failed (There are SANGRIA_MIXER_MAX_VOICES chips.)
+//	comment)
+//		Another PSG or SCC is mixed at the center, at the volume of the
+//		chips of sangria_sound_initialize(). Call it after
+//		sangria_sound_initialize(), from the thread that writes the
+//		registers.
+// --------------------------------------------------------------------
+int sangria_sound_add_chip( int type );
+
+// --------------------------------------------------------------------
+//	sangria_sound_set_mix
+//	input)
+//		chip ......... SANGRIA_SOUND_PSG, SANGRIA_SOUND_PSG_SE, SANGRIA_SOUND_SCC
+//		               or a chip of sangria_sound_add_chip()
+//		volume ....... 0 ... 32767, 256 is x1 (a PSG is 2816, an SCC is 5632)
+//		pan .......... -256 (left) ... 0 (center) ... 256 (right)
+//	output)
+//		none
+//	comment)
+//		The mix is limited smoothly, a loud mix does not wrap around.
+// --------------------------------------------------------------------
+void sangria_sound_set_mix( int chip, int volume, int pan );
+
 // --------------------------------------------------------------------
 //	sangria_get_psg_handle
 //	input)
 //		none
 //	output)
 //		PSG handle
+//	comment)
+//		psg_write_register() of the handle changes the PSG at once, from
+//		the thread of the game, while the audio thread is making a block.
+//		sangria_sound_write_register() is safe and has the exact time.
 // --------------------------------------------------------------------
 H_PSG_T sangria_get_psg_handle( void );
 
@@ -81,6 +190,41 @@ H_PSG_T sangria_get_psg_se_handle( void );
 // --------------------------------------------------------------------
 H_SCC_T sangria_get_scc_handle( void );
 
+// --------------------------------------------------------------------
+//	sangria_sound_write_register
+//	input)
+//		chip ......... SANGRIA_SOUND_PSG, SANGRIA_SOUND_PSG_SE, SANGRIA_SOUND_SCC
+//		               or a chip of sangria_sound_add_chip()
+//		address ...... register address of the chip
+//		data ......... Write data
+//	output)
+//		0 ...... Failed (The queue is full.)
+//		!0 ..... Success
+//	comment)
+//		The write is queued with the current time, and is heard at the
+//		sample of that time (plus the latency of the audio device), not
+//		at the start of the next block. Only one thread can call it.
+// --------------------------------------------------------------------
+int sangria_sound_write_register( int chip, uint16_t address, uint8_t data );
+
+// --------------------------------------------------------------------
+//	sangria_sound_write_register_at
+//	input)
+//		chip ......... SANGRIA_SOUND_PSG, SANGRIA_SOUND_PSG_SE, SANGRIA_SOUND_SCC
+//		               or a chip of sangria_sound_add_chip()
+//		address ...... register address of the chip
+//		data ......... Write data
+//		time ......... time of the write (nsec of CLOCK_MONOTONIC)
+//	output)
+//		0 ...... Failed (The queue is full.)
+//		!0 ..... Success
+//	comment)
+//		A sequencer can put the writes of its next steps at their own
+//		times. The times must not go back. The writes of the future wait
+//		in the queue, which holds SANGRIA_SOUND_QUEUE_SIZE writes.
+// --------------------------------------------------------------------
+int sangria_sound_write_register_at( int chip, uint16_t address, uint8_t data, int64_t time );
+
 #ifdef __cplusplus
 }
 #endif
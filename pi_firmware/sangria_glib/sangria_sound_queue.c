@@ -0,0 +1,140 @@
+// --------------------------------------------------------------------
+// Sangria game library: sound register queue
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <string.h>
+#include "sangria_sound_queue.h"
+#include "psg_emulator.h"
+#include "scc_emulator.h"
+
+#ifndef SAMPLE_RATE
+#define SAMPLE_RATE		48000		//	Hz
+#endif
+
+#define NSEC			1000000000LL
+#define DRIFT_DIVISOR	16			//	a drift is pulled by 1/16 in each block
+
+// --------------------------------------------------------------------
+void sangria_sound_queue_initialize( SANGRIA_SOUND_QUEUE_T *p_queue ) {
+
+	memset( p_queue, 0, sizeof(SANGRIA_SOUND_QUEUE_T) );
+}
+
+// --------------------------------------------------------------------
+int sangria_sound_queue_put( SANGRIA_SOUND_QUEUE_T *p_queue, const SANGRIA_SOUND_WRITE_T *p_write ) {
+	uint32_t head, tail;
+
+	head = p_queue->head;
+	tail = __atomic_load_n( &p_queue->tail, __ATOMIC_ACQUIRE );
+	if( head - tail >= SANGRIA_SOUND_QUEUE_SIZE ) {
+		return 0;
+	}
+	p_queue->write[ head & (SANGRIA_SOUND_QUEUE_SIZE - 1) ] = *p_write;
+	//	the write is seen by the consumer after it is stored
+	__atomic_store_n( &p_queue->head, head + 1, __ATOMIC_RELEASE );
+	return 1;
+}
+
+// --------------------------------------------------------------------
+int sangria_sound_queue_get( SANGRIA_SOUND_QUEUE_T *p_queue, SANGRIA_SOUND_WRITE_T *p_write, int64_t end_time ) {
+	const SANGRIA_SOUND_WRITE_T *p;
+	uint32_t tail;
+
+	tail = p_queue->tail;
+	if( tail == __atomic_load_n( &p_queue->head, __ATOMIC_ACQUIRE ) ) {
+		return 0;
+	}
+	p = &p_queue->write[ tail & (SANGRIA_SOUND_QUEUE_SIZE - 1) ];
+	if( p->time >= end_time ) {
+		return 0;
+	}
+	*p_write = *p;
+	//	the slot is given back to the producer after it is read
+	__atomic_store_n( &p_queue->tail, tail + 1, __ATOMIC_RELEASE );
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static void _generate( const SANGRIA_SOUND_CHIP_T *p_chip, int chips, int offset, int samples ) {
+	int i;
+
+	for( i = 0; i < chips; i++ ) {
+		if( p_chip[i].type == SANGRIA_SOUND_TYPE_PSG ) {
+			psg_generate_wave( p_chip[i].handle, p_chip[i].pwave + offset, samples );
+		}
+		else {
+			scc_generate_wave( p_chip[i].handle, p_chip[i].pwave + offset, samples );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static void _write_register( const SANGRIA_SOUND_CHIP_T *p_chip, int chips, const SANGRIA_SOUND_WRITE_T *p_write ) {
+
+	if( p_write->chip >= chips ) {
+		return;
+	}
+	p_chip += p_write->chip;
+	if( p_chip->type == SANGRIA_SOUND_TYPE_PSG ) {
+		psg_write_register( p_chip->handle, p_write->address, p_write->data );
+	}
+	else {
+		scc_write_register( p_chip->handle, p_write->address, p_write->data );
+	}
+}
+
+// --------------------------------------------------------------------
+void sangria_sound_queue_render( SANGRIA_SOUND_QUEUE_T *p_queue, const SANGRIA_SOUND_CHIP_T *p_chip, int chips, int samples, int64_t now ) {
+	SANGRIA_SOUND_WRITE_T write;
+	int64_t block_nsec, end_time, drift, total;
+	int offset, position;
+
+	total		= (int64_t) samples * NSEC + p_queue->time_fraction;
+	block_nsec	= total / SAMPLE_RATE;
+	drift		= now - (p_queue->block_time + block_nsec);
+	if( p_queue->block_time == 0 || drift > SANGRIA_SOUND_MAX_DRIFT || drift < -SANGRIA_SOUND_MAX_DRIFT ) {
+		//	the first block, or after a pause of the audio device
+		p_queue->block_time = now - block_nsec;
+	}
+	else {
+		p_queue->block_time += drift / DRIFT_DIVISOR;
+	}
+	end_time = p_queue->block_time + block_nsec;
+
+	offset = 0;
+	while( sangria_sound_queue_get( p_queue, &write, end_time ) ) {
+		if( write.time > p_queue->block_time ) {
+			position = (int)( (write.time - p_queue->block_time) * SAMPLE_RATE / NSEC );
+			if( position > offset ) {
+				_generate( p_chip, chips, offset, position - offset );
+				offset = position;
+			}
+		}
+		_write_register( p_chip, chips, &write );
+	}
+	if( offset < samples ) {
+		_generate( p_chip, chips, offset, samples - offset );
+	}
+	p_queue->block_time		= end_time;
+	p_queue->time_fraction	= (uint32_t)( total % SAMPLE_RATE );
+}
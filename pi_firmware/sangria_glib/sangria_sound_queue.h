@@ -0,0 +1,142 @@
+// --------------------------------------------------------------------
+// Sangria game library: sound register queue
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	The registers of the sound chips are written by the game thread, and
+//	the waves are made in blocks by the audio thread. Each write is put
+//	in a single producer, single consumer queue with its time, and the
+//	audio thread splits the block at the time of each write, so a write
+//	is heard at its own sample, whenever the block is made.
+//
+//	A block ends at the time it is made: the time of the samples follows
+//	the sample clock of the audio device, and is pulled toward the time
+//	of the requests slowly (or at once after SANGRIA_SOUND_MAX_DRIFT), so
+//	the two clocks do not drift apart.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_SOUND_QUEUE_H__
+#define __SANGRIA_SOUND_QUEUE_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SANGRIA_SOUND_QUEUE_SIZE	1024					//	writes, a power of 2
+#define SANGRIA_SOUND_MAX_DRIFT		50000000				//	nsec
+
+#define SANGRIA_SOUND_TYPE_PSG		0
+#define SANGRIA_SOUND_TYPE_SCC		1
+
+// --------------------------------------------------------------------
+//	SANGRIA_SOUND_WRITE_T
+//	comment)
+//		time is nsec of CLOCK_MONOTONIC. chip is the index of the table
+//		given to sangria_sound_queue_render().
+// --------------------------------------------------------------------
+typedef struct {
+	int64_t		time;
+	uint16_t	address;
+	uint8_t		data;
+	uint8_t		chip;
+} SANGRIA_SOUND_WRITE_T;
+
+typedef struct {
+	SANGRIA_SOUND_WRITE_T	write[ SANGRIA_SOUND_QUEUE_SIZE ];
+	uint32_t	head;				//	next write to be put (only the producer changes it)
+	uint32_t	tail;				//	next write to be taken (only the consumer changes it)
+	int64_t		block_time;			//	time of the next sample, 0: not started
+	uint32_t	time_fraction;		//	nsec x SAMPLE_RATE under block_time
+} SANGRIA_SOUND_QUEUE_T;
+
+// --------------------------------------------------------------------
+//	SANGRIA_SOUND_CHIP_T
+//	comment)
+//		A sound chip of the block. The wave of the chip is written to pwave.
+// --------------------------------------------------------------------
+typedef struct {
+	int			type;				//	SANGRIA_SOUND_TYPE_xxx
+	void		*handle;			//	H_PSG_T or H_SCC_T
+	int16_t		*pwave;
+} SANGRIA_SOUND_CHIP_T;
+
+// --------------------------------------------------------------------
+//	sangria_sound_queue_initialize
+//	input)
+//		p_queue ...... queue to be cleared
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_sound_queue_initialize( SANGRIA_SOUND_QUEUE_T *p_queue );
+
+// --------------------------------------------------------------------
+//	sangria_sound_queue_put
+//	input)
+//		p_queue ...... queue
+//		p_write ...... a register write
+//	output)
+//		0 ...... Failed (The queue is full.)
+//		!0 ..... Success
+//	comment)
+//		Only one thread can put the writes, in the order of the time.
+//		A write older than the block being made is at its first sample.
+// --------------------------------------------------------------------
+int sangria_sound_queue_put( SANGRIA_SOUND_QUEUE_T *p_queue, const SANGRIA_SOUND_WRITE_T *p_write );
+
+// --------------------------------------------------------------------
+//	sangria_sound_queue_get
+//	input)
+//		p_queue ...... queue
+//		p_write ...... the oldest write is stored
+//		end_time ..... a write at this time or later is not taken
+//	output)
+//		0 ...... No write before end_time
+//		!0 ..... Success
+//	comment)
+//		Only one thread can take the writes (sangria_sound_queue_render()
+//		takes them).
+// --------------------------------------------------------------------
+int sangria_sound_queue_get( SANGRIA_SOUND_QUEUE_T *p_queue, SANGRIA_SOUND_WRITE_T *p_write, int64_t end_time );
+
+// --------------------------------------------------------------------
+//	sangria_sound_queue_render
+//	input)
+//		p_queue ...... queue
+//		p_chip ....... sound chips
+//		chips ........ number of the sound chips
+//		samples ...... samples of the block
+//		now .......... time of the request (nsec of CLOCK_MONOTONIC)
+//	output)
+//		none
+//	comment)
+//		Makes the waves of the block, with the writes up to the end of
+//		the block. The later writes are left for the next blocks. Only
+//		one thread can call it.
+// --------------------------------------------------------------------
+void sangria_sound_queue_render( SANGRIA_SOUND_QUEUE_T *p_queue, const SANGRIA_SOUND_CHIP_T *p_chip, int chips, int samples, int64_t now );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
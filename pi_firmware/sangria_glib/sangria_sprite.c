@@ -0,0 +1,376 @@
+// --------------------------------------------------------------------
+// Sangria game library: sprite batch
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "sangria_sprite.h"
+#include "sangria_glib_1bpp.h"
+#include "sangria_glib_8bpp.h"
+
+#define MAX_COVERS		2			//	opaque sprites checked for hiding the others
+#define PRIORITY_RANGE	256			//	priorities sorted by counting, qsort() for a wider range
+
+typedef struct {
+	int			top;
+	int			bottom;
+	int			left;
+	int			right;
+} RECT_T;
+
+typedef struct {
+	SANGRIA_BACKBUFFER_T	*p_src_image;
+	int			sx;
+	int			sy;
+	int			width;
+	int			height;
+	int			dx;
+	int			dy;
+	int			attribute;
+	int			priority;
+	int			order;
+	RECT_T		area;			//	visible area on the destination
+} SPRITE_T;
+
+typedef struct {
+	int			max_sprites;
+	int			sprites;
+	SPRITE_T	*p_sprite;
+	//	priorities of the queued sprites
+	int			is_sorted;
+	int			min_priority;
+	int			max_priority;
+	//	visible sprites in the order of drawing
+	SPRITE_T	**pp_sorted;
+	SPRITE_T	**pp_work;
+	uint8_t		*p_hidden;
+} SPRITE_BATCH_T;
+
+// --------------------------------------------------------------------
+static int _compare( const void *p1, const void *p2 ) {
+	const SPRITE_T *p_a = *(SPRITE_T* const*) p1;
+	const SPRITE_T *p_b = *(SPRITE_T* const*) p2;
+
+	if( p_a->priority != p_b->priority ) {
+		return (p_a->priority < p_b->priority) ? -1 : 1;
+	}
+	return p_a->order - p_b->order;
+}
+
+// --------------------------------------------------------------------
+//	Area of the sprite on p_dest_image.
+//
+static int _get_rect( const SPRITE_T *p, const SANGRIA_BACKBUFFER_T *p_dest_image, RECT_T *p_rect ) {
+
+	p_rect->top		= (p->dy > 0) ? p->dy : 0;
+	p_rect->bottom	= (p->dy + p->height - 1 < p_dest_image->height - 1) ? p->dy + p->height - 1 : p_dest_image->height - 1;
+	p_rect->left	= (p->dx > 0) ? p->dx : 0;
+	p_rect->right	= (p->dx + p->width - 1 < p_dest_image->width - 1) ? p->dx + p->width - 1 : p_dest_image->width - 1;
+	return (p_rect->top <= p_rect->bottom) && (p_rect->left <= p_rect->right);
+}
+
+// --------------------------------------------------------------------
+static inline int _is_inside_source( const SPRITE_T *p ) {
+
+	return p->sx >= 0 && p->sy >= 0 && p->sx + p->width <= p->p_src_image->width && p->sy + p->height <= p->p_src_image->height;
+}
+
+// --------------------------------------------------------------------
+//	An opaque sprite hides everything under it, unless a part of it is
+//	outside of its source image.
+//
+static int _is_cover( const SPRITE_T *p ) {
+
+	return (p->attribute & SANGRIA_SPRITE_OPAQUE) && _is_inside_source( p );
+}
+
+// --------------------------------------------------------------------
+//	without branches, it is checked for most sprites
+//
+static inline int _is_inside( const RECT_T *p_inner, const RECT_T *p_outer ) {
+
+	return (p_inner->top >= p_outer->top) & (p_inner->bottom <= p_outer->bottom) &
+		(p_inner->left >= p_outer->left) & (p_inner->right <= p_outer->right);
+}
+
+// --------------------------------------------------------------------
+static inline int _get_area( const RECT_T *p_rect ) {
+
+	return (p_rect->right - p_rect->left + 1) * (p_rect->bottom - p_rect->top + 1);
+}
+
+// --------------------------------------------------------------------
+//	Stable counting sort of pp_sorted[0 ... n-1] by priority. p_count[]
+//	has the number of sprites of each priority, from min_priority, at
+//	p_count[1 ... range].
+//
+static void _sort_by_counting( SPRITE_BATCH_T *p_batch, int n, int *p_count, int range ) {
+	SPRITE_T **pp;
+	int i;
+
+	for( i = 0; i < range; i++ ) {
+		p_count[ i + 1 ] += p_count[i];
+	}
+	for( i = 0; i < n; i++ ) {
+		p_batch->pp_work[ p_count[ p_batch->pp_sorted[i]->priority - p_batch->min_priority ]++ ] = p_batch->pp_sorted[i];
+	}
+	pp					= p_batch->pp_sorted;
+	p_batch->pp_sorted	= p_batch->pp_work;
+	p_batch->pp_work	= pp;
+}
+
+// --------------------------------------------------------------------
+//	From the top most sprite: hidden by an opaque one above it?
+//	p_drawn is set to the lines of the sprites to be drawn.
+//
+static void _find_hidden( SPRITE_BATCH_T *p_batch, int n, RECT_T *p_drawn ) {
+	SPRITE_T *p;
+	RECT_T cover[ MAX_COVERS ];
+	int i, j, covers, smallest, area, cover_area[ MAX_COVERS ], is_hidden;
+
+	p_drawn->top	= INT32_MAX;
+	p_drawn->bottom	= -1;
+	covers = 0;
+	for( i = n - 1; i >= 0; i-- ) {
+		p = p_batch->pp_sorted[i];
+		is_hidden = 0;
+		for( j = 0; j < covers; j++ ) {
+			if( _is_inside( &p->area, &cover[j] ) ) {
+				is_hidden = 1;
+				break;
+			}
+		}
+		p_batch->p_hidden[i] = is_hidden;
+		if( is_hidden ) {
+			continue;
+		}
+		if( p_drawn->top > p->area.top ) {
+			p_drawn->top = p->area.top;
+		}
+		if( p_drawn->bottom < p->area.bottom ) {
+			p_drawn->bottom = p->area.bottom;
+		}
+		if( !_is_cover( p ) ) {
+			continue;
+		}
+		area = _get_area( &p->area );
+		if( covers < MAX_COVERS ) {
+			cover_area[ covers ]	= area;
+			cover[ covers++ ]		= p->area;
+			continue;
+		}
+		//	Only the largest ones are kept, small tiles rarely hide a sprite.
+		smallest = 0;
+		for( j = 1; j < MAX_COVERS; j++ ) {
+			if( cover_area[j] < cover_area[ smallest ] ) {
+				smallest = j;
+			}
+		}
+		if( cover_area[ smallest ] < area ) {
+			cover_area[ smallest ]	= area;
+			cover[ smallest ]		= p->area;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	The visible area of the sprite, as sangria_copy() of the whole sprite
+//	draws it. The area is already clipped, so a sprite inside of its
+//	source is drawn line by line like sangria_tilemap does; the others
+//	(and mirrored 1bpp ones) go through sangria_copy().
+//	p_dest_image is marked dirty by the caller.
+//
+static void _draw( const SPRITE_T *p, SANGRIA_BACKBUFFER_T *p_dest_image ) {
+	SANGRIA_BACKBUFFER_T *p_src_image = p->p_src_image;
+	int sx, sy, sx2, sy2, vx, vy, y, width, is_opaque;
+	const uint8_t *p_src;
+	uint8_t *p_dest;
+
+	vx			= (p->attribute & SANGRIA_SPRITE_FLIP_H) ? -1 : 1;
+	vy			= (p->attribute & SANGRIA_SPRITE_FLIP_V) ? -1 : 1;
+	sx			= (vx > 0) ? p->sx + (p->area.left - p->dx) : p->sx + p->width  - 1 - (p->area.left - p->dx);
+	sy			= (vy > 0) ? p->sy + (p->area.top  - p->dy) : p->sy + p->height - 1 - (p->area.top  - p->dy);
+	width		= p->area.right - p->area.left + 1;
+	is_opaque	= p->attribute & SANGRIA_SPRITE_OPAQUE;
+	if( _is_inside_source( p ) && p_src_image->format == SANGRIA_FORMAT_8BPP && p_dest_image->format == SANGRIA_FORMAT_8BPP ) {
+		p_src	= p_src_image->image  + sx + sy * p_src_image->width;
+		p_dest	= p_dest_image->image + p->area.left + p->area.top * p_dest_image->width;
+		for( y = p->area.top; y <= p->area.bottom; y++ ) {
+			if( is_opaque ) {
+				sangria_8bpp_copy_line_opaque( p_src, p_dest, width, vx );
+			}
+			else {
+				sangria_8bpp_copy_line( p_src, p_dest, width, vx );
+			}
+			p_src	+= p_src_image->width * vy;
+			p_dest	+= p_dest_image->width;
+		}
+		return;
+	}
+	if( _is_inside_source( p ) && p_src_image->format == SANGRIA_FORMAT_1BPP && p_dest_image->format == SANGRIA_FORMAT_1BPP && vx > 0 ) {
+		for( y = p->area.top; y <= p->area.bottom; y++ ) {
+			sangria_1bpp_copy_line( p_src_image, sx, sy, p_dest_image, p->area.left, y, width, is_opaque );
+			sy += vy;
+		}
+		return;
+	}
+	sx2 = sx + (width - 1) * vx;
+	sy2 = sy + (p->area.bottom - p->area.top) * vy;
+	if( is_opaque ) {
+		sangria_copy_opaque( p_src_image, sx, sy, sx2, sy2, p_dest_image, p->area.left, p->area.top );
+	}
+	else {
+		sangria_copy( p_src_image, sx, sy, sx2, sy2, p_dest_image, p->area.left, p->area.top );
+	}
+}
+
+// --------------------------------------------------------------------
+H_SANGRIA_SPRITE_T sangria_sprite_initialize( int max_sprites ) {
+	SPRITE_BATCH_T *p_batch;
+
+	p_batch = (SPRITE_BATCH_T*) calloc( 1, sizeof(SPRITE_BATCH_T) );
+	if( p_batch == NULL ) {
+		return NULL;
+	}
+	p_batch->max_sprites	= max_sprites;
+	p_batch->p_sprite		= (SPRITE_T*) malloc( sizeof(SPRITE_T) * max_sprites );
+	p_batch->pp_sorted		= (SPRITE_T**) malloc( sizeof(SPRITE_T*) * max_sprites );
+	p_batch->pp_work		= (SPRITE_T**) malloc( sizeof(SPRITE_T*) * max_sprites );
+	p_batch->p_hidden		= (uint8_t*) malloc( max_sprites );
+	if( p_batch->p_sprite == NULL || p_batch->pp_sorted == NULL || p_batch->pp_work == NULL || p_batch->p_hidden == NULL ) {
+		sangria_sprite_terminate( p_batch );
+		return NULL;
+	}
+	return p_batch;
+}
+
+// --------------------------------------------------------------------
+void sangria_sprite_terminate( H_SANGRIA_SPRITE_T hsprite ) {
+	SPRITE_BATCH_T *p_batch = (SPRITE_BATCH_T*) hsprite;
+
+	if( p_batch == NULL ) {
+		return;
+	}
+	free( p_batch->p_sprite );
+	free( p_batch->pp_sorted );
+	free( p_batch->pp_work );
+	free( p_batch->p_hidden );
+	free( p_batch );
+}
+
+// --------------------------------------------------------------------
+void sangria_sprite_clear( H_SANGRIA_SPRITE_T hsprite ) {
+	SPRITE_BATCH_T *p_batch = (SPRITE_BATCH_T*) hsprite;
+
+	p_batch->sprites = 0;
+}
+
+// --------------------------------------------------------------------
+int sangria_sprite_put( H_SANGRIA_SPRITE_T hsprite, SANGRIA_BACKBUFFER_T *p_src_image, int sx, int sy, int width, int height,
+	int dx, int dy, int attribute, int priority ) {
+	SPRITE_BATCH_T *p_batch = (SPRITE_BATCH_T*) hsprite;
+	SPRITE_T *p;
+
+	if( p_batch->sprites >= p_batch->max_sprites ) {
+		return 0;
+	}
+	if( width <= 0 || height <= 0 ) {
+		//	nothing to draw
+		return 1;
+	}
+	if( p_batch->sprites == 0 ) {
+		p_batch->is_sorted		= 1;
+		p_batch->min_priority	= priority;
+		p_batch->max_priority	= priority;
+	}
+	else {
+		if( p_batch->p_sprite[ p_batch->sprites - 1 ].priority > priority ) {
+			p_batch->is_sorted = 0;
+		}
+		if( p_batch->min_priority > priority ) {
+			p_batch->min_priority = priority;
+		}
+		if( p_batch->max_priority < priority ) {
+			p_batch->max_priority = priority;
+		}
+	}
+	p = &p_batch->p_sprite[ p_batch->sprites ];
+	p->p_src_image	= p_src_image;
+	p->sx			= sx;
+	p->sy			= sy;
+	p->width		= width;
+	p->height		= height;
+	p->dx			= dx;
+	p->dy			= dy;
+	p->attribute	= attribute;
+	p->priority		= priority;
+	p->order		= p_batch->sprites;
+	p_batch->sprites++;
+	return 1;
+}
+
+// --------------------------------------------------------------------
+void sangria_sprite_render( H_SANGRIA_SPRITE_T hsprite, SANGRIA_BACKBUFFER_T *p_dest_image ) {
+	SPRITE_BATCH_T *p_batch = (SPRITE_BATCH_T*) hsprite;
+	int count[ PRIORITY_RANGE + 1 ];
+	SPRITE_T *p;
+	RECT_T drawn;
+	int i, n, range, is_counting;
+
+	//	visible sprites, and the number of them for each priority
+	range		= p_batch->max_priority - p_batch->min_priority + 1;
+	is_counting	= !p_batch->is_sorted && range > 0 && range <= PRIORITY_RANGE;
+	if( is_counting ) {
+		memset( count, 0, sizeof(int) * (range + 1) );
+	}
+	n = 0;
+	for( i = 0; i < p_batch->sprites; i++ ) {
+		p = &p_batch->p_sprite[i];
+		if( _get_rect( p, p_dest_image, &p->area ) ) {
+			p_batch->pp_sorted[ n++ ] = p;
+			if( is_counting ) {
+				count[ p->priority - p_batch->min_priority + 1 ]++;
+			}
+		}
+	}
+	//	in the order of drawing
+	if( is_counting ) {
+		_sort_by_counting( p_batch, n, count, range );
+	}
+	else if( !p_batch->is_sorted ) {
+		qsort( p_batch->pp_sorted, n, sizeof(SPRITE_T*), _compare );
+	}
+
+	//	Each sprite is clipped once above, and drawn in one go.
+	_find_hidden( p_batch, n, &drawn );
+	if( drawn.top > drawn.bottom ) {
+		return;
+	}
+	sangria_mark_dirty( p_dest_image, drawn.top, drawn.bottom );
+	for( i = 0; i < n; i++ ) {
+		if( !p_batch->p_hidden[i] ) {
+			_draw( p_batch->pp_sorted[i], p_dest_image );
+		}
+	}
+}
@@ -0,0 +1,128 @@
+// --------------------------------------------------------------------
+// Sangria game library: sprite batch
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	A queue of the sprites of a frame, drawn in the order of priority
+//	whatever the order of sangria_sprite_put(). Each sprite is clipped
+//	once, and a sprite hidden behind one of the two largest opaque
+//	sprites of a higher priority is not drawn.
+//
+//	This is not a faster way to draw. test/sprite_bench draws 633
+//	sprites at about the speed of sangria_copy() of each sprite already
+//	in order: 2-4% slower in 8bpp, a few % faster in 1bpp. Drawing by
+//	bands of lines was tried and was slower, so it is not done.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_SPRITE_H__
+#define __SANGRIA_SPRITE_H__
+
+#include "sangria_glib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void *H_SANGRIA_SPRITE_T;
+
+// --------------------------------------------------------------------
+//	SANGRIA_SPRITE_ATTRIBUTE_T
+// --------------------------------------------------------------------
+typedef enum {
+	SANGRIA_SPRITE_NORMAL	= 0,
+	SANGRIA_SPRITE_FLIP_H	= 1,		//	mirrored horizontally
+	SANGRIA_SPRITE_FLIP_V	= 2,		//	mirrored vertically
+	SANGRIA_SPRITE_OPAQUE	= 4,		//	pixels of value 0 are drawn too (tiles, panels)
+} SANGRIA_SPRITE_ATTRIBUTE_T;
+
+// --------------------------------------------------------------------
+//	sangria_sprite_initialize()
+//	input)
+//		max_sprites .... maximum number of sprites in a frame
+//	output)
+//		NULL ........... failed (not enough memory)
+//		others ......... H_SANGRIA_SPRITE_T instance
+// --------------------------------------------------------------------
+H_SANGRIA_SPRITE_T sangria_sprite_initialize( int max_sprites );
+
+// --------------------------------------------------------------------
+//	sangria_sprite_terminate()
+//	input)
+//		hsprite ........ H_SANGRIA_SPRITE_T instance
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_sprite_terminate( H_SANGRIA_SPRITE_T hsprite );
+
+// --------------------------------------------------------------------
+//	sangria_sprite_clear()
+//	input)
+//		hsprite ........ H_SANGRIA_SPRITE_T instance
+//	output)
+//		none
+//	comment)
+//		Removes all queued sprites. sangria_sprite_render() does not
+//		remove them, so a static scene can be drawn again.
+// --------------------------------------------------------------------
+void sangria_sprite_clear( H_SANGRIA_SPRITE_T hsprite );
+
+// --------------------------------------------------------------------
+//	sangria_sprite_put()
+//	input)
+//		hsprite ........ H_SANGRIA_SPRITE_T instance
+//		p_src_image .... source backbuffer pointer
+//		sx ............. left of the sprite on source
+//		sy ............. top of the sprite on source
+//		width .......... width of the sprite
+//		height ......... height of the sprite
+//		dx ............. left X position on destination
+//		dy ............. top Y position on destination
+//		attribute ...... OR of SANGRIA_SPRITE_ATTRIBUTE_T
+//		priority ....... larger one is drawn over smaller one
+//	output)
+//		0 .............. failed (max_sprites are already queued)
+//		!0 ............. success
+//	comment)
+//		Only the pointer of p_src_image is kept, so it must be alive
+//		until sangria_sprite_render(). Sprites of the same priority are
+//		drawn in the order of sangria_sprite_put().
+// --------------------------------------------------------------------
+int sangria_sprite_put( H_SANGRIA_SPRITE_T hsprite, SANGRIA_BACKBUFFER_T *p_src_image, int sx, int sy, int width, int height,
+	int dx, int dy, int attribute, int priority );
+
+// --------------------------------------------------------------------
+//	sangria_sprite_render()
+//	input)
+//		hsprite ........ H_SANGRIA_SPRITE_T instance
+//		p_dest_image ... destination backbuffer pointer
+//	output)
+//		none
+//	comment)
+//		Same result as sangria_copy() (or sangria_copy_opaque() for
+//		SANGRIA_SPRITE_OPAQUE) of each sprite in the order of priority.
+// --------------------------------------------------------------------
+void sangria_sprite_render( H_SANGRIA_SPRITE_T hsprite, SANGRIA_BACKBUFFER_T *p_dest_image );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,497 @@
+// --------------------------------------------------------------------
+// Sangria game library: bitmap font text
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include "sangria_text.h"
+#include "sangria_glib_1bpp.h"
+#include "sangria_glib_8bpp.h"
+
+#define DIRECT_CODES		0x800		//	U+0000 ... U+07FF are in the table
+#define NO_GLYPH			0xFFFF
+#define MAX_GLYPHS			NO_GLYPH
+#define BATCH				256			//	glyphs decoded at a time
+
+typedef struct {
+	const SANGRIA_FONT_T	*p_font;
+	SANGRIA_FORMAT_T	format;
+	int			cell_width;
+	int			height;
+	int			is_opaque;				//	both colors are not transparent
+	uint16_t	replacement;			//	glyph of broken and unknown codes
+	uint16_t	direct[ DIRECT_CODES ];
+	uint8_t		*p_width;				//	advance, cell_width or less
+	//	8bpp: height lines of cell_width pixels for each glyph
+	//	1bpp: height pairs of pixel bits and mask bits, bit31 is the left pixel
+	uint8_t		*p_pixels;
+	uint32_t	*p_bits;
+} TEXT_T;
+
+// --------------------------------------------------------------------
+//	-1: not found
+//
+static int _search( const SANGRIA_FONT_T *p_font, uint32_t code ) {
+	int low, high, mid;
+
+	low		= 0;
+	high	= p_font->glyphs - 1;
+	while( low <= high ) {
+		mid = (low + high) >> 1;
+		if( p_font->p_code[ mid ] == code ) {
+			return mid;
+		}
+		if( p_font->p_code[ mid ] < code ) {
+			low = mid + 1;
+		}
+		else {
+			high = mid - 1;
+		}
+	}
+	return -1;
+}
+
+// --------------------------------------------------------------------
+static inline uint16_t _lookup( TEXT_T *p, int32_t code ) {
+	int g;
+
+	if( code < 0 ) {
+		return p->replacement;
+	}
+	if( code < DIRECT_CODES ) {
+		return p->direct[ code ];
+	}
+	g = _search( p->p_font, code );
+	return (g < 0) ? p->replacement : (uint16_t) g;
+}
+
+// --------------------------------------------------------------------
+//	One code point, -1: broken sequence. The bytes up to the first one
+//	that cannot continue the sequence are consumed.
+//
+static int32_t _decode_utf8( const uint8_t **pp ) {
+	const uint8_t *p = *pp;
+	uint32_t code, min;
+	int n, i;
+
+	code = *(p++);
+	if( code < 0x80 ) {
+		*pp = p;
+		return code;
+	}
+	if( code >= 0xC2 && code < 0xE0 ) {
+		n		= 1;
+		code	&= 0x1F;
+		min		= 0x80;
+	}
+	else if( code >= 0xE0 && code < 0xF0 ) {
+		n		= 2;
+		code	&= 0x0F;
+		min		= 0x800;
+	}
+	else if( code >= 0xF0 && code < 0xF5 ) {
+		n		= 3;
+		code	&= 0x07;
+		min		= 0x10000;
+	}
+	else {
+		*pp = p;
+		return -1;
+	}
+	for( i = 0; i < n; i++ ) {
+		if( (*p & 0xC0) != 0x80 ) {
+			*pp = p;
+			return -1;
+		}
+		code = (code << 6) | (*(p++) & 0x3F);
+	}
+	*pp = p;
+	if( code < min || code > 0x10FFFF || (code >= 0xD800 && code < 0xE000) ) {
+		return -1;
+	}
+	return code;
+}
+
+// --------------------------------------------------------------------
+//	Glyphs up to '\n' or the end of the string, BATCH at most.
+//
+static int _decode_run( TEXT_T *p, const uint8_t **pp, uint16_t *p_glyph ) {
+	uint16_t g;
+	int n;
+
+	n = 0;
+	while( n < BATCH && **pp != '\0' && **pp != '\n' ) {
+		g = _lookup( p, _decode_utf8( pp ) );
+		if( g != NO_GLYPH ) {
+			p_glyph[ n++ ] = g;
+		}
+	}
+	return n;
+}
+
+// --------------------------------------------------------------------
+static int _check_font( const SANGRIA_FONT_T *p_font ) {
+	int i;
+
+	if( p_font == NULL || p_font->cell_width < 1 || p_font->cell_width > SANGRIA_TEXT_MAX_WIDTH ||
+		p_font->height < 1 || p_font->glyphs < 1 || p_font->glyphs > MAX_GLYPHS ) {
+		return 0;
+	}
+	for( i = 1; i < p_font->glyphs; i++ ) {
+		if( p_font->p_code[ i - 1 ] >= p_font->p_code[i] ) {
+			return 0;
+		}
+	}
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static void _release( TEXT_T *p ) {
+
+	free( p->p_width );
+	free( p->p_pixels );
+	free( p->p_bits );
+	free( p );
+}
+
+// --------------------------------------------------------------------
+H_SANGRIA_TEXT_T sangria_text_initialize( const SANGRIA_FONT_T *p_font, SANGRIA_FORMAT_T format, uint8_t c, uint8_t background ) {
+	TEXT_T *p;
+	size_t lines;
+	int i, g;
+
+	if( !_check_font( p_font ) || (format != SANGRIA_FORMAT_8BPP && format != SANGRIA_FORMAT_1BPP) ) {
+		return NULL;
+	}
+	p = (TEXT_T*) calloc( 1, sizeof(TEXT_T) );
+	if( p == NULL ) {
+		return NULL;
+	}
+	p->p_font		= p_font;
+	p->format		= format;
+	p->cell_width	= p_font->cell_width;
+	p->height		= p_font->height;
+	lines			= (size_t) p_font->glyphs * p_font->height;
+	p->p_width		= (uint8_t*) malloc( p_font->glyphs );
+	if( format == SANGRIA_FORMAT_8BPP ) {
+		p->p_pixels	= (uint8_t*) malloc( lines * p->cell_width );
+	}
+	else {
+		p->p_bits	= (uint32_t*) malloc( lines * 2 * sizeof(uint32_t) );
+	}
+	if( p->p_width == NULL || (p->p_pixels == NULL && p->p_bits == NULL) ) {
+		_release( p );
+		return NULL;
+	}
+	for( i = 0; i < p_font->glyphs; i++ ) {
+		p->p_width[i] = (p_font->p_width[i] < p->cell_width) ? p_font->p_width[i] : p->cell_width;
+	}
+	g = _search( p_font, 0xFFFD );
+	if( g < 0 ) {
+		g = _search( p_font, '?' );
+	}
+	p->replacement = (g < 0) ? NO_GLYPH : (uint16_t) g;
+	for( i = 0; i < DIRECT_CODES; i++ ) {
+		p->direct[i] = p->replacement;
+	}
+	for( i = 0; i < p_font->glyphs && p_font->p_code[i] < DIRECT_CODES; i++ ) {
+		p->direct[ p_font->p_code[i] ] = (uint16_t) i;
+	}
+	sangria_text_set_color( p, c, background );
+	return p;
+}
+
+// --------------------------------------------------------------------
+void sangria_text_terminate( H_SANGRIA_TEXT_T htext ) {
+
+	if( htext == NULL ) {
+		return;
+	}
+	_release( (TEXT_T*) htext );
+}
+
+// --------------------------------------------------------------------
+void sangria_text_set_color( H_SANGRIA_TEXT_T htext, uint8_t c, uint8_t background ) {
+	TEXT_T *p = (TEXT_T*) htext;
+	const uint8_t *p_src;
+	uint8_t *p_pixel;
+	uint32_t *p_bits, d, w_mask, c_bits, b_bits;
+	int g, y, x, i, w, stride;
+
+	stride			= (p->cell_width + 7) >> 3;
+	p_src			= p->p_font->p_bitmap;
+	p_pixel			= p->p_pixels;
+	p_bits			= p->p_bits;
+	p->is_opaque	= (c != 0 && background != 0);
+	//	1bpp: 0xFFFFFFFF for a pixel bit 1 (pixel value 1 ... 127)
+	c_bits			= (c != 0 && c < 128) ? 0xFFFFFFFF : 0;
+	b_bits			= (background != 0 && background < 128) ? 0xFFFFFFFF : 0;
+	for( g = 0; g < p->p_font->glyphs; g++ ) {
+		w		= p->p_width[g];
+		w_mask	= w ? (0xFFFFFFFF << (32 - w)) : 0;
+		for( y = 0; y < p->height; y++ ) {
+			d = 0;
+			for( i = 0; i < stride; i++ ) {
+				d |= (uint32_t) *(p_src++) << (24 - 8 * i);
+			}
+			d &= w_mask;
+			if( p_pixel != NULL ) {
+				for( x = 0; x < p->cell_width; x++ ) {
+					*(p_pixel++) = (x >= w) ? 0 : ((d & (0x80000000 >> x)) ? c : background);
+				}
+			}
+			else {
+				*(p_bits++) = (d & c_bits) | (~d & w_mask & b_bits);
+				*(p_bits++) = (c ? d : 0) | (background ? (~d & w_mask) : 0);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	n pixels from x, clipped to the line.
+//
+static inline void _write_1bpp( SANGRIA_BACKBUFFER_T *p_image, int x, int y, int n, uint32_t d, uint32_t m ) {
+
+	if( x < 0 ) {
+		if( x + n <= 0 ) {
+			return;
+		}
+		d <<= -x;
+		m <<= -x;
+		n += x;
+		x = 0;
+	}
+	if( x + n > p_image->width ) {
+		n = p_image->width - x;
+		if( n <= 0 ) {
+			return;
+		}
+		m &= 0xFFFFFFFF << (32 - n);
+	}
+	if( m != 0 ) {
+		sangria_1bpp_write_pixels( p_image, x, y, n, d, m );
+	}
+}
+
+// --------------------------------------------------------------------
+//	The glyphs first ... last from x, clipped: the lines of the glyphs
+//	are packed into 32 pixels and written at once.
+//
+static void _draw_1bpp( TEXT_T *p, SANGRIA_BACKBUFFER_T *p_image, int x, int y, const uint16_t *p_glyph, int first, int last, int r1, int r2 ) {
+	const uint32_t *p_bits;
+	uint64_t d, m;
+	int r, i, n, pos;
+
+	for( r = r1; r <= r2; r++ ) {
+		d	= 0;
+		m	= 0;
+		n	= 0;
+		pos	= x;
+		for( i = first; i <= last; i++ ) {
+			p_bits = p->p_bits + ((size_t) p_glyph[i] * p->height + r) * 2;
+			d |= (uint64_t) p_bits[0] << (32 - n);
+			m |= (uint64_t) p_bits[1] << (32 - n);
+			n += p->p_width[ p_glyph[i] ];
+			if( n >= 32 ) {
+				_write_1bpp( p_image, pos, y + r, 32, (uint32_t)( d >> 32 ), (uint32_t)( m >> 32 ) );
+				d	<<= 32;
+				m	<<= 32;
+				n	-= 32;
+				pos	+= 32;
+			}
+		}
+		if( n > 0 ) {
+			_write_1bpp( p_image, pos, y + r, n, (uint32_t)( d >> 32 ), (uint32_t)( m >> 32 ) );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	The glyphs inside of the back buffer in X: the lines are packed into
+//	bytes from the byte of x, and the bytes of both planes are written.
+//
+static void _draw_1bpp_inside( TEXT_T *p, SANGRIA_BACKBUFFER_T *p_image, int x, int y, const uint16_t *p_glyph, int first, int last, int r1, int r2 ) {
+	const uint32_t *p_bits[ BATCH ];
+	const uint8_t *p_width = p->p_width;
+	uint8_t *p_pixel, *p_mask, bm;
+	uint64_t d, m;
+	int r, i, n, stride, plane;
+
+	//	the stores to the planes may alias p, so everything is in locals
+	for( i = first; i <= last; i++ ) {
+		p_bits[i] = p->p_bits + ((size_t) p_glyph[i] * p->height + r1) * 2;
+	}
+	stride	= sangria_1bpp_stride( p_image->width );
+	plane	= stride * p_image->height;
+	for( r = r1; r <= r2; r++ ) {
+		p_pixel	= p_image->image + (y + r) * stride + (x >> 3);
+		p_mask	= p_pixel + plane;
+		d		= 0;
+		m		= 0;
+		n		= x & 7;
+		for( i = first; i <= last; i++ ) {
+			d |= (uint64_t) p_bits[i][0] << (32 - n);
+			m |= (uint64_t) p_bits[i][1] << (32 - n);
+			p_bits[i] += 2;
+			n += p_width[ p_glyph[i] ];
+			for( ; n >= 8; n -= 8 ) {
+				bm = (uint8_t)( m >> 56 );
+				*p_pixel = (*p_pixel & ~bm) | ((uint8_t)( d >> 56 ) & bm);
+				*p_mask |= bm;
+				p_pixel++;
+				p_mask++;
+				d <<= 8;
+				m <<= 8;
+			}
+		}
+		if( n > 0 ) {
+			bm = (uint8_t)( m >> 56 );
+			*p_pixel = (*p_pixel & ~bm) | ((uint8_t)( d >> 56 ) & bm);
+			*p_mask |= bm;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static void _draw_8bpp( TEXT_T *p, SANGRIA_BACKBUFFER_T *p_image, int x, int y, const uint16_t *p_glyph, int first, int last, int r1, int r2 ) {
+	const uint8_t *p_src;
+	uint8_t *p_dest;
+	int r, i, k, w, s, n, cell_width, is_opaque;
+
+	cell_width	= p->cell_width;
+	is_opaque	= p->is_opaque;
+	for( i = first; i <= last; i++ ) {
+		w		= p->p_width[ p_glyph[i] ];
+		s		= (x < 0) ? -x : 0;
+		n		= ((x + w > p_image->width) ? p_image->width - x : w) - s;
+		p_src	= p->p_pixels + ((size_t) p_glyph[i] * p->height + r1) * cell_width + s;
+		p_dest	= p_image->image + (y + r1) * p_image->width + x + s;
+		for( r = r1; r <= r2; r++ ) {
+			if( is_opaque ) {
+				for( k = 0; k + 8 <= n; k += 8 ) {
+					memcpy( p_dest + k, p_src + k, 8 );
+				}
+				for( ; k < n; k++ ) {
+					p_dest[k] = p_src[k];
+				}
+			}
+			else {
+				sangria_8bpp_copy_line( p_src, p_dest, n, 1 );
+			}
+			p_src	+= cell_width;
+			p_dest	+= p_image->width;
+		}
+		x += w;
+	}
+}
+
+// --------------------------------------------------------------------
+//	Draws a run of glyphs on a line, and returns X after it.
+//
+static int _draw_run( TEXT_T *p, SANGRIA_BACKBUFFER_T *p_image, int x, int y, const uint16_t *p_glyph, int n ) {
+	int i, first, last, first_x, last_x, r1, r2;
+
+	//	the glyphs inside of the back buffer in X, first_x ... last_x - 1
+	first	= n;
+	last	= -1;
+	first_x	= x;
+	last_x	= x;
+	for( i = 0; i < n; i++ ) {
+		if( first == n && x + p->p_width[ p_glyph[i] ] > 0 ) {
+			first	= i;
+			first_x	= x;
+		}
+		if( x < p_image->width ) {
+			last	= i;
+			last_x	= x + p->p_width[ p_glyph[i] ];
+		}
+		x += p->p_width[ p_glyph[i] ];
+	}
+	r1 = (y < 0) ? -y : 0;
+	r2 = (y + p->height > p_image->height) ? p_image->height - y - 1 : p->height - 1;
+	if( first > last || r1 > r2 ) {
+		return x;
+	}
+	sangria_mark_dirty( p_image, y + r1, y + r2 );
+	if( p->format == SANGRIA_FORMAT_1BPP && first_x >= 0 && last_x <= p_image->width ) {
+		_draw_1bpp_inside( p, p_image, first_x, y, p_glyph, first, last, r1, r2 );
+	}
+	else if( p->format == SANGRIA_FORMAT_1BPP ) {
+		_draw_1bpp( p, p_image, first_x, y, p_glyph, first, last, r1, r2 );
+	}
+	else {
+		_draw_8bpp( p, p_image, first_x, y, p_glyph, first, last, r1, r2 );
+	}
+	return x;
+}
+
+// --------------------------------------------------------------------
+int sangria_text_draw( H_SANGRIA_TEXT_T htext, SANGRIA_BACKBUFFER_T *p_image, int x, int y, const char *p_text ) {
+	TEXT_T *p = (TEXT_T*) htext;
+	const uint8_t *p_char = (const uint8_t*) p_text;
+	uint16_t glyph[ BATCH ];
+	int left, n;
+
+	if( p_image == NULL || p_image->format != (int32_t) p->format ) {
+		return x;
+	}
+	left = x;
+	while( *p_char != '\0' ) {
+		if( *p_char == '\n' ) {
+			p_char++;
+			x = left;
+			y += p->height;
+			continue;
+		}
+		n = _decode_run( p, &p_char, glyph );
+		x = _draw_run( p, p_image, x, y, glyph, n );
+	}
+	return x;
+}
+
+// --------------------------------------------------------------------
+int sangria_text_width( H_SANGRIA_TEXT_T htext, const char *p_text ) {
+	TEXT_T *p = (TEXT_T*) htext;
+	const uint8_t *p_char = (const uint8_t*) p_text;
+	uint16_t g;
+	int w, max_w;
+
+	w		= 0;
+	max_w	= 0;
+	while( *p_char != '\0' ) {
+		if( *p_char == '\n' ) {
+			p_char++;
+			w = 0;
+			continue;
+		}
+		g = _lookup( p, _decode_utf8( &p_char ) );
+		if( g != NO_GLYPH ) {
+			w += p->p_width[g];
+			if( w > max_w ) {
+				max_w = w;
+			}
+		}
+	}
+	return max_w;
+}
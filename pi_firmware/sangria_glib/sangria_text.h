@@ -0,0 +1,132 @@
+// --------------------------------------------------------------------
+// Sangria game library: bitmap font text
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	Text in bitmap fonts made by font_converter.py -s (rp2040_firmware/tool).
+//	The glyphs are expanded into the format of the back buffer and into
+//	the colors when the text instance is made, so a string is drawn by
+//	copying lines of pixels only. A string is decoded from UTF-8 once,
+//	clipped once, and drawn line by line: 1bpp lines of the glyphs are
+//	packed and written 32 pixels at a time, and 8bpp lines are copied
+//	8 pixels at a time.
+//
+//	Code points of 1 and 2 bytes in UTF-8 (U+0000 ... U+07FF) are looked
+//	up in a table, others are searched in the codes of the font. A code
+//	that is not in the font, and a broken UTF-8 sequence, are drawn as
+//	U+FFFD or '?' if the font has them, and skipped if not.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_TEXT_H__
+#define __SANGRIA_TEXT_H__
+
+#include "sangria_glib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SANGRIA_TEXT_MAX_WIDTH		32		//	pixels of a glyph cell
+
+// --------------------------------------------------------------------
+//	SANGRIA_FONT_T
+//		p_bitmap has height lines of (cell_width + 7) / 8 bytes for each
+//		glyph, bit7 is the left pixel, 1 is drawn and 0 is background.
+// --------------------------------------------------------------------
+typedef struct {
+	int32_t			cell_width;		//	1 ... SANGRIA_TEXT_MAX_WIDTH
+	int32_t			height;			//	pixels of a line of text
+	int32_t			glyphs;			//	number of glyphs
+	const uint32_t	*p_code;		//	code point of each glyph, ascending
+	const uint8_t	*p_width;		//	advance of each glyph (pixels)
+	const uint8_t	*p_bitmap;
+} SANGRIA_FONT_T;
+
+typedef void *H_SANGRIA_TEXT_T;
+
+// --------------------------------------------------------------------
+//	sangria_text_initialize()
+//	input)
+//		p_font ......... font
+//		format ......... SANGRIA_FORMAT_8BPP or SANGRIA_FORMAT_1BPP
+//		c .............. pixel value of the glyphs
+//		background ..... pixel value of the background, 0: transparent
+//	output)
+//		NULL ........... failed (not enough memory or a broken font)
+//		others ......... H_SANGRIA_TEXT_T instance
+//	comment)
+//		The text is drawn into back buffers of this format only. p_font
+//		must be alive until sangria_text_terminate().
+// --------------------------------------------------------------------
+H_SANGRIA_TEXT_T sangria_text_initialize( const SANGRIA_FONT_T *p_font, SANGRIA_FORMAT_T format, uint8_t c, uint8_t background );
+
+// --------------------------------------------------------------------
+//	sangria_text_terminate()
+//	input)
+//		htext .......... H_SANGRIA_TEXT_T instance
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_text_terminate( H_SANGRIA_TEXT_T htext );
+
+// --------------------------------------------------------------------
+//	sangria_text_set_color()
+//	input)
+//		htext .......... H_SANGRIA_TEXT_T instance
+//		c .............. pixel value of the glyphs
+//		background ..... pixel value of the background, 0: transparent
+//	output)
+//		none
+//	comment)
+//		All the glyphs are expanded again, do not call it for each string.
+// --------------------------------------------------------------------
+void sangria_text_set_color( H_SANGRIA_TEXT_T htext, uint8_t c, uint8_t background );
+
+// --------------------------------------------------------------------
+//	sangria_text_draw()
+//	input)
+//		htext .......... H_SANGRIA_TEXT_T instance
+//		p_image ........ target backbuffer pointer
+//		x .............. X position of the left of the text
+//		y .............. Y position of the top of the text
+//		p_text ......... UTF-8 string, '\n' starts a new line at x
+//	output)
+//		X position after the last glyph
+//	comment)
+//		Nothing is drawn if p_image is not of the format of htext.
+// --------------------------------------------------------------------
+int sangria_text_draw( H_SANGRIA_TEXT_T htext, SANGRIA_BACKBUFFER_T *p_image, int x, int y, const char *p_text );
+
+// --------------------------------------------------------------------
+//	sangria_text_width()
+//	input)
+//		htext .......... H_SANGRIA_TEXT_T instance
+//		p_text ......... UTF-8 string
+//	output)
+//		width of the widest line (pixels)
+// --------------------------------------------------------------------
+int sangria_text_width( H_SANGRIA_TEXT_T htext, const char *p_text );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
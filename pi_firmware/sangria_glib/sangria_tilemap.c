@@ -0,0 +1,344 @@
+// --------------------------------------------------------------------
+// Sangria game library: tilemap
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "sangria_tilemap.h"
+#include "sangria_glib_8bpp.h"
+
+#define MAX_CACHE_WIDTH		2048		//	wider maps are not cached
+
+typedef enum {
+	LINE_DIRECT = 0,		//	tiles are drawn into the destination
+	LINE_FILL,				//	tiles are drawn into the cache, then copied
+	LINE_CACHE,				//	copied from the cache
+} LINE_ACTION_T;
+
+typedef struct {
+	int32_t		x;
+	int32_t		y;
+	int32_t		is_valid;
+} LINE_POSITION_T;
+
+typedef struct {
+	SANGRIA_BACKBUFFER_T	*p_sheet;
+	int			tile_width;
+	int			tile_height;
+	int			sheet_columns;
+	uint16_t	*p_map;
+	int			map_width;
+	int			map_height;
+	int			scroll_x;
+	int			scroll_y;
+	const int16_t	*p_line_x;
+	int			line_x_lines;
+	//	The line l of p_cache is the whole map line p_cached[l].y for the
+	//	line l of the layer, so it stays valid while scrolling in X.
+	SANGRIA_BACKBUFFER_T	*p_cache;
+	int			lines;
+	LINE_POSITION_T	*p_cached;		//	map line in p_cache
+	LINE_POSITION_T	*p_last;		//	map line in the last frame
+	LINE_POSITION_T	*p_current;
+	uint8_t		*p_action;
+} TILEMAP_T;
+
+// --------------------------------------------------------------------
+static inline int _wrap( int x, int size ) {
+
+	x %= size;
+	return (x < 0) ? x + size : x;
+}
+
+// --------------------------------------------------------------------
+static void _release_lines( TILEMAP_T *p ) {
+
+	sangria_release_backbuffer( p->p_cache );
+	free( p->p_cached );
+	free( p->p_last );
+	free( p->p_current );
+	free( p->p_action );
+	p->p_cache		= NULL;
+	p->p_cached		= NULL;
+	p->p_last		= NULL;
+	p->p_current	= NULL;
+	p->p_action		= NULL;
+	p->lines		= 0;
+}
+
+// --------------------------------------------------------------------
+static int _prepare_lines( TILEMAP_T *p, SANGRIA_BACKBUFFER_T *p_dest_image, int lines ) {
+	int is_cached;
+
+	is_cached = (p->map_width * p->tile_width <= MAX_CACHE_WIDTH);
+	if( p->p_current != NULL && p->lines == lines &&
+		(!is_cached || p->p_cache->format == p_dest_image->format) ) {
+		return 1;
+	}
+	_release_lines( p );
+	p->p_cached		= (LINE_POSITION_T*) calloc( lines, sizeof(LINE_POSITION_T) );
+	p->p_last		= (LINE_POSITION_T*) calloc( lines, sizeof(LINE_POSITION_T) );
+	p->p_current	= (LINE_POSITION_T*) calloc( lines, sizeof(LINE_POSITION_T) );
+	p->p_action		= (uint8_t*) calloc( lines, 1 );
+	if( is_cached ) {
+		p->p_cache	= sangria_get_backbuffer_format( p->map_width * p->tile_width, lines, p_dest_image->format );
+	}
+	if( p->p_cached == NULL || p->p_last == NULL || p->p_current == NULL || p->p_action == NULL ||
+		(is_cached && p->p_cache == NULL) ) {
+		_release_lines( p );
+		return 0;
+	}
+	p->lines = lines;
+	return 1;
+}
+
+// --------------------------------------------------------------------
+//	The last line of the run from the line l, which can be drawn at once.
+//	Tiles: the same tile row at the same X position.
+//	Cache: the same X position.
+//
+static int _get_run_end( TILEMAP_T *p, int l, int l_end ) {
+	int action;
+
+	action = p->p_action[l];
+	for( ; l < l_end; l++ ) {
+		if( p->p_action[ l + 1 ] != action ) break;
+		if( action != LINE_FILL && p->p_current[ l + 1 ].x != p->p_current[l].x ) break;
+		if( action == LINE_CACHE ) continue;
+		if( p->p_current[ l + 1 ].y != p->p_current[l].y + 1 ) break;
+		if( (p->p_current[ l + 1 ].y % p->tile_height) == 0 ) break;
+	}
+	return l;
+}
+
+// --------------------------------------------------------------------
+//	Draws the map from (map_x, map_y) into the lines y ... y + n of p_target.
+//	is_cache: The pixels of value 0 and the empty tiles are drawn too.
+//
+static void _draw_tiles( TILEMAP_T *p, SANGRIA_BACKBUFFER_T *p_target, int y, int n, int map_x, int map_y, int is_cache ) {
+	int x, w, tx, ty, sx, sy, i, is_8bpp;
+	uint16_t tile;
+	const uint16_t *p_map_line;
+	const uint8_t *p_src;
+	uint8_t *p_dest;
+
+	//	The lines are inside of p_target, so only the source has to be checked.
+	is_8bpp		= (p->p_sheet->format == SANGRIA_FORMAT_8BPP) && (p_target->format == SANGRIA_FORMAT_8BPP);
+	if( is_8bpp ) {
+		sangria_mark_dirty( p_target, y, y + n );
+	}
+	p_map_line	= p->p_map + (map_y / p->tile_height) * p->map_width;
+	ty			= map_y % p->tile_height;
+	for( x = 0; x < p_target->width; x += w ) {
+		tx		= map_x % p->tile_width;
+		w		= p->tile_width - tx;
+		if( w > p_target->width - x ) {
+			w = p_target->width - x;
+		}
+		tile	= p_map_line[ map_x / p->tile_width ];
+		if( tile == SANGRIA_TILEMAP_EMPTY ) {
+			if( is_cache ) {
+				sangria_fill_rect( p_target, x, y, x + w - 1, y + n, 0 );
+			}
+		}
+		else {
+			sx = (tile % p->sheet_columns) * p->tile_width + tx;
+			sy = (tile / p->sheet_columns) * p->tile_height + ty;
+			if( is_8bpp && sy + n < p->p_sheet->height ) {
+				p_src	= p->p_sheet->image + sx + sy * p->p_sheet->width;
+				p_dest	= p_target->image + x + y * p_target->width;
+				for( i = 0; i <= n; i++ ) {
+					if( is_cache ) {
+						sangria_8bpp_copy_line_opaque( p_src, p_dest, w, 1 );
+					}
+					else {
+						sangria_8bpp_copy_line( p_src, p_dest, w, 1 );
+					}
+					p_src	+= p->p_sheet->width;
+					p_dest	+= p_target->width;
+				}
+			}
+			else if( is_cache ) {
+				sangria_copy_opaque( p->p_sheet, sx, sy, sx + w - 1, sy + n, p_target, x, y );
+			}
+			else {
+				sangria_copy( p->p_sheet, sx, sy, sx + w - 1, sy + n, p_target, x, y );
+			}
+		}
+		map_x += w;
+		if( map_x >= p->map_width * p->tile_width ) {
+			map_x = 0;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	The lines l1 ... l2 of the cache, from X position x, wrapping around.
+//
+static void _copy_cache( TILEMAP_T *p, SANGRIA_BACKBUFFER_T *p_dest_image, int dy, int l1, int l2, int x ) {
+	int dx, w;
+
+	for( dx = 0; dx < p_dest_image->width; dx += w ) {
+		w = p->p_cache->width - x;
+		if( w > p_dest_image->width - dx ) {
+			w = p_dest_image->width - dx;
+		}
+		sangria_copy( p->p_cache, x, l1, x + w - 1, l2, p_dest_image, dx, dy + l1 );
+		x = 0;
+	}
+}
+
+// --------------------------------------------------------------------
+H_SANGRIA_TILEMAP_T sangria_tilemap_initialize( SANGRIA_BACKBUFFER_T *p_tile_sheet, int tile_width, int tile_height,
+	const uint16_t *p_map, int map_width, int map_height ) {
+	TILEMAP_T *p;
+
+	if( tile_width <= 0 || tile_height <= 0 || map_width <= 0 || map_height <= 0 || p_tile_sheet->width < tile_width ) {
+		return NULL;
+	}
+	p = (TILEMAP_T*) calloc( 1, sizeof(TILEMAP_T) );
+	if( p == NULL ) {
+		return NULL;
+	}
+	p->p_map = (uint16_t*) malloc( sizeof(uint16_t) * map_width * map_height );
+	if( p->p_map == NULL ) {
+		free( p );
+		return NULL;
+	}
+	memcpy( p->p_map, p_map, sizeof(uint16_t) * map_width * map_height );
+	p->p_sheet			= p_tile_sheet;
+	p->tile_width		= tile_width;
+	p->tile_height		= tile_height;
+	p->sheet_columns	= p_tile_sheet->width / tile_width;
+	p->map_width		= map_width;
+	p->map_height		= map_height;
+	return p;
+}
+
+// --------------------------------------------------------------------
+void sangria_tilemap_terminate( H_SANGRIA_TILEMAP_T htilemap ) {
+	TILEMAP_T *p = (TILEMAP_T*) htilemap;
+
+	if( p == NULL ) {
+		return;
+	}
+	_release_lines( p );
+	free( p->p_map );
+	free( p );
+}
+
+// --------------------------------------------------------------------
+void sangria_tilemap_set_tile( H_SANGRIA_TILEMAP_T htilemap, int x, int y, uint16_t tile ) {
+	TILEMAP_T *p = (TILEMAP_T*) htilemap;
+	int l;
+
+	if( x < 0 || y < 0 || x >= p->map_width || y >= p->map_height ) {
+		return;
+	}
+	if( p->p_map[ x + y * p->map_width ] == tile ) {
+		return;
+	}
+	p->p_map[ x + y * p->map_width ] = tile;
+	for( l = 0; l < p->lines; l++ ) {
+		p->p_cached[l].is_valid = 0;
+		p->p_last[l].is_valid = 0;
+	}
+}
+
+// --------------------------------------------------------------------
+void sangria_tilemap_scroll( H_SANGRIA_TILEMAP_T htilemap, int x, int y ) {
+	TILEMAP_T *p = (TILEMAP_T*) htilemap;
+
+	p->scroll_x = x;
+	p->scroll_y = y;
+}
+
+// --------------------------------------------------------------------
+void sangria_tilemap_set_line_scroll( H_SANGRIA_TILEMAP_T htilemap, const int16_t *p_line_x, int lines ) {
+	TILEMAP_T *p = (TILEMAP_T*) htilemap;
+
+	p->p_line_x		= p_line_x;
+	p->line_x_lines	= (p_line_x == NULL) ? 0 : lines;
+}
+
+// --------------------------------------------------------------------
+void sangria_tilemap_render( H_SANGRIA_TILEMAP_T htilemap, SANGRIA_BACKBUFFER_T *p_dest_image, int dy, int lines ) {
+	TILEMAP_T *p = (TILEMAP_T*) htilemap;
+	LINE_POSITION_T *p_pos;
+	int l, l1, l2, x, run_end;
+
+	if( lines <= 0 || !_prepare_lines( p, p_dest_image, lines ) ) {
+		return;
+	}
+	//	visible lines
+	l1 = (dy < 0) ? -dy : 0;
+	l2 = (dy + lines > p_dest_image->height) ? p_dest_image->height - dy - 1 : lines - 1;
+	if( l1 > l2 ) {
+		return;
+	}
+	for( l = l1; l <= l2; l++ ) {
+		p_pos = &p->p_current[l];
+		x = p->scroll_x;
+		if( l < p->line_x_lines ) {
+			x += p->p_line_x[l];
+		}
+		p_pos->x		= _wrap( x, p->map_width * p->tile_width );
+		p_pos->y		= _wrap( p->scroll_y + l, p->map_height * p->tile_height );
+		p_pos->is_valid	= 1;
+		if( p->p_cache == NULL ) {
+			p->p_action[l] = LINE_DIRECT;
+		}
+		else if( p->p_cached[l].is_valid && p->p_cached[l].y == p_pos->y ) {
+			p->p_action[l] = LINE_CACHE;
+		}
+		else if( p->p_last[l].is_valid && p->p_last[l].y == p_pos->y ) {
+			//	not moved in Y since the last frame
+			p->p_action[l] = LINE_FILL;
+		}
+		else {
+			p->p_action[l] = LINE_DIRECT;
+		}
+		p->p_last[l] = *p_pos;
+	}
+	//	fill the cache
+	for( l = l1; l <= l2; l = run_end + 1 ) {
+		run_end = _get_run_end( p, l, l2 );
+		if( p->p_action[l] != LINE_FILL ) continue;
+		_draw_tiles( p, p->p_cache, l, run_end - l, 0, p->p_current[l].y, 1 );
+		for( x = l; x <= run_end; x++ ) {
+			p->p_cached[x]	= p->p_current[x];
+			p->p_action[x]	= LINE_CACHE;
+		}
+	}
+	//	draw
+	for( l = l1; l <= l2; l = run_end + 1 ) {
+		run_end = _get_run_end( p, l, l2 );
+		if( p->p_action[l] == LINE_CACHE ) {
+			_copy_cache( p, p_dest_image, dy, l, run_end, p->p_current[l].x );
+		}
+		else {
+			_draw_tiles( p, p_dest_image, dy + l, run_end - l, p->p_current[l].x, p->p_current[l].y, 0 );
+		}
+	}
+}
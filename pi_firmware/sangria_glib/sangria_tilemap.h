@@ -0,0 +1,131 @@
+// --------------------------------------------------------------------
+// Sangria game library: tilemap
+// ====================================================================
+//	Copyright 2022 t.hara
+//
+//	Permission is hereby granted, free of charge, to any person obtaining 
+//	a copy of this software and associated documentation files (the "Software"), 
+//	to deal in the Software without restriction, including without limitation 
+//	the rights to use, copy, modify, merge, publish, distribute, sublicense, 
+//	and/or sell copies of the Software, and to permit persons to whom the 
+//	Software is furnished to do so, subject to the following conditions:
+//
+//	The above copyright notice and this permission notice shall be included in 
+//	all copies or substantial portions of the Software.
+//
+//	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, 
+//	EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF 
+//	MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. 
+//	IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, 
+//	DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, 
+//	ARISING FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER 
+//	DEALINGS IN THE SOFTWARE.
+// --------------------------------------------------------------------
+//	A layer of tiles, scrolled like the background planes of a game
+//	console. The map wraps around at its edges.
+//
+//	Only the tiles on the visible lines are drawn. A line whose map line
+//	has not changed since the last frame is drawn over the whole width of
+//	the map into a cache, and copied from it while it is scrolled in X
+//	only (also by the line scroll table). Maps wider than 2048 pixels are
+//	not cached.
+// --------------------------------------------------------------------
+
+#ifndef __SANGRIA_TILEMAP_H__
+#define __SANGRIA_TILEMAP_H__
+
+#include "sangria_glib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SANGRIA_TILEMAP_EMPTY	0xFFFF		//	nothing is drawn
+
+typedef void *H_SANGRIA_TILEMAP_T;
+
+// --------------------------------------------------------------------
+//	sangria_tilemap_initialize()
+//	input)
+//		p_tile_sheet ... backbuffer of the tiles, left to right and top to bottom
+//		tile_width ..... width of a tile
+//		tile_height .... height of a tile
+//		p_map .......... tile numbers, map_width x map_height (copied)
+//		map_width ...... number of tiles in X
+//		map_height ..... number of tiles in Y
+//	output)
+//		NULL ........... failed (not enough memory)
+//		others ......... H_SANGRIA_TILEMAP_T instance
+//	comment)
+//		Pixels of value 0 in the tiles are transparent. p_tile_sheet must
+//		be alive until sangria_tilemap_terminate().
+// --------------------------------------------------------------------
+H_SANGRIA_TILEMAP_T sangria_tilemap_initialize( SANGRIA_BACKBUFFER_T *p_tile_sheet, int tile_width, int tile_height,
+	const uint16_t *p_map, int map_width, int map_height );
+
+// --------------------------------------------------------------------
+//	sangria_tilemap_terminate()
+//	input)
+//		htilemap ....... H_SANGRIA_TILEMAP_T instance
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_tilemap_terminate( H_SANGRIA_TILEMAP_T htilemap );
+
+// --------------------------------------------------------------------
+//	sangria_tilemap_set_tile()
+//	input)
+//		htilemap ....... H_SANGRIA_TILEMAP_T instance
+//		x .............. X position on the map (tiles)
+//		y .............. Y position on the map (tiles)
+//		tile ........... tile number or SANGRIA_TILEMAP_EMPTY
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_tilemap_set_tile( H_SANGRIA_TILEMAP_T htilemap, int x, int y, uint16_t tile );
+
+// --------------------------------------------------------------------
+//	sangria_tilemap_scroll()
+//	input)
+//		htilemap ....... H_SANGRIA_TILEMAP_T instance
+//		x .............. map position (pixels) shown at the left of the layer
+//		y .............. map position (pixels) shown at the top of the layer
+//	output)
+//		none
+// --------------------------------------------------------------------
+void sangria_tilemap_scroll( H_SANGRIA_TILEMAP_T htilemap, int x, int y );
+
+// --------------------------------------------------------------------
+//	sangria_tilemap_set_line_scroll()
+//	input)
+//		htilemap ....... H_SANGRIA_TILEMAP_T instance
+//		p_line_x ....... X offset added to each line of the layer, NULL: none
+//		lines .......... number of elements of p_line_x
+//	output)
+//		none
+//	comment)
+//		For raster effects. Only the pointer is kept, so the table can be
+//		rewritten in each frame.
+// --------------------------------------------------------------------
+void sangria_tilemap_set_line_scroll( H_SANGRIA_TILEMAP_T htilemap, const int16_t *p_line_x, int lines );
+
+// --------------------------------------------------------------------
+//	sangria_tilemap_render()
+//	input)
+//		htilemap ....... H_SANGRIA_TILEMAP_T instance
+//		p_dest_image ... destination backbuffer pointer
+//		dy ............. top Y position of the layer on destination
+//		lines .......... height of the layer
+//	output)
+//		none
+//	comment)
+//		The layer is drawn over p_dest_image as sangria_copy() does.
+//		Its width is the width of p_dest_image.
+// --------------------------------------------------------------------
+void sangria_tilemap_render( H_SANGRIA_TILEMAP_T htilemap, SANGRIA_BACKBUFFER_T *p_dest_image, int dy, int lines );
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,7 @@
 #include <string.h>
 #include <stdint.h>
 #include <scc_emulator.h>
+#include <blip_buffer.h>
 
 typedef struct {
 	int			tone_enable;
@@ -42,6 +43,8 @@ typedef struct {
 	uint32_t	clock;
 	int			counter_reset_mode;
 	SCC_1CH_T	channel[5];
+	int			is_band_limited;
+	BLIP_BUFFER_T	blip;
 } SCC_T;
 
 #ifndef SAMPLE_RATE
@@ -54,6 +57,17 @@ typedef struct {
 
 #define BIT( d, n )			(((d) >> (n)) & 1)
 
+//	clocks to the time of blip_buffer, and the time from the clock of a
+//	sample (floor of sample x SCC_CLOCK / SAMPLE_RATE) to the sample itself,
+//	rem is the remainder of the division
+#define CLOCK_TO_TIME		((uint32_t)( ((uint64_t) SAMPLE_RATE << 32) / SCC_CLOCK ))
+#define BLIP_TIME( c )		((uint32_t)( ((uint64_t)(c) * CLOCK_TO_TIME) >> (32 - BLIP_TIME_BITS) ))
+#define BLIP_REM_TIME( rem )	((uint32_t)( ((uint64_t)(rem) << BLIP_TIME_BITS) / SCC_CLOCK ))
+
+//	a channel of a shorter period steps several times in each sample
+//	(over 7kHz), and is sampled as the default mode instead
+#define MIN_BLIP_PERIOD		16
+
 // --------------------------------------------------------------------
 H_SCC_T scc_initialize( void ) {
 	SCC_T *pscc;
@@ -91,11 +105,92 @@ static int _tone_generator( SCC_T *pscc, SCC_1CH_T *pch, int increment ) {
 	return level;
 }
 
+// --------------------------------------------------------------------
+//	Steps of a channel in the block of clocks, at the exact clocks.
+//
+static void _tone_steps( SCC_T *pscc, SCC_1CH_T *pch, int clocks, uint32_t start_time ) {
+	int period, offset, level;
+
+	period = pch->periodic_register + 1;
+	if( pch->counter >= period ) {
+		//	the period is shorter than the counter
+		pch->sample_pos	= (pch->sample_pos + pch->counter / period) & 31;
+		pch->counter	%= period;
+		level = (pch->volume * pch->wave[ pch->sample_pos ]) >> 4;
+		blip_add_delta( &pscc->blip, 0, level - pch->last_level );
+		pch->last_level	= level;
+	}
+	for( offset = period - pch->counter; offset <= clocks; offset += period ) {
+		pch->sample_pos	= (pch->sample_pos + 1) & 31;
+		level = (pch->volume * pch->wave[ pch->sample_pos ]) >> 4;
+		if( level != pch->last_level ) {
+			blip_add_delta( &pscc->blip, BLIP_TIME( offset ) - start_time, level - pch->last_level );
+			pch->last_level = level;
+		}
+	}
+	//	offset - period is the last step (-counter if no step)
+	pch->counter = clocks - (offset - period);
+}
+
+// --------------------------------------------------------------------
+//	The channels of a short period step at every sample. Their changes at
+//	the same sample are added together, and inserted as one step.
+//
+static void _generate_band_limited( SCC_T *pscc, int16_t *pwave, int samples ) {
+	int i, n, ch, clocks, next_clock, last_clock, delta, channels;
+	uint32_t end_clock, start_time;
+	SCC_1CH_T *pch, *p_short[5];
+
+	for( ; samples > 0; samples -= n, pwave += n ) {
+		n = (samples < BLIP_BLOCK) ? samples : BLIP_BLOCK;
+		//	the clock of the last sample, as scc_generate_wave() does
+		end_clock	= (uint32_t)( (uint64_t)( pscc->samples + n - 1 ) * SCC_CLOCK / SAMPLE_RATE );
+		clocks		= (int)( end_clock - pscc->clock );
+		start_time	= pscc->samples ? BLIP_REM_TIME( (uint64_t)( pscc->samples - 1 ) * SCC_CLOCK % SAMPLE_RATE ) : 0;
+		channels = 0;
+		for( ch = 0; ch < 5; ch++ ) {
+			pch = &pscc->channel[ch];
+			if( pch->periodic_register + 1 >= MIN_BLIP_PERIOD ) {
+				_tone_steps( pscc, pch, clocks, start_time );
+			}
+			else {
+				p_short[ channels++ ] = pch;
+			}
+		}
+		last_clock = (int) pscc->clock;
+		for( i = 0; channels && i < n; i++ ) {
+			next_clock	= (int)( (int64_t)( pscc->samples + i ) * SCC_CLOCK / SAMPLE_RATE );
+			delta		= 0;
+			for( ch = 0; ch < channels; ch++ ) {
+				delta -= p_short[ch]->last_level;
+				_tone_generator( pscc, p_short[ch], next_clock - last_clock );
+				delta += p_short[ch]->last_level;
+			}
+			if( delta ) {
+				blip_add_delta( &pscc->blip, BLIP_TIME( next_clock - (int) pscc->clock ) - start_time, delta );
+			}
+			last_clock = next_clock;
+		}
+		blip_read_samples( &pscc->blip, pwave, n );
+		pscc->clock		= end_clock;
+		pscc->samples	+= n;
+		if( pscc->samples >= SAMPLE_RATE ) {
+			pscc->clock		-= SCC_CLOCK;
+			pscc->samples	-= SAMPLE_RATE;
+		}
+	}
+}
+
 // --------------------------------------------------------------------
 void scc_generate_wave( H_SCC_T hscc, int16_t *pwave, int samples ) {
 	int i, next_clock, diff_clock, level;
 	SCC_T *pscc = (SCC_T*) hscc;
 
+	if( pscc->is_band_limited ) {
+		_generate_band_limited( pscc, pwave, samples );
+		return;
+	}
+
 	for( i = 0; i < samples; i++ ) {
 		next_clock = (int)( (int64_t)pscc->samples * SCC_CLOCK / SAMPLE_RATE );
 		diff_clock = next_clock - pscc->clock;
@@ -116,6 +211,21 @@ void scc_generate_wave( H_SCC_T hscc, int16_t *pwave, int samples ) {
 	}
 }
 
+// --------------------------------------------------------------------
+void scc_set_band_limited( H_SCC_T hscc, int is_band_limited ) {
+	SCC_T *pscc = (SCC_T*) hscc;
+	int ch, level;
+
+	if( is_band_limited && !pscc->is_band_limited ) {
+		level = 0;
+		for( ch = 0; ch < 5; ch++ ) {
+			level += pscc->channel[ch].last_level;
+		}
+		blip_clear( &pscc->blip, level );
+	}
+	pscc->is_band_limited = is_band_limited;
+}
+
 // --------------------------------------------------------------------
 void scc_write_register( H_SCC_T hscc, uint16_t address, uint8_t data ) {
 	int ch;
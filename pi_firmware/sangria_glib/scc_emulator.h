@@ -66,6 +66,25 @@ void scc_terminate( H_SCC_T hscc );
 // --------------------------------------------------------------------
 void scc_generate_wave( H_SCC_T hscc, int16_t *pwave, int samples );
 
+// --------------------------------------------------------------------
+//	scc_set_band_limited
+//	input)
+//		hscc ............. H_SCC_T instance
+//		is_band_limited .. 0: the level at each sample (default)
+//		                   1: band-limited steps (blip_buffer.h)
+//	output)
+//		none
+//	comment)
+//		Band-limited steps do not alias the wave back into the audible
+//		band, and the wave is BLIP_DELAY samples later. A channel over
+//		7kHz (period < 15) is not band-limited.
+//		This is a quality-over-speed mode. A 32-step wave changes its level
+//		up to 32 times in a period, and each change costs a BLIP_TAPS
+//		step, so it is about 2.5 times slower than the default for usual
+//		tunes (test/alias_test).
+// --------------------------------------------------------------------
+void scc_set_band_limited( H_SCC_T hscc, int is_band_limited );
+
 // --------------------------------------------------------------------
 //	scc_write_register
 //	input)
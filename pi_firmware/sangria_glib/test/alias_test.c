@@ -0,0 +1,273 @@
+// --------------------------------------------------------------------
+// Test of the band-limited steps of psg_emulator and scc_emulator
+// ====================================================================
+//	High square tones are made in both modes, and the spectrum of each
+//	is taken by FFT. The power out of the harmonics of the tone below
+//	20kHz is the aliasing, and it must be far lower in the band-limited
+//	mode. The fundamental of the band-limited mode must be the one of an
+//	ideal square wave, and the mean level must be the same in both modes.
+//	Then the time to make 1 second is printed for both modes.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include "psg_emulator.h"
+#include "scc_emulator.h"
+
+#define SAMPLE_RATE		48000
+#define CHIP_CLOCK		3579545.
+#define FFT_SIZE		16384
+#define BLOCK			960
+#define AUDIBLE			20000.
+#define HARMONIC_BINS	8			//	bins of a harmonic on each side
+#define MAX_ALIASING	-48.		//	dB to the harmonics, band-limited
+#define MIN_IMPROVEMENT	20.			//	dB
+#define MAX_GAIN_ERROR	0.5			//	dB of the fundamental, band-limited
+#define REPEAT			10
+#define PI				3.14159265358979
+
+typedef struct {
+	const char	*p_name;
+	int			is_scc;
+	int			period;
+	int			peak_to_peak;
+} CASE_T;
+
+static const CASE_T cases[] = {
+	{ "PSG tone period 13", 0, 13, 255 },
+	{ "PSG tone period 20", 0, 20, 255 },
+	{ "PSG tone period 57", 0, 57, 255 },
+	{ "SCC tone period 15", 1, 15, 119 + 120 },
+	{ "SCC tone period 40", 1, 40, 119 + 120 },
+};
+
+static int16_t wave[ FFT_SIZE ];
+static double re[ FFT_SIZE ];
+static double im[ FFT_SIZE ];
+static double power[ FFT_SIZE / 2 ];
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void fft( double *p_re, double *p_im, int n ) {
+	int i, j, k, len;
+	double t, w_re, w_im, u_re, u_im, v_re, v_im, a;
+
+	for( i = 1, j = 0; i < n; i++ ) {
+		for( k = n >> 1; j & k; k >>= 1 ) {
+			j ^= k;
+		}
+		j |= k;
+		if( i < j ) {
+			t = p_re[i]; p_re[i] = p_re[j]; p_re[j] = t;
+			t = p_im[i]; p_im[i] = p_im[j]; p_im[j] = t;
+		}
+	}
+	for( len = 2; len <= n; len <<= 1 ) {
+		for( k = 0; k < len / 2; k++ ) {
+			a		= -2. * PI * k / len;
+			w_re	= cos( a );
+			w_im	= sin( a );
+			for( i = k; i < n; i += len ) {
+				j		= i + len / 2;
+				u_re	= p_re[i];
+				u_im	= p_im[i];
+				v_re	= p_re[j] * w_re - p_im[j] * w_im;
+				v_im	= p_re[j] * w_im + p_im[j] * w_re;
+				p_re[i]	= u_re + v_re;
+				p_im[i]	= u_im + v_im;
+				p_re[j]	= u_re - v_re;
+				p_im[j]	= u_im - v_im;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	A square tone at the full volume, the wave after the start is used.
+//
+static void render( const CASE_T *p_case, int is_band_limited, int16_t *p_wave, int samples ) {
+	static int16_t dummy[ BLOCK ];
+	H_PSG_T hpsg = NULL;
+	H_SCC_T hscc = NULL;
+	int i, n;
+
+	if( p_case->is_scc ) {
+		hscc = scc_initialize();
+		scc_set_band_limited( hscc, is_band_limited );
+		for( i = 0; i < 32; i++ ) {
+			scc_write_register( hscc, 0xB800 + i, (i < 16) ? 127 : -128 );
+		}
+		scc_write_register( hscc, 0xB8A0, p_case->period & 255 );
+		scc_write_register( hscc, 0xB8A1, p_case->period >> 8 );
+		scc_write_register( hscc, 0xB8AA, 15 );
+		scc_write_register( hscc, 0xB8AF, 1 );
+		scc_generate_wave( hscc, dummy, BLOCK );
+	}
+	else {
+		hpsg = psg_initialize();
+		psg_set_band_limited( hpsg, is_band_limited );
+		psg_write_register( hpsg, 0, p_case->period & 255 );
+		psg_write_register( hpsg, 1, p_case->period >> 8 );
+		psg_write_register( hpsg, 7, 0xBE );
+		psg_write_register( hpsg, 8, 15 );
+		psg_generate_wave( hpsg, dummy, BLOCK );
+	}
+	for( i = 0; i < samples; i += n ) {
+		n = (samples - i < BLOCK) ? samples - i : BLOCK;
+		if( p_case->is_scc ) {
+			scc_generate_wave( hscc, p_wave + i, n );
+		}
+		else {
+			psg_generate_wave( hpsg, p_wave + i, n );
+		}
+	}
+	if( p_case->is_scc ) {
+		scc_terminate( hscc );
+	}
+	else {
+		psg_terminate( hpsg );
+	}
+}
+
+// --------------------------------------------------------------------
+//	dB of the aliasing to the harmonics, dB of the fundamental to the
+//	ideal square wave, and the mean.
+//
+static void analyze( const CASE_T *p_case, int is_band_limited, double *p_aliasing, double *p_fundamental, double *p_mean ) {
+	double f0, mean, signal, aliasing, fundamental, bin, amplitude;
+	int i, k, is_harmonic;
+
+	render( p_case, is_band_limited, wave, FFT_SIZE );
+	mean = 0.;
+	for( i = 0; i < FFT_SIZE; i++ ) {
+		mean += wave[i];
+	}
+	mean /= FFT_SIZE;
+	for( i = 0; i < FFT_SIZE; i++ ) {
+		re[i] = (wave[i] - mean) * (0.5 - 0.5 * cos( 2. * PI * i / FFT_SIZE ));
+		im[i] = 0.;
+	}
+	fft( re, im, FFT_SIZE );
+	for( i = 0; i < FFT_SIZE / 2; i++ ) {
+		power[i] = re[i] * re[i] + im[i] * im[i];
+	}
+
+	f0 = CHIP_CLOCK / 32. / (p_case->is_scc ? p_case->period + 1 : p_case->period);
+	signal = aliasing = fundamental = 0.;
+	for( i = 1; i < FFT_SIZE / 2 && i * (double) SAMPLE_RATE / FFT_SIZE < AUDIBLE; i++ ) {
+		bin = f0 * FFT_SIZE / SAMPLE_RATE;
+		is_harmonic = 0;
+		for( k = 1; k * f0 < AUDIBLE + f0; k++ ) {
+			if( fabs( i - k * bin ) <= HARMONIC_BINS ) {
+				is_harmonic = 1;
+				if( k == 1 ) {
+					fundamental += power[i];
+				}
+			}
+		}
+		if( i <= HARMONIC_BINS ) {
+			//	leak of DC
+		}
+		else if( is_harmonic ) {
+			signal += power[i];
+		}
+		else {
+			aliasing += power[i];
+		}
+	}
+	*p_aliasing		= 10. * log10( aliasing / signal );
+	//	a sine wave of the amplitude in the Hann window: N^2 x A^2 x 3/32 in the half of the spectrum
+	amplitude		= 2. * p_case->peak_to_peak / PI;
+	*p_fundamental	= 10. * log10( fundamental / ((double) FFT_SIZE * FFT_SIZE * amplitude * amplitude * 3. / 32.) );
+	*p_mean			= mean;
+}
+
+// --------------------------------------------------------------------
+static int check( void ) {
+	double aliasing[2], fundamental[2], mean[2];
+	int i, errors, is_ng;
+
+	errors = 0;
+	for( i = 0; i < (int)( sizeof(cases) / sizeof(cases[0]) ); i++ ) {
+		analyze( &cases[i], 0, &aliasing[0], &fundamental[0], &mean[0] );
+		analyze( &cases[i], 1, &aliasing[1], &fundamental[1], &mean[1] );
+		is_ng = aliasing[1] > MAX_ALIASING || aliasing[0] - aliasing[1] < MIN_IMPROVEMENT ||
+			fabs( fundamental[1] ) > MAX_GAIN_ERROR || fabs( mean[0] - mean[1] ) > 1.;
+		printf( "%-20s aliasing %6.1f dB -> %6.1f dB, fundamental %+5.2f dB -> %+5.2f dB, mean %7.2f -> %7.2f: %s\n",
+			cases[i].p_name, aliasing[0], aliasing[1], fundamental[0], fundamental[1], mean[0], mean[1], is_ng ? "NG" : "OK" );
+		errors += is_ng;
+	}
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	1 second of 3 PSG tones with noise and envelope, 5 SCC tones
+//
+static void bench( void ) {
+	static const uint8_t tune[] = {
+		0, 0xFE, 1, 0x00, 2, 0x7F, 3, 0x01, 4, 0x1A, 5, 0x00,
+		6, 0x10, 7, 0xA8, 8, 0x0C, 9, 0x0A, 10, 0x10,
+		11, 0x00, 12, 0x08, 13, 0x0E,
+	};
+	static int16_t bench_wave[ BLOCK ];
+	H_PSG_T hpsg;
+	H_SCC_T hscc;
+	long long start, t_psg, t_scc;
+	int is_band_limited, i, j;
+
+	for( is_band_limited = 0; is_band_limited < 2; is_band_limited++ ) {
+		hpsg = psg_initialize();
+		hscc = scc_initialize();
+		psg_set_band_limited( hpsg, is_band_limited );
+		scc_set_band_limited( hscc, is_band_limited );
+		for( i = 0; i < (int) sizeof(tune); i += 2 ) {
+			psg_write_register( hpsg, tune[i], tune[ i + 1 ] );
+		}
+		for( i = 0; i < 160; i++ ) {
+			scc_write_register( hscc, 0xB800 + i, (int) (100. * sin( 2. * PI * i / 32 ) + 20. * sin( 6. * PI * i / 32 )) );
+		}
+		for( i = 0; i < 5; i++ ) {
+			scc_write_register( hscc, 0xB8A0 + i * 2, 100 + 150 * i );
+			scc_write_register( hscc, 0xB8AA + i, 12 );
+		}
+		scc_write_register( hscc, 0xB8AF, 31 );
+		start = get_nsec();
+		for( i = 0; i < REPEAT; i++ ) {
+			for( j = 0; j < SAMPLE_RATE; j += BLOCK ) {
+				psg_generate_wave( hpsg, bench_wave, BLOCK );
+			}
+		}
+		t_psg = get_nsec() - start;
+		start = get_nsec();
+		for( i = 0; i < REPEAT; i++ ) {
+			for( j = 0; j < SAMPLE_RATE; j += BLOCK ) {
+				scc_generate_wave( hscc, bench_wave, BLOCK );
+			}
+		}
+		t_scc = get_nsec() - start;
+		printf( "%-13s psg_generate_wave %8.1f usec, scc_generate_wave %8.1f usec for 1 second\n",
+			is_band_limited ? "band-limited:" : "default:", t_psg / 1000. / REPEAT, t_scc / 1000. / REPEAT );
+		scc_terminate( hscc );
+		psg_terminate( hpsg );
+	}
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+
+	if( check() ) {
+		return 1;
+	}
+	bench();
+	return 0;
+}
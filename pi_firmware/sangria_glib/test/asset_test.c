@@ -0,0 +1,242 @@
+// --------------------------------------------------------------------
+// Test of sangria_asset
+// ====================================================================
+//	The assets in sample/ (*.sga) are loaded in both formats and
+//	compared with the arrays made from the same PNG files. Broken files
+//	must be rejected. Then the time to load an asset and the time to
+//	touch the array are printed. Run it in the sangria_glib directory.
+//	The display is not used.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_glib.h"
+#include "sangria_asset.h"
+#include "sample/game.h"
+#include "sample/startup_logo.h"
+#include "sample/usa.h"
+
+#define BROKEN_FILE		"/tmp/asset_test.sga"
+#define BROKEN_CHECKS	2000
+#define REPEAT			20
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	1bpp keeps only 0, 1 (1 ... 127) and 255 (128 ... 255).
+//
+static int is_same( SANGRIA_BACKBUFFER_T *p_image, SANGRIA_BACKBUFFER_T *p_expected ) {
+	int x, y;
+	uint8_t a, b;
+
+	if( p_image == NULL || p_image->width != p_expected->width || p_image->height != p_expected->height ) {
+		return 0;
+	}
+	for( y = 0; y < p_image->height; y++ ) {
+		for( x = 0; x < p_image->width; x++ ) {
+			a = sangria_get_pixel( p_image, x, y );
+			b = sangria_get_pixel( p_expected, x, y );
+			if( b ) {
+				b = (b < 128) ? 1 : 255;
+			}
+			if( a != b ) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static int check_image( const char *p_file_name, SANGRIA_BACKBUFFER_T *p_expected ) {
+	SANGRIA_BACKBUFFER_T *p_image;
+	int errors;
+
+	errors = 0;
+	p_image = sangria_load_image( p_file_name, SANGRIA_FORMAT_8BPP );
+	errors += !is_same( p_image, p_expected );
+	sangria_release_image( p_image );
+	p_image = sangria_load_image( p_file_name, SANGRIA_FORMAT_1BPP );
+	errors += !is_same( p_image, p_expected );
+	sangria_release_image( p_image );
+	printf( "%-28s %s\n", p_file_name, errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+static int check_tilemap( const char *p_file_name, SANGRIA_BACKBUFFER_T *p_expected ) {
+	SANGRIA_BACKBUFFER_T *p_sheet, *p_image;
+	H_SANGRIA_TILEMAP_T htilemap;
+	SANGRIA_FORMAT_T format;
+	int errors;
+
+	errors = 0;
+	for( format = SANGRIA_FORMAT_8BPP; format <= SANGRIA_FORMAT_1BPP; format++ ) {
+		htilemap = sangria_load_tilemap( p_file_name, format, &p_sheet );
+		if( htilemap == NULL ) {
+			errors++;
+			continue;
+		}
+		p_image = sangria_get_backbuffer_format( p_expected->width, p_expected->height, format );
+		sangria_tilemap_render( htilemap, p_image, 0, p_expected->height );
+		errors += !is_same( p_image, p_expected );
+		sangria_release_backbuffer( p_image );
+		sangria_tilemap_terminate( htilemap );
+		sangria_release_image( p_sheet );
+	}
+	printf( "%-28s %s\n", p_file_name, errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	Truncated and corrupted copies must not be loaded, or be loaded
+//	without touching outside of the buffers.
+//
+static int check_broken( const char *p_file_name ) {
+	static uint8_t data[ 65536 ];
+	SANGRIA_BACKBUFFER_T *p_image;
+	FILE *f;
+	int i, size, errors;
+
+	f = fopen( p_file_name, "rb" );
+	if( f == NULL ) {
+		return 1;
+	}
+	size = fread( data, 1, sizeof(data), f );
+	fclose( f );
+	errors = 0;
+	for( i = 0; i < BROKEN_CHECKS; i++ ) {
+		f = fopen( BROKEN_FILE, "wb" );
+		if( i & 1 ) {
+			//	truncated
+			fwrite( data, 1, rand() % size, f );
+		}
+		else {
+			//	corrupted
+			data[ rand() % size ] ^= 1 << (rand() % 8);
+			fwrite( data, 1, size, f );
+		}
+		fclose( f );
+		p_image = sangria_load_image( BROKEN_FILE, (i & 2) ? SANGRIA_FORMAT_1BPP : SANGRIA_FORMAT_8BPP );
+		if( p_image != NULL && (i & 1) ) {
+			errors++;
+		}
+		sangria_release_image( p_image );
+	}
+	remove( BROKEN_FILE );
+	printf( "%-28s %s\n", "broken files", errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	A header whose data_size would wrap around the file size (on a 32bit
+//	size_t) and a file cut inside the header must be rejected.
+//
+static int check_broken_header( const char *p_file_name ) {
+	static uint8_t data[ 65536 ];
+	static const uint32_t sizes[] = { 0xFFFFFFF0, 0xFFFFFFFF, 0x80000000 };
+	SANGRIA_BACKBUFFER_T *p_image;
+	FILE *f;
+	int i, size, errors;
+
+	f = fopen( p_file_name, "rb" );
+	if( f == NULL ) {
+		return 1;
+	}
+	size = fread( data, 1, sizeof(data), f );
+	fclose( f );
+	errors = 0;
+	//	data_size is at offset 8 (little endian)
+	for( i = 0; i < (int)( sizeof(sizes) / sizeof(sizes[0]) ); i++ ) {
+		data[ 8] = (uint8_t)( sizes[i] );
+		data[ 9] = (uint8_t)( sizes[i] >> 8 );
+		data[10] = (uint8_t)( sizes[i] >> 16 );
+		data[11] = (uint8_t)( sizes[i] >> 24 );
+		f = fopen( BROKEN_FILE, "wb" );
+		fwrite( data, 1, size, f );
+		fclose( f );
+		p_image = sangria_load_image( BROKEN_FILE, SANGRIA_FORMAT_8BPP );
+		if( p_image != NULL ) {
+			errors++;
+		}
+		sangria_release_image( p_image );
+	}
+	//	the header is 52 bytes
+	for( i = 0; i < 52; i++ ) {
+		f = fopen( BROKEN_FILE, "wb" );
+		fwrite( data, 1, i, f );
+		fclose( f );
+		p_image = sangria_load_image( BROKEN_FILE, SANGRIA_FORMAT_1BPP );
+		if( p_image != NULL ) {
+			errors++;
+		}
+		sangria_release_image( p_image );
+	}
+	remove( BROKEN_FILE );
+	printf( "%-28s %s\n", "broken headers", errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+static void bench( const char *p_name, const char *p_file_name, SANGRIA_BACKBUFFER_T *p_array ) {
+	SANGRIA_BACKBUFFER_T *p_image;
+	SANGRIA_FORMAT_T format;
+	long long start, t;
+	FILE *f;
+	int i, size, sum;
+
+	f = fopen( p_file_name, "rb" );
+	fseek( f, 0, SEEK_END );
+	size = ftell( f );
+	fclose( f );
+
+	//	The array is paged in when it is touched first.
+	start = get_nsec();
+	sum = 0;
+	for( i = 0; i < p_array->width * p_array->height; i++ ) {
+		sum += p_array->image[i];
+	}
+	t = get_nsec() - start;
+	printf( "%-28s array %7d bytes, first touch %8.1f usec (%d)\n", p_name, p_array->width * p_array->height, t / 1000., sum & 1 );
+
+	for( format = SANGRIA_FORMAT_8BPP; format <= SANGRIA_FORMAT_1BPP; format++ ) {
+		start = get_nsec();
+		for( i = 0; i < REPEAT; i++ ) {
+			p_image = sangria_load_image( p_file_name, format );
+			sangria_release_image( p_image );
+		}
+		t = get_nsec() - start;
+		printf( "%-28s asset %7d bytes, %dbpp load    %8.1f usec\n", p_name, size,
+			(format == SANGRIA_FORMAT_1BPP) ? 1 : 8, t / 1000. / REPEAT );
+	}
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	errors = 0;
+	errors += check_image( "sample/game.sga", p_game );
+	errors += check_image( "sample/startup_logo.sga", p_startup_logo );
+	errors += check_image( "sample/usa.sga", p_usa );
+	errors += check_tilemap( "sample/game_tiles.sga", p_game );
+	errors += check_broken( "sample/game.sga" );
+	errors += check_broken( "sample/startup_logo.sga" );
+	errors += check_broken_header( "sample/game.sga" );
+	errors += check_broken_header( "sample/startup_logo.sga" );
+	if( errors ) {
+		return 1;
+	}
+	bench( "game (LZ)", "sample/game.sga", p_game );
+	bench( "startup_logo (raw)", "sample/startup_logo.sga", p_startup_logo );
+	return 0;
+}
@@ -0,0 +1,261 @@
+// --------------------------------------------------------------------
+// Benchmark of sangria_copy()
+// ====================================================================
+//	Checks sangria_copy() and sangria_copy_opaque() against a pixel by
+//	pixel reference, including clipping and mirrored copies, and then
+//	measures MPixels/s of each path. Copies that start or end around
+//	each edge are checked one by one, because _clip() once wrote one
+//	pixel past the right edge into the next line. The display is not
+//	used.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_glib.h"
+
+#define LAYER_WIDTH		800
+#define LAYER_HEIGHT	200
+#define CHECKS			20000
+#define REPEAT			200
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	The former sangria_copy() without clipping: one byte at a time.
+//
+static void copy_reference( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1 ) {
+	int x, y;
+	uint8_t *p_src, *p_dest, d;
+
+	for( y = sy1; y <= sy2; y++ ) {
+		p_src	= p_src_image->image  + (sx1 + y * p_src_image->width );
+		p_dest	= p_dest_image->image + (dx1 + (dy1 + y - sy1) * p_dest_image->width);
+		for( x = sx1; x <= sx2; x++ ) {
+			d = *(p_src++);
+			if( d ) {
+				*p_dest = d;
+			}
+			p_dest++;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	Definition of sangria_copy(), with the bounds checks of get/set_pixel.
+//
+static void copy_pixels( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1, int is_opaque ) {
+	int i, j, w, h, vx, vy, x, y;
+	uint8_t d;
+
+	vx = (sx1 <= sx2) ? 1 : -1;
+	vy = (sy1 <= sy2) ? 1 : -1;
+	w = (sx2 - sx1) * vx + 1;
+	h = (sy2 - sy1) * vy + 1;
+	for( j = 0; j < h; j++ ) {
+		for( i = 0; i < w; i++ ) {
+			x = sx1 + i * vx;
+			y = sy1 + j * vy;
+			if( x < 0 || y < 0 || x >= p_src_image->width || y >= p_src_image->height ) continue;
+			d = sangria_get_pixel( p_src_image, x, y );
+			if( d || is_opaque ) {
+				sangria_set_pixel( p_dest_image, dx1 + i, dy1 + j, d );
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static void random_image( SANGRIA_BACKBUFFER_T *p_image, int transparent_percent ) {
+	int x, y;
+	uint8_t c;
+
+	for( y = 0; y < p_image->height; y++ ) {
+		for( x = 0; x < p_image->width; x++ ) {
+			c = (rand() % 100 < transparent_percent) ? 0 : ((rand() & 1) ? 1 : 255);
+			sangria_set_pixel( p_image, x, y, c );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static int is_same( SANGRIA_BACKBUFFER_T *p_a, SANGRIA_BACKBUFFER_T *p_b ) {
+	int x, y;
+
+	for( y = 0; y < p_a->height; y++ ) {
+		for( x = 0; x < p_a->width; x++ ) {
+			if( sangria_get_pixel( p_a, x, y ) != sangria_get_pixel( p_b, x, y ) ) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static int check( SANGRIA_FORMAT_T src_format, SANGRIA_FORMAT_T dest_format, int is_opaque ) {
+	SANGRIA_BACKBUFFER_T *p_src, *p_dest, *p_expected;
+	int i, sx1, sy1, sx2, sy2, dx1, dy1, errors;
+
+	p_src		= sangria_get_backbuffer_format( 77, 45, src_format );
+	p_dest		= sangria_get_backbuffer_format( 131, 61, dest_format );
+	p_expected	= sangria_get_backbuffer_format( 131, 61, dest_format );
+	random_image( p_src, 30 );
+	random_image( p_dest, 0 );
+	sangria_copy_opaque( p_dest, 0, 0, 130, 60, p_expected, 0, 0 );
+	errors = 0;
+	for( i = 0; i < CHECKS; i++ ) {
+		sx1 = rand() % 97 - 10;
+		sx2 = rand() % 97 - 10;
+		sy1 = rand() % 65 - 10;
+		sy2 = rand() % 65 - 10;
+		dx1 = rand() % 171 - 20;
+		dy1 = rand() % 81 - 20;
+		if( is_opaque ) {
+			sangria_copy_opaque( p_src, sx1, sy1, sx2, sy2, p_dest, dx1, dy1 );
+		}
+		else {
+			sangria_copy( p_src, sx1, sy1, sx2, sy2, p_dest, dx1, dy1 );
+		}
+		copy_pixels( p_src, sx1, sy1, sx2, sy2, p_expected, dx1, dy1, is_opaque );
+		if( !is_same( p_dest, p_expected ) ) {
+			printf( "  mismatch: (%d, %d)-(%d, %d) to (%d, %d)\n", sx1, sy1, sx2, sy2, dx1, dy1 );
+			sangria_copy_opaque( p_expected, 0, 0, 130, 60, p_dest, 0, 0 );
+			errors++;
+		}
+	}
+	printf( "%dbpp to %dbpp, %-11s %s\n", (src_format == SANGRIA_FORMAT_1BPP) ? 1 : 8,
+		(dest_format == SANGRIA_FORMAT_1BPP) ? 1 : 8, is_opaque ? "opaque:" : "transparent:", errors ? "NG" : "OK" );
+	sangria_release_backbuffer( p_src );
+	sangria_release_backbuffer( p_dest );
+	sangria_release_backbuffer( p_expected );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	Every pair of the source coordinates around the edges of the source,
+//	to every destination around the edges of the destination, on one
+//	axis at a time. Mirrored copies are included as s1 > s2.
+//
+static int check_edges( SANGRIA_FORMAT_T format ) {
+	static const int offsets[] = { -2, -1, 0, 1 };
+	SANGRIA_BACKBUFFER_T *p_src, *p_dest, *p_expected;
+	int s[8], d[6], i, j, k, axis, sx1, sy1, sx2, sy2, dx1, dy1, errors;
+
+	p_src		= sangria_get_backbuffer_format( 37, 21, format );
+	p_dest		= sangria_get_backbuffer_format( 45, 27, format );
+	p_expected	= sangria_get_backbuffer_format( 45, 27, format );
+	random_image( p_src, 30 );
+	errors = 0;
+	for( axis = 0; axis < 2; axis++ ) {
+		for( i = 0; i < 4; i++ ) {
+			s[i]		= offsets[i];
+			s[i + 4]	= offsets[i] + (axis ? p_src->height : p_src->width) - 1;
+		}
+		for( i = 0; i < 3; i++ ) {
+			d[i]		= offsets[i];
+			d[i + 3]	= offsets[i] + (axis ? p_dest->height : p_dest->width) - 1;
+		}
+		for( i = 0; i < 8; i++ ) {
+			for( j = 0; j < 8; j++ ) {
+				for( k = 0; k < 6; k++ ) {
+					if( axis ) {
+						sx1 = 3;	sx2 = 30;	dx1 = 5;
+						sy1 = s[i];	sy2 = s[j];	dy1 = d[k];
+					}
+					else {
+						sx1 = s[i];	sx2 = s[j];	dx1 = d[k];
+						sy1 = 2;	sy2 = 17;	dy1 = 4;
+					}
+					random_image( p_dest, 0 );
+					sangria_copy_opaque( p_dest, 0, 0, p_dest->width - 1, p_dest->height - 1, p_expected, 0, 0 );
+					sangria_copy( p_src, sx1, sy1, sx2, sy2, p_dest, dx1, dy1 );
+					copy_pixels( p_src, sx1, sy1, sx2, sy2, p_expected, dx1, dy1, 0 );
+					if( !is_same( p_dest, p_expected ) ) {
+						if( errors < 5 ) {
+							printf( "  mismatch: (%d, %d)-(%d, %d) to (%d, %d)\n", sx1, sy1, sx2, sy2, dx1, dy1 );
+						}
+						errors++;
+					}
+				}
+			}
+		}
+	}
+	printf( "%dbpp edges:                %s\n", (format == SANGRIA_FORMAT_1BPP) ? 1 : 8, errors ? "NG" : "OK" );
+	sangria_release_backbuffer( p_src );
+	sangria_release_backbuffer( p_dest );
+	sangria_release_backbuffer( p_expected );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	2 layers per frame as sample/game_demo.c
+//
+static void bench( const char *p_name, SANGRIA_FORMAT_T format, int transparent_percent, int mode ) {
+	SANGRIA_BACKBUFFER_T *p_layer, *p_screen;
+	int i, x;
+	long long start, t;
+
+	p_layer		= sangria_get_backbuffer_format( LAYER_WIDTH, LAYER_HEIGHT, format );
+	p_screen	= sangria_get_backbuffer_format( 400, 240, format );
+	random_image( p_layer, transparent_percent );
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		x = i % LAYER_WIDTH;
+		switch( mode ) {
+		case 0:
+			copy_reference( p_layer, x, 0, 399 + x, LAYER_HEIGHT - 1, p_screen, 0, 20 );
+			break;
+		case 1:
+			sangria_copy( p_layer, 0, 0, LAYER_WIDTH - 1, LAYER_HEIGHT - 1, p_screen, -x, 20 );
+			break;
+		case 2:
+			sangria_copy( p_layer, LAYER_WIDTH - 1, 0, 0, LAYER_HEIGHT - 1, p_screen, -x, 20 );
+			break;
+		default:
+			sangria_copy_opaque( p_layer, 0, 0, LAYER_WIDTH - 1, LAYER_HEIGHT - 1, p_screen, -x, 20 );
+			break;
+		}
+	}
+	t = get_nsec() - start;
+	printf( "%-32s %8.1f MPixels/s\n", p_name, (double) 400 * LAYER_HEIGHT * REPEAT * 1000. / t );
+	sangria_release_backbuffer( p_layer );
+	sangria_release_backbuffer( p_screen );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	errors = 0;
+	errors += check( SANGRIA_FORMAT_8BPP, SANGRIA_FORMAT_8BPP, 0 );
+	errors += check( SANGRIA_FORMAT_8BPP, SANGRIA_FORMAT_8BPP, 1 );
+	errors += check( SANGRIA_FORMAT_1BPP, SANGRIA_FORMAT_1BPP, 0 );
+	errors += check( SANGRIA_FORMAT_1BPP, SANGRIA_FORMAT_1BPP, 1 );
+	errors += check( SANGRIA_FORMAT_8BPP, SANGRIA_FORMAT_1BPP, 0 );
+	errors += check( SANGRIA_FORMAT_1BPP, SANGRIA_FORMAT_8BPP, 1 );
+	errors += check_edges( SANGRIA_FORMAT_8BPP );
+	errors += check_edges( SANGRIA_FORMAT_1BPP );
+	if( errors ) {
+		return 1;
+	}
+
+	printf( "400x%d pixels per copy\n", LAYER_HEIGHT );
+	bench( "8bpp reference, byte loop",      SANGRIA_FORMAT_8BPP, 30, 0 );
+	bench( "8bpp copy, 30% transparent",     SANGRIA_FORMAT_8BPP, 30, 1 );
+	bench( "8bpp copy, no transparent",      SANGRIA_FORMAT_8BPP,  0, 1 );
+	bench( "8bpp copy, all transparent",     SANGRIA_FORMAT_8BPP, 100, 1 );
+	bench( "8bpp copy, mirrored",            SANGRIA_FORMAT_8BPP, 30, 2 );
+	bench( "8bpp copy_opaque",               SANGRIA_FORMAT_8BPP, 30, 3 );
+	bench( "1bpp copy, 30% transparent",     SANGRIA_FORMAT_1BPP, 30, 1 );
+	bench( "1bpp copy_opaque",               SANGRIA_FORMAT_1BPP, 30, 3 );
+	return 0;
+}
@@ -0,0 +1,278 @@
+// --------------------------------------------------------------------
+// Test of the frame triple buffer
+// ====================================================================
+//	The reader of sangria_lcd (frame_shm.c) runs in a thread, and the
+//	frames are published by sangria_display(), and by sangria_flip() in
+//	both formats. Only a band of lines is marked dirty in each frame.
+//	Every frame read must be the same as one of the published frames,
+//	and never older than the last one read. The reader notifies each
+//	frame as transferred, and sangria_wait_transfer() is checked on some
+//	frames. A broken slot index stored in middle must not be read. Then
+//	the time spent in sangria_display() and sangria_flip() is measured.
+//	Built with another SANGRIA_SHM_NAME, so sangria_lcd is not disturbed.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <pthread.h>
+#include "sangria_glib.h"
+#include "sangria_shm.h"
+#include "frame_shm.h"
+
+#define FRAMES			3000
+#define REPEAT			2000
+#define LINE_BYTES		(SANGRIA_SHM_WIDTH / 8)
+#define BITMAP_SIZE		(LINE_BYTES * SANGRIA_SHM_HEIGHT)
+
+static uint8_t expected[ FRAMES ][ BITMAP_SIZE ];
+static volatile int is_done = 0;
+static int reader_errors = 0;
+static int frames_read = 0;
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static int get_stamp( const uint8_t *p_bitmap ) {
+
+	return (p_bitmap[0] << 24) | (p_bitmap[1] << 16) | (p_bitmap[2] << 8) | p_bitmap[3];
+}
+
+// --------------------------------------------------------------------
+static void *reader_thread( void *p_arg ) {
+	static uint8_t bitmap[ BITMAP_SIZE ];
+	int stamp, last_stamp;
+	long long start;
+
+	last_stamp = -1;
+	start = get_nsec();
+	while( last_stamp < FRAMES - 1 && (!is_done || get_nsec() - start < 10000000000LL) ) {
+		fshm_wait( 10 );
+		if( !fshm_read( bitmap ) ) {
+			continue;
+		}
+		stamp = get_stamp( bitmap );
+		if( stamp < last_stamp || stamp >= FRAMES ) {
+			printf( "  frame %d is read after %d\n", stamp, last_stamp );
+			reader_errors++;
+			break;
+		}
+		if( stamp != last_stamp ) {
+			frames_read++;
+		}
+		if( memcmp( bitmap, expected[ stamp ], BITMAP_SIZE ) != 0 ) {
+			printf( "  frame %d is different\n", stamp );
+			reader_errors++;
+		}
+		last_stamp = stamp;
+		fshm_notify_transferred( fshm_get_frame_id() );
+	}
+	if( last_stamp != FRAMES - 1 ) {
+		printf( "  the last frame is not read (%d)\n", last_stamp );
+		reader_errors++;
+	}
+	return NULL;
+}
+
+// --------------------------------------------------------------------
+//	A band of lines is changed, and line 0 has the frame number.
+//
+static void draw_frame( SANGRIA_BACKBUFFER_T *p_model, int k, int *p_top, int *p_bottom ) {
+	int x, y;
+
+	*p_top		= rand() % SANGRIA_SHM_HEIGHT;
+	*p_bottom	= *p_top + rand() % 40;
+	sangria_fill_rect( p_model, rand() % 400, *p_top, rand() % 400, *p_bottom, (rand() & 1) ? 1 : 255 );
+	for( x = 0; x < 32; x++ ) {
+		sangria_set_pixel( p_model, x, 0, (k & (0x80000000 >> x)) ? 1 : 255 );
+	}
+	memset( expected[k], 0, BITMAP_SIZE );
+	for( y = 0; y < SANGRIA_SHM_HEIGHT; y++ ) {
+		for( x = 0; x < SANGRIA_SHM_WIDTH; x++ ) {
+			if( sangria_get_pixel( p_model, x, y ) < 128 ) {
+				expected[k][ y * LINE_BYTES + (x >> 3) ] |= 0x80 >> (x & 7);
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	The whole frame is drawn again, but only the changed lines are marked.
+//
+static void redraw( SANGRIA_BACKBUFFER_T *p_model, SANGRIA_BACKBUFFER_T *p_screen, int top, int bottom ) {
+
+	sangria_copy_opaque( p_model, 0, 0, 399, 239, p_screen, 0, 0 );
+	p_screen->dirty_top		= 0;
+	p_screen->dirty_bottom	= -1;
+	sangria_mark_dirty( p_screen, top, bottom );
+	sangria_mark_dirty( p_screen, 0, 0 );
+}
+
+// --------------------------------------------------------------------
+static int check( void ) {
+	SANGRIA_BACKBUFFER_T *p_model, *p_screen;
+	SANGRIA_FRAME_COUNT_T count;
+	pthread_t thread;
+	int k, top, bottom, errors, transfer_errors;
+
+	p_model = sangria_get_backbuffer( 400, 240 );
+	p_screen = NULL;
+	transfer_errors = 0;
+	pthread_create( &thread, NULL, reader_thread, NULL );
+	for( k = 0; k < FRAMES; k++ ) {
+		draw_frame( p_model, k, &top, &bottom );
+		if( k < FRAMES / 3 ) {
+			sangria_display( p_model );
+		}
+		else {
+			if( k == FRAMES / 3 ) {
+				p_screen = sangria_get_flip_buffer( SANGRIA_FORMAT_8BPP );
+			}
+			else if( k == FRAMES * 2 / 3 ) {
+				p_screen = sangria_get_flip_buffer( SANGRIA_FORMAT_1BPP );
+			}
+			redraw( p_model, p_screen, top, bottom );
+			p_screen = sangria_flip( p_screen );
+		}
+		//	bursts of frames are dropped
+		if( rand() % 4 == 0 ) {
+			usleep( rand() % 300 );
+		}
+		if( k % 100 == 0 && !sangria_wait_transfer( 1000 ) ) {
+			printf( "  frame %d is not transferred\n", k );
+			transfer_errors++;
+		}
+	}
+	is_done = 1;
+	pthread_join( thread, NULL );
+	sangria_get_frame_count( &count );
+	errors = reader_errors + transfer_errors;
+	if( count.published != FRAMES || count.presented + count.dropped != count.published ) {
+		errors++;
+	}
+	printf( "%d frames: %s, %u presented, %u dropped, %d read\n", FRAMES, errors ? "NG" : "OK",
+		count.presented, count.dropped, frames_read );
+	sangria_release_backbuffer( p_model );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	A broken client can write anything into middle, also a slot
+//	index out of range. No frame is read from it, and the next frame of
+//	the client is read again.
+//
+static int check_broken_slot( void ) {
+	static uint8_t bitmap[ BITMAP_SIZE ];
+	SANGRIA_BACKBUFFER_T *p_model;
+	SANGRIA_SHM_T *p_shm;
+	int h, top, bottom, errors;
+
+	h = shm_open( SANGRIA_SHM_NAME, O_RDWR, 0 );
+	if( h == -1 ) {
+		printf( "broken slot: NG, cannot open the shared memory\n" );
+		return 1;
+	}
+	p_shm = (SANGRIA_SHM_T*) mmap( NULL, sizeof(SANGRIA_SHM_T), PROT_READ | PROT_WRITE, MAP_SHARED, h, 0 );
+	close( h );
+	if( p_shm == MAP_FAILED ) {
+		printf( "broken slot: NG, cannot map the shared memory\n" );
+		return 1;
+	}
+	errors = 0;
+	__atomic_store_n( &p_shm->middle, SANGRIA_SHM_SLOT_MASK | SANGRIA_SHM_FRESH, __ATOMIC_RELEASE );
+	if( fshm_read( bitmap ) ) {
+		printf( "  the broken slot is read\n" );
+		errors++;
+	}
+	if( (p_shm->middle & SANGRIA_SHM_SLOT_MASK) >= SANGRIA_SHM_SLOTS || p_shm->middle == p_shm->front ) {
+		printf( "  middle is not restored (%u)\n", p_shm->middle );
+		errors++;
+	}
+	p_model = sangria_get_backbuffer( 400, 240 );
+	draw_frame( p_model, 0, &top, &bottom );
+	sangria_display( p_model );
+	if( !fshm_read( bitmap ) || memcmp( bitmap, expected[0], BITMAP_SIZE ) != 0 ) {
+		printf( "  the next frame is not read\n" );
+		errors++;
+	}
+	sangria_release_backbuffer( p_model );
+	munmap( p_shm, sizeof(SANGRIA_SHM_T) );
+	printf( "broken slot: %s\n", errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+static void *idle_reader_thread( void *p_arg ) {
+	static uint8_t bitmap[ BITMAP_SIZE ];
+
+	while( !is_done ) {
+		fshm_wait( 10 );
+		fshm_read( bitmap );
+	}
+	return NULL;
+}
+
+// --------------------------------------------------------------------
+static void bench( void ) {
+	SANGRIA_BACKBUFFER_T *p_model, *p_screen;
+	pthread_t thread;
+	long long t_display, t_flip, start;
+	int i;
+
+	p_model = sangria_get_backbuffer( 400, 240 );
+	is_done = 0;
+	pthread_create( &thread, NULL, idle_reader_thread, NULL );
+	t_display = 0;
+	for( i = 0; i < REPEAT; i++ ) {
+		sangria_clear_buffer( p_model, i & 255 );
+		start = get_nsec();
+		sangria_display( p_model );
+		t_display += get_nsec() - start;
+	}
+	t_flip = 0;
+	p_screen = sangria_get_flip_buffer( SANGRIA_FORMAT_8BPP );
+	for( i = 0; i < REPEAT; i++ ) {
+		sangria_clear_buffer( p_screen, i & 255 );
+		start = get_nsec();
+		p_screen = sangria_flip( p_screen );
+		t_flip += get_nsec() - start;
+	}
+	is_done = 1;
+	pthread_join( thread, NULL );
+	printf( "all lines changed: sangria_display %6.2f usec, sangria_flip %6.2f usec per frame\n",
+		t_display / 1000. / REPEAT, t_flip / 1000. / REPEAT );
+	sangria_release_backbuffer( p_model );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	if( !fshm_initialize( 100000 ) ) {
+		return 1;
+	}
+	if( !sangria_initialize() ) {
+		printf( "ERROR: Failed sangria_initialize()\n" );
+		fshm_terminate();
+		return 1;
+	}
+	errors = check();
+	errors += check_broken_slot();
+	if( !errors ) {
+		bench();
+	}
+	sangria_terminate();
+	fshm_terminate();
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,168 @@
+// --------------------------------------------------------------------
+// Test of sangria_frame
+// ====================================================================
+//	A main loop with a random amount of work per frame is paced, and
+//	the frames must keep the rate on average without drifting. A stall
+//	must restart the grid instead of being followed by a burst of short
+//	frames. A check is tried again if it fails, since a preempted frame
+//	can be late on a busy machine. Then the frame time statistics and
+//	the CPU time of the paced loop are printed. The display is not used.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "sangria_frame.h"
+
+#define FRAME_RATE		100
+#define FRAMES			300
+#define PERIOD			(1000000 / FRAME_RATE)		//	usec
+#define RETRY			5
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static long long get_cpu_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_PROCESS_CPUTIME_ID, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	busy for usec, as a game that draws a frame
+//
+static void work( int usec ) {
+	long long end;
+
+	end = get_nsec() + usec * 1000LL;
+	while( get_nsec() < end ) {
+	}
+}
+
+// --------------------------------------------------------------------
+static void print_frame_time( const char *p_name ) {
+	SANGRIA_FRAME_TIME_T t;
+
+	sangria_get_frame_time( &t );
+	printf( "%-28s %u frames, %u late, min %u, avg %u, max %u, p99 %u, work %u usec\n", p_name,
+		t.frames, t.late, t.min, t.average, t.max, t.p99, t.work );
+}
+
+// --------------------------------------------------------------------
+//	The sum of the frames must be FRAMES periods. Each frame is up to
+//	0.6 periods of work, so only a preempted one can be late.
+//
+static int check_rate( void ) {
+	long long start, elapsed, sum;
+	int i, errors;
+
+	sangria_set_frame_rate( FRAME_RATE );
+	sangria_wait_frame();
+	start = get_nsec();
+	sum = 0;
+	for( i = 0; i < FRAMES; i++ ) {
+		work( rand() % (PERIOD * 6 / 10) );
+		sum += sangria_wait_frame();
+	}
+	elapsed = (get_nsec() - start) / 1000;
+	errors = 0;
+	//	the oversleep of the first and the last frame only, not of each frame
+	if( elapsed < (long long) FRAMES * PERIOD - PERIOD / 2 || elapsed > (long long) FRAMES * PERIOD + PERIOD / 2 ) {
+		errors++;
+	}
+	if( sum < elapsed - 1 || sum > elapsed + 1 ) {
+		errors++;
+	}
+	printf( "rate: %d frames in %lld usec (%lld expected): %s\n", FRAMES, elapsed, (long long) FRAMES * PERIOD, errors ? "NG" : "OK" );
+	print_frame_time( "  frame time" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	A frame of 1.5 periods is caught up by the next one, and a frame of
+//	5 periods restarts the grid.
+//
+static int check_late( void ) {
+	uint32_t t[4];
+	SANGRIA_FRAME_TIME_T stat;
+	int i, errors;
+
+	errors = 0;
+	sangria_set_frame_rate( FRAME_RATE );
+	sangria_wait_frame();
+	sangria_wait_frame();
+	work( PERIOD * 3 / 2 );
+	t[0] = sangria_wait_frame();
+	t[1] = sangria_wait_frame();
+	if( t[0] < PERIOD * 3 / 2 || t[0] + t[1] > 2 * PERIOD + PERIOD / 5 ) {
+		printf( "  catch up: %u, %u usec\n", t[0], t[1] );
+		errors++;
+	}
+	work( PERIOD * 5 );
+	for( i = 0; i < 4; i++ ) {
+		t[i] = sangria_wait_frame();
+	}
+	if( t[0] < PERIOD * 5 ) {
+		errors++;
+	}
+	for( i = 1; i < 4; i++ ) {
+		if( t[i] < PERIOD * 9 / 10 ) {
+			printf( "  frame %d after the stall: %u usec\n", i, t[i] );
+			errors++;
+		}
+	}
+	sangria_get_frame_time( &stat );
+	if( stat.late < 2 || stat.max < PERIOD * 5 ) {
+		errors++;
+	}
+	printf( "late frames: %s\n", errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	CPU time of a loop with 1/10 period of work, paced and not paced
+//
+static void bench( void ) {
+	long long start, cpu;
+	int i, fps;
+
+	for( fps = FRAME_RATE; fps >= 0; fps -= FRAME_RATE ) {
+		sangria_set_frame_rate( fps );
+		sangria_wait_frame();
+		start = get_nsec();
+		cpu = get_cpu_nsec();
+		for( i = 0; i < FRAMES; i++ ) {
+			work( PERIOD / 10 );
+			sangria_wait_frame();
+		}
+		cpu = get_cpu_nsec() - cpu;
+		printf( "%-28s %7.1f frames/s, CPU %5.1f%%\n", fps ? "paced" : "not paced",
+			FRAMES * 1000000000. / (get_nsec() - start), cpu * 100. / (get_nsec() - start) );
+	}
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int i, errors;
+
+	srand( 1 );
+	errors = 0;
+	for( i = 0; i < RETRY && check_rate(); i++ ) {
+	}
+	errors += (i == RETRY);
+	for( i = 0; i < RETRY && check_late(); i++ ) {
+	}
+	errors += (i == RETRY);
+	if( errors ) {
+		return 1;
+	}
+	bench();
+	return 0;
+}
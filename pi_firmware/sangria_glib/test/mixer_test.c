@@ -0,0 +1,345 @@
+// --------------------------------------------------------------------
+// Test of sangria_mixer
+// ====================================================================
+//	The loops of the SIMD version must make the same sums and waves as
+//	the C version, for random waves, gains and lengths.
+//	Two PSG and an SCC at the center with random register writes must
+//	make the same wave as the mix of sangria_slib before the mixer,
+//	(PSG + PSG + SCC * 2) * 11 on both sides.
+//	A loud mix must stay under SANGRIA_MIXER_LIMIT and come back to x1,
+//	and a voice on the left must not be heard on the right.
+//	Then the time to make 1 second of 8 voices is printed, and the time
+//	of the mixing loops in it.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_mixer.h"
+#include "psg_emulator.h"
+#include "scc_emulator.h"
+
+#define SAMPLE_RATE		48000
+#define NSEC			1000000000LL
+#define SAMPLES			(SAMPLE_RATE * 2)
+#define MAX_BLOCK		2000
+#define BENCH_BLOCK		960
+#define BENCH_VOICES	8
+#define REPEAT			10
+
+static int16_t wave[ SAMPLES * 2 ];
+static int16_t expected[ SAMPLES * 2 ];
+static int16_t mono[3][ MAX_BLOCK ];
+static SANGRIA_MIXER_T mixer, simd_mixer;
+static SANGRIA_SOUND_QUEUE_T queue, ref_queue;
+static uint32_t seed;
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	The same sequence on every libc.
+//
+static int random_of( int n ) {
+
+	seed = seed * 1103515245 + 12345;
+	return (int)( (seed >> 16) % n );
+}
+
+// --------------------------------------------------------------------
+static int32_t random_sum( void ) {
+
+	return ((random_of( 32768 ) << 15) | random_of( 32768 )) - (1 << 29);
+}
+
+// --------------------------------------------------------------------
+static int check_kernel( void ) {
+	static int16_t src[ SANGRIA_MIXER_BLOCK ];
+	static int32_t left[2][ SANGRIA_MIXER_BLOCK ], right[2][ SANGRIA_MIXER_BLOCK ];
+	static int16_t out[2][ SANGRIA_MIXER_BLOCK * 2 ];
+	static float gain[ SANGRIA_MIXER_BLOCK ];
+	const SANGRIA_MIXER_KERNEL_T *p_kernel[2];
+	int i, k, n, gl, gr, errors;
+
+	sangria_mixer_initialize( &mixer, 0 );
+	sangria_mixer_initialize( &simd_mixer, 1 );
+	p_kernel[0] = mixer.p_kernel;
+	p_kernel[1] = simd_mixer.p_kernel;
+	seed = 1;
+	errors = 0;
+	for( k = 0; k < 2000; k++ ) {
+		n = 1 + random_of( SANGRIA_MIXER_BLOCK );
+		for( i = 0; i < n; i++ ) {
+			src[i]		= (int16_t)( random_of( 65536 ) - 32768 );
+			left[0][i]	= left[1][i]	= random_sum();
+			right[0][i]	= right[1][i]	= random_sum();
+			gain[i]		= random_of( 65536 ) / 65536.f;
+		}
+		gl = random_of( SANGRIA_MIXER_MAX_VOLUME + 1 );
+		gr = random_of( SANGRIA_MIXER_MAX_VOLUME + 1 );
+		p_kernel[0]->p_accumulate( left[0], right[0], src, gl, gr, n );
+		p_kernel[1]->p_accumulate( left[1], right[1], src, gl, gr, n );
+		if( memcmp( left[0], left[1], n * sizeof(int32_t) ) || memcmp( right[0], right[1], n * sizeof(int32_t) ) ) {
+			printf( "  accumulate of %d samples is different\n", n );
+			errors++;
+		}
+		if( p_kernel[0]->p_peak( left[0], right[0], n ) != p_kernel[1]->p_peak( left[1], right[1], n ) ) {
+			printf( "  peak of %d samples is different\n", n );
+			errors++;
+		}
+		p_kernel[0]->p_output( out[0], left[0], right[0], (k & 1) ? gain : NULL, n );
+		p_kernel[1]->p_output( out[1], left[1], right[1], (k & 1) ? gain : NULL, n );
+		if( memcmp( out[0], out[1], n * 2 * sizeof(int16_t) ) ) {
+			printf( "  output of %d samples is different\n", n );
+			errors++;
+		}
+	}
+	printf( "C and %s: %s\n", sangria_mixer_get_name( &simd_mixer ), errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+static void write_random_register( int chip, SANGRIA_SOUND_WRITE_T *p_write ) {
+
+	p_write->chip = (uint8_t) chip;
+	if( chip < 2 ) {
+		p_write->address	= (uint16_t) random_of( 14 );
+		p_write->data		= (uint8_t)( p_write->address == 7 ? (random_of( 64 ) | 0x80) : random_of( 256 ) );
+		if( p_write->address >= 8 && p_write->address <= 10 ) {
+			p_write->data &= 15;
+		}
+	}
+	else {
+		//	waves, frequency, volume and key on of the SCC
+		p_write->address	= (uint16_t)( 0xB800 + random_of( 0xB0 ) );
+		p_write->data		= (uint8_t) random_of( 256 );
+		if( random_of( 4 ) == 0 ) {
+			p_write->address	= 0xB8AF;
+			p_write->data		= 0x1F;
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	The writes are at the middle of a sample, so they are at the same
+//	sample on both paths.
+//
+static int check_slib_mix( void ) {
+	SANGRIA_SOUND_CHIP_T chip[3];
+	SANGRIA_SOUND_WRITE_T write;
+	int64_t now;
+	int i, k, n, done, errors;
+
+	sangria_mixer_initialize( &mixer, 1 );
+	sangria_sound_queue_initialize( &queue );
+	sangria_sound_queue_initialize( &ref_queue );
+	for( i = 0; i < 3; i++ ) {
+		chip[i].type	= (i < 2) ? SANGRIA_SOUND_TYPE_PSG : SANGRIA_SOUND_TYPE_SCC;
+		chip[i].handle	= (i < 2) ? (void*) psg_initialize() : (void*) scc_initialize();
+		chip[i].pwave	= mono[i];
+		sangria_mixer_add_voice( &mixer, chip[i].type, (i < 2) ? (void*) psg_initialize() : (void*) scc_initialize(),
+			((i < 2) ? 11 : 22) << SANGRIA_MIXER_GAIN_BITS, SANGRIA_MIXER_PAN_CENTER );
+	}
+	seed = 1;
+	now = NSEC;
+	for( done = 0; done < SAMPLES; done += n ) {
+		n = 1 + random_of( MAX_BLOCK );
+		if( n > SAMPLES - done ) {
+			n = SAMPLES - done;
+		}
+		for( k = random_of( 8 ); k > 0; k-- ) {
+			write_random_register( random_of( 3 ), &write );
+			write.time = NSEC + ((int64_t)( done + random_of( n ) ) * NSEC + NSEC / 2) / SAMPLE_RATE;
+			sangria_sound_queue_put( &queue, &write );
+			sangria_sound_queue_put( &ref_queue, &write );
+		}
+		now = NSEC + (int64_t)( done + n ) * NSEC / SAMPLE_RATE;
+		sangria_mixer_render( &mixer, &queue, wave + done * 2, n, now );
+		sangria_sound_queue_render( &ref_queue, chip, 3, n, now );
+		for( i = 0; i < n; i++ ) {
+			expected[ (done + i) * 2 + 0 ] = (mono[0][i] + mono[1][i] + (mono[2][i] << 1)) * 11;
+			expected[ (done + i) * 2 + 1 ] = (mono[0][i] + mono[1][i] + (mono[2][i] << 1)) * 11;
+		}
+	}
+	errors = 0;
+	for( i = 0; i < SAMPLES * 2; i++ ) {
+		if( wave[i] != expected[i] ) {
+			if( errors < 10 ) {
+				printf( "  sample %d: %d (%d expected)\n", i, wave[i], expected[i] );
+			}
+			errors++;
+		}
+	}
+	printf( "%d samples of PSG + PSG + SCC: %s\n", SAMPLES, errors ? "NG" : "OK" );
+	for( i = 0; i < 3; i++ ) {
+		if( i < 2 ) {
+			psg_terminate( chip[i].handle );
+			psg_terminate( mixer.chip[i].handle );
+		}
+		else {
+			scc_terminate( chip[i].handle );
+			scc_terminate( mixer.chip[i].handle );
+		}
+	}
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	4 PSG of the full volume at x16 for a second (far over 32767), and
+//	quiet after it.
+//
+static int check_limiter( void ) {
+	static const uint8_t loud[] = { 0, 0x40, 1, 0, 2, 0x55, 3, 0, 4, 0x6A, 5, 0, 7, 0xB8, 8, 15, 9, 15, 10, 15 };
+	H_PSG_T hpsg[4];
+	SANGRIA_SOUND_WRITE_T write;
+	int i, k, peak, errors, pan_errors, restored;
+
+	sangria_mixer_initialize( &mixer, 1 );
+	sangria_sound_queue_initialize( &queue );
+	for( k = 0; k < 4; k++ ) {
+		hpsg[k] = psg_initialize();
+		sangria_mixer_add_voice( &mixer, SANGRIA_SOUND_TYPE_PSG, hpsg[k], 16 << SANGRIA_MIXER_GAIN_BITS, SANGRIA_MIXER_PAN_CENTER );
+		for( i = 0; i < (int) sizeof(loud); i += 2 ) {
+			psg_write_register( hpsg[k], loud[i], loud[ i + 1 ] );
+		}
+		psg_write_register( hpsg[k], 0, 0x40 + k * 3 );
+	}
+	sangria_mixer_render( &mixer, &queue, wave, SAMPLE_RATE, NSEC );
+	peak = 0;
+	for( i = 0; i < SAMPLE_RATE * 2; i++ ) {
+		if( abs( wave[i] ) > peak ) {
+			peak = abs( wave[i] );
+		}
+	}
+	//	quiet, the limiter goes back to x1
+	for( k = 0; k < 4; k++ ) {
+		write.time		= NSEC;
+		write.address	= 8;
+		write.data		= 4;
+		write.chip		= (uint8_t) k;
+		sangria_sound_queue_put( &queue, &write );
+		write.address	= 9;
+		sangria_sound_queue_put( &queue, &write );
+		write.address	= 10;
+		sangria_sound_queue_put( &queue, &write );
+	}
+	sangria_mixer_render( &mixer, &queue, wave, SAMPLE_RATE, NSEC * 2 );
+	sangria_mixer_render( &mixer, &queue, wave, SAMPLE_RATE, NSEC * 3 );
+	restored = (mixer.limiter_gain == 1.0f);
+	errors = (peak > SANGRIA_MIXER_LIMIT || peak < SANGRIA_MIXER_LIMIT * 9 / 10 || !restored);
+	printf( "limiter: peak %d (limit %d), %s after the loud part: %s\n", peak, SANGRIA_MIXER_LIMIT,
+		restored ? "x1" : "not x1", errors ? "NG" : "OK" );
+
+	//	a voice on the left
+	sangria_mixer_set_voice( &mixer, 0, 8 << SANGRIA_MIXER_GAIN_BITS, SANGRIA_MIXER_PAN_LEFT );
+	for( k = 1; k < 4; k++ ) {
+		sangria_mixer_set_voice( &mixer, k, 0, SANGRIA_MIXER_PAN_CENTER );
+	}
+	sangria_mixer_render( &mixer, &queue, wave, SAMPLE_RATE, NSEC * 4 );
+	peak = 0;
+	pan_errors = 0;
+	for( i = 0; i < SAMPLE_RATE; i++ ) {
+		if( wave[ i * 2 + 1 ] != 0 ) {
+			pan_errors++;
+			break;
+		}
+		if( wave[ i * 2 ] > peak ) {
+			peak = wave[ i * 2 ];
+		}
+	}
+	if( peak == 0 ) {
+		pan_errors++;
+	}
+	printf( "pan: %s\n", pan_errors ? "NG" : "OK" );
+	for( k = 0; k < 4; k++ ) {
+		psg_terminate( hpsg[k] );
+	}
+	return errors + pan_errors;
+}
+
+// --------------------------------------------------------------------
+static void bench( int use_simd ) {
+	H_PSG_T hpsg[ BENCH_VOICES ];
+	long long start, t;
+	int i, j;
+
+	sangria_mixer_initialize( &mixer, use_simd );
+	sangria_sound_queue_initialize( &queue );
+	for( i = 0; i < BENCH_VOICES; i++ ) {
+		hpsg[i] = psg_initialize();
+		psg_write_register( hpsg[i], 0, 0x80 + i );
+		psg_write_register( hpsg[i], 7, 0xBE );
+		psg_write_register( hpsg[i], 8, 12 );
+		sangria_mixer_add_voice( &mixer, SANGRIA_SOUND_TYPE_PSG, hpsg[i], 3 << SANGRIA_MIXER_GAIN_BITS,
+			SANGRIA_MIXER_PAN_LEFT + i * 64 );
+	}
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		for( j = 0; j < SAMPLE_RATE; j += BENCH_BLOCK ) {
+			sangria_mixer_render( &mixer, &queue, wave, BENCH_BLOCK, start + (int64_t) j * NSEC / SAMPLE_RATE );
+		}
+	}
+	t = get_nsec() - start;
+	printf( "%d PSG (%-4s): %8.1f usec for 1 second (%.3f%% of real time)\n", BENCH_VOICES,
+		sangria_mixer_get_name( &mixer ), t / 1000. / REPEAT, t / 1e9 / REPEAT * 100. );
+	for( i = 0; i < BENCH_VOICES; i++ ) {
+		psg_terminate( hpsg[i] );
+	}
+}
+
+// --------------------------------------------------------------------
+//	The loops of 1 second of 8 voices, with the limiter working.
+//
+static void bench_kernel( int use_simd ) {
+	static int32_t left[ SANGRIA_MIXER_BLOCK ], right[ SANGRIA_MIXER_BLOCK ];
+	static float gain[ SANGRIA_MIXER_BLOCK ];
+	const SANGRIA_MIXER_KERNEL_T *p_kernel;
+	long long start, t;
+	int i, j, k;
+
+	sangria_mixer_initialize( &mixer, use_simd );
+	p_kernel = mixer.p_kernel;
+	for( i = 0; i < SANGRIA_MIXER_BLOCK; i++ ) {
+		gain[i] = 0.75f;
+		for( k = 0; k < BENCH_VOICES; k++ ) {
+			mixer.wave[k][i] = (int16_t)( (i * (k + 1)) & 1023 );
+		}
+	}
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		for( j = 0; j < SAMPLE_RATE; j += SANGRIA_MIXER_BLOCK ) {
+			memset( left, 0, sizeof(left) );
+			memset( right, 0, sizeof(right) );
+			for( k = 0; k < BENCH_VOICES; k++ ) {
+				p_kernel->p_accumulate( left, right, mixer.wave[k], 768 + k, 768 - k, SANGRIA_MIXER_BLOCK );
+			}
+			p_kernel->p_peak( left, right, SANGRIA_MIXER_BLOCK );
+			p_kernel->p_output( wave, left, right, gain, SANGRIA_MIXER_BLOCK );
+		}
+	}
+	t = get_nsec() - start;
+	printf( "  mixing loops (%-4s): %8.1f usec for 1 second\n", p_kernel->p_name, t / 1000. / REPEAT );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	errors = check_kernel();
+	errors += check_slib_mix();
+	errors += check_limiter();
+	if( errors ) {
+		return 1;
+	}
+	bench( 0 );
+	bench( 1 );
+	bench_kernel( 0 );
+	bench_kernel( 1 );
+	return 0;
+}
@@ -0,0 +1,208 @@
+// --------------------------------------------------------------------
+// Test of psg_emulator
+// ====================================================================
+//	Random register writes between blocks of random length are played
+//	for 2 seconds (over the wrap of the clock at each second), and the
+//	wave must be the same as test/psg_golden.wav sample by sample. The
+//	golden file was made by the PSG that stepped every master clock.
+//	Then the time to make 1 second of a tune is printed.
+//	"psg_wave_test -w" writes the golden file again.
+//	Run it in the sangria_glib directory.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "psg_emulator.h"
+
+#define GOLDEN_FILE		"test/psg_golden.wav"
+#define SAMPLE_RATE		48000
+#define SAMPLES			(SAMPLE_RATE * 2)
+#define MAX_BLOCK		1500
+#define BENCH_BLOCK		960
+#define REPEAT			10
+
+typedef struct {
+	char		riff[4];
+	uint32_t	riff_size;
+	char		wave[4];
+	char		fmt[4];
+	uint32_t	fmt_size;
+	uint16_t	format;
+	uint16_t	channels;
+	uint32_t	rate;
+	uint32_t	byte_rate;
+	uint16_t	block_align;
+	uint16_t	bits;
+	char		data[4];
+	uint32_t	data_size;
+} WAV_HEADER_T;
+
+static int16_t wave[ SAMPLES ];
+static int16_t golden[ SAMPLES ];
+static uint32_t seed;
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	The same sequence on every libc.
+//
+static int random_of( int n ) {
+
+	seed = seed * 1103515245 + 12345;
+	return (int)( (seed >> 16) % n );
+}
+
+// --------------------------------------------------------------------
+static void write_random_register( H_PSG_T hpsg ) {
+	int address, data;
+
+	address = random_of( 14 );
+	switch( address ) {
+	case 0: case 2: case 4:
+		//	from very high tones to low tones
+		data = random_of( 2 ) ? random_of( 8 ) : random_of( 256 );
+		break;
+	case 1: case 3: case 5:
+		data = random_of( 3 ) ? 0 : random_of( 16 );
+		break;
+	case 7:
+		data = random_of( 64 ) | 0x80;
+		break;
+	case 8: case 9: case 10:
+		data = random_of( 32 );
+		break;
+	case 11:
+		data = random_of( 2 ) ? random_of( 4 ) : random_of( 256 );
+		break;
+	case 12:
+		data = random_of( 4 ) ? 0 : random_of( 4 );
+		break;
+	default:
+		data = random_of( 256 );
+		break;
+	}
+	psg_write_register( hpsg, address, data );
+}
+
+// --------------------------------------------------------------------
+static void render( int16_t *p_wave ) {
+	H_PSG_T hpsg;
+	int i, n, done;
+
+	hpsg = psg_initialize();
+	seed = 1;
+	for( done = 0; done < SAMPLES; done += n ) {
+		for( i = random_of( 4 ); i > 0; i-- ) {
+			write_random_register( hpsg );
+		}
+		n = random_of( 8 ) ? 1 + random_of( MAX_BLOCK ) : 1 + random_of( 8 );
+		if( n > SAMPLES - done ) {
+			n = SAMPLES - done;
+		}
+		psg_generate_wave( hpsg, p_wave + done, n );
+	}
+	psg_terminate( hpsg );
+}
+
+// --------------------------------------------------------------------
+static int write_golden( void ) {
+	WAV_HEADER_T header = {
+		{ 'R', 'I', 'F', 'F' }, sizeof(WAV_HEADER_T) - 8 + sizeof(wave), { 'W', 'A', 'V', 'E' },
+		{ 'f', 'm', 't', ' ' }, 16, 1, 1, SAMPLE_RATE, SAMPLE_RATE * 2, 2, 16,
+		{ 'd', 'a', 't', 'a' }, sizeof(wave),
+	};
+	FILE *f;
+
+	render( wave );
+	f = fopen( GOLDEN_FILE, "wb" );
+	if( f == NULL ) {
+		return 1;
+	}
+	fwrite( &header, sizeof(header), 1, f );
+	fwrite( wave, sizeof(wave), 1, f );
+	fclose( f );
+	printf( "%s is written\n", GOLDEN_FILE );
+	return 0;
+}
+
+// --------------------------------------------------------------------
+static int check( void ) {
+	WAV_HEADER_T header;
+	FILE *f;
+	int i, errors;
+
+	f = fopen( GOLDEN_FILE, "rb" );
+	if( f == NULL ) {
+		printf( "ERROR: Cannot read %s\n", GOLDEN_FILE );
+		return 1;
+	}
+	if( fread( &header, sizeof(header), 1, f ) != 1 || memcmp( header.data, "data", 4 ) != 0 ||
+		header.data_size != sizeof(golden) || fread( golden, sizeof(golden), 1, f ) != 1 ) {
+		printf( "ERROR: %s is broken\n", GOLDEN_FILE );
+		fclose( f );
+		return 1;
+	}
+	fclose( f );
+	render( wave );
+	errors = 0;
+	for( i = 0; i < SAMPLES; i++ ) {
+		if( wave[i] != golden[i] ) {
+			if( errors < 10 ) {
+				printf( "  sample %d: %d (%d expected)\n", i, wave[i], golden[i] );
+			}
+			errors++;
+		}
+	}
+	printf( "%d samples against %s: %s\n", SAMPLES, GOLDEN_FILE, errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	3 tones, an envelope on one of them and noise on another
+//
+static void bench( void ) {
+	static const uint8_t tune[] = {
+		0, 0xFE, 1, 0x00, 2, 0x7F, 3, 0x01, 4, 0xAA, 5, 0x02,
+		6, 0x10, 7, 0xA8, 8, 0x0C, 9, 0x0A, 10, 0x10,
+		11, 0x00, 12, 0x08, 13, 0x0E,
+	};
+	H_PSG_T hpsg;
+	long long start, t;
+	int i, j;
+
+	hpsg = psg_initialize();
+	for( i = 0; i < (int) sizeof(tune); i += 2 ) {
+		psg_write_register( hpsg, tune[i], tune[ i + 1 ] );
+	}
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		for( j = 0; j < SAMPLE_RATE; j += BENCH_BLOCK ) {
+			psg_generate_wave( hpsg, wave, BENCH_BLOCK );
+		}
+	}
+	t = get_nsec() - start;
+	printf( "psg_generate_wave: %8.1f usec for 1 second (%.3f%% of real time)\n",
+		t / 1000. / REPEAT, t / 1e9 / REPEAT * 100. );
+	psg_terminate( hpsg );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+
+	if( argc > 1 && strcmp( argv[1], "-w" ) == 0 ) {
+		return write_golden();
+	}
+	if( check() ) {
+		return 1;
+	}
+	bench();
+	return 0;
+}
@@ -0,0 +1,392 @@
+// --------------------------------------------------------------------
+// Test of sangria_line(), sangria_fill_rect() and sangria_shape
+// ====================================================================
+//	Lines, rectangles, ellipses and polygons at random positions (also far outside
+//	of the back buffer) are compared with pixel by pixel references in
+//	both formats. Then the shapes drawn per second are printed for each
+//	primitive, against the same shapes by sangria_set_pixel(), which
+//	was the only way before. The display is not used.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_glib.h"
+#include "sangria_shape.h"
+
+#define CHECKS			3000
+#define REPEAT			3000
+#define MAX_VERTICES	10
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	the former sangria_line()
+//
+static void reference_line( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, int y2, uint8_t c ) {
+	int w, h, vx, vy, n, i;
+
+	if( x1 == x2 && y1 == y2 ) {
+		sangria_set_pixel( p_image, x1, y1, c );
+		return;
+	}
+	w = abs( x2 - x1 );
+	h = abs( y2 - y1 );
+	vx = (x1 == x2) ? 0 : (x1 < x2) ? 1 : -1;
+	vy = (y1 == y2) ? 0 : (y1 < y2) ? 1 : -1;
+	n = 0;
+	if( w > h ) {
+		for( i = 0; i <= w; i++ ) {
+			sangria_set_pixel( p_image, x1, y1, c );
+			x1 += vx;
+			n += h;
+			if( n >= w ) {
+				n -= w;
+				y1 += vy;
+			}
+		}
+	}
+	else {
+		for( i = 0; i <= h; i++ ) {
+			sangria_set_pixel( p_image, x1, y1, c );
+			y1 += vy;
+			n += w;
+			if( n >= h ) {
+				n -= h;
+				x1 += vx;
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static void reference_fill_rect( SANGRIA_BACKBUFFER_T *p_image, int x1, int y1, int x2, int y2, uint8_t c ) {
+	int x, y;
+
+	for( y = (y1 < y2) ? y1 : y2; y <= ((y1 < y2) ? y2 : y1); y++ ) {
+		for( x = (x1 < x2) ? x1 : x2; x <= ((x1 < x2) ? x2 : x1); x++ ) {
+			sangria_set_pixel( p_image, x, y, c );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static int is_in_ellipse( int x, int y, int rx, int ry ) {
+	uint64_t a, b;
+
+	a = (uint64_t)( 2 * rx + 1 ) * ( 2 * rx + 1 );
+	b = (uint64_t)( 2 * ry + 1 ) * ( 2 * ry + 1 );
+	return 4 * (uint64_t)( x * x ) * b + 4 * (uint64_t)( y * y ) * a <= a * b;
+}
+
+// --------------------------------------------------------------------
+static void reference_ellipse( SANGRIA_BACKBUFFER_T *p_image, int cx, int cy, int rx, int ry, uint8_t c, int is_fill ) {
+	int x, y;
+
+	for( y = -ry - 1; y <= ry + 1; y++ ) {
+		for( x = -rx - 1; x <= rx + 1; x++ ) {
+			if( !is_in_ellipse( x, y, rx, ry ) ) {
+				continue;
+			}
+			if( is_fill || !is_in_ellipse( x - 1, y, rx, ry ) || !is_in_ellipse( x + 1, y, rx, ry ) ||
+				!is_in_ellipse( x, y - 1, rx, ry ) || !is_in_ellipse( x, y + 1, rx, ry ) ) {
+				sangria_set_pixel( p_image, cx + x, cy + y, c );
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	even-odd: the number of edges crossed on the left of the pixel center,
+//	an edge from (x1, y1) to (x2, y2) (y1 < y2) is on the lines y1 ... y2 - 1.
+//
+static void reference_fill_polygon( SANGRIA_BACKBUFFER_T *p_image, const SANGRIA_POINT_T *p_points, int n, uint8_t c ) {
+	const SANGRIA_POINT_T *p1, *p2, *p_t;
+	int x, y, i, crossed;
+
+	for( y = 0; y < p_image->height; y++ ) {
+		for( x = 0; x < p_image->width; x++ ) {
+			crossed = 0;
+			for( i = 0; i < n; i++ ) {
+				p1 = &p_points[i];
+				p2 = &p_points[ (i + 1) % n ];
+				if( p1->y > p2->y ) {
+					p_t = p1;
+					p1 = p2;
+					p2 = p_t;
+				}
+				if( y < p1->y || y >= p2->y ) {
+					continue;
+				}
+				if( (long long) p1->x * (p2->y - p1->y) + (long long)( y - p1->y ) * (p2->x - p1->x) <= (long long) x * (p2->y - p1->y) ) {
+					crossed ^= 1;
+				}
+			}
+			if( crossed ) {
+				sangria_set_pixel( p_image, x, y, c );
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+//	is_exact_dirty = 0: the dirty lines must include those of p_expected
+//
+static int compare( SANGRIA_BACKBUFFER_T *p_image, SANGRIA_BACKBUFFER_T *p_expected, int is_exact_dirty ) {
+	int x, y;
+
+	for( y = 0; y < p_image->height; y++ ) {
+		for( x = 0; x < p_image->width; x++ ) {
+			if( sangria_get_pixel( p_image, x, y ) != sangria_get_pixel( p_expected, x, y ) ) {
+				return 0;
+			}
+		}
+	}
+	if( p_expected->dirty_top > p_expected->dirty_bottom ) {
+		return !is_exact_dirty || p_image->dirty_top > p_image->dirty_bottom;
+	}
+	if( is_exact_dirty ) {
+		return p_image->dirty_top == p_expected->dirty_top && p_image->dirty_bottom == p_expected->dirty_bottom;
+	}
+	return p_image->dirty_top <= p_expected->dirty_top && p_image->dirty_bottom >= p_expected->dirty_bottom;
+}
+
+// --------------------------------------------------------------------
+static void reset( SANGRIA_BACKBUFFER_T *p_image, SANGRIA_BACKBUFFER_T *p_expected ) {
+
+	sangria_clear_buffer( p_image, 0 );
+	sangria_clear_buffer( p_expected, 0 );
+	p_image->dirty_top		= 0;
+	p_image->dirty_bottom	= -1;
+	p_expected->dirty_top		= 0;
+	p_expected->dirty_bottom	= -1;
+}
+
+// --------------------------------------------------------------------
+static int check( SANGRIA_FORMAT_T format ) {
+	SANGRIA_BACKBUFFER_T *p_image, *p_expected;
+	SANGRIA_POINT_T points[ MAX_VERTICES ];
+	int i, j, n, x1, y1, x2, y2, rx, ry, is_fill, errors[4];
+	uint8_t c;
+
+	p_image		= sangria_get_backbuffer_format( 123, 71, format );
+	p_expected	= sangria_get_backbuffer_format( 123, 71, format );
+	memset( errors, 0, sizeof(errors) );
+	for( i = 0; i < CHECKS; i++ ) {
+		c = (rand() & 1) ? 1 : 255;
+
+		//	lines: short ones near the back buffer, and long ones through it
+		reset( p_image, p_expected );
+		n = (i & 1) ? 200 : 2000;
+		x1 = rand() % n - n / 2 + 60;
+		y1 = rand() % n - n / 2 + 35;
+		x2 = (rand() % 8 == 0) ? x1 : rand() % n - n / 2 + 60;
+		y2 = (rand() % 8 == 0) ? y1 : rand() % n - n / 2 + 35;
+		sangria_line( p_image, x1, y1, x2, y2, c );
+		reference_line( p_expected, x1, y1, x2, y2, c );
+		if( !compare( p_image, p_expected, 1 ) ) {
+			if( errors[0] < 5 ) {
+				printf( "  line (%d, %d) - (%d, %d) is different\n", x1, y1, x2, y2 );
+			}
+			errors[0]++;
+		}
+
+		//	rectangles: inside, across the edges and outside of the back buffer
+		reset( p_image, p_expected );
+		x1 = rand() % 300 - 90;
+		y1 = rand() % 200 - 60;
+		x2 = rand() % 300 - 90;
+		y2 = rand() % 200 - 60;
+		sangria_fill_rect( p_image, x1, y1, x2, y2, c );
+		reference_fill_rect( p_expected, x1, y1, x2, y2, c );
+		if( !compare( p_image, p_expected, 1 ) ) {
+			if( errors[3] < 5 ) {
+				printf( "  rectangle (%d, %d) - (%d, %d) is different\n", x1, y1, x2, y2 );
+			}
+			errors[3]++;
+		}
+
+		//	ellipses and circles
+		reset( p_image, p_expected );
+		x1 = rand() % 200 - 40;
+		y1 = rand() % 140 - 35;
+		rx = (rand() % 4 == 0) ? rand() % 4 : rand() % 70;
+		ry = (rand() % 4 == 0) ? rx : rand() % 70;
+		is_fill = rand() & 1;
+		if( is_fill ) {
+			sangria_fill_ellipse( p_image, x1, y1, rx, ry, c );
+		}
+		else {
+			sangria_ellipse( p_image, x1, y1, rx, ry, c );
+		}
+		reference_ellipse( p_expected, x1, y1, rx, ry, c, is_fill );
+		if( !compare( p_image, p_expected, 0 ) ) {
+			if( errors[1] < 5 ) {
+				printf( "  ellipse (%d, %d) %dx%d %s is different\n", x1, y1, rx, ry, is_fill ? "filled" : "outline" );
+			}
+			errors[1]++;
+		}
+
+		//	polygons, also self-intersecting ones
+		reset( p_image, p_expected );
+		n = 3 + rand() % (MAX_VERTICES - 2);
+		for( j = 0; j < n; j++ ) {
+			points[j].x = rand() % 220 - 50;
+			points[j].y = rand() % 170 - 50;
+		}
+		sangria_fill_polygon( p_image, points, n, c );
+		reference_fill_polygon( p_expected, points, n, c );
+		if( !compare( p_image, p_expected, 0 ) ) {
+			if( errors[2] < 5 ) {
+				printf( "  polygon of %d vertices (%d, %d) ... is different\n", n, points[0].x, points[0].y );
+			}
+			errors[2]++;
+		}
+	}
+	printf( "%dbpp: lines %s, rectangles %s, ellipses %s, polygons %s\n", (format == SANGRIA_FORMAT_1BPP) ? 1 : 8,
+		errors[0] ? "NG" : "OK", errors[3] ? "NG" : "OK", errors[1] ? "NG" : "OK", errors[2] ? "NG" : "OK" );
+	sangria_release_backbuffer( p_image );
+	sangria_release_backbuffer( p_expected );
+	return errors[0] + errors[1] + errors[2] + errors[3];
+}
+
+// --------------------------------------------------------------------
+//	polygons that share edges must not overlap, and must cover the whole area
+//
+static int check_tiling( void ) {
+	SANGRIA_BACKBUFFER_T *p_image;
+	SANGRIA_POINT_T points[3];
+	int i, x, y, gx, gy, errors;
+	static int count[ 71 ][ 123 ];
+	static int grid_x[5][5], grid_y[5][5];
+
+	p_image = sangria_get_backbuffer( 123, 71 );
+	memset( count, 0, sizeof(count) );
+	//	a grid of 4x4 cells, each split into 2 triangles
+	for( gy = 0; gy < 5; gy++ ) {
+		for( gx = 0; gx < 5; gx++ ) {
+			grid_x[gy][gx] = gx * 30 + ((gx % 4) ? rand() % 11 - 5 : 0);
+			grid_y[gy][gx] = gy * 17 + ((gy % 4) ? rand() % 7 - 3 : 0);
+		}
+	}
+	for( gy = 0; gy < 4; gy++ ) {
+		for( gx = 0; gx < 4; gx++ ) {
+			for( x = 0; x < 2; x++ ) {
+				points[0].x = grid_x[gy][gx];			points[0].y = grid_y[gy][gx];
+				points[1].x = grid_x[gy + 1][gx + 1];	points[1].y = grid_y[gy + 1][gx + 1];
+				points[2].x = x ? grid_x[gy][gx + 1] : grid_x[gy + 1][gx];
+				points[2].y = x ? grid_y[gy][gx + 1] : grid_y[gy + 1][gx];
+				sangria_clear_buffer( p_image, 0 );
+				sangria_fill_polygon( p_image, points, 3, 1 );
+				for( y = 0; y < 71; y++ ) {
+					for( i = 0; i < 123; i++ ) {
+						count[y][i] += (sangria_get_pixel( p_image, i, y ) != 0);
+					}
+				}
+			}
+		}
+	}
+	errors = 0;
+	for( y = 0; y < 68; y++ ) {
+		for( x = 0; x < 120; x++ ) {
+			errors += (count[y][x] != 1);
+		}
+	}
+	printf( "tiling: %s\n", errors ? "NG" : "OK" );
+	sangria_release_backbuffer( p_image );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	mode 0: sangria_shape (or the new sangria_line()), 1: pixel by pixel
+//
+static void bench( const char *p_name, int primitive ) {
+	SANGRIA_BACKBUFFER_T *p_screen;
+	SANGRIA_POINT_T points[6];
+	long long start, t[2];
+	int i, j, mode;
+
+	p_screen = sangria_get_display();
+	for( mode = 0; mode < 2; mode++ ) {
+		srand( 2 );
+		start = get_nsec();
+		for( i = 0; i < REPEAT; i++ ) {
+			switch( primitive ) {
+			case 0:
+				//	lines across the screen, half of them partly outside
+				points[0].x = rand() % 800 - 200;
+				points[0].y = rand() % 480 - 120;
+				points[1].x = rand() % 800 - 200;
+				points[1].y = rand() % 480 - 120;
+				if( mode == 0 ) {
+					sangria_line( p_screen, points[0].x, points[0].y, points[1].x, points[1].y, 1 );
+				}
+				else {
+					reference_line( p_screen, points[0].x, points[0].y, points[1].x, points[1].y, 1 );
+				}
+				break;
+			case 1:
+			case 2:
+				//	circles of radius 10 ... 49
+				points[0].x = rand() % 400;
+				points[0].y = rand() % 240;
+				j = 10 + rand() % 40;
+				if( mode == 1 ) {
+					reference_ellipse( p_screen, points[0].x, points[0].y, j, j, 1, primitive == 1 );
+				}
+				else if( primitive == 1 ) {
+					sangria_fill_circle( p_screen, points[0].x, points[0].y, j, 1 );
+				}
+				else {
+					sangria_circle( p_screen, points[0].x, points[0].y, j, 1 );
+				}
+				break;
+			default:
+				//	hexagons of radius 40 (concave)
+				points[0].x = rand() % 400;
+				points[0].y = rand() % 240;
+				for( j = 1; j < 6; j++ ) {
+					points[j].x = points[0].x + ((j & 1) ? 40 : 10) * ((j < 3) ? 1 : -1);
+					points[j].y = points[0].y + ((j & 2) ? 40 : -20);
+				}
+				if( mode == 0 ) {
+					sangria_fill_polygon( p_screen, points, 6, 1 );
+				}
+				else {
+					reference_fill_polygon( p_screen, points, 6, 1 );
+				}
+				break;
+			}
+		}
+		t[ mode ] = get_nsec() - start;
+	}
+	printf( "%-28s %9.0f shapes/s (pixel by pixel %9.0f shapes/s)\n", p_name,
+		REPEAT * 1000000000. / t[0], REPEAT * 1000000000. / t[1] );
+	sangria_release_backbuffer( p_screen );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	errors = 0;
+	errors += check( SANGRIA_FORMAT_8BPP );
+	errors += check( SANGRIA_FORMAT_1BPP );
+	errors += check_tiling();
+	if( errors ) {
+		return 1;
+	}
+	bench( "sangria_line", 0 );
+	bench( "sangria_fill_circle", 1 );
+	bench( "sangria_circle", 2 );
+	bench( "sangria_fill_polygon", 3 );
+	return 0;
+}
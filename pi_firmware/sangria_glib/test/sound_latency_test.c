@@ -0,0 +1,128 @@
+// --------------------------------------------------------------------
+// Latency of sangria_slib
+// ====================================================================
+//	A short beep is played at the top of each second by
+//	sangria_sound_write_register(), and the end-to-end latency (from a
+//	write to the time it is heard, as the audio device reports its
+//	delay) and the underruns of each second are printed.
+//	The beep can also be measured with a scope on the audio output,
+//	against the time printed when it is written.
+//
+//	usage: sound_latency_test [-p period] [-l latency] [-m max_latency]
+//	                          [-r priority] [-t seconds]
+//		-p, -l, -m  msec
+//		-r ........ SCHED_FIFO priority of the audio thread
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "sangria_slib.h"
+
+#define BEEP_TIME		50000000LL		//	nsec
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void sleep_until( long long time ) {
+	struct timespec t;
+
+	t.tv_sec	= (time_t)( time / 1000000000LL );
+	t.tv_nsec	= (long)( time % 1000000000LL );
+	clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL );
+}
+
+// --------------------------------------------------------------------
+static void beep( int is_on ) {
+
+	if( is_on ) {
+		sangria_sound_write_register( SANGRIA_SOUND_PSG_SE, 0, 0x7C );
+		sangria_sound_write_register( SANGRIA_SOUND_PSG_SE, 1, 0x00 );
+		sangria_sound_write_register( SANGRIA_SOUND_PSG_SE, 7, 0xBE );
+		sangria_sound_write_register( SANGRIA_SOUND_PSG_SE, 8, 0x0F );
+	}
+	else {
+		sangria_sound_write_register( SANGRIA_SOUND_PSG_SE, 8, 0x00 );
+	}
+}
+
+// --------------------------------------------------------------------
+static void usage( void ) {
+
+	printf( "usage: sound_latency_test [-p period] [-l latency] [-m max_latency]\n" );
+	printf( "                          [-r priority] [-t seconds]\n" );
+	printf( "  -p, -l, -m  msec\n" );
+	printf( "  -r ........ SCHED_FIFO priority of the audio thread\n" );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	SANGRIA_SOUND_CONFIG_T config;
+	SANGRIA_SOUND_STATUS_T status, last;
+	long long start, time;
+	int c, seconds, i, blocks;
+
+	sangria_sound_get_default_config( &config );
+	config.period	= 10000;
+	config.latency	= 20000;
+	seconds			= 30;
+	while( (c = getopt( argc, argv, "p:l:m:r:t:" )) != -1 ) {
+		switch( c ) {
+		case 'p':
+			config.period = (int)( atof( optarg ) * 1000 );
+			break;
+		case 'l':
+			config.latency = (int)( atof( optarg ) * 1000 );
+			break;
+		case 'm':
+			config.max_latency = (int)( atof( optarg ) * 1000 );
+			break;
+		case 'r':
+			config.priority = atoi( optarg );
+			break;
+		case 't':
+			seconds = atoi( optarg );
+			break;
+		default:
+			usage();
+			return 1;
+		}
+	}
+	if( !sangria_sound_initialize_with_config( &config ) ) {
+		printf( "ERROR: Failed sangria_sound_initialize_with_config()\n" );
+		return 1;
+	}
+	sangria_sound_get_status( &last );
+	status = last;
+	printf( "PulseAudio, period %.1f msec, %s thread\n", last.period / 1000., last.is_real_time ? "real-time" : "normal" );
+	printf( " sec   target  average     last      max  underruns  beep written at\n" );
+
+	start = (get_nsec() / 1000000000LL + 1) * 1000000000LL;
+	for( i = 0; i < seconds; i++ ) {
+		time = start + i * 1000000000LL;
+		sleep_until( time );
+		beep( 1 );
+		sleep_until( time + BEEP_TIME );
+		beep( 0 );
+
+		sleep_until( time + 999000000LL );
+		sangria_sound_get_status( &status );
+		blocks = (int)( status.blocks - last.blocks );
+		printf( "%4d %8.2f %8.2f %8.2f %8.2f %10u  %lld.%09lld\n", i,
+			status.target_latency / 1000., blocks ? (status.latency_sum - last.latency_sum) / 1000. / blocks : 0.,
+			status.last_latency / 1000., status.max_latency / 1000., status.underruns - last.underruns,
+			time / 1000000000LL, time % 1000000000LL );
+		last = status;
+	}
+	printf( "total %u underruns, the longest latency %.2f msec\n", status.underruns, status.max_latency / 1000. );
+	sangria_sound_terminate();
+	return 0;
+}
@@ -0,0 +1,294 @@
+// --------------------------------------------------------------------
+// Test of sangria_sound_queue
+// ====================================================================
+//	Random register writes at random samples of 2 PSGs and an SCC are
+//	put in the queue with their times, and the waves are made through
+//	the queue in blocks of random length. They must be the same sample
+//	by sample as the waves made by writing each register at its sample.
+//	Then a producer thread puts writes while the consumer takes them,
+//	and all of them must be taken once and in order. Then the cost of
+//	a write and of a block is printed.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include "psg_emulator.h"
+#include "scc_emulator.h"
+#include "sangria_sound_queue.h"
+
+#define SAMPLE_RATE		48000
+#define NSEC			1000000000LL
+#define SAMPLES			(SAMPLE_RATE * 2)
+#define WRITES			3000
+#define MAX_BLOCK		2000
+#define START_TIME		(1000LL * NSEC)
+#define THREAD_WRITES	2000000
+#define BENCH_BLOCK		960
+#define REPEAT			10
+
+typedef struct {
+	int			sample;
+	int			chip;
+	uint16_t	address;
+	uint8_t		data;
+} EVENT_T;
+
+static EVENT_T events[ WRITES ];
+static int16_t reference[3][ SAMPLES ];
+static int16_t wave[3][ SAMPLES ];
+static SANGRIA_SOUND_QUEUE_T queue;
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	time of a sample: the first nsec that is not before it
+//
+static int64_t time_of( int sample ) {
+
+	return START_TIME + ((int64_t) sample * NSEC + SAMPLE_RATE - 1) / SAMPLE_RATE;
+}
+
+// --------------------------------------------------------------------
+static int compare_event( const void *p1, const void *p2 ) {
+
+	return ((const EVENT_T*) p1)->sample - ((const EVENT_T*) p2)->sample;
+}
+
+// --------------------------------------------------------------------
+static void make_events( void ) {
+	int i;
+
+	for( i = 0; i < WRITES; i++ ) {
+		events[i].sample	= rand() % SAMPLES;
+		events[i].chip		= rand() % 3;
+		if( events[i].chip < 2 ) {
+			events[i].address	= rand() % 14;
+			events[i].data		= (events[i].address == 7) ? (rand() & 0x3F) | 0x80 : rand() & 255;
+		}
+		else {
+			events[i].address	= 0xB800 + rand() % 0xB0;
+			events[i].data		= rand() & 255;
+		}
+	}
+	qsort( events, WRITES, sizeof(EVENT_T), compare_event );
+}
+
+// --------------------------------------------------------------------
+static void open_chips( SANGRIA_SOUND_CHIP_T *p_chip, int16_t (*p_wave)[ SAMPLES ] ) {
+	int i;
+
+	for( i = 0; i < 3; i++ ) {
+		p_chip[i].type		= (i < 2) ? SANGRIA_SOUND_TYPE_PSG : SANGRIA_SOUND_TYPE_SCC;
+		p_chip[i].handle	= (i < 2) ? psg_initialize() : scc_initialize();
+		p_chip[i].pwave		= p_wave[i];
+	}
+}
+
+// --------------------------------------------------------------------
+static void close_chips( SANGRIA_SOUND_CHIP_T *p_chip ) {
+
+	psg_terminate( p_chip[0].handle );
+	psg_terminate( p_chip[1].handle );
+	scc_terminate( p_chip[2].handle );
+}
+
+// --------------------------------------------------------------------
+//	Each register is written at its sample.
+//
+static void render_reference( void ) {
+	SANGRIA_SOUND_CHIP_T chip[3];
+	int i, k, done, next;
+
+	open_chips( chip, reference );
+	done = 0;
+	for( i = 0; i <= WRITES; i++ ) {
+		next = (i < WRITES) ? events[i].sample : SAMPLES;
+		if( next > done ) {
+			for( k = 0; k < 3; k++ ) {
+				if( k < 2 ) {
+					psg_generate_wave( chip[k].handle, reference[k] + done, next - done );
+				}
+				else {
+					scc_generate_wave( chip[k].handle, reference[k] + done, next - done );
+				}
+			}
+			done = next;
+		}
+		if( i < WRITES ) {
+			if( events[i].chip < 2 ) {
+				psg_write_register( chip[ events[i].chip ].handle, events[i].address, events[i].data );
+			}
+			else {
+				scc_write_register( chip[2].handle, events[i].address, events[i].data );
+			}
+		}
+	}
+	close_chips( chip );
+}
+
+// --------------------------------------------------------------------
+//	The writes are put up to a block ahead, and each block is made at
+//	the time of its end.
+//
+static int render_queue( void ) {
+	SANGRIA_SOUND_CHIP_T chip[3];
+	SANGRIA_SOUND_WRITE_T write;
+	int i, k, n, done, errors;
+
+	open_chips( chip, wave );
+	sangria_sound_queue_initialize( &queue );
+	i = 0;
+	for( done = 0; done < SAMPLES; done += n ) {
+		n = 1 + rand() % MAX_BLOCK;
+		if( n > SAMPLES - done ) {
+			n = SAMPLES - done;
+		}
+		for( ; i < WRITES && events[i].sample < done + n + MAX_BLOCK; i++ ) {
+			write.time		= time_of( events[i].sample );
+			write.address	= events[i].address;
+			write.data		= events[i].data;
+			write.chip		= events[i].chip;
+			sangria_sound_queue_put( &queue, &write );
+		}
+		for( k = 0; k < 3; k++ ) {
+			chip[k].pwave = wave[k] + done;
+		}
+		sangria_sound_queue_render( &queue, chip, 3, n, START_TIME + (int64_t)( done + n ) * NSEC / SAMPLE_RATE );
+	}
+	close_chips( chip );
+
+	errors = 0;
+	for( k = 0; k < 3; k++ ) {
+		for( i = 0; i < SAMPLES; i++ ) {
+			if( wave[k][i] != reference[k][i] ) {
+				if( errors < 10 ) {
+					printf( "  chip %d sample %d: %d (%d expected)\n", k, i, wave[k][i], reference[k][i] );
+				}
+				errors++;
+			}
+		}
+	}
+	return errors;
+}
+
+// --------------------------------------------------------------------
+static void *producer_thread( void *p_full ) {
+	SANGRIA_SOUND_WRITE_T write;
+	int i;
+
+	for( i = 0; i < THREAD_WRITES; i++ ) {
+		write.time		= i;
+		write.address	= (uint16_t) i;
+		write.data		= (uint8_t)( i >> 16 );
+		write.chip		= (uint8_t)( i >> 24 );
+		while( !sangria_sound_queue_put( &queue, &write ) ) {
+			(*(int*) p_full)++;
+			sched_yield();
+		}
+	}
+	return NULL;
+}
+
+// --------------------------------------------------------------------
+static int check_threads( void ) {
+	SANGRIA_SOUND_WRITE_T write;
+	pthread_t thread;
+	int i, errors, full;
+
+	sangria_sound_queue_initialize( &queue );
+	full = 0;
+	errors = 0;
+	pthread_create( &thread, NULL, producer_thread, &full );
+	for( i = 0; i < THREAD_WRITES; ) {
+		if( !sangria_sound_queue_get( &queue, &write, INT64_MAX ) ) {
+			sched_yield();
+			continue;
+		}
+		if( write.time != i || write.address != (uint16_t) i || write.data != (uint8_t)( i >> 16 ) || write.chip != (uint8_t)( i >> 24 ) ) {
+			if( errors < 10 ) {
+				printf( "  write %d is taken as %d\n", i, (int) write.time );
+			}
+			errors++;
+		}
+		i++;
+	}
+	pthread_join( thread, NULL );
+	if( sangria_sound_queue_get( &queue, &write, INT64_MAX ) ) {
+		errors++;
+	}
+	printf( "%d writes between 2 threads: %s (the queue was full %d times)\n", THREAD_WRITES, errors ? "NG" : "OK", full );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	1 second of blocks, with 25 writes in each block or without writes
+//
+static void bench( void ) {
+	SANGRIA_SOUND_CHIP_T chip[3];
+	SANGRIA_SOUND_WRITE_T write;
+	long long start, t_put, t_render[2];
+	int i, j, k, with_writes, count;
+	int64_t now;
+
+	open_chips( chip, wave );
+	for( with_writes = 0; with_writes < 2; with_writes++ ) {
+		sangria_sound_queue_initialize( &queue );
+		t_put = 0;
+		t_render[ with_writes ] = 0;
+		count = 0;
+		now = START_TIME;
+		for( i = 0; i < REPEAT; i++ ) {
+			for( j = 0; j < SAMPLE_RATE; j += BENCH_BLOCK ) {
+				if( with_writes ) {
+					start = get_nsec();
+					for( k = 0; k < 25; k++ ) {
+						write.time		= now + k * (BENCH_BLOCK * NSEC / SAMPLE_RATE / 25);
+						write.address	= k % 14;
+						write.data		= (k % 14 == 7) ? 0xB8 : k * 7;
+						write.chip		= k % 2;
+						sangria_sound_queue_put( &queue, &write );
+					}
+					t_put += get_nsec() - start;
+					count += 25;
+				}
+				now += BENCH_BLOCK * NSEC / SAMPLE_RATE;
+				start = get_nsec();
+				sangria_sound_queue_render( &queue, chip, 3, BENCH_BLOCK, now );
+				t_render[ with_writes ] += get_nsec() - start;
+			}
+		}
+		if( with_writes ) {
+			printf( "sangria_sound_queue_put: %6.1f nsec per write\n", (double) t_put / count );
+		}
+	}
+	printf( "sangria_sound_queue_render: %8.1f usec for 1 second, %8.1f usec with 1250 writes\n",
+		t_render[0] / 1000. / REPEAT, t_render[1] / 1000. / REPEAT );
+	close_chips( chip );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	make_events();
+	render_reference();
+	errors = render_queue();
+	printf( "%d writes at their samples in blocks of 1 ... %d samples: %s\n", WRITES, MAX_BLOCK, errors ? "NG" : "OK" );
+	errors += check_threads();
+	if( errors ) {
+		return 1;
+	}
+	bench();
+	return 0;
+}
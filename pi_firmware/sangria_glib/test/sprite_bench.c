@@ -0,0 +1,207 @@
+// --------------------------------------------------------------------
+// Benchmark of sangria_sprite
+// ====================================================================
+//	A scene of 16x16 background tiles, 256 sprites and two opaque
+//	panels is drawn by sangria_sprite_render(), and by sangria_copy()
+//	of each sprite in the order of priority. Both images must be the
+//	same. Then frames/s of both are measured; sangria_copy() is given
+//	the scene already sorted, so it is the cost to beat. The display is
+//	not used.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_glib.h"
+#include "sangria_sprite.h"
+
+#define SPRITES			256
+#define REPEAT			500
+#define TILE_X			(400 / 16)
+#define TILE_Y			(240 / 16)
+
+typedef struct {
+	int			sx;
+	int			sy;
+	int			width;
+	int			height;
+	int			dx;
+	int			dy;
+	int			attribute;
+	int			priority;
+} SCENE_SPRITE_T;
+
+static SCENE_SPRITE_T scene[ TILE_X * TILE_Y + SPRITES + 2 ];
+static int scene_sprites = 0;
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	0 ... 63: 4 opaque tiles, 64 ... 127: sprites with transparent corners
+//
+static void make_pattern( SANGRIA_BACKBUFFER_T *p_image ) {
+	int x, y;
+	uint8_t c;
+
+	for( y = 0; y < p_image->height; y++ ) {
+		for( x = 0; x < p_image->width; x++ ) {
+			c = ((x ^ y) & 1) ? 1 : 255;
+			if( x >= 64 && ((x - 64) % 16 - 8) * ((x - 64) % 16 - 8) + (y % 16 - 8) * (y % 16 - 8) > 56 ) {
+				c = 0;
+			}
+			sangria_set_pixel( p_image, x, y, c );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static void add( int sx, int sy, int width, int height, int dx, int dy, int attribute, int priority ) {
+	SCENE_SPRITE_T *p = &scene[ scene_sprites++ ];
+
+	p->sx			= sx;
+	p->sy			= sy;
+	p->width		= width;
+	p->height		= height;
+	p->dx			= dx;
+	p->dy			= dy;
+	p->attribute	= attribute;
+	p->priority		= priority;
+}
+
+// --------------------------------------------------------------------
+static void make_scene( void ) {
+	int i, x, y, size;
+
+	for( y = 0; y < TILE_Y; y++ ) {
+		for( x = 0; x < TILE_X; x++ ) {
+			add( (rand() % 4) * 16, 0, 16, 16, x * 16, y * 16, SANGRIA_SPRITE_OPAQUE, 0 );
+		}
+	}
+	for( i = 0; i < SPRITES; i++ ) {
+		size = (rand() & 1) ? 16 : 32;
+		add( 64 + (rand() % 2) * 32, 0, size, size, rand() % 440 - 20, rand() % 280 - 20,
+			rand() & (SANGRIA_SPRITE_FLIP_H | SANGRIA_SPRITE_FLIP_V), 1 + rand() % 3 );
+	}
+	//	status panels
+	add( 0, 0, 64, 32, 0,   0,   SANGRIA_SPRITE_OPAQUE, 10 );
+	add( 0, 0, 64, 32, 300, 208, SANGRIA_SPRITE_OPAQUE, 10 );
+}
+
+// --------------------------------------------------------------------
+static int compare_priority( const void *p1, const void *p2 ) {
+	const SCENE_SPRITE_T *p_a = (const SCENE_SPRITE_T*) p1;
+	const SCENE_SPRITE_T *p_b = (const SCENE_SPRITE_T*) p2;
+
+	if( p_a->priority != p_b->priority ) {
+		return p_a->priority - p_b->priority;
+	}
+	return (p_a < p_b) ? -1 : 1;
+}
+
+// --------------------------------------------------------------------
+static void draw_direct( SCENE_SPRITE_T *p_sorted, SANGRIA_BACKBUFFER_T *p_pattern, SANGRIA_BACKBUFFER_T *p_screen ) {
+	int i, sx1, sx2, sy1, sy2;
+	SCENE_SPRITE_T *p;
+
+	for( i = 0; i < scene_sprites; i++ ) {
+		p = &p_sorted[i];
+		sx1 = p->sx;
+		sx2 = p->sx + p->width - 1;
+		sy1 = p->sy;
+		sy2 = p->sy + p->height - 1;
+		if( p->attribute & SANGRIA_SPRITE_FLIP_H ) {
+			sx1 = sx2;
+			sx2 = p->sx;
+		}
+		if( p->attribute & SANGRIA_SPRITE_FLIP_V ) {
+			sy1 = sy2;
+			sy2 = p->sy;
+		}
+		if( p->attribute & SANGRIA_SPRITE_OPAQUE ) {
+			sangria_copy_opaque( p_pattern, sx1, sy1, sx2, sy2, p_screen, p->dx, p->dy );
+		}
+		else {
+			sangria_copy( p_pattern, sx1, sy1, sx2, sy2, p_screen, p->dx, p->dy );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static void draw_batch( H_SANGRIA_SPRITE_T hsprite, SANGRIA_BACKBUFFER_T *p_pattern, SANGRIA_BACKBUFFER_T *p_screen ) {
+	int i;
+	SCENE_SPRITE_T *p;
+
+	sangria_sprite_clear( hsprite );
+	for( i = 0; i < scene_sprites; i++ ) {
+		p = &scene[i];
+		sangria_sprite_put( hsprite, p_pattern, p->sx, p->sy, p->width, p->height, p->dx, p->dy, p->attribute, p->priority );
+	}
+	sangria_sprite_render( hsprite, p_screen );
+}
+
+// --------------------------------------------------------------------
+static int test( SANGRIA_FORMAT_T format ) {
+	static SCENE_SPRITE_T sorted[ sizeof(scene) / sizeof(scene[0]) ];
+	SANGRIA_BACKBUFFER_T *p_pattern, *p_direct, *p_batch;
+	H_SANGRIA_SPRITE_T hsprite;
+	long long start, t_direct, t_batch;
+	int i, x, y, errors;
+
+	p_pattern	= sangria_get_backbuffer_format( 128, 32, format );
+	p_direct	= sangria_get_backbuffer_format( 400, 240, format );
+	p_batch		= sangria_get_backbuffer_format( 400, 240, format );
+	hsprite		= sangria_sprite_initialize( scene_sprites );
+	make_pattern( p_pattern );
+	memcpy( sorted, scene, sizeof(scene) );
+	qsort( sorted, scene_sprites, sizeof(SCENE_SPRITE_T), compare_priority );
+
+	draw_direct( sorted, p_pattern, p_direct );
+	draw_batch( hsprite, p_pattern, p_batch );
+	errors = 0;
+	for( y = 0; y < 240; y++ ) {
+		for( x = 0; x < 400; x++ ) {
+			if( sangria_get_pixel( p_direct, x, y ) != sangria_get_pixel( p_batch, x, y ) ) {
+				errors++;
+			}
+		}
+	}
+
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		draw_direct( sorted, p_pattern, p_direct );
+	}
+	t_direct = get_nsec() - start;
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		draw_batch( hsprite, p_pattern, p_batch );
+	}
+	t_batch = get_nsec() - start;
+
+	printf( "%dbpp, %d sprites: %s, sangria_copy %7.1f frames/s, sangria_sprite %7.1f frames/s\n",
+		(format == SANGRIA_FORMAT_1BPP) ? 1 : 8, scene_sprites, errors ? "NG" : "OK",
+		REPEAT * 1000000000. / t_direct, REPEAT * 1000000000. / t_batch );
+	sangria_sprite_terminate( hsprite );
+	sangria_release_backbuffer( p_pattern );
+	sangria_release_backbuffer( p_direct );
+	sangria_release_backbuffer( p_batch );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	make_scene();
+	errors = 0;
+	errors += test( SANGRIA_FORMAT_8BPP );
+	errors += test( SANGRIA_FORMAT_1BPP );
+	return errors ? 1 : 0;
+}
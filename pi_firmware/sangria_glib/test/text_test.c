@@ -0,0 +1,347 @@
+// --------------------------------------------------------------------
+// Test of sangria_text
+// ====================================================================
+//	Random UTF-8 strings (also with broken sequences and codes that are
+//	not in the font) are drawn at random positions and colors in both
+//	formats, with a font of random glyphs and widths, and compared with
+//	pixel by pixel references. Then a screen of 50x30 characters of the
+//	8x8 font is drawn, against the same screen by a sangria_copy() for
+//	each character from a sheet of the glyphs. The display is not used.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_glib.h"
+#include "sangria_text.h"
+#include "sample/font8x8.h"
+#include "sample/font8x8_p.h"
+
+#define CHECKS			3000
+#define REPEAT			300
+#define MAX_CODES		40
+#define CELL_WIDTH		13
+#define CELL_HEIGHT		11
+#define GLYPHS			(95 + 4)
+#define COLUMNS			50
+#define ROWS			30
+
+static uint32_t test_code[ GLYPHS ];
+static uint8_t test_width[ GLYPHS ];
+static uint8_t test_bitmap[ GLYPHS * CELL_HEIGHT * 2 ];
+static const SANGRIA_FONT_T test_font = {
+	CELL_WIDTH, CELL_HEIGHT, GLYPHS, test_code, test_width, test_bitmap,
+};
+
+//	broken sequences and the codes drawn for them
+typedef struct {
+	const char	*p_bytes;
+	int			codes;
+} BROKEN_T;
+
+static const BROKEN_T broken[] = {
+	{ "\x80", 1 },				//	continuation byte
+	{ "\xC3" "A", 2 },			//	cut by 'A'
+	{ "\xE3\x81" "A", 2 },
+	{ "\xC0\xAF", 2 },			//	overlong
+	{ "\xED\xA0\x80", 1 },		//	surrogate
+	{ "\xF4\x90\x80\x80", 1 },	//	> U+10FFFF
+	{ "\xFF", 1 },
+};
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	ASCII, U+00E9, U+3042, U+1F600 and U+FFFD is not there. Widths are
+//	up to 15 (clipped to the cell) and 0.
+//
+static void make_test_font( void ) {
+	int i;
+
+	for( i = 0; i < 95; i++ ) {
+		test_code[i] = 0x20 + i;
+	}
+	test_code[ 95 ] = 0xE9;
+	test_code[ 96 ] = 0x7FF;
+	test_code[ 97 ] = 0x3042;
+	test_code[ 98 ] = 0x1F600;
+	for( i = 0; i < GLYPHS; i++ ) {
+		test_width[i] = rand() % 16;
+	}
+	for( i = 0; i < (int) sizeof(test_bitmap); i++ ) {
+		test_bitmap[i] = rand();
+	}
+}
+
+// --------------------------------------------------------------------
+static int encode_utf8( uint32_t code, char *p ) {
+
+	if( code < 0x80 ) {
+		p[0] = code;
+		return 1;
+	}
+	if( code < 0x800 ) {
+		p[0] = 0xC0 | (code >> 6);
+		p[1] = 0x80 | (code & 0x3F);
+		return 2;
+	}
+	if( code < 0x10000 ) {
+		p[0] = 0xE0 | (code >> 12);
+		p[1] = 0x80 | ((code >> 6) & 0x3F);
+		p[2] = 0x80 | (code & 0x3F);
+		return 3;
+	}
+	p[0] = 0xF0 | (code >> 18);
+	p[1] = 0x80 | ((code >> 12) & 0x3F);
+	p[2] = 0x80 | ((code >> 6) & 0x3F);
+	p[3] = 0x80 | (code & 0x3F);
+	return 4;
+}
+
+// --------------------------------------------------------------------
+static int find_glyph( const SANGRIA_FONT_T *p_font, uint32_t code ) {
+	int i;
+
+	for( i = 0; i < p_font->glyphs; i++ ) {
+		if( p_font->p_code[i] == code ) {
+			return i;
+		}
+	}
+	return -1;
+}
+
+// --------------------------------------------------------------------
+//	A string of random codes and the codes to be drawn ('\n' as is).
+//
+static int make_string( char *p_text, uint32_t *p_codes ) {
+	static const uint32_t others[] = { 0xE9, 0x7FF, 0x3042, 0x1F600, 0xE8, 0x3044, 0x1F601, '\n' };
+	int i, k, n, len, count;
+
+	len = 0;
+	n = 0;
+	count = rand() % MAX_CODES;
+	for( i = 0; i < count; i++ ) {
+		k = rand() % 10;
+		if( k == 0 ) {
+			k = rand() % (sizeof(broken) / sizeof(broken[0]));
+			strcpy( p_text + len, broken[k].p_bytes );
+			len += strlen( broken[k].p_bytes );
+			p_codes[ n++ ] = '?';
+			if( broken[k].codes == 2 ) {
+				p_codes[ n++ ] = (uint8_t) p_text[ len - 1 ] < 0x80 ? (uint8_t) p_text[ len - 1 ] : '?';
+			}
+		}
+		else if( k == 1 ) {
+			p_codes[n] = others[ rand() % (sizeof(others) / sizeof(others[0])) ];
+			len += encode_utf8( p_codes[n], p_text + len );
+			if( p_codes[n] != '\n' && find_glyph( &test_font, p_codes[n] ) < 0 ) {
+				p_codes[n] = '?';
+			}
+			n++;
+		}
+		else {
+			p_codes[n] = 0x20 + rand() % 95;
+			p_text[ len++ ] = p_codes[ n++ ];
+		}
+	}
+	p_text[ len ] = '\0';
+	return n;
+}
+
+// --------------------------------------------------------------------
+static int reference_draw( SANGRIA_BACKBUFFER_T *p_image, const SANGRIA_FONT_T *p_font, int x, int y,
+	const uint32_t *p_codes, int n, uint8_t c, uint8_t background ) {
+	const uint8_t *p_bits;
+	int i, g, w, gx, gy, stride;
+	uint8_t d;
+
+	stride = (p_font->cell_width + 7) >> 3;
+	for( i = 0; i < n; i++ ) {
+		g = find_glyph( p_font, p_codes[i] );
+		w = (p_font->p_width[g] < p_font->cell_width) ? p_font->p_width[g] : p_font->cell_width;
+		for( gy = 0; gy < p_font->height; gy++ ) {
+			p_bits = p_font->p_bitmap + (g * p_font->height + gy) * stride;
+			for( gx = 0; gx < w; gx++ ) {
+				d = (p_bits[ gx >> 3 ] & (0x80 >> (gx & 7))) ? c : background;
+				if( d ) {
+					sangria_set_pixel( p_image, x + gx, y + gy, d );
+				}
+			}
+		}
+		x += w;
+	}
+	return x;
+}
+
+// --------------------------------------------------------------------
+static int is_same( SANGRIA_BACKBUFFER_T *p_a, SANGRIA_BACKBUFFER_T *p_b ) {
+	int x, y;
+
+	for( y = 0; y < p_a->height; y++ ) {
+		for( x = 0; x < p_a->width; x++ ) {
+			if( sangria_get_pixel( p_a, x, y ) != sangria_get_pixel( p_b, x, y ) ) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static int check( SANGRIA_FORMAT_T format ) {
+	static const uint8_t colors[] = { 0, 1, 100, 128, 255 };
+	static char text[ MAX_CODES * 4 + 1 ];
+	static uint32_t codes[ MAX_CODES * 2 ];
+	SANGRIA_BACKBUFFER_T *p_image, *p_expected;
+	H_SANGRIA_TEXT_T htext;
+	int i, j, k, n, x, y, left, top, end_x, w, max_w, errors;
+	uint8_t c, background;
+
+	errors = 0;
+	htext = sangria_text_initialize( &test_font, format, 1, 0 );
+	p_image = sangria_get_backbuffer_format( 123, 77, format );
+	p_expected = sangria_get_backbuffer_format( 123, 77, format );
+	for( i = 0; i < CHECKS; i++ ) {
+		c = colors[ rand() % 5 ];
+		background = colors[ rand() % 5 ];
+		sangria_text_set_color( htext, c, background );
+		sangria_clear_buffer( p_image, colors[ i % 5 ] );
+		sangria_fill_rect( p_image, rand() % 123, rand() % 77, rand() % 123, rand() % 77, colors[ rand() % 5 ] );
+		sangria_copy_opaque( p_image, 0, 0, 122, 76, p_expected, 0, 0 );
+		n = make_string( text, codes );
+		x = rand() % 300 - 150;
+		y = rand() % 150 - 75;
+		end_x = sangria_text_draw( htext, p_image, x, y, text );
+		//	the reference draws each line from x
+		left	= x;
+		top		= y;
+		max_w	= 0;
+		for( j = 0; j < n; j = k + 1 ) {
+			for( k = j; k < n && codes[k] != '\n'; k++ ) {
+			}
+			x = reference_draw( p_expected, &test_font, left, y, codes + j, k - j, c, background );
+			y += CELL_HEIGHT;
+			w = x - left;
+			max_w = (w > max_w) ? w : max_w;
+		}
+		if( n == 0 || codes[ n - 1 ] == '\n' ) {
+			x = left;
+		}
+		if( !is_same( p_image, p_expected ) || end_x != x || sangria_text_width( htext, text ) != max_w ) {
+			printf( "  \"%s\" at (%d, %d) in %d/%d, end %d (%d)\n", text, left, top, c, background, end_x, x );
+			errors++;
+		}
+	}
+	sangria_release_backbuffer( p_image );
+	sangria_release_backbuffer( p_expected );
+	sangria_text_terminate( htext );
+	printf( "%dbpp text: %s\n", (format == SANGRIA_FORMAT_1BPP) ? 1 : 8, errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+static int check_width( void ) {
+	H_SANGRIA_TEXT_T htext;
+	int errors;
+
+	htext = sangria_text_initialize( p_font8x8_p, SANGRIA_FORMAT_1BPP, 1, 0 );
+	errors = 0;
+	//	'W' 8, 'i' 4, '!' 3, ' ' 4
+	errors += (sangria_text_width( htext, "Wi!" ) != 15);
+	errors += (sangria_text_width( htext, "i\nW W\n!" ) != 20);
+	errors += (sangria_text_width( htext, "" ) != 0);
+	//	U+00E9 is drawn as '?'
+	errors += (sangria_text_width( htext, "\xC3\xA9" ) != 8);
+	sangria_text_terminate( htext );
+	errors += (sangria_text_initialize( p_font8x8, 2, 1, 0 ) != NULL);
+	printf( "width: %s\n", errors ? "NG" : "OK" );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+static void make_screen( char screen[ ROWS ][ COLUMNS + 1 ] ) {
+	int x, y;
+
+	for( y = 0; y < ROWS; y++ ) {
+		for( x = 0; x < COLUMNS; x++ ) {
+			screen[y][x] = 0x21 + rand() % 94;
+		}
+		screen[y][ COLUMNS ] = '\0';
+	}
+}
+
+// --------------------------------------------------------------------
+static void bench( SANGRIA_FORMAT_T format, uint8_t background ) {
+	static char screen[ ROWS ][ COLUMNS + 1 ];
+	static char sheet_text[ 97 ];
+	SANGRIA_BACKBUFFER_T *p_image, *p_sheet;
+	H_SANGRIA_TEXT_T htext;
+	long long start, t_text, t_copy;
+	int i, x, y, g;
+
+	make_screen( screen );
+	htext = sangria_text_initialize( p_font8x8, format, 1, background );
+	p_image = sangria_get_backbuffer_format( 400, 240, format );
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		for( y = 0; y < ROWS; y++ ) {
+			sangria_text_draw( htext, p_image, 0, y * 8, screen[y] );
+		}
+	}
+	t_text = get_nsec() - start;
+
+	//	a sheet of the glyphs, and a copy for each character
+	for( i = 0; i < 96; i++ ) {
+		sheet_text[i] = 0x20 + i;
+	}
+	p_sheet = sangria_get_backbuffer_format( 96 * 8, 8, format );
+	sangria_text_draw( htext, p_sheet, 0, 0, sheet_text );
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		for( y = 0; y < ROWS; y++ ) {
+			for( x = 0; x < COLUMNS; x++ ) {
+				g = screen[y][x] - 0x20;
+				if( background ) {
+					sangria_copy_opaque( p_sheet, g * 8, 0, g * 8 + 7, 7, p_image, x * 8, y * 8 );
+				}
+				else {
+					sangria_copy( p_sheet, g * 8, 0, g * 8 + 7, 7, p_image, x * 8, y * 8 );
+				}
+			}
+		}
+	}
+	t_copy = get_nsec() - start;
+	printf( "%dbpp %-12s 50x30 screen: sangria_text_draw %7.1f usec, sangria_copy per character %7.1f usec\n",
+		(format == SANGRIA_FORMAT_1BPP) ? 1 : 8, background ? "opaque" : "transparent",
+		t_text / 1000. / REPEAT, t_copy / 1000. / REPEAT );
+	sangria_release_backbuffer( p_sheet );
+	sangria_release_backbuffer( p_image );
+	sangria_text_terminate( htext );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	make_test_font();
+	errors = 0;
+	errors += check( SANGRIA_FORMAT_8BPP );
+	errors += check( SANGRIA_FORMAT_1BPP );
+	errors += check_width();
+	if( errors ) {
+		return 1;
+	}
+	bench( SANGRIA_FORMAT_1BPP, 0 );
+	bench( SANGRIA_FORMAT_1BPP, 255 );
+	bench( SANGRIA_FORMAT_8BPP, 0 );
+	bench( SANGRIA_FORMAT_8BPP, 255 );
+	return 0;
+}
@@ -0,0 +1,210 @@
+// --------------------------------------------------------------------
+// Test of sangria_tilemap
+// ====================================================================
+//	Layers are scrolled at random, with and without line scroll tables,
+//	and every frame is compared with a pixel by pixel reference. Then
+//	the two parallax layers of sample/game_demo.c are drawn by
+//	sangria_copy() of 800x200 images and by tilemaps, and frames/s of
+//	both are printed. The display is not used.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_glib.h"
+#include "sangria_tilemap.h"
+
+#define FRAMES			3000
+#define REPEAT			500
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+static void random_image( SANGRIA_BACKBUFFER_T *p_image, int transparent_percent ) {
+	int x, y;
+	uint8_t c;
+
+	for( y = 0; y < p_image->height; y++ ) {
+		for( x = 0; x < p_image->width; x++ ) {
+			c = (rand() % 100 < transparent_percent) ? 0 : ((rand() & 1) ? 1 : 255);
+			sangria_set_pixel( p_image, x, y, c );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static int wrap( int x, int size ) {
+
+	x %= size;
+	return (x < 0) ? x + size : x;
+}
+
+// --------------------------------------------------------------------
+static void draw_reference( SANGRIA_BACKBUFFER_T *p_sheet, int tw, int th, const uint16_t *p_map, int mw, int mh,
+	int scroll_x, int scroll_y, const int16_t *p_line_x, SANGRIA_BACKBUFFER_T *p_dest, int dy, int lines ) {
+	int l, x, mx, my, tile;
+	uint8_t d;
+
+	for( l = 0; l < lines; l++ ) {
+		my = wrap( scroll_y + l, mh * th );
+		for( x = 0; x < p_dest->width; x++ ) {
+			mx = wrap( scroll_x + (p_line_x ? p_line_x[l] : 0) + x, mw * tw );
+			tile = p_map[ (mx / tw) + (my / th) * mw ];
+			if( tile == SANGRIA_TILEMAP_EMPTY ) continue;
+			d = sangria_get_pixel( p_sheet, (tile % (p_sheet->width / tw)) * tw + mx % tw, (tile / (p_sheet->width / tw)) * th + my % th );
+			if( d ) {
+				sangria_set_pixel( p_dest, x, dy + l, d );
+			}
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static int check( SANGRIA_FORMAT_T format ) {
+	SANGRIA_BACKBUFFER_T *p_sheet, *p_background, *p_dest, *p_expected;
+	H_SANGRIA_TILEMAP_T htilemap;
+	static uint16_t map[ 7 * 5 ];
+	static int16_t line_x[ 90 ];
+	int i, x, y, scroll_x, scroll_y, dy, lines, use_line_x, errors;
+
+	p_sheet			= sangria_get_backbuffer_format( 64, 48, format );
+	p_background	= sangria_get_backbuffer_format( 123, 71, format );
+	p_dest			= sangria_get_backbuffer_format( 123, 71, format );
+	p_expected		= sangria_get_backbuffer_format( 123, 71, format );
+	random_image( p_sheet, 30 );
+	random_image( p_background, 0 );
+	for( i = 0; i < 7 * 5; i++ ) {
+		map[i] = (rand() % 8 == 0) ? SANGRIA_TILEMAP_EMPTY : rand() % 12;
+	}
+	htilemap = sangria_tilemap_initialize( p_sheet, 16, 16, map, 7, 5 );
+
+	scroll_x	= 0;
+	scroll_y	= 0;
+	dy			= 10;
+	lines		= 50;
+	use_line_x	= 0;
+	errors		= 0;
+	for( i = 0; i < FRAMES; i++ ) {
+		//	Most frames keep the position, so the cache is used.
+		switch( rand() % 8 ) {
+		case 0:
+			scroll_x += rand() % 41 - 20;
+			scroll_y += rand() % 41 - 20;
+			break;
+		case 1:
+			dy		= rand() % 101 - 30;
+			lines	= 1 + rand() % 90;
+			break;
+		case 2:
+			use_line_x = !use_line_x;
+			for( y = 0; y < 90; y++ ) {
+				line_x[y] = (y / 8) * 3 - 20;
+			}
+			break;
+		case 3:
+			line_x[ rand() % 90 ] += rand() % 5 - 2;
+			break;
+		case 4:
+			x = rand() % 7;
+			y = rand() % 5;
+			map[ x + y * 7 ] = (rand() % 8 == 0) ? SANGRIA_TILEMAP_EMPTY : rand() % 12;
+			sangria_tilemap_set_tile( htilemap, x, y, map[ x + y * 7 ] );
+			break;
+		}
+		sangria_tilemap_scroll( htilemap, scroll_x, scroll_y );
+		sangria_tilemap_set_line_scroll( htilemap, use_line_x ? line_x : NULL, 90 );
+		sangria_copy_opaque( p_background, 0, 0, 122, 70, p_dest, 0, 0 );
+		sangria_copy_opaque( p_background, 0, 0, 122, 70, p_expected, 0, 0 );
+		sangria_tilemap_render( htilemap, p_dest, dy, lines );
+		draw_reference( p_sheet, 16, 16, map, 7, 5, scroll_x, scroll_y, use_line_x ? line_x : NULL, p_expected, dy, lines );
+		for( y = 0; y < 71; y++ ) {
+			for( x = 0; x < 123; x++ ) {
+				if( sangria_get_pixel( p_dest, x, y ) != sangria_get_pixel( p_expected, x, y ) ) {
+					if( errors < 5 ) {
+						printf( "  frame %d: (%d, %d) is different\n", i, x, y );
+					}
+					errors++;
+					y = 71;
+					break;
+				}
+			}
+		}
+	}
+	printf( "%dbpp: %s\n", (format == SANGRIA_FORMAT_1BPP) ? 1 : 8, errors ? "NG" : "OK" );
+	sangria_tilemap_terminate( htilemap );
+	sangria_release_backbuffer( p_sheet );
+	sangria_release_backbuffer( p_background );
+	sangria_release_backbuffer( p_dest );
+	sangria_release_backbuffer( p_expected );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	mode 0: sangria_copy() of 800x200 images, 1: scrolled tilemaps, 2: still tilemaps
+//
+static void bench( const char *p_name, int mode ) {
+	SANGRIA_BACKBUFFER_T *p_layer, *p_sheet, *p_screen;
+	H_SANGRIA_TILEMAP_T htilemap1, htilemap2;
+	static uint16_t map[ 50 * 13 ];
+	long long start, t;
+	int i, x1, x2;
+
+	p_layer		= sangria_get_backbuffer( 800, 200 );
+	p_sheet		= sangria_get_backbuffer( 256, 256 );
+	p_screen	= sangria_get_display();
+	random_image( p_layer, 30 );
+	random_image( p_sheet, 30 );
+	for( i = 0; i < 50 * 13; i++ ) {
+		map[i] = rand() % 256;
+	}
+	htilemap1 = sangria_tilemap_initialize( p_sheet, 16, 16, map, 50, 13 );
+	htilemap2 = sangria_tilemap_initialize( p_sheet, 16, 16, map, 50, 13 );
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		x1 = (mode == 2) ? 0 : i % 800;
+		x2 = (mode == 2) ? 0 : (i * 2) % 800;
+		if( mode == 0 ) {
+			sangria_copy( p_layer, 0, 0, 799, 199, p_screen,     - x1, 50 );
+			sangria_copy( p_layer, 0, 0, 799, 199, p_screen, 800 - x1, 50 );
+			sangria_copy( p_layer, 0, 0, 799, 179, p_screen,     - x2, 60 );
+			sangria_copy( p_layer, 0, 0, 799, 179, p_screen, 800 - x2, 60 );
+		}
+		else {
+			sangria_tilemap_scroll( htilemap1, x1, 0 );
+			sangria_tilemap_render( htilemap1, p_screen, 50, 190 );
+			sangria_tilemap_scroll( htilemap2, x2, 0 );
+			sangria_tilemap_render( htilemap2, p_screen, 60, 180 );
+		}
+	}
+	t = get_nsec() - start;
+	printf( "%-28s %7.1f frames/s\n", p_name, REPEAT * 1000000000. / t );
+	sangria_tilemap_terminate( htilemap1 );
+	sangria_tilemap_terminate( htilemap2 );
+	sangria_release_backbuffer( p_layer );
+	sangria_release_backbuffer( p_sheet );
+	sangria_release_backbuffer( p_screen );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	errors = 0;
+	errors += check( SANGRIA_FORMAT_8BPP );
+	errors += check( SANGRIA_FORMAT_1BPP );
+	if( errors ) {
+		return 1;
+	}
+	bench( "800x200 images", 0 );
+	bench( "tilemaps, scrolled", 1 );
+	bench( "tilemaps, still", 2 );
+	return 0;
+}
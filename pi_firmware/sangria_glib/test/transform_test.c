@@ -0,0 +1,216 @@
+// --------------------------------------------------------------------
+// Test of sangria_stretch_copy() and sangria_rotate_copy()
+// ====================================================================
+//	The results must be the same as the former implementations, which
+//	divide for each pixel. Random areas, including mirrored ones and
+//	ones outside of the back buffers, are drawn in both formats.
+//	The speed of rotate_demo is printed at the end.
+// --------------------------------------------------------------------
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sangria_glib.h"
+
+#define CHECKS			5000
+#define REPEAT			200
+
+// --------------------------------------------------------------------
+static long long get_nsec( void ) {
+	struct timespec t;
+
+	clock_gettime( CLOCK_MONOTONIC, &t );
+	return (long long) t.tv_sec * 1000000000LL + t.tv_nsec;
+}
+
+// --------------------------------------------------------------------
+//	sangria_stretch_copy() before the DDA version
+//
+static void stretch_copy_reference( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1, int dx2, int dy2 ) {
+	int x, y, vx, vy, sx, sy, sw, dw, sh, dh, dx1d, dx2d, dy1d, dy2d;
+	uint8_t d;
+
+	if( (dx1 < 0) && (dx2 < 0) ) return;
+	if( (dy1 < 0) && (dy2 < 0) ) return;
+	if( (dx1 >= p_dest_image->width)  && (dx2 >= p_dest_image->width)  ) return;
+	if( (dy1 >= p_dest_image->height) && (dy2 >= p_dest_image->height) ) return;
+	vx = (dx1 < dx2) ? 1 : -1;
+	vy = (dy1 < dy2) ? 1 : -1;
+	sw = abs(sx2 - sx1) + 1;
+	sh = abs(sy2 - sy1) + 1;
+	dw = abs(dx2 - dx1) + 1;
+	dh = abs(dy2 - dy1) + 1;
+	dx1d = (dx1 < 0) ? 0 : (dx1 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx1;
+	dx2d = (dx2 < 0) ? 0 : (dx2 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx2;
+	dy1d = (dy1 < 0) ? 0 : (dy1 >= p_dest_image->height) ? p_dest_image->height - 1: dy1;
+	dy2d = (dy2 < 0) ? 0 : (dy2 >= p_dest_image->height) ? p_dest_image->height - 1: dy2;
+	for( y = dy1d; ; y += vy ) {
+		sy = (y - dy1) * sh / dh + sy1;
+		for( x = dx1d; ; x += vx ) {
+			sx = (x - dx1) * sw / dw + sx1;
+			d = sangria_get_pixel( p_src_image, sx, sy );
+			if( d ) {
+				sangria_set_pixel( p_dest_image, x, y, d );
+			}
+			if( x == dx2d ) break;
+		}
+		if( y == dy2d ) break;
+	}
+}
+
+// --------------------------------------------------------------------
+static int inline _linear( int sx1, int sx2, int dx, int dxs, int dw ) {
+
+	return (sx2 - sx1) * (dx - dxs) / dw + sx1;
+}
+
+// --------------------------------------------------------------------
+//	sangria_rotate_copy() before the DDA version
+//
+static void rotate_copy_reference( SANGRIA_BACKBUFFER_T *p_src_image, int sx1, int sy1, int sx2, int sy2, int sx3, int sy3, SANGRIA_BACKBUFFER_T *p_dest_image, int dx1, int dy1, int dx2, int dy2 ) {
+	int sx4, sy4, sx1y, sy1y, sx2y, sy2y, sx, sy, x, y, vx, vy, dw, dh, dx1d, dx2d, dy1d, dy2d;
+	uint8_t d;
+
+	vx = (dx1 < dx2) ? 1 : -1;
+	vy = (dy1 < dy2) ? 1 : -1;
+	dw = abs(dx2 - dx1) + 1;
+	dh = abs(dy2 - dy1) + 1;
+	dx1d = (dx1 < 0) ? 0 : (dx1 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx1;
+	dx2d = (dx2 < 0) ? 0 : (dx2 >= p_dest_image->width ) ? p_dest_image->width  - 1: dx2;
+	dy1d = (dy1 < 0) ? 0 : (dy1 >= p_dest_image->height) ? p_dest_image->height - 1: dy1;
+	dy2d = (dy2 < 0) ? 0 : (dy2 >= p_dest_image->height) ? p_dest_image->height - 1: dy2;
+	sx4 = sx3 + sx2 - sx1;
+	sy4 = sy3 + sy2 - sy1;
+	for( y = dy1d; ; y += vy ) {
+		sx1y = _linear( sx1, sx3, y, dy1, dh );
+		sy1y = _linear( sy1, sy3, y, dy1, dh );
+		sx2y = _linear( sx2, sx4, y, dy1, dh );
+		sy2y = _linear( sy2, sy4, y, dy1, dh );
+		for( x = dx1d; ; x += vx ) {
+			sx = _linear( sx1y, sx2y, x, dx1, dw );
+			sy = _linear( sy1y, sy2y, x, dx1, dw );
+			d = sangria_get_pixel( p_src_image, sx, sy );
+			if( d ) {
+				sangria_set_pixel( p_dest_image, x, y, d );
+			}
+			if( x == dx2d ) break;
+		}
+		if( y == dy2d ) break;
+	}
+}
+
+// --------------------------------------------------------------------
+static void random_image( SANGRIA_BACKBUFFER_T *p_image ) {
+	int x, y;
+	uint8_t c;
+
+	for( y = 0; y < p_image->height; y++ ) {
+		for( x = 0; x < p_image->width; x++ ) {
+			c = (rand() % 100 < 30) ? 0 : ((rand() & 1) ? 1 : 255);
+			sangria_set_pixel( p_image, x, y, c );
+		}
+	}
+}
+
+// --------------------------------------------------------------------
+static int is_same( SANGRIA_BACKBUFFER_T *p_a, SANGRIA_BACKBUFFER_T *p_b ) {
+	int x, y;
+
+	for( y = 0; y < p_a->height; y++ ) {
+		for( x = 0; x < p_a->width; x++ ) {
+			if( sangria_get_pixel( p_a, x, y ) != sangria_get_pixel( p_b, x, y ) ) {
+				return 0;
+			}
+		}
+	}
+	return 1;
+}
+
+// --------------------------------------------------------------------
+static int check( SANGRIA_FORMAT_T format, int is_rotate ) {
+	SANGRIA_BACKBUFFER_T *p_src, *p_dest, *p_expected;
+	int i, s[6], d[4], errors;
+
+	p_src		= sangria_get_backbuffer_format( 53, 37, format );
+	p_dest		= sangria_get_backbuffer_format( 101, 67, format );
+	p_expected	= sangria_get_backbuffer_format( 101, 67, format );
+	random_image( p_src );
+	errors = 0;
+	for( i = 0; i < CHECKS; i++ ) {
+		s[0] = rand() % 93 - 20;
+		s[1] = rand() % 77 - 20;
+		s[2] = rand() % 93 - 20;
+		s[3] = rand() % 77 - 20;
+		s[4] = rand() % 93 - 20;
+		s[5] = rand() % 77 - 20;
+		d[0] = rand() % 161 - 30;
+		d[1] = rand() % 127 - 30;
+		d[2] = rand() % 161 - 30;
+		d[3] = rand() % 127 - 30;
+		sangria_clear_buffer( p_dest, 0 );
+		sangria_clear_buffer( p_expected, 0 );
+		if( is_rotate ) {
+			sangria_rotate_copy( p_src, s[0], s[1], s[2], s[3], s[4], s[5], p_dest, d[0], d[1], d[2], d[3] );
+			rotate_copy_reference( p_src, s[0], s[1], s[2], s[3], s[4], s[5], p_expected, d[0], d[1], d[2], d[3] );
+		}
+		else {
+			sangria_stretch_copy( p_src, s[0], s[1], s[2], s[3], p_dest, d[0], d[1], d[2], d[3] );
+			stretch_copy_reference( p_src, s[0], s[1], s[2], s[3], p_expected, d[0], d[1], d[2], d[3] );
+		}
+		if( !is_same( p_dest, p_expected ) ) {
+			printf( "  mismatch: (%d, %d)-(%d, %d)-(%d, %d) to (%d, %d)-(%d, %d)\n", s[0], s[1], s[2], s[3], s[4], s[5], d[0], d[1], d[2], d[3] );
+			errors++;
+		}
+	}
+	printf( "%s, %dbpp: %s\n", is_rotate ? "sangria_rotate_copy" : "sangria_stretch_copy",
+		(format == SANGRIA_FORMAT_1BPP) ? 1 : 8, errors ? "NG" : "OK" );
+	sangria_release_backbuffer( p_src );
+	sangria_release_backbuffer( p_dest );
+	sangria_release_backbuffer( p_expected );
+	return errors;
+}
+
+// --------------------------------------------------------------------
+//	400x240 to 400x240 rotated by 30 degrees, as sample/rotate_demo.c
+//
+static void bench( const char *p_name, int is_reference ) {
+	SANGRIA_BACKBUFFER_T *p_src, *p_screen;
+	long long start, t;
+	int i;
+
+	p_src		= sangria_get_backbuffer( 400, 240 );
+	p_screen	= sangria_get_backbuffer( 400, 240 );
+	random_image( p_src );
+	start = get_nsec();
+	for( i = 0; i < REPEAT; i++ ) {
+		if( is_reference ) {
+			rotate_copy_reference( p_src, 87, -84, 432, 115, -32, 123, p_screen, 0, 0, 399, 239 );
+		}
+		else {
+			sangria_rotate_copy( p_src, 87, -84, 432, 115, -32, 123, p_screen, 0, 0, 399, 239 );
+		}
+	}
+	t = get_nsec() - start;
+	printf( "%-28s %7.1f frames/s\n", p_name, REPEAT * 1000000000. / t );
+	sangria_release_backbuffer( p_src );
+	sangria_release_backbuffer( p_screen );
+}
+
+// --------------------------------------------------------------------
+int main( int argc, char *argv[] ) {
+	int errors;
+
+	srand( 1 );
+	errors = 0;
+	errors += check( SANGRIA_FORMAT_8BPP, 0 );
+	errors += check( SANGRIA_FORMAT_8BPP, 1 );
+	errors += check( SANGRIA_FORMAT_1BPP, 0 );
+	errors += check( SANGRIA_FORMAT_1BPP, 1 );
+	if( errors ) {
+		return 1;
+	}
+	bench( "rotate, former version", 1 );
+	bench( "rotate, DDA version", 0 );
+	return 0;
+}
@@ -43,18 +43,162 @@ def convert( input_name, output_name ):
 		file.write( '};\n' )
 	print( "Success!!" )
 
+# -----------------------------------------------------------------------------
+#  SANGRIA_FONT_T of sangria_text.h (pi_firmware/sangria_glib)
+#	Glyphs are cut from the image left to right and top to bottom, and
+#	sorted by the code. A glyph line is ( cell_width + 7 ) / 8 bytes, bit7
+#	is the left pixel, 1 is a white pixel of the image.
+#	Proportional: the blank columns on the left are removed, and the
+#	width is the rest + 1 column of space (the half of the cell if blank).
+# -----------------------------------------------------------------------------
+def get_glyph( img, left, top, cell_width, cell_height ):
+	lines = []
+	for y in range( 0, cell_height ):
+		d = 0
+		for x in range( 0, cell_width ):
+			( r, g, b ) = img.getpixel( ( left + x, top + y ) )
+			d = ( d << 1 ) | ( 1 if int((r + g + b) / 3) >= 128 else 0 )
+		lines.append( d )
+	return lines
+
+def make_proportional( lines, cell_width ):
+	used = 0
+	for d in lines:
+		used |= d
+	if used == 0:
+		return ( lines, ( cell_width + 1 ) // 2 )
+	left = cell_width - used.bit_length()
+	right = 0
+	while ( used >> right ) & 1 == 0:
+		right = right + 1
+	lines = [ ( d << left ) & ( ( 1 << cell_width ) - 1 ) for d in lines ]
+	return ( lines, min( cell_width - left - right + 1, cell_width ) )
+
+def convert_sangria( input_name, output_name, cell_size, map_name, is_proportional ):
+	try:
+		img = Image.open( input_name )
+	except:
+		print( "ERROR: Cannot read the '%s'." % input_name )
+		return
+
+	( cell_width, cell_height ) = cell_size
+	if cell_width < 1 or cell_width > 32 or cell_height < 1:
+		print( "ERROR: The glyph must be 1 ... 32 pixels wide." )
+		return
+	img = img.convert( 'RGB' )
+	columns = img.width // cell_width
+	count = columns * ( img.height // cell_height )
+	if map_name is None:
+		codes = [ 32 + i for i in range( 0, count ) ]
+	else:
+		with open( map_name, 'rt', encoding='utf-8' ) as file:
+			codes = [ ord( c ) for c in file.read() if c != '\n' and c != '\r' ]
+		if len( codes ) > count or len( set( codes ) ) != len( codes ):
+			print( "ERROR: '%s' has %d characters, duplicated or more than %d glyphs." % ( map_name, len( codes ), count ) )
+			return
+
+	glyphs = []
+	for i in range( 0, len( codes ) ):
+		lines = get_glyph( img, ( i % columns ) * cell_width, ( i // columns ) * cell_height, cell_width, cell_height )
+		width = cell_width
+		if is_proportional:
+			( lines, width ) = make_proportional( lines, cell_width )
+		glyphs.append( ( codes[i], width, lines ) )
+	glyphs.sort()
+
+	name = re.sub( r'^.*/', r'', output_name )
+	stride = ( cell_width + 7 ) // 8
+	with open( "%s.c" % output_name, 'wt' ) as file:
+		file.write( "// --------------------------------------------------------------------\n" )
+		file.write( "//  Font data: [%s]\n" % re.sub( r'^.*/', r'', input_name ) )
+		file.write( "// --------------------------------------------------------------------\n" )
+		file.write( "\n" )
+		file.write( "#include <sangria_text.h>\n" )
+		file.write( "\n" )
+		file.write( "static const uint32_t _%s_code[] = {\n" % name )
+		for i in range( 0, len( glyphs ), 8 ):
+			file.write( "\t%s,\n" % ", ".join( "0x%04X" % g[0] for g in glyphs[ i : i + 8 ] ) )
+		file.write( "};\n" )
+		file.write( "\n" )
+		file.write( "static const uint8_t _%s_width[] = {\n" % name )
+		for i in range( 0, len( glyphs ), 16 ):
+			file.write( "\t%s,\n" % ", ".join( "%d" % g[1] for g in glyphs[ i : i + 16 ] ) )
+		file.write( "};\n" )
+		file.write( "\n" )
+		file.write( "static const uint8_t _%s_bitmap[] = {\n" % name )
+		for ( code, width, lines ) in glyphs:
+			file.write( "\t" )
+			for d in lines:
+				d = d << ( stride * 8 - cell_width )
+				for k in range( stride - 1, -1, -1 ):
+					file.write( "0x%02X, " % ( ( d >> ( k * 8 ) ) & 255 ) )
+			if code > 32 and code < 127 and chr( code ) != '\\':
+				file.write( "// '%c'\n" % code )
+			else:
+				file.write( "// U+%04X\n" % code )
+		file.write( "};\n" )
+		file.write( "\n" )
+		file.write( "const SANGRIA_FONT_T %s = {\n" % name )
+		file.write( "\t%d, %d, %d, _%s_code, _%s_width, _%s_bitmap,\n" % ( cell_width, cell_height, len( glyphs ), name, name, name ) )
+		file.write( "};\n" )
+
+	with open( "%s.h" % output_name, 'wt' ) as file:
+		file.write( "// --------------------------------------------------------------------\n" )
+		file.write( "//  Font data: [%s]\n" % re.sub( r'^.*/', r'', input_name ) )
+		file.write( "// --------------------------------------------------------------------\n" )
+		file.write( "\n" )
+		file.write( "#ifndef __%s_H__\n" % name.upper() )
+		file.write( "#define __%s_H__\n" % name.upper() )
+		file.write( "\n" )
+		file.write( "#include <sangria_text.h>\n" )
+		file.write( "\n" )
+		file.write( "extern const SANGRIA_FONT_T %s;\n" % name )
+		file.write( "#define p_%s (&%s)\n" % ( name, name ) )
+		file.write( "\n" )
+		file.write( "#endif // __%s_H__\n" % name.upper() )
+	print( "Success!! %d glyphs of %dx%d" % ( len( glyphs ), cell_width, cell_height ) )
+
 def usage():
 	print( "Usage> font_converter.py <image_file 768x8>" )
+	print( "Usage> font_converter.py -s [-p] [-g <W>x<H>] [-m <map.txt>] <image_file> <output>" )
+	print( "  -s ........ <output>.c and <output>.h of a SANGRIA_FONT_T are generated" )
+	print( "              for sangria_text.h of sangria_glib." )
+	print( "  -p ........ proportional font, the width of each glyph is its own." )
+	print( "  -g WxH .... size of a glyph (default 8x8, W is 32 or less)." )
+	print( "  -m file ... UTF-8 text of the characters of the glyphs in order." )
+	print( "              Without it, the glyphs are ' ' (U+0020) and after." )
 
 def main():
-	if len( sys.argv ) < 2:
+	args = sys.argv[1:]
+	is_sangria = False
+	is_proportional = False
+	cell_size = ( 8, 8 )
+	map_name = None
+	while len( args ) > 0 and args[0].startswith( '-' ):
+		if args[0] == '-s':
+			is_sangria = True
+		elif args[0] == '-p':
+			is_proportional = True
+		elif args[0] == '-g' and len( args ) > 1:
+			cell_size = tuple( int( n ) for n in args[1].split( 'x' ) )
+			args = args[1:]
+		elif args[0] == '-m' and len( args ) > 1:
+			map_name = args[1]
+			args = args[1:]
+		args = args[1:]
+	if len( args ) < 1 or ( is_sangria and len( args ) < 2 ):
 		usage()
 		exit()
-	output_name = re.sub( r'^.*/', r'', sys.argv[1] )
+	if is_sangria:
+		print( "Input  name: %s" % args[0] )
+		print( "Output name: %s" % args[1] )
+		convert_sangria( args[0], args[1], cell_size, map_name, is_proportional )
+		return
+	output_name = re.sub( r'^.*/', r'', args[0] )
 	output_name = re.sub( r'^(.*)\..*?$', r'\1', output_name )
-	print( "Input  name: %s" % sys.argv[1] )
+	print( "Input  name: %s" % args[0] )
 	print( "Output name: %s" % output_name )
-	convert( sys.argv[1], output_name )
+	convert( args[0], output_name )
 
 if __name__ == "__main__":
 	main()